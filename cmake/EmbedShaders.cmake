@@ -0,0 +1,50 @@
+# Packs compiled SPIR-V into a header of constexpr uint32_t arrays plus a name lookup table.
+# Invoked with cmake -DOUTPUT=<header> -DSPV_FILES=<a.spv,b.spv> -P EmbedShaders.cmake
+# The lookup name is the shader source file name, yuvRgba.comp.spv is embedded as yuvRgba.comp.
+
+if (NOT OUTPUT OR NOT SPV_FILES)
+    message(FATAL_ERROR "EmbedShaders.cmake needs OUTPUT and SPV_FILES")
+endif ()
+string(REPLACE "," ";" SPV_FILES "${SPV_FILES}")
+
+set(arrays "")
+set(table "")
+foreach (spv ${SPV_FILES})
+    get_filename_component(fileName ${spv} NAME)
+    string(REGEX REPLACE "\\.spv$" "" shaderName ${fileName})
+    string(MAKE_C_IDENTIFIER "${shaderName}" identifier)
+
+    file(READ ${spv} hex HEX)
+    string(LENGTH "${hex}" hexLength)
+    math(EXPR remainder "${hexLength} % 8")
+    if (hexLength EQUAL 0 OR NOT remainder EQUAL 0)
+        message(FATAL_ERROR "${spv} is not a SPIR-V binary")
+    endif ()
+    # SPIR-V is little endian words, the byte swap turns the file bytes into host order literals.
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])"
+            "0x\\4\\3\\2\\1," words "${hex}")
+    string(REPEAT "0x[0-9a-f]+," 8 eightWords)
+    string(REGEX REPLACE "(${eightWords})" "\\1\n            " words "${words}")
+    string(STRIP "${words}" words)
+
+    string(APPEND arrays "        constexpr uint32_t ${identifier}[] = {\n            ${words}\n        };\n\n")
+    string(APPEND table "            {\"${shaderName}\", ${identifier}, sizeof(${identifier}) / sizeof(uint32_t)},\n")
+endforeach ()
+
+set(content "//\n// Generated by cmake/EmbedShaders.cmake from the shaders directory, do not edit.\n//\n\n")
+string(APPEND content "#ifndef REALTIMEFRAMEDISPLAY_SHADERBUNDLE_H\n#define REALTIMEFRAMEDISPLAY_SHADERBUNDLE_H\n\n")
+string(APPEND content "#include <cstddef>\n#include <cstdint>\n\n")
+string(APPEND content "namespace fd {\n    struct EmbeddedShader {\n        const char *name;\n")
+string(APPEND content "        const uint32_t *code;\n        size_t wordCount;\n    };\n\n")
+string(APPEND content "    namespace shader_bundle {\n${arrays}")
+string(APPEND content "        constexpr EmbeddedShader SHADERS[] = {\n${table}        };\n    }\n}\n")
+string(APPEND content "#endif //REALTIMEFRAMEDISPLAY_SHADERBUNDLE_H\n")
+
+# Rewriting an unchanged header would rebuild every translation unit that includes Util.h.
+if (EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} previous)
+    if (previous STREQUAL content)
+        return()
+    endif ()
+endif ()
+file(WRITE ${OUTPUT} "${content}")
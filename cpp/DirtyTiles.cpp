@@ -0,0 +1,176 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include "DirtyTiles.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FD_TILES_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace fd {
+    namespace {
+        uint32_t row_sad(const uint8_t *a, const uint8_t *b, uint32_t count) {
+            uint32_t i = 0;
+            uint32_t sad = 0;
+#ifdef FD_TILES_SSE2
+            __m128i sum = _mm_setzero_si128();
+            for (; i + 16 <= count; i += 16) {
+                __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+                __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+                // Two partial sums, one per eight bytes, in the low words of each half.
+                sum = _mm_add_epi64(sum, _mm_sad_epu8(va, vb));
+            }
+            sad = static_cast<uint32_t>(_mm_cvtsi128_si32(sum)) +
+                  static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+#endif
+            for (; i < count; i++) {
+                sad += static_cast<uint32_t>(std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i])));
+            }
+            return sad;
+        }
+    }
+
+    DirtyTiles::DirtyTiles(uint32_t width, uint32_t height) : m_width{width}, m_height{height} {
+        m_columns = (m_width + TILE - 1) / TILE;
+        m_rows = (m_height + TILE - 1) / TILE;
+        const char *threshold = std::getenv("FD_DIRTY_TILE_SAD");
+        m_threshold = threshold != nullptr ? static_cast<uint32_t>(std::strtoul(threshold, nullptr, 10)) : 0;
+        size_t lumaSize = static_cast<size_t>(m_width) * m_height;
+        size_t chromaSize = static_cast<size_t>(m_width >> 1) * (m_height >> 1);
+        m_reference[0].resize(lumaSize);
+        m_reference[1].resize(chromaSize);
+        m_reference[2].resize(chromaSize);
+        m_age.assign(get_tile_count(), SETTLE_FRAMES);
+        LOG_INFO("Diffing {}x{} in {}x{} tiles of {} pixels", m_width, m_height, m_columns, m_rows, TILE);
+    }
+
+    bool DirtyTiles::is_requested() {
+        const char *tiles = std::getenv("FD_DIRTY_TILES");
+        return tiles != nullptr && std::strcmp(tiles, "1") == 0;
+    }
+
+    uint32_t DirtyTiles::tile_sad(uint32_t plane, const uint8_t *frame, uint32_t tileX, uint32_t tileY,
+                                  uint32_t limit) const {
+        uint32_t shift = plane == 0 ? 0 : 1;
+        uint32_t planeW = m_width >> shift;
+        uint32_t planeH = m_height >> shift;
+        uint32_t tile = TILE >> shift;
+        uint32_t x0 = tileX * tile;
+        uint32_t y0 = tileY * tile;
+        uint32_t w = (std::min)(tile, planeW - (std::min)(planeW, x0));
+        uint32_t h = (std::min)(tile, planeH - (std::min)(planeH, y0));
+        const uint8_t *reference = m_reference[plane].data();
+        uint32_t sad = 0;
+        for (uint32_t y = y0; y < y0 + h && sad <= limit; y++) {
+            size_t offset = static_cast<size_t>(y) * planeW + x0;
+            sad += row_sad(frame + offset, reference + offset, w);
+        }
+        return sad;
+    }
+
+    void DirtyTiles::take_tile(uint32_t plane, const uint8_t *frame, uint8_t *staging, uint32_t tileX,
+                               uint32_t tileY) {
+        uint32_t shift = plane == 0 ? 0 : 1;
+        uint32_t planeW = m_width >> shift;
+        uint32_t planeH = m_height >> shift;
+        uint32_t tile = TILE >> shift;
+        uint32_t x0 = tileX * tile;
+        uint32_t y0 = tileY * tile;
+        if (x0 >= planeW || y0 >= planeH) return;
+        uint32_t w = (std::min)(tile, planeW - x0);
+        uint32_t h = (std::min)(tile, planeH - y0);
+        for (uint32_t y = y0; y < y0 + h; y++) {
+            size_t offset = static_cast<size_t>(y) * planeW + x0;
+            memcpy(staging + offset, frame + offset, w);
+            memcpy(m_reference[plane].data() + offset, frame + offset, w);
+        }
+        VkBufferImageCopy region{};
+        region.bufferOffset = static_cast<VkDeviceSize>(y0) * planeW + x0;
+        region.bufferRowLength = planeW;
+        region.bufferImageHeight = planeH;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageOffset = {static_cast<int32_t>(x0), static_cast<int32_t>(y0), 0};
+        region.imageExtent = {w, h, 1};
+        m_regions[plane].push_back(region);
+        m_uploaded_bytes += static_cast<uint64_t>(w) * h;
+    }
+
+    uint32_t DirtyTiles::update(const uint8_t *const planes[3], uint8_t *const staging[3]) {
+        for (std::vector<VkBufferImageCopy> &regions: m_regions) {
+            regions.clear();
+        }
+        uint32_t changed = 0;
+        for (uint32_t tileY = 0; tileY < m_rows; tileY++) {
+            for (uint32_t tileX = 0; tileX < m_columns; tileX++) {
+                uint32_t index = tileY * m_columns + tileX;
+                bool dirty = !m_valid;
+                uint32_t sad = 0;
+                for (uint32_t plane = 0; plane < 3 && !dirty; plane++) {
+                    sad += tile_sad(plane, planes[plane], tileX, tileY, m_threshold - (std::min)(sad, m_threshold));
+                    dirty = sad > m_threshold;
+                }
+                if (!dirty) {
+                    if (m_age[index] < SETTLE_FRAMES) m_age[index]++;
+                    continue;
+                }
+                for (uint32_t plane = 0; plane < 3; plane++) {
+                    take_tile(plane, planes[plane], staging[plane], tileX, tileY);
+                }
+                m_age[index] = 0;
+                changed++;
+            }
+        }
+        if (changed == get_tile_count()) {
+            // One copy per plane instead of one per tile.
+            for (uint32_t plane = 0; plane < 3; plane++) {
+                uint32_t shift = plane == 0 ? 0 : 1;
+                VkBufferImageCopy region{};
+                region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+                region.imageExtent = {m_width >> shift, m_height >> shift, 1};
+                m_regions[plane].assign(1, region);
+            }
+        }
+        m_valid = true;
+        m_frames++;
+        m_frame_bytes += m_reference[0].size() + m_reference[1].size() + m_reference[2].size();
+        return changed;
+    }
+
+    bool DirtyTiles::converted_tiles(std::vector<VkRect2D> &rects) const {
+        rects.clear();
+        for (uint32_t tileY = 0; tileY < m_rows; tileY++) {
+            for (uint32_t tileX = 0; tileX < m_columns; tileX++) {
+                bool active = false;
+                for (uint32_t y = tileY > 0 ? tileY - 1 : 0; y <= (std::min)(tileY + 1, m_rows - 1) && !active; y++) {
+                    for (uint32_t x = tileX > 0 ? tileX - 1 : 0; x <= (std::min)(tileX + 1, m_columns - 1); x++) {
+                        if (m_age[y * m_columns + x] < SETTLE_FRAMES) {
+                            active = true;
+                            break;
+                        }
+                    }
+                }
+                if (!active) continue;
+                uint32_t x0 = tileX * TILE;
+                uint32_t y0 = tileY * TILE;
+                rects.push_back({{static_cast<int32_t>(x0), static_cast<int32_t>(y0)},
+                                 {(std::min)(TILE, m_width - x0), (std::min)(TILE, m_height - y0)}});
+            }
+        }
+        return rects.size() == get_tile_count();
+    }
+
+    double DirtyTiles::saved_fraction() const {
+        if (m_frame_bytes == 0) return 0.0;
+        return 1.0 - static_cast<double>(m_uploaded_bytes) / static_cast<double>(m_frame_bytes);
+    }
+
+    void DirtyTiles::log_stats() const {
+        LOG_INFO("Dirty tiles: {} frames, {:.1f} of {:.1f} MB uploaded, {:.1f}% of the upload bandwidth saved",
+                 m_frames, m_uploaded_bytes / (1024.0 * 1024.0), m_frame_bytes / (1024.0 * 1024.0),
+                 100.0 * saved_fraction());
+    }
+}
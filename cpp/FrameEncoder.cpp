@@ -0,0 +1,209 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <cmath>
+#include <cstdlib>
+#include "FrameEncoder.h"
+#include "GpuProfiler.h"
+
+namespace fd {
+    FrameEncoder::FrameEncoder(RenderContext *ctx, uint32_t width, uint32_t height, double frameDuration,
+                               std::string path) : m_ctx{ctx}, m_width{width}, m_height{height},
+                                                   m_frame_duration{frameDuration}, m_path{std::move(path)} {
+        m_start = std::chrono::steady_clock::now();
+        if (!open_output()) {
+            close_output();
+            return;
+        }
+        VkDeviceSize frameSize = static_cast<VkDeviceSize>(m_width) * m_height * sizeof(uint32_t);
+        m_readback = new ReadbackRing(m_ctx, frameSize, ReadbackRing::depth_from_env(RING_SLOTS), "encoder");
+        LOG_INFO("Transcoding {}x{} to {} with the {} encoder", m_codec_context->width, m_codec_context->height, m_path,
+                 m_codec_context->codec->name);
+    }
+
+    const char *FrameEncoder::requested_path() {
+        const char *path = std::getenv("FD_ENCODE");
+        return path != nullptr && *path != '\0' ? path : nullptr;
+    }
+
+    bool FrameEncoder::open_output() {
+        if (avformat_alloc_output_context2(&m_format_context, nullptr, nullptr, m_path.c_str()) < 0 ||
+            m_format_context == nullptr) {
+            LOG_ERROR("No output format for {}", m_path);
+            return false;
+        }
+        const char *codecName = std::getenv("FD_ENCODE_CODEC");
+        const AVCodec *codec = codecName != nullptr ? avcodec_find_encoder_by_name(codecName)
+                                                    : avcodec_find_encoder(m_format_context->oformat->video_codec);
+        if (codec == nullptr) {
+            LOG_ERROR("No video encoder {} for {}", codecName != nullptr ? codecName : "", m_path);
+            return false;
+        }
+        m_codec_context = avcodec_alloc_context3(codec);
+        const void *formats = nullptr;
+        int formatCount = 0;
+        avcodec_get_supported_config(m_codec_context, nullptr, AV_CODEC_CONFIG_PIX_FORMAT, 0, &formats, &formatCount);
+        // No list means the encoder takes any format.
+        bool takesYuv420 = formats == nullptr;
+        for (int i = 0; i < formatCount; i++) {
+            if (static_cast<const AVPixelFormat *>(formats)[i] == AV_PIX_FMT_YUV420P) takesYuv420 = true;
+        }
+        if (!takesYuv420) {
+            LOG_ERROR("The {} encoder does not take yuv420p", codec->name);
+            return false;
+        }
+        // Subsampled chroma needs even sizes, an odd last row or column is cropped.
+        m_codec_context->width = static_cast<int>(m_width & ~1u);
+        m_codec_context->height = static_cast<int>(m_height & ~1u);
+        m_codec_context->pix_fmt = AV_PIX_FMT_YUV420P;
+        m_codec_context->time_base = av_d2q(m_frame_duration, 65535);
+        m_codec_context->framerate = av_inv_q(m_codec_context->time_base);
+        // A tenth of a bit per pixel, encoders that rate control on their own ignore it.
+        m_codec_context->bit_rate = static_cast<int64_t>(0.1 * m_codec_context->width * m_codec_context->height /
+                                                         m_frame_duration);
+        m_codec_context->thread_count = 0;
+        if (m_format_context->oformat->flags & AVFMT_GLOBALHEADER) {
+            m_codec_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        }
+        if (avcodec_open2(m_codec_context, codec, nullptr) < 0) {
+            LOG_ERROR("Failed to open the {} encoder", codec->name);
+            return false;
+        }
+        m_stream = avformat_new_stream(m_format_context, nullptr);
+        m_stream->time_base = m_codec_context->time_base;
+        avcodec_parameters_from_context(m_stream->codecpar, m_codec_context);
+        if (!(m_format_context->oformat->flags & AVFMT_NOFILE) &&
+            avio_open(&m_format_context->pb, m_path.c_str(), AVIO_FLAG_WRITE) < 0) {
+            LOG_ERROR("Failed to open {} for writing", m_path);
+            return false;
+        }
+        if (avformat_write_header(m_format_context, nullptr) < 0) {
+            LOG_ERROR("Failed to write the header of {}", m_path);
+            return false;
+        }
+        m_header_written = true;
+        m_frame = av_frame_alloc();
+        m_frame->format = AV_PIX_FMT_YUV420P;
+        m_frame->width = m_codec_context->width;
+        m_frame->height = m_codec_context->height;
+        av_frame_get_buffer(m_frame, 0);
+        m_packet = av_packet_alloc();
+        return true;
+    }
+
+    void FrameEncoder::record_readback(VkCommandBuffer commandBuffer, VkImage image, double ptsSeconds) {
+        if (m_finished) return;
+        ReadbackRegion region{image, m_width, m_height, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                              VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT};
+        uint32_t profileScope = gpu_profile_begin(m_ctx, commandBuffer, GpuStage::COPY, m_ctx->graphicsQueueIndex);
+        m_readback->record(commandBuffer, m_frame_index++, region,
+                           [this, ptsSeconds](uint64_t, const uint8_t *data, VkDeviceSize) -> void {
+                               encode_readback(data, ptsSeconds);
+                           }, true);
+        gpu_profile_end(m_ctx, commandBuffer, profileScope);
+    }
+
+    void FrameEncoder::on_submitted(VkFence fence) {
+        m_readback->on_submitted(fence);
+    }
+
+    void FrameEncoder::encode_readback(const uint8_t *rgba, double ptsSeconds) {
+        TRACE_SCOPE("encode frame");
+        ScopedMsTimer timer{m_encode_ms};
+        convert_to_yuv420(rgba);
+        // Frame pts in the codec time base, kept increasing should the source timestamps jump back.
+        int64_t pts = std::llround(ptsSeconds * m_codec_context->time_base.den / m_codec_context->time_base.num);
+        if (pts <= m_last_pts) pts = m_last_pts + 1;
+        m_last_pts = pts;
+        m_frame->pts = pts;
+        if (encode(m_frame)) m_frames_encoded++;
+    }
+
+    void FrameEncoder::convert_to_yuv420(const uint8_t *rgba) {
+        // The encoder may still hold a reference to the last frame's buffers.
+        av_frame_make_writable(m_frame);
+        auto width = static_cast<uint32_t>(m_frame->width);
+        auto height = static_cast<uint32_t>(m_frame->height);
+        size_t stride = static_cast<size_t>(m_width) * 4;
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *row = rgba + y * stride;
+            uint8_t *yRow = m_frame->data[0] + y * m_frame->linesize[0];
+            for (uint32_t x = 0; x < width; x++) {
+                int R = row[x * 4];
+                int G = row[x * 4 + 1];
+                int B = row[x * 4 + 2];
+                yRow[x] = static_cast<uint8_t>(((66 * R + 129 * G + 25 * B + 128) >> 8) + 16);
+            }
+        }
+        for (uint32_t y = 0; y < height / 2; y++) {
+            const uint8_t *top = rgba + 2 * y * stride;
+            const uint8_t *bottom = top + stride;
+            uint8_t *uRow = m_frame->data[1] + y * m_frame->linesize[1];
+            uint8_t *vRow = m_frame->data[2] + y * m_frame->linesize[2];
+            for (uint32_t x = 0; x < width / 2; x++) {
+                size_t left = x * 8;
+                size_t right = left + 4;
+                int R = (top[left] + top[right] + bottom[left] + bottom[right] + 2) >> 2;
+                int G = (top[left + 1] + top[right + 1] + bottom[left + 1] + bottom[right + 1] + 2) >> 2;
+                int B = (top[left + 2] + top[right + 2] + bottom[left + 2] + bottom[right + 2] + 2) >> 2;
+                uRow[x] = static_cast<uint8_t>(((-38 * R - 74 * G + 112 * B + 128) >> 8) + 128);
+                vRow[x] = static_cast<uint8_t>(((112 * R - 94 * G - 18 * B + 128) >> 8) + 128);
+            }
+        }
+    }
+
+    // A null frame drains the encoder.
+    bool FrameEncoder::encode(AVFrame *frame) {
+        if (avcodec_send_frame(m_codec_context, frame) < 0) {
+            LOG_WARN_EVERY_MS(1000, "The encoder rejected a frame for {}", m_path);
+            return false;
+        }
+        while (avcodec_receive_packet(m_codec_context, m_packet) == 0) {
+            av_packet_rescale_ts(m_packet, m_codec_context->time_base, m_stream->time_base);
+            m_packet->stream_index = m_stream->index;
+            if (av_interleaved_write_frame(m_format_context, m_packet) < 0) {
+                LOG_WARN_EVERY_MS(1000, "Failed to write a packet to {}", m_path);
+            }
+        }
+        return true;
+    }
+
+    void FrameEncoder::finish() {
+        if (m_finished || !m_header_written) return;
+        m_finished = true;
+        m_readback->flush();
+        encode(nullptr);
+        close_output();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+        LOG_INFO("Transcoded {} frames to {} in {:.2f} s, {:.1f} fps end to end, {:.2f} ms per frame on the encoder "
+                 "thread", m_frames_encoded, m_path, seconds,
+                 seconds > 0.0 ? static_cast<double>(m_frames_encoded) / seconds : 0.0,
+                 m_frames_encoded > 0 ? m_encode_ms / static_cast<double>(m_frames_encoded) : 0.0);
+    }
+
+    void FrameEncoder::close_output() {
+        if (m_header_written) {
+            av_write_trailer(m_format_context);
+            m_header_written = false;
+        }
+        if (m_format_context != nullptr) {
+            if (!(m_format_context->oformat->flags & AVFMT_NOFILE)) {
+                avio_closep(&m_format_context->pb);
+            }
+            avformat_free_context(m_format_context);
+            m_format_context = nullptr;
+        }
+        avcodec_free_context(&m_codec_context);
+        av_frame_free(&m_frame);
+        av_packet_free(&m_packet);
+    }
+
+    void FrameEncoder::clean_up() {
+        finish();
+        if (m_readback != nullptr) {
+            m_readback->clean_up();
+            delete m_readback;
+            m_readback = nullptr;
+        }
+    }
+}
@@ -2,79 +2,180 @@
 // Created by ghima on 13-01-2026.
 //
 #include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
 #include "FrameGeneratorTwo.h"
 #include "Util.h"
-#include <windows.h>
-#include <mmdeviceapi.h>
-#include <uuids.h>
+#include "audio/AudioConverter.h"
+#include "GpuFrameCache.h"
+#include "VulkanHwDecode.h"
 
 
 namespace fd {
-    void FrameGeneratorTwo::start_demuxer_thread(const char *videoPath) {
-        std::thread demuxer{[this, videoPath]() -> void {
+    void FrameGeneratorTwo::open(const char *videoPath, bool openVideoCodec) {
+        TRACE_SCOPE("open stream");
+        std::chrono::time_point<std::chrono::steady_clock> openStart = std::chrono::steady_clock::now();
+        m_media_path = videoPath;
+        if (avformat_open_input(&m_av_Context, videoPath, nullptr, nullptr) < 0) {
+            std::cout << "failed to load the video from the context" << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        if (avformat_find_stream_info(m_av_Context, nullptr) < 0) {
+            std::cout << "Failed to load the stream info" << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < m_av_Context->nb_streams; i++) {
+            if (m_av_Context->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+                _mutex_vid.lock();
+                videoIndex = i;
+                _mutex_vid.unlock();
 
-            if (avformat_open_input(&m_av_Context, videoPath, nullptr, nullptr) < 0) {
-                std::cout << "failed to load the video from the context" << std::endl;
-                std::exit(EXIT_FAILURE);
+            } else if (m_av_Context->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
+                _mutex_aud.lock();
+                audioIndex = i;
+                _mutex_aud.unlock();
             }
-            if (avformat_find_stream_info(m_av_Context, nullptr) < 0) {
-                std::cout << "Failed to load the stream info" << std::endl;
-                std::exit(EXIT_FAILURE);
+        }
+        {
+            std::lock_guard<std::mutex> lockVid{_mutex_vid};
+            std::lock_guard<std::mutex> lockAud{_mutex_aud};
+            m_streams_found = true;
+        }
+        m_cv_aud.notify_all();
+        m_cv_vid.notify_all();
+        if (videoIndex != -1) {
+            AVStream *videoStream = m_av_Context->streams[videoIndex];
+            m_timebase = av_q2d(videoStream->time_base);
+            AVRational frameRate = videoStream->avg_frame_rate;
+            if (frameRate.num > 0 && frameRate.den > 0) {
+                m_frame_duration = 1.0 / av_q2d(frameRate);
             }
-            for (int i = 0; i < m_av_Context->nb_streams; i++) {
-                if (m_av_Context->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-                    _mutex_vid.lock();
-                    videoIndex = i;
-                    _mutex_vid.unlock();
-
-                } else if (m_av_Context->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
-                    _mutex_aud.lock();
-                    audioIndex = i;
-                    _mutex_aud.unlock();
-                }
+            // The decoder overwrites these with the size of every frame it queues.
+            std::lock_guard<std::mutex> lock{_mutex_vid};
+            m_width = videoStream->codecpar->width;
+            m_height = videoStream->codecpar->height;
+        }
+        if (openVideoCodec) {
+            open_video_codec();
+        }
+        if (audioIndex != -1) {
+            AVCodecParameters *audioCodecParams = m_av_Context->streams[audioIndex]->codecpar;
+            m_audio_timebase = av_q2d(m_av_Context->streams[audioIndex]->time_base);
+            const AVCodec *audioDecoder = avcodec_find_decoder(audioCodecParams->codec_id);
+            m_aud_codec_context = avcodec_alloc_context3(audioDecoder);
+            avcodec_parameters_to_context(m_aud_codec_context, audioCodecParams);
+            if (avcodec_open2(m_aud_codec_context, audioDecoder, nullptr) >= 0) {
+                m_aud_decoder_ready = true;
             }
-            m_cv_aud.notify_all();
-            m_cv_vid.notify_all();
-            // Setting up the codecs
-            bool vidDecoderReady = false;
-            bool audioDecoderReady = false;
-            AVCodecContext *vidCodecContext = nullptr;
-            AVCodecContext *audioContext = nullptr;
-            if (videoIndex != -1) {
-                AVCodecParameters *videoCodecParams = m_av_Context->streams[videoIndex]->codecpar;
-                AVRational timebase = m_av_Context->streams[videoIndex]->time_base;
-                m_timebase = av_q2d(timebase);
-                const AVCodec *vidDecoder = avcodec_find_decoder(videoCodecParams->codec_id);
-                vidCodecContext = avcodec_alloc_context3(vidDecoder);
-                avcodec_parameters_to_context(vidCodecContext, videoCodecParams);
-                if (avcodec_open2(vidCodecContext, vidDecoder, nullptr) >= 0) {
-                    vidDecoderReady = true;
-                }
+        }
+        // FD_CLOCK picks the master, without a decodable audio stream there is no audio clock to follow.
+        ClockSource clockSource = MasterClock::parse_source(std::getenv("FD_CLOCK"));
+        if (clockSource == ClockSource::AUDIO && !m_aud_decoder_ready) {
+            LOG_INFO("{} has no audio, its video follows the external clock", m_media_path);
+            clockSource = ClockSource::EXTERNAL;
+        }
+        m_clock.set_source(clockSource);
+        LOG_INFO("Opened {} ({}x{}) in {:.2f} ms", m_media_path, m_width, m_height,
+                 std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - openStart).count());
+    }
+
+    void FrameGeneratorTwo::open_video_codec() {
+        if (videoIndex == -1 || m_vid_codec_context != nullptr) return;
+        AVCodecParameters *videoCodecParams = m_av_Context->streams[videoIndex]->codecpar;
+        const AVCodec *vidDecoder = avcodec_find_decoder(videoCodecParams->codec_id);
+        m_vid_codec_context = avcodec_alloc_context3(vidDecoder);
+        avcodec_parameters_to_context(m_vid_codec_context, videoCodecParams);
+        if (m_hw_device != nullptr) {
+            VulkanHwDecode::attach(m_vid_codec_context, m_hw_device);
+        }
+        if (avcodec_open2(m_vid_codec_context, vidDecoder, nullptr) >= 0) {
+            m_vid_decoder_ready = true;
+        }
+    }
+
+    bool FrameGeneratorTwo::send_packet(AVCodecContext *codecContext, const AVPacket *packet) {
+        TRACE_SCOPE("avcodec_send_packet");
+        return avcodec_send_packet(codecContext, packet) == 0;
+    }
+
+    bool FrameGeneratorTwo::receive_frame(AVCodecContext *codecContext, AVFrame *frame) {
+        TRACE_SCOPE("avcodec_receive_frame");
+        return avcodec_receive_frame(codecContext, frame) == 0;
+    }
+
+    void FrameGeneratorTwo::start_demuxer_thread(const char *videoPath) {
+        m_demuxer_thread = std::thread{[this, videoPath]() -> void {
+            Trace::set_thread_name("demuxer " + std::string{videoPath});
+            // Opened here unless the renderer already probed the file beside its own setup.
+            if (m_av_Context == nullptr) {
+                open(videoPath);
             }
-            if (audioIndex != -1) {
-                AVCodecParameters *audioCodecParams = m_av_Context->streams[audioIndex]->codecpar;
-                const AVCodec *audioDecoder = avcodec_find_decoder(audioCodecParams->codec_id);
-                audioContext = avcodec_alloc_context3(audioDecoder);
-                avcodec_parameters_to_context(audioContext, audioCodecParams);
-                if (avcodec_open2(audioContext, audioDecoder, nullptr) >= 0) {
-                    audioDecoderReady = true;
-                }
+            open_video_codec();
+            bool vidDecoderReady = m_vid_decoder_ready;
+            bool audioDecoderReady = m_aud_decoder_ready;
+            AVCodecContext *&vidCodecContext = m_vid_codec_context;
+            AVCodecContext *&audioContext = m_aud_codec_context;
+            // Without a container index the file is scanned beside playback, a seek before that finishes falls back
+            // to the demuxer's own search.
+            if (videoIndex != -1 && !m_keyframe_index.load_from_container(m_av_Context->streams[videoIndex])) {
+                m_index_thread = std::thread{[this]() -> void {
+                    m_keyframe_index.load_from_file(m_media_path, videoIndex);
+                }};
             }
             AVPacket *packet = av_packet_alloc();
             AVFrame *frame = av_frame_alloc();
             AVFrame *frameAud = av_frame_alloc();
 
-            while (av_read_frame(m_av_Context, packet) >= 0) {
-                if (vidStop) break;
+            bool videoDrained = false;
+            while (!vidStop) {
+                if (m_seek_requested) {
+                    perform_seek();
+                    videoDrained = false;
+                }
+                int readResult = 0;
+                {
+                    TRACE_SCOPE("av_read_frame");
+                    readResult = av_read_frame(m_av_Context, packet);
+                }
+                if (readResult < 0 && !videoDrained) {
+                    // End of file, an empty packet drains the frames the video decoder still holds back.
+                    videoDrained = true;
+                    av_packet_unref(packet);
+                    packet->stream_index = videoIndex;
+                } else if (readResult < 0) {
+                    {
+                        std::lock_guard<std::mutex> lockVid{_mutex_vid};
+                        std::lock_guard<std::mutex> lockAud{_mutex_aud};
+                        m_demux_finished = true;
+                    }
+                    m_cv_vid.notify_all();
+                    m_cv_aud.notify_all();
+                    // The last frame stays on screen until a seek or shutdown.
+                    std::unique_lock<std::mutex> lock{_mutex_vid};
+                    m_cv_vid.wait(lock, [this]() -> bool { return vidStop || m_seek_requested; });
+                    continue;
+                }
                 if (packet->stream_index == videoIndex && vidDecoderReady) {
-                    if (avcodec_send_packet(vidCodecContext, packet) == 0) {
-                        while (avcodec_receive_frame(vidCodecContext, frame) == 0) {
+                    if (send_packet(vidCodecContext, packet)) {
+                        while (receive_frame(vidCodecContext, frame)) {
+                            // Decode to target, frames ending before the seek target never leave the demuxer.
+                            double framePts = frame->pts != AV_NOPTS_VALUE ? frame->pts * m_timebase : 0.0;
+                            if (framePts + m_frame_duration <= m_seek_target_seconds) {
+                                av_frame_unref(frame);
+                                continue;
+                            }
                             {
+                                TRACE_SCOPE("wait video queue space");
                                 std::unique_lock<std::mutex> lock{_mutex_vid};
                                 m_cv_vid.wait(lock, [this]() -> bool {
-                                    return m_vid_frame_queue.size() <= MAX_FRAMES;
+                                    return m_vid_frame_queue.size() <= MAX_FRAMES || m_seek_requested || vidStop;
                                 });
                             }
+                            if (m_seek_requested || vidStop) {
+                                av_frame_unref(frame);
+                                break;
+                            }
                             AVFrame *clone = av_frame_clone(frame);
                             std::unique_ptr<AVFrame, void (*)(AVFrame *)> framePtr(clone,
                                                                                    &FrameGeneratorTwo::free_clone_frame);
@@ -87,14 +188,28 @@ namespace fd {
                     }
                 }
                 if (packet->stream_index == audioIndex && audioDecoderReady) {
-                    if (avcodec_send_packet(audioContext, packet) == 0) {
-                        while (avcodec_receive_frame(audioContext, frameAud) == 0) {
+                    if (send_packet(audioContext, packet)) {
+                        while (receive_frame(audioContext, frameAud)) {
+                            double framePts = frameAud->pts != AV_NOPTS_VALUE ? frameAud->pts * m_audio_timebase : 0.0;
+                            double frameSeconds = frameAud->sample_rate > 0 ?
+                                                  static_cast<double>(frameAud->nb_samples) / frameAud->sample_rate
+                                                                            : 0.0;
+                            if (framePts + frameSeconds <= m_seek_target_seconds) {
+                                av_frame_unref(frameAud);
+                                continue;
+                            }
                             {
+                                TRACE_SCOPE("wait audio queue space");
                                 std::unique_lock<std::mutex> lock{_mutex_aud};
                                 m_cv_aud.wait(lock, [this]() -> bool {
-                                    return m_aud_decoded_frame_queue.size() <= MAX_FRAMES;
+                                    return m_aud_decoded_frame_queue.size() <= MAX_FRAMES || m_seek_requested ||
+                                           vidStop;
                                 });
                             }
+                            if (m_seek_requested || vidStop) {
+                                av_frame_unref(frameAud);
+                                break;
+                            }
                             AVFrame *clone = av_frame_clone(frameAud);
                             std::unique_ptr<AVFrame, void (*)(AVFrame *)> framePtr(clone,
                                                                                    &FrameGeneratorTwo::free_clone_frame);
@@ -108,36 +223,71 @@ namespace fd {
                 }
                 av_packet_unref(packet);
             }
-            _mutex_vid.lock();
-            vidStop = true;
-            _mutex_vid.unlock();
+            av_frame_free(&frame);
+            av_frame_free(&frameAud);
+            av_packet_free(&packet);
         }};
-        demuxer.detach();
     }
 
     void FrameGeneratorTwo::start_video_decoder_thread() {
-        std::thread videoDecoder{[this]() -> void {
+        m_video_decoder_thread = std::thread{[this]() -> void {
             {
                 std::unique_lock<std::mutex> lock{_mutex_vid};
-                m_cv_vid.wait(lock, [this]() -> bool { return videoIndex != -1; });
+                m_cv_vid.wait(lock, [this]() -> bool { return m_streams_found || vidStop; });
+                if (vidStop || videoIndex == -1) return;
             }
             LOG_INFO("Starting the video decoder");
+            Trace::set_thread_name("video decoder " + m_media_path);
             while (true) {
                 {
+                    TRACE_SCOPE("wait decoded video");
                     std::unique_lock<std::mutex> lock{_mutex_vid};
                     m_cv_vid.wait(lock, [this]() -> bool {
-                        return vidStop || !m_vid_decoded_frame_queue.empty();
+                        return vidStop || !m_vid_decoded_frame_queue.empty() ||
+                               (m_demux_finished && !m_video_finished);
                     });
                 }
-                if (vidStop || m_vid_decoded_frame_queue.empty()) break;
+                if (vidStop) break;
+                _mutex_vid.lock();
+                if (m_vid_decoded_frame_queue.empty()) {
+                    // A seek flushed the queue between the wake up and here, or every frame of the file is queued.
+                    if (m_demux_finished) m_video_finished = true;
+                    _mutex_vid.unlock();
+                    m_cv_vid.notify_all();
+                    continue;
+                }
                 std::unique_ptr<AVFrame, void (*)(AVFrame *)> framePtr = std::move(m_vid_decoded_frame_queue.front());
                 m_vid_decoded_frame_queue.pop();
+                uint32_t frameGeneration = m_seek_generation;
+                _mutex_vid.unlock();
                 double pts = 0;
                 if (framePtr->pts != AV_NOPTS_VALUE) {
                     pts = (double) framePtr->pts * m_timebase;
                 }
                 int width = framePtr->width;
                 int height = framePtr->height;
+                GpuFrameCache *frameCache = m_frame_cache;
+                // A frame the GPU cache already holds travels without planes, its pinned entry is shown instead.
+                std::shared_ptr<void> cachePin{};
+                if (frameCache != nullptr) cachePin = frameCache->pin(m_cache_stream_id, pts);
+                if (framePtr->format == AV_PIX_FMT_VULKAN) {
+                    // The decoded image is handed over as is, the converter copies its planes on the GPU.
+                    std::shared_ptr<AVFrame> hwFrame{};
+                    if (!cachePin) {
+                        hwFrame = std::shared_ptr<AVFrame>(framePtr.release(), &FrameGeneratorTwo::free_clone_frame);
+                    }
+                    std::lock_guard<std::mutex> lock{_mutex_vid};
+                    if (frameGeneration != m_seek_generation) continue;
+                    if (!m_isVidGeneratorReady) {
+                        m_isVidGeneratorReady = true;
+                        m_clock.start_external(pts);
+                    }
+                    m_width = width;
+                    m_height = height;
+                    VideoFrame videoFrame{nullptr, nullptr, nullptr, pts, std::move(hwFrame), std::move(cachePin)};
+                    m_vid_frame_queue.push(std::move(videoFrame));
+                    continue;
+                }
                 uint8_t *yPlane = framePtr->data[0];
                 uint8_t *uPlane = framePtr->data[1];
                 uint8_t *vPlane = framePtr->data[2];
@@ -147,80 +297,139 @@ namespace fd {
 
                 int chromaW = width >> 1;
                 int chromaH = height >> 1;
-                std::unique_ptr<uint8_t[]> yPlanePtr = std::make_unique<uint8_t[]>(width * height);
-                std::unique_ptr<uint8_t[]> uPlanePtr = std::make_unique<uint8_t[]>(chromaW * chromaH);
-                std::unique_ptr<uint8_t[]> vPlanePtr = std::make_unique<uint8_t[]>(chromaW * chromaH);
+                std::unique_ptr<uint8_t[]> yPlanePtr{};
+                std::unique_ptr<uint8_t[]> uPlanePtr{};
+                std::unique_ptr<uint8_t[]> vPlanePtr{};
+                if (!cachePin) {
+                    TRACE_SCOPE("plane copy");
+                    yPlanePtr = std::make_unique<uint8_t[]>(width * height);
+                    uPlanePtr = std::make_unique<uint8_t[]>(chromaW * chromaH);
+                    vPlanePtr = std::make_unique<uint8_t[]>(chromaW * chromaH);
 
-                for (int y = 0; y < height; y++) {
-                    memcpy(&yPlanePtr[y * width], &yPlane[y * yStride], width);
-                }
-                for (int y = 0; y < chromaH; y++) {
-                    memcpy(&uPlanePtr[y * chromaW], &uPlane[y * uStride], chromaW);
-                    memcpy(&vPlanePtr[y * chromaW], &vPlane[y * vStride], chromaW);
+                    for (int y = 0; y < height; y++) {
+                        memcpy(&yPlanePtr[y * width], &yPlane[y * yStride], width);
+                    }
+                    for (int y = 0; y < chromaH; y++) {
+                        memcpy(&uPlanePtr[y * chromaW], &uPlane[y * uStride], chromaW);
+                        memcpy(&vPlanePtr[y * chromaW], &vPlane[y * vStride], chromaW);
+                    }
                 }
                 {
                     std::lock_guard<std::mutex> lock{_mutex_vid};
+                    if (frameGeneration != m_seek_generation) continue;
                     if (!m_isVidGeneratorReady) {
                         m_isVidGeneratorReady = true;
-                        frame_start = std::chrono::steady_clock::now();
+                        m_clock.start_external(pts);
                     }
                     m_width = width;
                     m_height = height;
-                    VideoFrame videoFrame{std::move(yPlanePtr), std::move(uPlanePtr), std::move(vPlanePtr), pts};
+                    VideoFrame videoFrame{std::move(yPlanePtr), std::move(uPlanePtr), std::move(vPlanePtr), pts, {},
+                                          std::move(cachePin)};
                     m_vid_frame_queue.push(std::move(videoFrame));
                 }
             }
         }};
-        videoDecoder.detach();
     }
 
     void FrameGeneratorTwo::start_audio_decoder_thread() {
-        std::thread audioDecoder{[this]() -> void {
-            setup_audio_listener_win();
+        m_audio_decoder_thread = std::thread{[this]() -> void {
+            AudioFormat preferred{};
             {
                 std::unique_lock<std::mutex> lock{_mutex_aud};
-                m_cv_aud.wait(lock,
-                              [this]() -> bool { return audioIndex != -1; });
+                m_cv_aud.wait(lock, [this]() -> bool { return m_streams_found || vidStop; });
+                // A file without audio never opens a sink, the clock falls back to its own source.
+                if (vidStop || audioIndex == -1) return;
+                // The device is asked for the stream rate, the converter covers whatever it settles on.
+                int streamRate = m_av_Context->streams[audioIndex]->codecpar->sample_rate;
+                if (streamRate > 0) {
+                    preferred.sampleRate = streamRate;
+                }
             }
+            if (!open_audio_sink(preferred)) return;
+            AudioConverter converter{m_audio_sink->get_format()};
             LOG_INFO("Starting the audio frame");
+            Trace::set_thread_name("audio decoder " + m_media_path);
+            bool audioClockStarted = false;
+            uint32_t audioGeneration = m_seek_generation;
+            uint64_t totalFramesWritten = 0;
+            std::chrono::time_point<std::chrono::steady_clock> audioStart = std::chrono::steady_clock::now();
+            // The end of the file was played out and the sink stopped, only a seek starts it again.
+            bool audioFinished = false;
             while (true) {
                 {
+                    TRACE_SCOPE("wait decoded audio");
                     std::unique_lock<std::mutex> lock{_mutex_aud};
-                    m_cv_aud.wait(lock, [this]() -> bool { return vidStop || !m_aud_decoded_frame_queue.empty(); });
+                    m_cv_aud.wait(lock, [this, &audioFinished]() -> bool {
+                        return vidStop || !m_aud_decoded_frame_queue.empty() || (m_demux_finished && !audioFinished);
+                    });
                 }
-                if (vidStop || m_aud_decoded_frame_queue.empty()) break;
+                if (vidStop) break;
                 _mutex_aud.lock();
+                if (m_aud_decoded_frame_queue.empty()) {
+                    bool demuxFinished = m_demux_finished;
+                    _mutex_aud.unlock();
+                    if (demuxFinished && !audioFinished) {
+                        // End of stream, the ring and then the device buffer play out before the sink stops.
+                        while (!vidStop && !m_seek_requested && m_pcm_ring->readable_frames() > 0) {
+                            m_pcm_ring->wait_for_space(m_pcm_ring->capacity(), std::chrono::milliseconds(20));
+                        }
+                        const AudioFormat &format = m_audio_sink->get_format();
+                        auto bufferMs = static_cast<int64_t>(1000.0 * m_audio_sink->buffer_frames() /
+                                                             format.sampleRate);
+                        std::unique_lock<std::mutex> lock{_mutex_aud};
+                        m_cv_aud.wait_for(lock, std::chrono::milliseconds(bufferMs),
+                                          [this]() -> bool { return vidStop || m_seek_requested; });
+                        lock.unlock();
+                        m_audio_sink->stop();
+                        audioFinished = true;
+                        LOG_INFO("Audio reached the end of the stream");
+                    }
+                    continue;
+                }
+                audioFinished = false;
                 std::unique_ptr<AVFrame, void (*)(AVFrame *)> framePtr = std::move(m_aud_decoded_frame_queue.front());
                 m_aud_decoded_frame_queue.pop();
+                uint32_t frameGeneration = m_seek_generation;
                 _mutex_aud.unlock();
                 m_cv_aud.notify_one();
-                const char *fmtName = av_get_sample_fmt_name(static_cast<AVSampleFormat>(framePtr->format));
-                LOG_INFO("Audio Frame number samples {}, sampleRate {}, channel Count {}, format {}",
-                         framePtr->nb_samples,
-                         framePtr->sample_rate, framePtr->ch_layout.nb_channels, fmtName);
-                // Preparing the AUDIO PCM
-                std::unique_ptr<int16_t[]> interleavedSamples = std::make_unique<int16_t[]>(framePtr->nb_samples * 2);
-                float *lChannel = reinterpret_cast<float *>(framePtr->data[0]);
-                float *rChannel = reinterpret_cast<float *>(framePtr->data[1]);
-                for (int i = 0; i < framePtr->nb_samples; i++) {
-                    interleavedSamples[2 * i + 0] = static_cast<int16_t >(clamp_float_audio(lChannel[i]) * 32767);
-                    interleavedSamples[2 * i + 1] = static_cast<int16_t >(clamp_float_audio(rChannel[i]) * 32767);
+                if (frameGeneration != audioGeneration) {
+                    // First frame after a seek, whatever the ring still holds belongs to the old position.
+                    m_audio_sink->stop();
+                    m_pcm_ring->clear();
+                    start_audio_sink();
+                    audioGeneration = frameGeneration;
+                    audioClockStarted = false;
                 }
-                AudioPCM pcm{std::move(interleavedSamples), framePtr->ch_layout.nb_channels, framePtr->nb_samples, 1};
+                // Conversion happens in the converter's own buffers, nothing is allocated per frame.
+                uint32_t totalFrames = 0;
+                const int16_t *samples = converter.convert(framePtr.get(), totalFrames);
+                uint32_t channels = m_audio_sink->get_format().channels;
 
-                // Writing the audio frames 4 bytes to the audio buffer;
-                UINT32 padding = 0;
-                m_audioClient->GetCurrentPadding(&padding);
-                UINT32 frameAvailable = bufferFrameCount - padding;
-                UINT32 framesToWrite = frameAvailable > framePtr->nb_samples ? framePtr->nb_samples : frameAvailable;
-                BYTE *data = nullptr;
-                m_audio_render_client->GetBuffer(framesToWrite, &data);
-                memcpy(data, pcm.samples.get(), framesToWrite * 4);
-                m_audio_render_client->ReleaseBuffer(framesToWrite, 0);
-                m_audio_clock += (double)framesToWrite / framePtr->nb_samples;
+                if (!audioClockStarted) {
+                    double startPts = framePtr->pts != AV_NOPTS_VALUE ? framePtr->pts * m_audio_timebase : 0.0;
+                    m_clock.start_audio(startPts, m_audio_sink->get_format().sampleRate);
+                    audioClockStarted = true;
+                }
+
+                // The ring never drops samples, a full ring parks this thread until the device thread drains it.
+                uint32_t framesWritten = 0;
+                while (framesWritten < totalFrames && !vidStop && frameGeneration == m_seek_generation) {
+                    framesWritten += m_pcm_ring->write(samples + framesWritten * channels, totalFrames - framesWritten);
+                    if (framesWritten < totalFrames) {
+                        TRACE_SCOPE("wait pcm ring space");
+                        m_pcm_ring->wait_for_space((std::min)(totalFrames - framesWritten, m_pcm_ring->capacity()),
+                                                   std::chrono::milliseconds(20));
+                    }
+                }
+                totalFramesWritten += framesWritten;
             }
+            m_audio_sink->stop();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - audioStart).count();
+            double audioSeconds = static_cast<double>(totalFramesWritten) / m_audio_sink->get_format().sampleRate;
+            LOG_INFO("Audio thread wrote {} frames ({:.2f} s of audio) in {:.2f} s through the {} sink, {} underruns",
+                     totalFramesWritten, audioSeconds, seconds, m_audio_sink->name(), m_audio_sink->get_underruns());
+            m_audio_sink->close();
         }};
-        audioDecoder.detach();
     }
 
     void FrameGeneratorTwo::process(const char *videoPath) {
@@ -229,44 +438,108 @@ namespace fd {
         start_demuxer_thread(videoPath);
     }
 
-    FrameGeneratorTwo::~FrameGeneratorTwo() {
-        vidStop = true;
+    void FrameGeneratorTwo::seek(double seconds) {
+        {
+            std::lock_guard<std::mutex> lockVid{_mutex_vid};
+            std::lock_guard<std::mutex> lockAud{_mutex_aud};
+            m_seek_request_seconds = seconds < 0.0 ? 0.0 : seconds;
+            m_seek_requested = true;
+        }
+        // The demuxer may be parked on either queue or at the end of the file.
+        m_cv_vid.notify_all();
+        m_cv_aud.notify_all();
     }
 
-    void FrameGeneratorTwo::setup_audio_listener_win() {
-        HRESULT result = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
-        if (FAILED(result)) {
-            LOG_INFO("The com init failed");
+    // Runs on the demuxer thread, which owns the format and codec contexts.
+    void FrameGeneratorTwo::perform_seek() {
+        double seconds = 0.0;
+        {
+            std::lock_guard<std::mutex> lockVid{_mutex_vid};
+            std::lock_guard<std::mutex> lockAud{_mutex_aud};
+            seconds = m_seek_request_seconds;
+            m_seek_requested = false;
+            m_seek_generation++;
+            m_vid_decoded_frame_queue = {};
+            m_aud_decoded_frame_queue = {};
+            m_vid_frame_queue = {};
+            m_demux_finished = false;
+            m_video_finished = false;
         }
-        IMMDeviceEnumerator *enumerator;
-        CoCreateInstance(
-                __uuidof(MMDeviceEnumerator),
-                nullptr,
-                CLSCTX_ALL,
-                __uuidof(IMMDeviceEnumerator),
-                (void **) &enumerator
-        );
-        IMMDevice *audioDevice;
-        enumerator->GetDefaultAudioEndpoint(eRender, eConsole, &audioDevice);
-        audioDevice->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, (void **) &m_audioClient);
-        WAVEFORMATEX format{};
-        format.wFormatTag = WAVE_FORMAT_PCM;
-        format.nChannels = 2;
-        format.nSamplesPerSec = 44100;
-        format.wBitsPerSample = 16;
-        format.nBlockAlign = format.nChannels * format.wBitsPerSample / 8;
-        format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+        m_cv_vid.notify_all();
+        m_cv_aud.notify_all();
 
+        std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+        int result = -1;
+        if (videoIndex != -1) {
+            int64_t targetPts = static_cast<int64_t>(seconds / m_timebase);
+            KeyframeEntry keyframe{};
+            if (m_keyframe_index.keyframe_at_or_before(targetPts, keyframe)) {
+                result = av_seek_frame(m_av_Context, videoIndex, keyframe.pts, AVSEEK_FLAG_BACKWARD);
+                // Containers without a timestamp index can still be positioned by the scanned byte offset.
+                if (result < 0 && keyframe.pos >= 0) {
+                    result = av_seek_frame(m_av_Context, -1, keyframe.pos, AVSEEK_FLAG_BYTE);
+                }
+            }
+            if (result < 0) {
+                result = av_seek_frame(m_av_Context, videoIndex, targetPts, AVSEEK_FLAG_BACKWARD);
+            }
+        } else {
+            result = av_seek_frame(m_av_Context, -1, static_cast<int64_t>(seconds * AV_TIME_BASE), AVSEEK_FLAG_BACKWARD);
+        }
+        if (result < 0) {
+            LOG_WARN("Seek to {:.3f} s failed, playback continues from the current position", seconds);
+        }
+        if (m_vid_codec_context) avcodec_flush_buffers(m_vid_codec_context);
+        if (m_aud_codec_context) avcodec_flush_buffers(m_aud_codec_context);
+        m_seek_target_seconds = seconds;
+        m_clock.seek(seconds);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        LOG_INFO("Seek to {:.3f} s repositioned the demuxer in {:.2f} ms", seconds, ms);
+    }
 
-        REFERENCE_TIME bufferDurationTime = 10000000;
+    FrameGeneratorTwo::~FrameGeneratorTwo() {
+        {
+            std::lock_guard<std::mutex> lockVid{_mutex_vid};
+            std::lock_guard<std::mutex> lockAud{_mutex_aud};
+            vidStop = true;
+        }
+        m_cv_vid.notify_all();
+        m_cv_aud.notify_all();
+        // A scan in progress ends early instead of reading the rest of the file.
+        m_keyframe_index.stop();
+        // The demuxer starts the index scan, it is joined first so the scan thread no longer changes.
+        for (std::thread *thread: {&m_demuxer_thread, &m_video_decoder_thread, &m_audio_decoder_thread,
+                                   &m_index_thread}) {
+            if (thread->joinable()) {
+                thread->join();
+            }
+        }
+        // Nothing decodes any more, the queued frames hold their own references.
+        avcodec_free_context(&m_vid_codec_context);
+        avcodec_free_context(&m_aud_codec_context);
+        avformat_close_input(&m_av_Context);
+    }
 
-        m_audioClient->Initialize(AUDCLNT_SHAREMODE_SHARED, 0, bufferDurationTime, 0, &format, nullptr);
-        HRESULT clientResult =  m_audioClient->GetService(__uuidof(IAudioRenderClient), (void **) &m_audio_render_client);
-        if(FAILED(clientResult) || !m_audio_render_client) {
-            LOG_INFO("Failed to get the render client");
-            return;
+    bool FrameGeneratorTwo::open_audio_sink(const AudioFormat &preferred) {
+        if (!m_audio_sink) {
+            m_audio_sink = create_audio_sink(std::getenv("FD_AUDIO_SINK"));
+        }
+        if (!m_audio_sink->open(preferred)) {
+            LOG_ERROR("Failed to open the {} audio sink", m_audio_sink->name());
+            return false;
         }
-        m_audioClient->GetBufferSize(&bufferFrameCount);
-        m_audioClient->Start();
+        // A quarter second of decoded audio absorbs decoder stalls, the device buffer itself stays small.
+        const AudioFormat &format = m_audio_sink->get_format();
+        m_pcm_ring = std::make_unique<PcmRing>(format.sampleRate / 4, format.channels);
+        start_audio_sink();
+        LOG_INFO("Audio output through the {} sink at {} Hz, {} frames of buffer", m_audio_sink->name(),
+                 m_audio_sink->get_format().sampleRate, m_audio_sink->buffer_frames());
+        return true;
+    }
+
+    void FrameGeneratorTwo::start_audio_sink() {
+        m_audio_sink->start(m_pcm_ring.get(), [this](uint32_t framesWritten, uint32_t framesQueued) -> void {
+            m_clock.on_audio_written(framesWritten, framesQueued);
+        });
     }
-}
\ No newline at end of file
+}
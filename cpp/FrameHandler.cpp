@@ -3,17 +3,9 @@
 //
 #include "FrameHandler.h"
 #include "Util.h"
+#include "GpuProfiler.h"
 
 namespace fd {
-    FrameHandler *FrameHandler::m_instance = nullptr;
-
-    FrameHandler *FrameHandler::get_instance(fd::RenderContext *ctx, size_t width, size_t height) {
-        if (m_instance == nullptr) {
-            m_instance = new FrameHandler(ctx, width, height);
-        }
-        return m_instance;
-    }
-
     FrameHandler::FrameHandler(RenderContext *ctx, size_t width, size_t height) :
             m_ctx{ctx},
             m_width{width},
@@ -21,11 +13,7 @@ namespace fd {
         m_commandBuffer = start_command_buffer(m_ctx);
         create_buffer_and_images();
         create_sampler();
-        create_descriptor_set_and_layout();
-        ctx->desLayoutFrame = m_des_layout;
-        for (VkDescriptorSet &des: m_des_sets) {
-            ctx->desSetFrame.push_back(des);
-        }
+        create_descriptor_sets();
         VkSemaphoreCreateInfo semaphoreCreateInfo{};
         semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
         vkCreateSemaphore(m_ctx->logicalDevice, &semaphoreCreateInfo, nullptr, &m_frame_handler_semaphore);
@@ -36,7 +24,8 @@ namespace fd {
                       VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
                       m_width * m_height * sizeof(uint32_t));
         create_image(m_ctx, yPlaneImage, m_width, m_height, yPlaneImageMemory, VK_FORMAT_R8G8B8A8_UNORM,
-                     VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+                     VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
         create_image_view(m_ctx->logicalDevice, yPlaneImage, yPlaneImageView, VK_FORMAT_R8G8B8A8_UNORM);
         transition_image_layout(m_ctx, m_commandBuffer, yPlaneImage, VK_IMAGE_ASPECT_COLOR_BIT,
                                 VK_IMAGE_LAYOUT_UNDEFINED,
@@ -49,9 +38,10 @@ namespace fd {
         samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
         samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
         samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
-        samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        // Repeat would blend the first row and column into the last ones at the edges of the cell.
+        samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
         samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
         samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 
@@ -59,7 +49,7 @@ namespace fd {
                  "failed to create the sampler");
     }
 
-    void FrameHandler::create_descriptor_set_and_layout() {
+    VkDescriptorSetLayout FrameHandler::create_descriptor_layout(VkDevice device) {
         VkDescriptorSetLayoutBinding imageBinding{};
         imageBinding.binding = 0;
         imageBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -71,8 +61,13 @@ namespace fd {
         desLayoutCreateInfo.bindingCount = 1;
         desLayoutCreateInfo.pBindings = &imageBinding;
 
-        VK_CHECK(vkCreateDescriptorSetLayout(m_ctx->logicalDevice, &desLayoutCreateInfo, nullptr, &m_des_layout),
+        VkDescriptorSetLayout desLayout{};
+        VK_CHECK(vkCreateDescriptorSetLayout(device, &desLayoutCreateInfo, nullptr, &desLayout),
                  "Failed to create the descriptor set layout");
+        return desLayout;
+    }
+
+    void FrameHandler::create_descriptor_sets() {
         VkDescriptorPoolSize poolSize{};
         poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         poolSize.descriptorCount = m_ctx->imageCount;
@@ -87,7 +82,7 @@ namespace fd {
         VK_CHECK(vkCreateDescriptorPool(m_ctx->logicalDevice, &poolCreateInfo, nullptr, &m_des_pool),
                  "Failed to create the descriptor Pool");
 
-        std::vector<VkDescriptorSetLayout> layouts(3, m_des_layout);
+        std::vector<VkDescriptorSetLayout> layouts(m_ctx->imageCount, m_ctx->desLayoutFrame);
         m_des_sets.resize(m_ctx->imageCount);
         VkDescriptorSetAllocateInfo allocateInfo{};
         allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -141,24 +136,73 @@ namespace fd {
         }
     }
 
-    void FrameHandler::render_with_compute_image(VkImage &rgbaImage, VkSemaphore &computeSemaphore) {
-        vkResetCommandBuffer(m_commandBuffer, 0);
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+    void FrameHandler::record_copy(VkCommandBuffer commandBuffer, VkImage &rgbaImage, uint32_t srcLayer,
+                                   VkImage cacheImage, const std::vector<VkRect2D> *regions) {
         if (!isFirstRender) {
-            record_transition_image(m_commandBuffer, yPlaneImage, VK_IMAGE_ASPECT_COLOR_BIT,
+            record_transition_image(commandBuffer, yPlaneImage, VK_IMAGE_ASPECT_COLOR_BIT,
                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                                     0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
                                     VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
         }
-        record_image_to_image(m_commandBuffer, rgbaImage, yPlaneImage, m_width, m_height);
-        record_transition_image(m_commandBuffer, yPlaneImage, VK_IMAGE_ASPECT_COLOR_BIT,
-                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+        if (regions == nullptr) {
+            record_image_to_image(commandBuffer, rgbaImage, yPlaneImage, m_width, m_height, srcLayer);
+        } else if (!regions->empty()) {
+            std::vector<VkImageCopy> copies(regions->size());
+            for (size_t i = 0; i < regions->size(); i++) {
+                const VkRect2D &rect = (*regions)[i];
+                copies[i].srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, srcLayer, 1};
+                copies[i].dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+                copies[i].srcOffset = {rect.offset.x, rect.offset.y, 0};
+                copies[i].dstOffset = copies[i].srcOffset;
+                copies[i].extent = {rect.extent.width, rect.extent.height, 1};
+            }
+            vkCmdCopyImage(commandBuffer, rgbaImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, yPlaneImage,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copies.size()), copies.data());
+        }
+        VkImageLayout presentedLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        if (cacheImage != VK_NULL_HANDLE) {
+            // Old contents are discarded, the barrier still orders the copy after earlier reads of a reused entry.
+            record_transition_image(commandBuffer, cacheImage, VK_IMAGE_ASPECT_COLOR_BIT,
+                                    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                    VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                    VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+            if (regions == nullptr) {
+                record_image_to_image(commandBuffer, rgbaImage, cacheImage, m_width, m_height, srcLayer);
+            } else {
+                // The converted image only holds the changed tiles, the whole frame is in the presented one.
+                record_transition_image(commandBuffer, yPlaneImage, VK_IMAGE_ASPECT_COLOR_BIT,
+                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                        VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                        VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+                presentedLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                record_image_to_image(commandBuffer, yPlaneImage, cacheImage, m_width, m_height);
+            }
+            record_transition_image(commandBuffer, cacheImage, VK_IMAGE_ASPECT_COLOR_BIT,
+                                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                    VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                    VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
+        record_transition_image(commandBuffer, yPlaneImage, VK_IMAGE_ASPECT_COLOR_BIT, presentedLayout,
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT,
                                 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_READ_BIT,
                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        if (isFirstRender) { isFirstRender = false; }
+    }
+
+    void FrameHandler::render_with_compute_image(VkImage &rgbaImage, VkSemaphore &computeSemaphore,
+                                                 VkImage cacheImage, const std::vector<VkRect2D> *regions) {
+        vkResetCommandBuffer(m_commandBuffer, 0);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+        record_acquire_image(m_commandBuffer, rgbaImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL,
+                             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, m_ctx->computeQueueIndex, m_ctx->graphicsQueueIndex);
+        uint32_t profileScope = gpu_profile_begin(m_ctx, m_commandBuffer, GpuStage::COPY, m_ctx->graphicsQueueIndex);
+        record_copy(m_commandBuffer, rgbaImage, 0, cacheImage, regions);
+        gpu_profile_end(m_ctx, m_commandBuffer, profileScope);
         vkEndCommandBuffer(m_commandBuffer);
         VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         VkSubmitInfo submitInfo{};
@@ -170,13 +214,39 @@ namespace fd {
         submitInfo.pWaitDstStageMask = &waitStage;
         submitInfo.signalSemaphoreCount = 1;
         submitInfo.pSignalSemaphores = &m_frame_handler_semaphore;
-        vkQueueSubmit(m_ctx->graphicsQueue, 1, &submitInfo, nullptr);
+        queue_submit(m_ctx, m_ctx->graphicsQueue, submitInfo, nullptr);
+    }
+
+    void FrameHandler::render_from_cached_image(VkImage cachedImage) {
+        vkResetCommandBuffer(m_commandBuffer, 0);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+        record_transition_image(m_commandBuffer, yPlaneImage, VK_IMAGE_ASPECT_COLOR_BIT,
+                                isFirstRender ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        record_image_to_image(m_commandBuffer, cachedImage, yPlaneImage, m_width, m_height);
+        record_transition_image(m_commandBuffer, yPlaneImage, VK_IMAGE_ASPECT_COLOR_BIT,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        vkEndCommandBuffer(m_commandBuffer);
+        // Still signals the frame handler semaphore, the render submit waits on it for every new frame.
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &m_commandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &m_frame_handler_semaphore;
+        queue_submit(m_ctx, m_ctx->graphicsQueue, submitInfo, nullptr);
         if (isFirstRender) { isFirstRender = false; }
     }
 
     void FrameHandler::cleanup() {
         vkDestroyDescriptorPool(m_ctx->logicalDevice, m_des_pool, nullptr);
-        vkDestroyDescriptorSetLayout(m_ctx->logicalDevice, m_des_layout, nullptr);
         vkDestroyBuffer(m_ctx->logicalDevice, yPlaneBuffer, nullptr);
         vkFreeMemory(m_ctx->logicalDevice, yPlaneBufferMemory, nullptr);
         vkDestroyImageView(m_ctx->logicalDevice, yPlaneImageView, nullptr);
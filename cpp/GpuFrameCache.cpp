@@ -0,0 +1,109 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "GpuFrameCache.h"
+
+namespace fd {
+    GpuFrameCache::GpuFrameCache(RenderContext *ctx, uint32_t width, uint32_t height, size_t budgetMb) :
+            m_ctx{ctx},
+            m_width{width},
+            m_height{height} {
+        size_t frameBytes = static_cast<size_t>(width) * height * sizeof(uint32_t);
+        m_capacity = frameBytes > 0 ? budgetMb * 1024 * 1024 / frameBytes : 0;
+        LOG_INFO("Frame cache holds up to {} frames of {}x{} in {} MB", m_capacity, width, height, budgetMb);
+    }
+
+    size_t GpuFrameCache::budget_from_env() {
+        const char *budget = std::getenv("FD_FRAME_CACHE_MB");
+        if (budget == nullptr) return 256;
+        return static_cast<size_t>(std::strtoull(budget, nullptr, 10));
+    }
+
+    // Microseconds keep neighbouring frames apart at any real frame rate while absorbing float rounding.
+    GpuFrameCache::Key GpuFrameCache::make_key(uint32_t streamId, double pts) {
+        return {streamId, std::llround(pts * 1e6)};
+    }
+
+    std::shared_ptr<void> GpuFrameCache::pin(uint32_t streamId, double pts) {
+        Key key = make_key(streamId, pts);
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            auto it = m_entries.find(key);
+            if (it == m_entries.end()) return nullptr;
+            it->second.pins++;
+        }
+        // The handle only carries the deleter, its pointer is never dereferenced.
+        return {static_cast<void *>(this), [this, key](void *) { unpin(key); }};
+    }
+
+    void GpuFrameCache::unpin(const Key &key) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        auto it = m_entries.find(key);
+        if (it != m_entries.end() && it->second.pins > 0) it->second.pins--;
+    }
+
+    bool GpuFrameCache::lookup(uint32_t streamId, double pts, VkImage &image) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        auto it = m_entries.find(make_key(streamId, pts));
+        if (it == m_entries.end()) {
+            m_misses++;
+            return false;
+        }
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lruPosition);
+        image = it->second.image;
+        m_hits++;
+        return true;
+    }
+
+    VkImage GpuFrameCache::insert(uint32_t streamId, double pts) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (m_capacity == 0) return VK_NULL_HANDLE;
+        Key key = make_key(streamId, pts);
+        auto existing = m_entries.find(key);
+        if (existing != m_entries.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, existing->second.lruPosition);
+            return existing->second.image;
+        }
+        Entry entry{};
+        if (m_entries.size() >= m_capacity) {
+            // The coldest unpinned image is handed to the new key, later copies into it are ordered after earlier
+            // reads on the graphics queue by the barrier the store records.
+            auto coldest = std::find_if(m_lru.rbegin(), m_lru.rend(), [this](const Key &candidate) {
+                return m_entries.at(candidate).pins == 0;
+            });
+            if (coldest == m_lru.rend()) return VK_NULL_HANDLE;
+            auto evicted = m_entries.find(*coldest);
+            entry = evicted->second;
+            entry.pins = 0;
+            m_lru.erase(evicted->second.lruPosition);
+            m_entries.erase(evicted);
+            m_evictions++;
+        } else {
+            create_image(m_ctx, entry.image, m_width, m_height, entry.memory, VK_FORMAT_R8G8B8A8_UNORM,
+                         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+        m_lru.push_front(key);
+        entry.lruPosition = m_lru.begin();
+        m_entries.emplace(key, entry);
+        return entry.image;
+    }
+
+    FrameCacheStats GpuFrameCache::get_stats() const {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return {m_hits, m_misses, m_evictions, m_entries.size(), m_capacity};
+    }
+
+    void GpuFrameCache::clean_up() {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        for (auto &[key, entry]: m_entries) {
+            vkDestroyImage(m_ctx->logicalDevice, entry.image, nullptr);
+            vkFreeMemory(m_ctx->logicalDevice, entry.memory, nullptr);
+        }
+        m_entries.clear();
+        m_lru.clear();
+    }
+}
@@ -0,0 +1,204 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include "GpuProfiler.h"
+
+namespace fd {
+    const char *gpu_stage_name(GpuStage stage) {
+        switch (stage) {
+            case GpuStage::UPLOAD:
+                return "upload";
+            case GpuStage::SCALE:
+                return "scale";
+            case GpuStage::BLUR:
+                return "blur";
+            case GpuStage::TEMPORAL:
+                return "temporal";
+            case GpuStage::YUV_RGBA:
+                return "yuv->rgba";
+            case GpuStage::COPY:
+                return "copy";
+            case GpuStage::DRAW:
+                return "draw";
+            default:
+                return "unknown";
+        }
+    }
+
+    GpuProfiler::GpuProfiler(RenderContext *ctx, uint32_t frameLatency, uint32_t streamCount) :
+            m_ctx{ctx},
+            m_frame_latency{frameLatency},
+            m_scopes_per_frame{streamCount * SCOPES_PER_STREAM + SCOPES_PER_FRAME} {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(m_ctx->physicalDevice, &properties);
+        m_timestamp_period = properties.limits.timestampPeriod;
+        uint32_t count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(m_ctx->physicalDevice, &count, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+        vkGetPhysicalDeviceQueueFamilyProperties(m_ctx->physicalDevice, &count, queueFamilyProperties.data());
+        // Queries are reset in the command buffer that writes them, which transfer only families can't record, so
+        // uploads on a dedicated transfer queue go unmeasured.
+        for (const VkQueueFamilyProperties &family: queueFamilyProperties) {
+            m_family_has_timestamps.push_back(family.timestampValidBits > 0 && m_timestamp_period > 0.0 &&
+                                              (family.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)));
+        }
+
+        VkQueryPoolCreateInfo queryPoolCreateInfo{};
+        queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolCreateInfo.queryCount = m_frame_latency * m_scopes_per_frame * 2;
+        VK_CHECK(vkCreateQueryPool(m_ctx->logicalDevice, &queryPoolCreateInfo, nullptr, &m_query_pool),
+                 "Failed to create the profiler query pool");
+        m_frame_scopes.resize(m_frame_latency);
+        if (Trace::is_enabled() && m_family_has_timestamps[m_ctx->graphicsQueueIndex]) {
+            calibrate_trace_clock();
+        }
+        LOG_INFO("GPU profiler reading timestamps {} frames behind, {} scopes a frame", m_frame_latency,
+                 m_scopes_per_frame);
+    }
+
+    void GpuProfiler::calibrate_trace_clock() {
+        VkCommandBuffer commandBuffer = start_command_buffer(m_ctx);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo), "Failed to begin the calibration command buffer");
+        // Query 0 is reset again by the first scope that uses it.
+        vkCmdResetQueryPool(commandBuffer, m_query_pool, 0, 1);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_query_pool, 0);
+        vkEndCommandBuffer(commandBuffer);
+        VkFence fence = get_fence(m_ctx);
+        vkResetFences(m_ctx->logicalDevice, 1, &fence);
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        uint64_t submitNs = Trace::now_ns();
+        queue_submit(m_ctx, m_ctx->graphicsQueue, submitInfo, fence);
+        vkWaitForFences(m_ctx->logicalDevice, 1, &fence, VK_TRUE, UINT64_MAX);
+        uint64_t doneNs = Trace::now_ns();
+        uint64_t ticks = 0;
+        vkGetQueryPoolResults(m_ctx->logicalDevice, m_query_pool, 0, 1, sizeof(ticks), &ticks, sizeof(uint64_t),
+                              VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+        m_trace_offset_ns = static_cast<double>(submitNs + (doneNs - submitNs) / 2) -
+                            static_cast<double>(ticks) * m_timestamp_period;
+        m_trace_calibrated = true;
+        vkDestroyFence(m_ctx->logicalDevice, fence, nullptr);
+        vkFreeCommandBuffers(m_ctx->logicalDevice, m_ctx->commandPool, 1, &commandBuffer);
+    }
+
+    bool GpuProfiler::is_requested() {
+        const char *profile = std::getenv("FD_GPU_PROFILE");
+        return profile != nullptr && std::strcmp(profile, "0") != 0;
+    }
+
+    uint32_t GpuProfiler::begin(VkCommandBuffer commandBuffer, GpuStage stage, uint32_t queueFamily) {
+        std::vector<Scope> &scopes = m_frame_scopes[m_frame];
+        if (!m_family_has_timestamps[queueFamily]) return UINT32_MAX;
+        if (scopes.size() >= m_scopes_per_frame) {
+            LOG_WARN_EVERY_MS(5000, "GPU profiler ran out of its {} scopes a frame, {} goes unmeasured",
+                              m_scopes_per_frame, gpu_stage_name(stage));
+            return UINT32_MAX;
+        }
+        uint32_t query = (m_frame * m_scopes_per_frame + static_cast<uint32_t>(scopes.size())) * 2;
+        scopes.push_back({stage, queueFamily, query});
+        vkCmdResetQueryPool(commandBuffer, m_query_pool, query, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_query_pool, query);
+        return query;
+    }
+
+    void GpuProfiler::end(VkCommandBuffer commandBuffer, uint32_t scope) {
+        if (scope == UINT32_MAX) return;
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_query_pool, scope + 1);
+    }
+
+    void GpuProfiler::next_frame() {
+        m_frame = (m_frame + 1) % m_frame_latency;
+        resolve(m_frame);
+    }
+
+    void GpuProfiler::resolve(uint32_t frame) {
+        std::vector<Scope> &scopes = m_frame_scopes[frame];
+        if (scopes.empty()) return;
+        std::array<double, static_cast<size_t>(GpuStage::COUNT)> stageMs{};
+        std::array<bool, static_cast<size_t>(GpuStage::COUNT)> stageSeen{};
+        bool available = true;
+        for (const Scope &scope: scopes) {
+            // Begin and end timestamps, each followed by its availability.
+            std::array<uint64_t, 4> results{};
+            vkGetQueryPoolResults(m_ctx->logicalDevice, m_query_pool, scope.query, 2, sizeof(results),
+                                  results.data(), 2 * sizeof(uint64_t),
+                                  VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+            if (results[1] == 0 || results[3] == 0 || results[2] < results[0]) {
+                available = false;
+                break;
+            }
+            if (m_trace_calibrated) {
+                Trace::record_gpu(gpu_stage_name(scope.stage), scope.queueFamily,
+                                  static_cast<uint64_t>(static_cast<double>(results[0]) * m_timestamp_period +
+                                                        m_trace_offset_ns),
+                                  static_cast<uint64_t>(static_cast<double>(results[2]) * m_timestamp_period +
+                                                        m_trace_offset_ns));
+            }
+            auto stage = static_cast<size_t>(scope.stage);
+            stageMs[stage] += static_cast<double>(results[2] - results[0]) * m_timestamp_period * 1e-6;
+            stageSeen[stage] = true;
+        }
+        scopes.clear();
+        if (!available) {
+            // Only a GPU running more than frameLatency frames behind gets here, its stage times have gaps.
+            LOG_WARN_EVERY_MS(5000, "GPU profiler dropped a frame whose timestamps were not ready {} frames later",
+                              m_frame_latency);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            for (size_t stage = 0; stage < stageMs.size(); stage++) {
+                if (!stageSeen[stage]) continue;
+                std::deque<double> &window = m_windows[stage];
+                window.push_back(stageMs[stage]);
+                if (window.size() > WINDOW_FRAMES) window.pop_front();
+            }
+        }
+        m_frames_resolved++;
+        if (m_frames_resolved % (WINDOW_FRAMES * 5) == 0) {
+            log_stats();
+        }
+    }
+
+    GpuStageStats GpuProfiler::get_stats(GpuStage stage) const {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        const std::deque<double> &window = m_windows[static_cast<size_t>(stage)];
+        GpuStageStats stats{};
+        stats.samples = window.size();
+        if (window.empty()) return stats;
+        for (double ms: window) {
+            stats.averageMs += ms;
+            stats.maxMs = (std::max)(stats.maxMs, ms);
+        }
+        stats.averageMs /= static_cast<double>(window.size());
+        stats.lastMs = window.back();
+        return stats;
+    }
+
+    void GpuProfiler::log_stats() const {
+        std::ostringstream line{};
+        line << std::fixed << std::setprecision(3);
+        for (uint32_t stage = 0; stage < static_cast<uint32_t>(GpuStage::COUNT); stage++) {
+            GpuStageStats stats = get_stats(static_cast<GpuStage>(stage));
+            if (stats.samples == 0) continue;
+            line << " " << gpu_stage_name(static_cast<GpuStage>(stage)) << " " << stats.averageMs << "/"
+                 << stats.maxMs;
+        }
+        LOG_INFO("GPU ms per frame, average/max over the last {} frames:{}", WINDOW_FRAMES, line.str());
+    }
+
+    void GpuProfiler::clean_up() {
+        vkDestroyQueryPool(m_ctx->logicalDevice, m_query_pool, nullptr);
+    }
+}
@@ -0,0 +1,175 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include "KeyframeIndex.h"
+#include "Util.h"
+
+namespace fd {
+    std::string KeyframeIndex::cache_path(const std::string &mediaPath) {
+        return mediaPath + ".fdidx";
+    }
+
+    uint64_t KeyframeIndex::media_size(const std::string &mediaPath) {
+        std::ifstream media{mediaPath, std::ios::binary | std::ios::ate};
+        if (!media) return 0;
+        return static_cast<uint64_t>(media.tellg());
+    }
+
+    void KeyframeIndex::mark_ready(const char *source, std::chrono::steady_clock::time_point start) {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_ready = true;
+        LOG_INFO("Keyframe index holds {} keyframes from the {} in {:.2f} ms", m_entries.size(), source, ms);
+    }
+
+    bool KeyframeIndex::load_from_container(AVStream *stream) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int count = avformat_index_get_entries_count(stream);
+        std::vector<KeyframeEntry> entries{};
+        for (int i = 0; i < count; i++) {
+            const AVIndexEntry *entry = avformat_index_get_entry(stream, i);
+            if (entry != nullptr && (entry->flags & AVINDEX_KEYFRAME)) {
+                entries.push_back({entry->timestamp, entry->pos});
+            }
+        }
+        if (entries.empty()) return false;
+        std::sort(entries.begin(), entries.end(),
+                  [](const KeyframeEntry &a, const KeyframeEntry &b) -> bool { return a.pts < b.pts; });
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_entries = std::move(entries);
+        }
+        mark_ready("container index", start);
+        return true;
+    }
+
+    void KeyframeIndex::load_from_file(const std::string &mediaPath, int streamIndex) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (load_cache(mediaPath, streamIndex)) {
+            mark_ready("index cache", start);
+            return;
+        }
+        scan_packets(mediaPath, streamIndex);
+        if (m_stop) return;
+        save_cache(mediaPath, streamIndex);
+        mark_ready("packet scan", start);
+    }
+
+    // A second context keeps the scan from moving the playback demuxer.
+    void KeyframeIndex::scan_packets(const std::string &mediaPath, int streamIndex) {
+        AVFormatContext *context = nullptr;
+        if (avformat_open_input(&context, mediaPath.c_str(), nullptr, nullptr) < 0) {
+            LOG_WARN("Keyframe scan could not open {}", mediaPath);
+            return;
+        }
+        for (unsigned int i = 0; i < context->nb_streams; i++) {
+            context->streams[i]->discard = static_cast<int>(i) == streamIndex ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+        }
+        std::vector<KeyframeEntry> entries{};
+        AVPacket *packet = av_packet_alloc();
+        while (!m_stop && av_read_frame(context, packet) >= 0) {
+            if (packet->stream_index == streamIndex && (packet->flags & AV_PKT_FLAG_KEY)) {
+                int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+                if (pts != AV_NOPTS_VALUE) {
+                    entries.push_back({pts, packet->pos});
+                }
+            }
+            av_packet_unref(packet);
+        }
+        av_packet_free(&packet);
+        avformat_close_input(&context);
+        if (m_stop) return;
+        std::sort(entries.begin(), entries.end(),
+                  [](const KeyframeEntry &a, const KeyframeEntry &b) -> bool { return a.pts < b.pts; });
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_entries = std::move(entries);
+    }
+
+    // Layout: magic, version, media size, stream index, entry count, then the entries. A media size mismatch means
+    // the file was replaced and the cache is rebuilt.
+    bool KeyframeIndex::load_cache(const std::string &mediaPath, int streamIndex) {
+        std::ifstream cache{cache_path(mediaPath), std::ios::binary};
+        if (!cache) return false;
+        uint32_t magic = 0;
+        uint32_t version = 0;
+        uint64_t size = 0;
+        int32_t stream = -1;
+        uint64_t count = 0;
+        cache.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+        cache.read(reinterpret_cast<char *>(&version), sizeof(version));
+        cache.read(reinterpret_cast<char *>(&size), sizeof(size));
+        cache.read(reinterpret_cast<char *>(&stream), sizeof(stream));
+        cache.read(reinterpret_cast<char *>(&count), sizeof(count));
+        if (!cache || magic != CACHE_MAGIC || version != CACHE_VERSION || size != media_size(mediaPath) ||
+            stream != streamIndex || count == 0) {
+            return false;
+        }
+        // A truncated or corrupt file must not size the allocation, the entries have to fit in what is left of it.
+        std::streampos entriesStart = cache.tellg();
+        cache.seekg(0, std::ios::end);
+        std::streampos end = cache.tellg();
+        cache.seekg(entriesStart);
+        if (!cache || end < entriesStart ||
+            count > static_cast<uint64_t>(end - entriesStart) / sizeof(KeyframeEntry)) {
+            LOG_WARN("Keyframe index cache {} is truncated, rescanning", cache_path(mediaPath));
+            return false;
+        }
+        std::vector<KeyframeEntry> entries(static_cast<size_t>(count));
+        auto bytes = static_cast<std::streamsize>(count * sizeof(KeyframeEntry));
+        cache.read(reinterpret_cast<char *>(entries.data()), bytes);
+        if (!cache || cache.gcount() != bytes) return false;
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_entries = std::move(entries);
+        return true;
+    }
+
+    void KeyframeIndex::save_cache(const std::string &mediaPath, int streamIndex) const {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (m_entries.empty()) return;
+        std::string path = cache_path(mediaPath);
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream cache{tempPath, std::ios::binary | std::ios::trunc};
+            if (!cache) {
+                LOG_WARN("Could not write the keyframe index cache {}", path);
+                return;
+            }
+            uint32_t magic = CACHE_MAGIC;
+            uint32_t version = CACHE_VERSION;
+            uint64_t size = media_size(mediaPath);
+            int32_t stream = streamIndex;
+            uint64_t count = m_entries.size();
+            cache.write(reinterpret_cast<const char *>(&magic), sizeof(magic));
+            cache.write(reinterpret_cast<const char *>(&version), sizeof(version));
+            cache.write(reinterpret_cast<const char *>(&size), sizeof(size));
+            cache.write(reinterpret_cast<const char *>(&stream), sizeof(stream));
+            cache.write(reinterpret_cast<const char *>(&count), sizeof(count));
+            cache.write(reinterpret_cast<const char *>(m_entries.data()),
+                        static_cast<std::streamsize>(count * sizeof(KeyframeEntry)));
+        }
+        std::remove(path.c_str());
+        std::rename(tempPath.c_str(), path.c_str());
+    }
+
+    bool KeyframeIndex::is_ready() const {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_ready;
+    }
+
+    size_t KeyframeIndex::size() const {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_entries.size();
+    }
+
+    bool KeyframeIndex::keyframe_at_or_before(int64_t pts, KeyframeEntry &entry) const {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        auto it = std::upper_bound(m_entries.begin(), m_entries.end(), pts,
+                                   [](int64_t value, const KeyframeEntry &e) -> bool { return value < e.pts; });
+        if (it == m_entries.begin()) return false;
+        entry = *(it - 1);
+        return true;
+    }
+}
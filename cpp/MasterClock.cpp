@@ -0,0 +1,117 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <algorithm>
+#include <string>
+#include "MasterClock.h"
+
+namespace fd {
+    MasterClock::MasterClock(ClockSource source) : m_source{source} {}
+
+    double MasterClock::elapsed_since(const ClockSample &sample) {
+        return std::chrono::duration<double>(Clock::now() - sample.updatedAt).count();
+    }
+
+    FrameDecision MasterClock::decide_frame(double framePts, double masterTime, double frameDuration,
+                                            bool newerQueued, bool hasShownFrame) {
+        // The newest queued frame is always kept so a slow decoder still shows something.
+        if (newerQueued && framePts < masterTime - frameDuration) return FrameDecision::DROP;
+        if (hasShownFrame && framePts - masterTime > frameDuration) return FrameDecision::REPEAT;
+        return FrameDecision::SHOW;
+    }
+
+    ClockSource MasterClock::parse_source(const char *name) {
+        std::string source = name != nullptr ? name : "";
+        if (source == "video") {
+            return ClockSource::VIDEO;
+        }
+        if (source == "external") {
+            return ClockSource::EXTERNAL;
+        }
+        return ClockSource::AUDIO;
+    }
+
+    void MasterClock::set_source(ClockSource source) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_source = source;
+    }
+
+    ClockSource MasterClock::get_source() const {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_source;
+    }
+
+    void MasterClock::start_external(double pts) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (m_external.valid) return;
+        m_external = {pts, Clock::now(), true};
+    }
+
+    void MasterClock::start_audio(double startPts, uint32_t sampleRate) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_audio_start_pts = startPts;
+        m_audio_sample_rate = sampleRate;
+        m_audio_frames_written = 0;
+        m_audio = {};
+    }
+
+    void MasterClock::seek(double pts) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_external = {pts, Clock::now(), true};
+        m_video = {};
+        m_audio = {};
+        // Writes the device reports for samples queued before the seek are ignored until start_audio.
+        m_audio_sample_rate = 0;
+        m_audio_frames_written = 0;
+    }
+
+    void MasterClock::on_audio_written(uint32_t framesWritten, uint32_t framesQueued) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (m_audio_sample_rate == 0) return;
+        m_audio_frames_written += framesWritten;
+        int64_t framesPlayed = std::max<int64_t>(m_audio_frames_written - framesQueued, 0);
+        m_audio = {m_audio_start_pts + static_cast<double>(framesPlayed) / m_audio_sample_rate, Clock::now(), true};
+    }
+
+    void MasterClock::on_video_shown(double pts) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_video = {pts, Clock::now(), true};
+    }
+
+    double MasterClock::audio_time() const {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (!m_audio.valid) return external_time_locked();
+        // Between writes the device keeps playing, but never past the last sample it was given.
+        double writtenEnd = m_audio_start_pts + static_cast<double>(m_audio_frames_written) / m_audio_sample_rate;
+        return std::min(m_audio.pts + elapsed_since(m_audio), writtenEnd);
+    }
+
+    double MasterClock::video_time() const {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (!m_video.valid) return external_time_locked();
+        return m_video.pts + elapsed_since(m_video);
+    }
+
+    double MasterClock::external_time() const {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return external_time_locked();
+    }
+
+    double MasterClock::external_time_locked() const {
+        if (!m_external.valid) return 0.0;
+        return m_external.pts + elapsed_since(m_external);
+    }
+
+    double MasterClock::now() const {
+        ClockSource source = get_source();
+        switch (source) {
+            case ClockSource::AUDIO:
+                return audio_time();
+            case ClockSource::VIDEO:
+                return video_time();
+            case ClockSource::EXTERNAL:
+            default:
+                return external_time();
+        }
+    }
+}
@@ -0,0 +1,149 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include "PresentScheduler.h"
+#include "Util.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace fd {
+    PresentTimingMode PresentScheduler::select_device_extensions(VkPhysicalDevice physicalDevice,
+                                                                 std::vector<const char *> &extensions,
+                                                                 PresentTimingFeatures &features) {
+        uint32_t count = 0;
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count, nullptr);
+        std::vector<VkExtensionProperties> available(count);
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count, available.data());
+        auto hasExtension = [&available](const char *name) -> bool {
+            return std::any_of(available.begin(), available.end(), [name](const VkExtensionProperties &extension) {
+                return strcmp(extension.extensionName, name) == 0;
+            });
+        };
+
+        if (hasExtension(VK_KHR_PRESENT_ID_EXTENSION_NAME) && hasExtension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+            features.presentId.pNext = &features.presentWait;
+            VkPhysicalDeviceFeatures2 features2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+            features2.pNext = &features.presentId;
+            vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+            if (features.presentId.presentId && features.presentWait.presentWait) {
+                extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+                extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+                return PresentTimingMode::PRESENT_WAIT;
+            }
+        }
+        if (hasExtension(VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME)) {
+            extensions.push_back(VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME);
+            return PresentTimingMode::DISPLAY_TIMING;
+        }
+        return PresentTimingMode::SLEEP_SPIN;
+    }
+
+    void PresentScheduler::init(VkDevice device, VkSwapchainKHR swapchain, PresentTimingMode mode) {
+        m_device = device;
+        m_swapchain = swapchain;
+        m_mode = mode;
+        m_present_id = 0;
+        if (m_mode == PresentTimingMode::PRESENT_WAIT) {
+            m_wait_for_present = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+                    vkGetDeviceProcAddr(device, "vkWaitForPresentKHR"));
+            if (!m_wait_for_present) m_mode = PresentTimingMode::SLEEP_SPIN;
+        }
+        if (m_mode == PresentTimingMode::DISPLAY_TIMING) {
+            m_get_refresh_cycle = reinterpret_cast<PFN_vkGetRefreshCycleDurationGOOGLE>(
+                    vkGetDeviceProcAddr(device, "vkGetRefreshCycleDurationGOOGLE"));
+            VkRefreshCycleDurationGOOGLE refreshCycle{};
+            if (m_get_refresh_cycle && m_get_refresh_cycle(device, swapchain, &refreshCycle) == VK_SUCCESS) {
+                m_refresh_seconds = static_cast<double>(refreshCycle.refreshDuration) * 1e-9;
+            } else {
+                m_mode = PresentTimingMode::SLEEP_SPIN;
+            }
+        }
+        const char *modeNames[] = {"present wait", "display timing", "sleep and spin"};
+        LOG_INFO("Present scheduling through {}", modeNames[static_cast<int>(m_mode)]);
+    }
+
+    void PresentScheduler::sleep_then_spin(Clock::time_point target) {
+#ifdef _WIN32
+        // The default Windows sleep granularity is a whole timer tick, a high resolution waitable timer is not.
+        static thread_local HANDLE timer = CreateWaitableTimerExW(nullptr, nullptr,
+                                                                  CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                                                  TIMER_ALL_ACCESS);
+#endif
+        while (true) {
+            double remaining = std::chrono::duration<double>(target - Clock::now()).count();
+            if (remaining <= 0.0) return;
+            if (remaining <= SPIN_WINDOW_SECONDS) {
+                std::this_thread::yield();
+                continue;
+            }
+            double sleepSeconds = remaining - SPIN_WINDOW_SECONDS;
+#ifdef _WIN32
+            if (timer) {
+                LARGE_INTEGER dueTime{};
+                dueTime.QuadPart = -static_cast<LONGLONG>(sleepSeconds * 1e7);
+                SetWaitableTimer(timer, &dueTime, 0, nullptr, nullptr, FALSE);
+                WaitForSingleObject(timer, INFINITE);
+                continue;
+            }
+#endif
+            std::this_thread::sleep_for(std::chrono::duration<double>(sleepSeconds));
+        }
+    }
+
+    void PresentScheduler::wait_for_target(Clock::time_point target) {
+        switch (m_mode) {
+            case PresentTimingMode::PRESENT_WAIT: {
+                if (m_present_id > 0) {
+                    // Returns once the previous present is on screen, which also caps the queue at one present.
+                    uint64_t timeoutNs = static_cast<uint64_t>(m_refresh_seconds * 4e9);
+                    VkResult result = m_wait_for_present(m_device, m_swapchain, m_present_id, timeoutNs);
+                    if (result == VK_SUCCESS) {
+                        double latency = std::chrono::duration<double>(Clock::now() - m_last_present).count();
+                        m_display_latency = m_display_latency == 0.0 ? latency : m_display_latency * 0.9 +
+                                                                                 latency * 0.1;
+                    }
+                }
+                auto latency = std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(m_display_latency));
+                sleep_then_spin(target - latency);
+                break;
+            }
+            case PresentTimingMode::DISPLAY_TIMING:
+                // The presentation engine holds the image until its desired time.
+                break;
+            case PresentTimingMode::SLEEP_SPIN:
+            default:
+                sleep_then_spin(target);
+                break;
+        }
+    }
+
+    void PresentScheduler::prepare_present(VkPresentInfoKHR &presentInfo, Clock::time_point target) {
+        if (m_mode == PresentTimingMode::PRESENT_WAIT) {
+            m_present_id_info = {VK_STRUCTURE_TYPE_PRESENT_ID_KHR};
+            m_present_id_info.pNext = presentInfo.pNext;
+            m_present_id_info.swapchainCount = 1;
+            m_present_id_info.pPresentIds = &(++m_present_id);
+            presentInfo.pNext = &m_present_id_info;
+        } else if (m_mode == PresentTimingMode::DISPLAY_TIMING) {
+            // Display timing runs on CLOCK_MONOTONIC, the same base steady_clock uses on the platforms that ship it.
+            m_present_time.presentID = static_cast<uint32_t>(++m_present_id);
+            m_present_time.desiredPresentTime = static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(target.time_since_epoch()).count());
+            m_present_times_info = {VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE};
+            m_present_times_info.pNext = presentInfo.pNext;
+            m_present_times_info.swapchainCount = 1;
+            m_present_times_info.pTimes = &m_present_time;
+            presentInfo.pNext = &m_present_times_info;
+        }
+    }
+
+    void PresentScheduler::on_presented() {
+        m_last_present = Clock::now();
+    }
+}
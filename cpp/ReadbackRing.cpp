@@ -0,0 +1,237 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <cstdlib>
+#include "ReadbackRing.h"
+
+namespace fd {
+    ReadbackRing::ReadbackRing(RenderContext *ctx, VkDeviceSize slotSize, uint32_t depth, std::string name) :
+            m_ctx{ctx}, m_name{std::move(name)}, m_slot_size{slotSize} {
+        // Host reads out of uncached, write combined memory are slow, cached memory is preferred even when it is not
+        // coherent and has to be invalidated.
+        VkMemoryPropertyFlags memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        VkPhysicalDeviceMemoryProperties memoryProperties{};
+        vkGetPhysicalDeviceMemoryProperties(m_ctx->physicalDevice, &memoryProperties);
+        const VkMemoryPropertyFlags candidates[] = {
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT |
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT
+        };
+        bool found = false;
+        for (VkMemoryPropertyFlags candidate: candidates) {
+            for (uint32_t i = 0; i < memoryProperties.memoryTypeCount && !found; i++) {
+                found = (memoryProperties.memoryTypes[i].propertyFlags & candidate) == candidate;
+            }
+            if (found) {
+                memoryFlags = candidate;
+                break;
+            }
+        }
+        m_coherent = (memoryFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+        m_slots.resize(depth > 0 ? depth : 1);
+        for (Slot &slot: m_slots) {
+            create_buffer(m_ctx, slot.buffer, VK_BUFFER_USAGE_TRANSFER_DST_BIT, slot.memory, memoryFlags, m_slot_size);
+            void *data = nullptr;
+            vkMapMemory(m_ctx->logicalDevice, slot.memory, 0, VK_WHOLE_SIZE, 0, &data);
+            slot.mapped = static_cast<const uint8_t *>(data);
+        }
+        m_thread = std::thread{[this]() -> void { callback_loop(); }};
+        LOG_INFO("Readback ring {} holds {} slots of {} KB in {} memory", m_name, m_slots.size(), m_slot_size / 1024,
+                 (memoryFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) ? "cached" : "uncached");
+    }
+
+    uint32_t ReadbackRing::depth_from_env(uint32_t fallback) {
+        const char *depth = std::getenv("FD_READBACK_DEPTH");
+        int value = depth != nullptr ? std::atoi(depth) : 0;
+        return value > 0 ? static_cast<uint32_t>(value) : fallback;
+    }
+
+    int32_t ReadbackRing::acquire_slot(bool wait) {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        while (true) {
+            for (uint32_t i = 0; i < m_slots.size(); i++) {
+                if (m_slots[i].state == SlotState::FREE) return static_cast<int32_t>(i);
+            }
+            if (!wait) return -1;
+            if (!m_pending.empty()) {
+                lock.unlock();
+                collect(true);
+                lock.lock();
+            } else {
+                m_cv.wait(lock);
+            }
+        }
+    }
+
+    bool ReadbackRing::record(VkCommandBuffer commandBuffer, uint64_t frameId, const ReadbackRegion &region,
+                              ReadbackCallback callback, bool waitForSlot) {
+        VkDeviceSize size = static_cast<VkDeviceSize>(region.width) * region.height * region.bytesPerPixel;
+        if (size > m_slot_size) {
+            LOG_ERROR_EVERY_MS(1000, "Readback of {}x{} does not fit the {} ring", region.width, region.height,
+                               m_name);
+            return false;
+        }
+        int32_t index = 0;
+        {
+            TRACE_SCOPE("wait readback slot");
+            ScopedMsTimer timer{m_slot_wait_ms};
+            index = acquire_slot(waitForSlot);
+        }
+        if (index < 0) {
+            m_dropped++;
+            return false;
+        }
+        Slot &slot = m_slots[index];
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            slot.state = SlotState::RECORDED;
+        }
+        slot.frameId = frameId;
+        slot.size = size;
+        slot.callback = std::move(callback);
+        record_transition_image(commandBuffer, region.image, region.aspect, region.layout,
+                                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, region.access, region.stage,
+                                VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        record_image_to_buffer(commandBuffer, region.image, slot.buffer, region.width, region.height, region.aspect, 0,
+                               region.layer);
+        record_transition_image(commandBuffer, region.image, region.aspect, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                region.layout, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                region.access, region.stage);
+        record_buffer_barrier(commandBuffer, slot.buffer, VK_ACCESS_TRANSFER_WRITE_BIT,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+        m_recorded.push_back(static_cast<uint32_t>(index));
+        m_readbacks++;
+        return true;
+    }
+
+    void ReadbackRing::on_submitted(VkFence fence) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        for (uint32_t index: m_recorded) {
+            m_slots[index].fence = fence;
+            m_slots[index].state = SlotState::PENDING;
+            m_pending.push_back(index);
+        }
+        m_recorded.clear();
+    }
+
+    // A fence signals after everything submitted before it on the queue, so readbacks finish in submit order.
+    void ReadbackRing::collect(bool wait) {
+        bool waited = !wait;
+        while (true) {
+            uint32_t index = 0;
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                if (m_pending.empty()) break;
+                index = m_pending.front();
+            }
+            Slot &slot = m_slots[index];
+            if (!waited) {
+                vkWaitForFences(m_ctx->logicalDevice, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+                waited = true;
+            } else if (vkGetFenceStatus(m_ctx->logicalDevice, slot.fence) != VK_SUCCESS) {
+                break;
+            }
+            if (!m_coherent) {
+                VkMappedMemoryRange range{};
+                range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+                range.memory = slot.memory;
+                range.offset = 0;
+                range.size = VK_WHOLE_SIZE;
+                vkInvalidateMappedMemoryRanges(m_ctx->logicalDevice, 1, &range);
+            }
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                m_pending.pop_front();
+                if (slot.callback) {
+                    slot.state = SlotState::DISPATCHED;
+                    m_callbacks.push_back(index);
+                } else {
+                    slot.state = SlotState::READY;
+                }
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    void ReadbackRing::callback_loop() {
+        Trace::set_thread_name("readback " + m_name);
+        while (true) {
+            uint32_t index = 0;
+            {
+                std::unique_lock<std::mutex> lock{m_mutex};
+                m_cv.wait(lock, [this]() -> bool { return m_stopping || !m_callbacks.empty(); });
+                if (m_callbacks.empty()) break;
+                index = m_callbacks.front();
+            }
+            Slot &slot = m_slots[index];
+            {
+                TRACE_SCOPE("readback callback");
+                slot.callback(slot.frameId, slot.mapped, slot.size);
+            }
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                // Popped only now so flush sees the callback as still running.
+                m_callbacks.pop_front();
+                slot.callback = {};
+                slot.state = SlotState::FREE;
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    bool ReadbackRing::try_get(uint64_t frameId, const uint8_t *&data, VkDeviceSize &size) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        for (Slot &slot: m_slots) {
+            if (slot.frameId != frameId || (slot.state != SlotState::READY && slot.state != SlotState::HELD)) continue;
+            slot.state = SlotState::HELD;
+            data = slot.mapped;
+            size = slot.size;
+            return true;
+        }
+        return false;
+    }
+
+    void ReadbackRing::release(uint64_t frameId) {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            for (Slot &slot: m_slots) {
+                if (slot.frameId == frameId && (slot.state == SlotState::READY || slot.state == SlotState::HELD)) {
+                    slot.state = SlotState::FREE;
+                }
+            }
+        }
+        m_cv.notify_all();
+    }
+
+    void ReadbackRing::flush() {
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                if (m_pending.empty()) break;
+            }
+            collect(true);
+        }
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_cv.wait(lock, [this]() -> bool { return m_callbacks.empty(); });
+    }
+
+    void ReadbackRing::clean_up() {
+        flush();
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_stopping = true;
+        }
+        m_cv.notify_all();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        LOG_INFO("Readback ring {}: {} readbacks, {} dropped, {:.2f} ms waiting for slots", m_name, m_readbacks,
+                 m_dropped, m_slot_wait_ms);
+        for (Slot &slot: m_slots) {
+            vkUnmapMemory(m_ctx->logicalDevice, slot.memory);
+            vkDestroyBuffer(m_ctx->logicalDevice, slot.buffer, nullptr);
+            vkFreeMemory(m_ctx->logicalDevice, slot.memory, nullptr);
+        }
+        m_slots.clear();
+    }
+}
@@ -0,0 +1,311 @@
+//
+// Created by ghima on 19-10-2026.
+//
+extern "C" {
+#include "libavutil/pixdesc.h"
+};
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include "ThumbnailBatch.h"
+
+namespace fd {
+    ThumbnailBatch::ThumbnailBatch(RenderContext *ctx, const char *listPath) : m_ctx{ctx} {
+        std::ifstream list{listPath};
+        std::string line{};
+        while (std::getline(list, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty() && line.front() != '#') m_paths.push_back(line);
+        }
+        const char *output = std::getenv("FD_THUMBNAIL_OUT");
+        m_output = output != nullptr && *output != '\0' ? output : "contact_sheet";
+        const char *size = std::getenv("FD_THUMBNAIL_SIZE");
+        int tileWidth = size != nullptr ? std::atoi(size) : 0;
+        m_tile_width = tileWidth > 0 ? static_cast<uint32_t>((std::clamp)(tileWidth, 16, 1024)) : DEFAULT_TILE_WIDTH;
+        // 16:9 tiles, other aspects are letterboxed.
+        m_tile_height = (m_tile_width * 9 / 16 + 1) & ~1u;
+        const char *jobs = std::getenv("FD_THUMBNAIL_JOBS");
+        int jobCount = jobs != nullptr ? std::atoi(jobs) : 0;
+        m_jobs = jobCount > 0 ? static_cast<uint32_t>(jobCount)
+                              : (std::max)(2u, std::thread::hardware_concurrency()) - 1;
+        if (!ThumbnailAtlas::is_available()) {
+            LOG_ERROR("The thumbnail kernel is not in the shader bundle");
+            return;
+        }
+        m_atlas = new ThumbnailAtlas(m_ctx, m_tile_width, m_tile_height, COLUMNS, ROWS);
+        VkDeviceSize sheetSize = static_cast<VkDeviceSize>(m_atlas->get_width()) * m_atlas->get_height() * 4;
+        m_readback = new ReadbackRing(m_ctx, sheetSize, ReadbackRing::depth_from_env(2), "sheets");
+    }
+
+    const char *ThumbnailBatch::requested_list() {
+        const char *list = std::getenv("FD_THUMBNAILS");
+        return list != nullptr && *list != '\0' ? list : nullptr;
+    }
+
+    AVFrame *ThumbnailBatch::decode_keyframe(const std::string &path) {
+        AVFormatContext *formatContext = nullptr;
+        if (avformat_open_input(&formatContext, path.c_str(), nullptr, nullptr) < 0) {
+            LOG_WARN("Thumbnails could not open {}", path);
+            return nullptr;
+        }
+        const AVCodec *codec = nullptr;
+        int streamIndex = avformat_find_stream_info(formatContext, nullptr) < 0 ? -1 :
+                          av_find_best_stream(formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+        if (streamIndex < 0) {
+            LOG_WARN("No video stream in {}", path);
+            avformat_close_input(&formatContext);
+            return nullptr;
+        }
+        // Demuxers that know their keyframes drop every other packet before it is read.
+        for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+            formatContext->streams[i]->discard = static_cast<int>(i) == streamIndex ? AVDISCARD_NONKEY : AVDISCARD_ALL;
+        }
+        AVCodecContext *codecContext = avcodec_alloc_context3(codec);
+        avcodec_parameters_to_context(codecContext, formatContext->streams[streamIndex]->codecpar);
+        // Files are decoded in parallel, threads inside a decoder would only delay its single frame.
+        codecContext->thread_count = 1;
+        codecContext->skip_frame = AVDISCARD_NONKEY;
+        if (avcodec_open2(codecContext, codec, nullptr) < 0) {
+            LOG_WARN("Thumbnails could not open the {} decoder for {}", codec->name, path);
+            avcodec_free_context(&codecContext);
+            avformat_close_input(&formatContext);
+            return nullptr;
+        }
+        // A tenth in skips most intros and fades from black.
+        if (formatContext->duration > 0) {
+            av_seek_frame(formatContext, -1, formatContext->duration / 10, AVSEEK_FLAG_BACKWARD);
+        }
+        AVPacket *packet = av_packet_alloc();
+        AVFrame *frame = av_frame_alloc();
+        bool decoded = false;
+        for (int packets = 0; !decoded && packets < MAX_PACKETS && av_read_frame(formatContext, packet) >= 0;
+             packets++) {
+            if (packet->stream_index == streamIndex && avcodec_send_packet(codecContext, packet) >= 0) {
+                decoded = avcodec_receive_frame(codecContext, frame) == 0;
+            }
+            av_packet_unref(packet);
+        }
+        // Decoders that hold frames back for reordering give them up when drained.
+        if (!decoded && avcodec_send_packet(codecContext, nullptr) >= 0) {
+            decoded = avcodec_receive_frame(codecContext, frame) == 0;
+        }
+        av_packet_free(&packet);
+        avcodec_free_context(&codecContext);
+        avformat_close_input(&formatContext);
+        if (!decoded) {
+            LOG_WARN("No keyframe decoded from {}", path);
+            av_frame_free(&frame);
+        } else if (frame->format != AV_PIX_FMT_YUV420P && frame->format != AV_PIX_FMT_YUVJ420P) {
+            const char *formatName = av_get_pix_fmt_name(static_cast<AVPixelFormat>(frame->format));
+            LOG_WARN("Thumbnails take planar 4:2:0 only, {} is {}", path, formatName != nullptr ? formatName : "?");
+            av_frame_free(&frame);
+        }
+        return frame;
+    }
+
+    void ThumbnailBatch::decode_loop() {
+        Trace::set_thread_name("thumbnail decoder");
+        double decodeMs = 0.0;
+        while (true) {
+            size_t index = m_next_path++;
+            if (index >= m_paths.size()) break;
+            AVFrame *frame = nullptr;
+            {
+                TRACE_SCOPE("decode keyframe");
+                ScopedMsTimer timer{decodeMs};
+                frame = decode_keyframe(m_paths[index]);
+            }
+            if (frame == nullptr) {
+                m_failed++;
+                continue;
+            }
+            {
+                std::unique_lock<std::mutex> lock{m_mutex};
+                m_cv.wait(lock, [this]() -> bool { return m_keyframes.size() < 2 * m_jobs + TILES_PER_BATCH; });
+                m_keyframes.push_back({m_paths[index], frame});
+            }
+            m_cv.notify_all();
+        }
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_decoders_running--;
+            m_decode_ms += decodeMs;
+        }
+        m_cv.notify_all();
+    }
+
+    bool ThumbnailBatch::next_keyframe(Keyframe &keyframe) {
+        TRACE_SCOPE("wait keyframe");
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_cv.wait(lock, [this]() -> bool { return !m_keyframes.empty() || m_decoders_running == 0; });
+            if (m_keyframes.empty()) return false;
+            keyframe = m_keyframes.front();
+            m_keyframes.pop_front();
+        }
+        m_cv.notify_all();
+        return true;
+    }
+
+    void ThumbnailBatch::run() {
+        if (m_atlas == nullptr || m_paths.empty()) return;
+        std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+        m_decoders_running = m_jobs;
+        for (uint32_t i = 0; i < m_jobs; i++) {
+            m_decoders.emplace_back([this]() -> void { decode_loop(); });
+        }
+        LOG_INFO("Thumbnails of {} files with {} decoder threads", m_paths.size(), m_jobs);
+
+        VkCommandBuffer commandBuffer{};
+        bool recording = false;
+        // A batch's fence is waited on by begin_batch and reset by submit_batch, the ring polls in between.
+        auto begin = [&]() -> void {
+            commandBuffer = m_atlas->begin_batch();
+            m_readback->poll();
+            recording = true;
+        };
+        auto submit = [&]() -> void {
+            m_readback->on_submitted(m_atlas->submit_batch());
+            recording = false;
+        };
+        uint32_t tile = 0;
+        uint64_t sheet = 0;
+        uint32_t thumbnails = 0;
+        std::vector<std::string> tilePaths{};
+        auto record_sheet = [&]() -> void {
+            ReadbackRegion region{m_atlas->get_atlas_image(), m_atlas->get_width(), m_atlas->get_height(),
+                                  VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT,
+                                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT};
+            m_readback->record(commandBuffer, sheet++, region,
+                               [this, paths = std::move(tilePaths)](uint64_t id, const uint8_t *data,
+                                                                    VkDeviceSize) -> void {
+                                   write_sheet(id, data, paths);
+                               }, true);
+            tilePaths.clear();
+            tile = 0;
+        };
+
+        Keyframe keyframe{};
+        while (next_keyframe(keyframe)) {
+            if (!recording) begin();
+            if (tile == 0 && m_atlas->batch_tiles() == 0) m_atlas->record_clear();
+            const uint8_t *const planes[3] = {keyframe.frame->data[0], keyframe.frame->data[1],
+                                              keyframe.frame->data[2]};
+            bool fullRange = keyframe.frame->format == AV_PIX_FMT_YUVJ420P ||
+                             keyframe.frame->color_range == AVCOL_RANGE_JPEG;
+            double pixelAspect = keyframe.frame->sample_aspect_ratio.num > 0 ?
+                                 av_q2d(keyframe.frame->sample_aspect_ratio) : 1.0;
+            auto add = [&]() -> bool {
+                return m_atlas->add_tile(tile, static_cast<uint32_t>(keyframe.frame->width),
+                                         static_cast<uint32_t>(keyframe.frame->height), planes,
+                                         keyframe.frame->linesize, fullRange, pixelAspect);
+            };
+            bool added = add();
+            if (!added && m_atlas->batch_tiles() > 0) {
+                submit();
+                begin();
+                added = add();
+            }
+            if (added) {
+                tilePaths.push_back(keyframe.path);
+                tile++;
+                thumbnails++;
+            } else {
+                LOG_WARN("{} is too large for a thumbnail batch", keyframe.path);
+                m_failed++;
+            }
+            av_frame_free(&keyframe.frame);
+            if (tile == m_atlas->get_tile_count()) {
+                record_sheet();
+                submit();
+            } else if (m_atlas->batch_tiles() >= TILES_PER_BATCH) {
+                submit();
+            }
+        }
+        // The last sheet keeps its unused tiles black.
+        if (tile > 0) {
+            if (!recording) begin();
+            record_sheet();
+        }
+        if (recording) submit();
+        m_readback->flush();
+        m_atlas->wait_idle();
+        for (std::thread &decoder: m_decoders) {
+            decoder.join();
+        }
+        m_decoders.clear();
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        LOG_INFO("Thumbnails: {} of {} files in {:.2f} s, {:.1f} per second, {} sheets, {} failed, {:.2f} ms to "
+                 "decode a keyframe", thumbnails, m_paths.size(), seconds,
+                 seconds > 0.0 ? thumbnails / seconds : 0.0, m_sheets_written.load(), m_failed.load(),
+                 m_decode_ms / static_cast<double>(m_paths.size()));
+    }
+
+    void ThumbnailBatch::write_sheet(uint64_t sheet, const uint8_t *rgba, const std::vector<std::string> &tilePaths) {
+        std::string number = std::to_string(sheet);
+        std::string name = m_output + "_" + std::string(number.size() < 4 ? 4 - number.size() : 0, '0') + number;
+        const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_PNG);
+        AVCodecContext *codecContext = codec != nullptr ? avcodec_alloc_context3(codec) : nullptr;
+        if (codecContext == nullptr) {
+            LOG_ERROR("No PNG encoder for {}", name);
+            return;
+        }
+        codecContext->width = static_cast<int>(m_atlas->get_width());
+        codecContext->height = static_cast<int>(m_atlas->get_height());
+        codecContext->pix_fmt = AV_PIX_FMT_RGBA;
+        codecContext->time_base = {1, 1};
+        AVFrame *frame = av_frame_alloc();
+        AVPacket *packet = av_packet_alloc();
+        bool written = false;
+        if (avcodec_open2(codecContext, codec, nullptr) >= 0) {
+            // The encoder copies the mapped readback, the frame does not own it.
+            frame->format = AV_PIX_FMT_RGBA;
+            frame->width = codecContext->width;
+            frame->height = codecContext->height;
+            frame->data[0] = const_cast<uint8_t *>(rgba);
+            frame->linesize[0] = codecContext->width * 4;
+            if (avcodec_send_frame(codecContext, frame) >= 0 && avcodec_receive_packet(codecContext, packet) == 0) {
+                std::ofstream image{name + ".png", std::ios::binary | std::ios::trunc};
+                image.write(reinterpret_cast<const char *>(packet->data), packet->size);
+                written = image.good();
+            }
+        }
+        av_packet_free(&packet);
+        av_frame_free(&frame);
+        avcodec_free_context(&codecContext);
+        if (!written) {
+            LOG_ERROR("Failed to write {}.png", name);
+            return;
+        }
+        // Row by row, the file of every tile.
+        std::ofstream index{name + ".txt", std::ios::trunc};
+        for (const std::string &path: tilePaths) {
+            index << path << '\n';
+        }
+        m_sheets_written++;
+        LOG_INFO("Wrote {}.png with {} thumbnails", name, tilePaths.size());
+    }
+
+    void ThumbnailBatch::clean_up() {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            for (Keyframe &keyframe: m_keyframes) {
+                av_frame_free(&keyframe.frame);
+            }
+            m_keyframes.clear();
+        }
+        if (m_readback != nullptr) {
+            m_readback->clean_up();
+            delete m_readback;
+            m_readback = nullptr;
+        }
+        if (m_atlas != nullptr) {
+            m_atlas->clean_up();
+            delete m_atlas;
+            m_atlas = nullptr;
+        }
+    }
+}
@@ -0,0 +1,166 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+#include "Trace.h"
+#include "Util.h"
+
+namespace fd {
+    namespace {
+        struct TraceEvent {
+            const char *name;
+            uint64_t startNs;
+            uint64_t endNs;
+            uint32_t tid;
+        };
+
+        // Single writer ring, the writer publishes with the release store of count.
+        struct ThreadBuffer {
+            static constexpr size_t CAPACITY = 1 << 16;
+            uint32_t tid = 0;
+            std::string name{};
+            std::unique_ptr<TraceEvent[]> events = std::make_unique<TraceEvent[]>(CAPACITY);
+            std::atomic<uint64_t> count{0};
+        };
+
+        // GPU queue families show up as threads of their own after every CPU thread id.
+        constexpr uint32_t GPU_TID_BASE = 1000;
+        // The oldest events of a ring may be overwritten while it is written out, they are skipped.
+        constexpr uint64_t WRITE_SLACK = 1024;
+
+        std::string s_path{};
+        uint64_t s_start_ns = 0;
+        std::atomic<bool> s_dump_requested{false};
+        std::mutex s_registry_mutex;
+        // Threads are detached, their buffers live until exit.
+        std::vector<ThreadBuffer *> s_buffers{};
+        thread_local ThreadBuffer *t_buffer = nullptr;
+
+        ThreadBuffer *thread_buffer() {
+            if (t_buffer == nullptr) {
+                t_buffer = new ThreadBuffer{};
+                std::lock_guard<std::mutex> lock{s_registry_mutex};
+                t_buffer->tid = static_cast<uint32_t>(s_buffers.size()) + 1;
+                t_buffer->name = "thread " + std::to_string(t_buffer->tid);
+                s_buffers.push_back(t_buffer);
+            }
+            return t_buffer;
+        }
+
+        void push_event(const char *name, uint64_t startNs, uint64_t endNs, uint32_t tid) {
+            ThreadBuffer *buffer = thread_buffer();
+            uint64_t count = buffer->count.load(std::memory_order_relaxed);
+            buffer->events[count % ThreadBuffer::CAPACITY] = {name, startNs, endNs, tid};
+            buffer->count.store(count + 1, std::memory_order_release);
+        }
+
+        void on_dump_signal(int) {
+            s_dump_requested = true;
+        }
+
+        // Thread names carry file paths, which on Windows are full of backslashes.
+        std::string json_escape(const std::string &text) {
+            std::string escaped{};
+            for (char c: text) {
+                if (c == '\\' || c == '"') escaped.push_back('\\');
+                escaped.push_back(c);
+            }
+            return escaped;
+        }
+
+        // Microseconds since the trace started, the unit of the Chrome trace format.
+        double to_trace_us(uint64_t ns) {
+            return ns > s_start_ns ? static_cast<double>(ns - s_start_ns) * 1e-3 : 0.0;
+        }
+    }
+
+    std::atomic<bool> Trace::s_enabled{false};
+
+    void Trace::init_from_env() {
+        const char *path = std::getenv("FD_TRACE");
+        if (path == nullptr || *path == '\0') return;
+        s_path = path;
+        s_start_ns = now_ns();
+#ifdef SIGUSR1
+        std::signal(SIGUSR1, on_dump_signal);
+#elif defined(SIGBREAK)
+        std::signal(SIGBREAK, on_dump_signal);
+#endif
+        s_enabled = true;
+        set_thread_name("render");
+        LOG_INFO("Tracing to {}", s_path);
+    }
+
+    void Trace::set_thread_name(const std::string &name) {
+        if (!is_enabled()) return;
+        ThreadBuffer *buffer = thread_buffer();
+        std::lock_guard<std::mutex> lock{s_registry_mutex};
+        buffer->name = name;
+    }
+
+    void Trace::record(const char *name, uint64_t startNs, uint64_t endNs) {
+        if (!is_enabled()) return;
+        push_event(name, startNs, endNs, thread_buffer()->tid);
+    }
+
+    void Trace::record_gpu(const char *name, uint32_t queueFamily, uint64_t startNs, uint64_t endNs) {
+        if (!is_enabled()) return;
+        push_event(name, startNs, endNs, GPU_TID_BASE + queueFamily);
+    }
+
+    void Trace::poll() {
+        if (is_enabled() && s_dump_requested.exchange(false)) {
+            write();
+        }
+    }
+
+    void Trace::write() {
+        if (!is_enabled()) return;
+        std::ofstream file{s_path, std::ios::trunc};
+        if (!file) {
+            LOG_WARN("Failed to open the trace file {}", s_path);
+            return;
+        }
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        bool first = true;
+        auto separator = [&file, &first]() -> void {
+            if (!first) file << ",\n";
+            first = false;
+        };
+        std::set<uint32_t> gpuTids{};
+        uint64_t written = 0;
+        std::lock_guard<std::mutex> lock{s_registry_mutex};
+        for (const ThreadBuffer *buffer: s_buffers) {
+            separator();
+            file << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << buffer->tid << R"(,"args":{"name":")"
+                 << json_escape(buffer->name) << "\"}}";
+            uint64_t count = buffer->count.load(std::memory_order_acquire);
+            uint64_t oldest = count > ThreadBuffer::CAPACITY - WRITE_SLACK ? count -
+                                                                             (ThreadBuffer::CAPACITY - WRITE_SLACK) : 0;
+            for (uint64_t i = oldest; i < count; i++) {
+                const TraceEvent &event = buffer->events[i % ThreadBuffer::CAPACITY];
+                if (event.tid >= GPU_TID_BASE) gpuTids.insert(event.tid);
+                separator();
+                file << R"({"name":")" << event.name << R"(","ph":"X","pid":1,"tid":)" << event.tid << ",\"ts\":"
+                     << to_trace_us(event.startNs) << ",\"dur\":"
+                     << static_cast<double>(event.endNs - event.startNs) * 1e-3 << "}";
+                written++;
+            }
+        }
+        for (uint32_t tid: gpuTids) {
+            separator();
+            file << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << tid
+                 << R"(,"args":{"name":"GPU queue family )" << tid - GPU_TID_BASE << "\"}}";
+        }
+        file << "\n]}\n";
+        LOG_INFO("Wrote {} trace events to {}", written, s_path);
+    }
+}
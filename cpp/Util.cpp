@@ -0,0 +1,33 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <cstdlib>
+#include <cstring>
+#include <spdlog/async.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "Util.h"
+
+namespace fd {
+    namespace {
+        // Messages, not bytes. A second of per frame logging from every thread fits with room to spare.
+        constexpr size_t LOG_QUEUE_SIZE = 8192;
+    }
+
+    void init_logging() {
+        const char *mode = std::getenv("FD_LOG_MODE");
+        if (mode == nullptr || std::strcmp(mode, "sync") != 0) {
+            // Formatting still happens on the calling thread, only the console write moves to the logger thread.
+            spdlog::init_thread_pool(LOG_QUEUE_SIZE, 1);
+            auto logger = std::make_shared<spdlog::async_logger>(
+                    "", std::make_shared<spdlog::sinks::stdout_color_sink_mt>(), spdlog::thread_pool(),
+                    spdlog::async_overflow_policy::overrun_oldest);
+            spdlog::set_default_logger(logger);
+        }
+        spdlog::set_level(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
+        spdlog::flush_on(spdlog::level::err);
+    }
+
+    void shutdown_logging() {
+        spdlog::shutdown();
+    }
+}
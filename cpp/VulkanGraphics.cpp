@@ -4,12 +4,25 @@
 #define GLFW_INCLUDE_VULKAN
 
 #include <glfw/glfw3.h>
-#include <set>
+#include <algorithm>
+#include <map>
 #include <array>
 #include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <memory>
 #include "VulkanGraphics.h"
+#include "GpuProfiler.h"
 #include "Util.h"
 #include "FrameGeneratorTwo.h"
+#include "computes/KernelAutotuner.h"
+#include "computes/StreamBenchmark.h"
+#include "computes/BatchedYuvRgba.h"
+#include "DirtyTiles.h"
+#include "audio/NullAudioSink.h"
 
 __declspec(dllimport) void print_simple_message_two(const char *val);
 
@@ -20,22 +33,72 @@ namespace fd {
     }
 
     VulkanGraphics::~VulkanGraphics() {
-        vkDeviceWaitIdle(m_device.logicalDevice);
-        FrameHandler::get_instance(m_ctx, 0, 0)->cleanup();
-        m_computeYuvRgba->clean_up();
-        delete m_fmGenerator;
+        {
+            std::lock_guard<std::mutex> lock{m_ctx->queueMutex};
+            vkDeviceWaitIdle(m_device.logicalDevice);
+        }
+        for (VideoStream &stream: m_streams) {
+            LOG_INFO("Stream {} A/V sync dropped {} frames and repeated {} presents", stream.id, stream.droppedFrames,
+                     stream.repeatedFrames);
+            // The generator joins its decoder threads and releases the pins its queued frames hold, only then can
+            // the cache go.
+            delete stream.generator;
+            FrameCacheStats cacheStats = stream.frameCache->get_stats();
+            LOG_INFO("Stream {} frame cache: {} hits, {} misses, {} evictions, {} of {} entries used", stream.id,
+                     cacheStats.hits, cacheStats.misses, cacheStats.evictions, cacheStats.entries,
+                     cacheStats.capacity);
+            stream.frameCache->clean_up();
+            delete stream.frameCache;
+            stream.frameHandler->cleanup();
+            delete stream.frameHandler;
+        }
+        // The first converter owns the pipeline the others borrow, it is destroyed last.
+        for (auto it = m_streams.rbegin(); it != m_streams.rend(); ++it) {
+            if (it->compute == nullptr) continue;
+            it->compute->clean_up();
+            delete it->compute;
+        }
+        if (m_batch != nullptr) {
+            m_batch->clean_up();
+            delete m_batch;
+        }
+        if (m_hw_decode != nullptr) {
+            m_hw_decode->clean_up();
+            delete m_hw_decode;
+        }
+        if (m_encoder != nullptr) {
+            m_encoder->clean_up();
+            delete m_encoder;
+        }
+        if (m_checksums != nullptr) {
+            m_checksums->clean_up();
+            delete m_checksums;
+        }
+        if (m_ctx->profiler != nullptr) {
+            m_ctx->profiler->log_stats();
+            m_ctx->profiler->clean_up();
+            delete m_ctx->profiler;
+        }
+        Trace::write();
+        vkDestroyDescriptorSetLayout(m_device.logicalDevice, m_ctx->desLayoutFrame, nullptr);
         delete m_ctx;
-        delete m_computeYuvRgba;
         vkDestroyBuffer(m_device.logicalDevice, quadVertBuffer, nullptr);
         vkFreeMemory(m_device.logicalDevice, vertBufferMemory, nullptr);
         vkDestroyBuffer(m_device.logicalDevice, quadIndexBuffer, nullptr);
         vkFreeMemory(m_device.logicalDevice, indexBufferMemory, nullptr);
-        vkDestroySemaphore(m_device.logicalDevice, m_render_image_semaphore, nullptr);
-        vkDestroySemaphore(m_device.logicalDevice, m_get_image_semaphore, nullptr);
-        vkDestroyFence(m_device.logicalDevice, m_render_fence, nullptr);
+        for (FrameSlot &frame: m_frames) {
+            vkDestroySemaphore(m_device.logicalDevice, frame.getImageSemaphore, nullptr);
+            vkDestroyFence(m_device.logicalDevice, frame.renderFence, nullptr);
+        }
+        for (VkSemaphore semaphore: m_render_image_semaphores) {
+            vkDestroySemaphore(m_device.logicalDevice, semaphore, nullptr);
+        }
         vkDestroyCommandPool(m_device.logicalDevice, m_command_pool, nullptr);
+        vkDestroyCommandPool(m_device.logicalDevice, m_compute_command_pool, nullptr);
         vkDestroyPipeline(m_device.logicalDevice, m_graphics_pipeline, nullptr);
         vkDestroyPipelineLayout(m_device.logicalDevice, m_graphics_layout, nullptr);
+        save_pipeline_cache();
+        vkDestroyPipelineCache(m_device.logicalDevice, m_pipeline_cache, nullptr);
 
         for (int i = 0; i < m_image_count; i++) {
             vkDestroyFramebuffer(m_device.logicalDevice, m_frame_buffers[i], nullptr);
@@ -50,9 +113,18 @@ namespace fd {
     }
 
     void VulkanGraphics::init() {
+        m_startup_start = std::chrono::steady_clock::now();
+        Trace::init_from_env();
+        const char *thumbnailList = ThumbnailBatch::requested_list();
+        // Containers are probed and codecs opened beside the Vulkan setup, none of it needs the device.
+        std::vector<std::future<void>> probes{};
+        if (thumbnailList == nullptr) {
+            probes = start_stream_probes();
+        }
         create_instance();
         get_physical_device_and_create_logical_device();
         create_swapchain();
+        m_present_scheduler.init(m_device.logicalDevice, m_swap_chain, m_present_timing_mode);
         create_render_pass();
         create_frame_buffers();
         create_command_pool_and_allocate_buffer();
@@ -66,23 +138,192 @@ namespace fd {
         m_ctx->computeQueue = m_compute_queue;
         m_ctx->graphicsQueueIndex = m_queue_family_index.graphicsIndex.value();
         m_ctx->computeQueueIndex = m_queue_family_index.computeIndex.value();
+        m_ctx->transferQueue = m_transfer_queue;
+        m_ctx->transferQueueIndex = m_queue_family_index.transferIndex.value();
+        m_ctx->computeCommandPool = m_compute_command_pool;
+        create_pipeline_cache();
+        m_ctx->pipelineCache = m_pipeline_cache;
         prepare_quad_display();
-        m_fmGenerator = new FrameGeneratorTwo();
-        m_fmGenerator->process("D:\\vid.mp4");
+        if (m_queue_family_index.decodeIndex.has_value()) {
+            m_hw_decode = new VulkanHwDecode{};
+            if (!m_hw_decode->init(m_ctx, m_instance, m_instance_extensions, m_device_extensions,
+                                   m_hw_decode_features, m_queue_family_index.decodeIndex.value())) {
+                delete m_hw_decode;
+                m_hw_decode = nullptr;
+            }
+        }
+        m_ctx->desLayoutFrame = FrameHandler::create_descriptor_layout(m_device.logicalDevice);
+        create_pipeline();
+        m_device_ready_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                                      m_startup_start).count();
+        if (thumbnailList != nullptr) {
+            run_thumbnails(thumbnailList);
+            return;
+        }
+        create_streams(probes);
+        create_encoder();
+        create_checksums();
+        // Created after the autotuner so its timing runs stay out of the stage times. A trace needs it for the GPU.
+        if (GpuProfiler::is_requested() || Trace::is_enabled()) {
+            m_ctx->profiler = new GpuProfiler(m_ctx, m_image_count + 1, static_cast<uint32_t>(m_streams.size()));
+        }
+
+        LOG_INFO("Pipeline creation took {:.2f} ms with a {} pipeline cache", m_ctx->pipelineCreationMs,
+                 m_pipeline_cache_warm ? "warm" : "cold");
+        // Saving once the startup pipelines exist keeps the cache warm even if the player never shuts down cleanly.
+        save_pipeline_cache();
+    }
+
+#pragma region STREAMS
+
+    std::vector<std::string> VulkanGraphics::parse_stream_paths(const char *paths) {
+        std::vector<std::string> streamPaths{};
+        if (paths == nullptr) {
+            streamPaths.emplace_back("D:\\vid.mp4");
+            return streamPaths;
+        }
+        std::string path{};
+        std::istringstream pathStream{paths};
+        while (std::getline(pathStream, path, ';')) {
+            if (!path.empty()) streamPaths.push_back(path);
+        }
+        if (streamPaths.empty()) streamPaths.emplace_back("D:\\vid.mp4");
+        return streamPaths;
+    }
+
+    // FD_STREAMS lists the videos separated by ';'. The first stream drives the master clock audio and the present
+    // timing, the others decode to a null sink and follow their own clocks.
+    std::vector<std::future<void>> VulkanGraphics::start_stream_probes() {
+        std::vector<std::string> paths = parse_stream_paths(std::getenv("FD_STREAMS"));
+        // The demuxer threads keep a pointer to the path, the vector must never reallocate.
+        m_streams.reserve(paths.size());
+        // A Vulkan decoder needs the device first, its video codec is opened once the streams are created.
+        bool openVideoCodec = !VulkanHwDecode::is_requested();
+        std::vector<std::future<void>> probes{};
+        for (uint32_t i = 0; i < paths.size(); i++) {
+            VideoStream &stream = m_streams.emplace_back();
+            stream.id = i;
+            stream.path = paths[i];
+            stream.generator = new FrameGeneratorTwo();
+            if (i > 0) {
+                stream.generator->set_audio_sink(std::make_unique<NullAudioSink>());
+            } else if (FrameEncoder::requested_path() != nullptr) {
+                stream.generator->set_audio_sink(std::make_unique<NullAudioSink>(std::string{},
+                                                                                 FrameEncoder::AUDIO_SPEED));
+            }
+            probes.push_back(std::async(std::launch::async, [&stream, openVideoCodec]() -> void {
+                stream.generator->open(stream.path.c_str(), openVideoCodec);
+            }));
+        }
+        return probes;
+    }
+
+    void VulkanGraphics::create_streams(std::vector<std::future<void>> &probes) {
         {
-            std::unique_lock<std::mutex> lock{m_fmGenerator->get_vid_mutex()};
-            m_fmGenerator->get_vid_cv().wait(lock, [this]() -> bool { return m_fmGenerator->is_generator_ready(); });
-            FrameHandler::get_instance(m_ctx, m_fmGenerator->get_vid_frame_width(),
-                                       m_fmGenerator->get_vid_frame_height());
-            m_computeYuvRgba = new ComputeYuvRgba(m_ctx,
-                                                  R"(D:\cProjects\realTimeFrameDisplay\shaders\yuvRgba.comp.spv)",
-                                                  m_fmGenerator->get_vid_frame_width(),
-                                                  m_fmGenerator->get_vid_frame_height());
+            ScopedMsTimer timer{m_probe_wait_ms};
+            for (std::future<void> &probe: probes) {
+                probe.get();
+            }
+        }
+        for (VideoStream &stream: m_streams) {
+            if (m_hw_decode != nullptr) {
+                stream.generator->set_hw_device(m_hw_decode->get_device());
+            }
+            stream.generator->process(stream.path.c_str());
+        }
+        size_t cacheBudgetMb = GpuFrameCache::budget_from_env() / m_streams.size();
+        KernelConfigs kernelConfigs{};
+        for (VideoStream &stream: m_streams) {
+            uint32_t videoWidth = 0;
+            uint32_t videoHeight = 0;
+            {
+                // Sized from the stream parameters, only containers that don't know the size wait for a frame.
+                std::unique_lock<std::mutex> lock{stream.generator->get_vid_mutex()};
+                stream.generator->get_vid_cv().wait(lock, [&stream]() -> bool {
+                    return (stream.generator->get_vid_frame_width() > 0 &&
+                            stream.generator->get_vid_frame_height() > 0) || stream.generator->is_generator_ready();
+                });
+                videoWidth = stream.generator->get_vid_frame_width();
+                videoHeight = stream.generator->get_vid_frame_height();
+            }
+            if (stream.id == 0) {
+                // Tuning happens outside the queue lock so the decoder keeps filling the frame queue. Every stream
+                // shares the first stream's pipeline, so it is tuned once at that resolution.
+                double keptPipelineMs = m_ctx->pipelineCreationMs;
+                KernelAutotuner autotuner{m_ctx, videoWidth, videoHeight};
+                kernelConfigs = autotuner.tune();
+                StreamBenchmark benchmark{m_ctx, videoWidth, videoHeight, kernelConfigs};
+                benchmark.run(StreamBenchmark::max_streams_from_env(),
+                              1000.0 * stream.generator->get_frame_duration());
+                // Only the pipelines the player keeps are reported, tuning variants are compiled once per device.
+                m_ctx->pipelineCreationMs = keptPipelineMs;
+            }
+            stream.width = videoWidth;
+            stream.height = videoHeight;
+        }
+        create_batch(kernelConfigs);
+        layout_grid();
+        // Streams outside the batch convert on their own and are scaled to their cell, all of them share the first
+        // converter's pipeline. The frame handler and the cache hold frames at whatever size the converter produces.
+        const ComputeYuvRgba *pipelineSource = nullptr;
+        for (VideoStream &stream: m_streams) {
+            stream.frameWidth = stream.width;
+            stream.frameHeight = stream.height;
+            if (stream.batchLayer < 0) {
+                stream.compute = new ComputeYuvRgba(m_ctx, SHADER_YUV_RGBA, stream.width, stream.height,
+                                                    kernelConfigs, pipelineSource, stream.cell.extent.width,
+                                                    stream.cell.extent.height);
+                if (pipelineSource == nullptr) pipelineSource = stream.compute;
+                if (DirtyTiles::is_requested()) stream.compute->enable_tile_diff();
+                stream.frameWidth = stream.compute->get_out_width();
+                stream.frameHeight = stream.compute->get_out_height();
+            }
+            stream.frameHandler = new FrameHandler(m_ctx, stream.frameWidth, stream.frameHeight);
+            stream.frameCache = new GpuFrameCache(m_ctx, stream.frameWidth, stream.frameHeight, cacheBudgetMb);
+            stream.generator->set_frame_cache(stream.frameCache, stream.id);
         }
+        LOG_INFO("Playing {} streams", m_streams.size());
+    }
 
-        create_pipeline();
+    // With FD_BATCHED_YUV=1 streams at the first stream's resolution share one batched converter, trading their
+    // filters for a single dispatch. A single stream gains nothing from a batch and keeps the per stream path.
+    void VulkanGraphics::create_batch(const KernelConfigs &kernelConfigs) {
+        if (!BatchedYuvRgba::is_requested()) return;
+        // The batch stages planes from the CPU, frames decoded on the GPU go through each stream's converter.
+        if (m_hw_decode != nullptr) return;
+        // So does the tile diff, the batch uploads every layer whole.
+        if (DirtyTiles::is_requested()) return;
+        const VideoStream &first = m_streams.front();
+        uint32_t layers = 0;
+        for (const VideoStream &stream: m_streams) {
+            if (stream.width == first.width && stream.height == first.height) layers++;
+        }
+        if (layers < 2) return;
+        m_batch = new BatchedYuvRgba(m_ctx, first.width, first.height, layers, kernelConfigs);
+        int32_t layer = 0;
+        for (VideoStream &stream: m_streams) {
+            if (stream.width == first.width && stream.height == first.height) stream.batchLayer = layer++;
+        }
     }
 
+    // Near square grid filled row by row, each video is stretched over its cell like the single stream was over the
+    // window.
+    void VulkanGraphics::layout_grid() {
+        auto count = static_cast<uint32_t>(m_streams.size());
+        auto cols = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+        uint32_t rows = (count + cols - 1) / cols;
+        uint32_t cellWidth = WIN_WIDTH / cols;
+        uint32_t cellHeight = WIN_HEIGHT / rows;
+        for (VideoStream &stream: m_streams) {
+            uint32_t col = stream.id % cols;
+            uint32_t row = stream.id / cols;
+            stream.cell.offset = {static_cast<int32_t>(col * cellWidth), static_cast<int32_t>(row * cellHeight)};
+            stream.cell.extent = {cellWidth, cellHeight};
+        }
+    }
+
+#pragma endregion
+
     void VulkanGraphics::create_instance() {
         VkApplicationInfo applicationInfo{};
         applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -90,9 +331,9 @@ namespace fd {
         applicationInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         applicationInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
         applicationInfo.pEngineName = "Real Time frame Engine";
-        applicationInfo.apiVersion = VK_API_VERSION_1_1;
+        applicationInfo.apiVersion = VulkanHwDecode::instance_api_version();
 
-        std::vector<const char *> windowExtensions{};
+        std::vector<const char *> &windowExtensions = m_instance_extensions;
         get_window_required_instance_extensions(windowExtensions);
         windowExtensions.push_back("VK_EXT_debug_utils");
         std::vector<const char *> requiredLayers = {"VK_LAYER_KHRONOS_validation"};
@@ -187,32 +428,27 @@ namespace fd {
         vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
         std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
         vkGetPhysicalDeviceQueueFamilyProperties(device, &count, queueFamilyProperties.data());
-        std::vector<VkQueueFamilyProperties>::iterator iter = std::find_if(queueFamilyProperties.begin(),
-                                                                           queueFamilyProperties.end(),
-                                                                           [](VkQueueFamilyProperties pr) -> bool {
-                                                                               return (pr.queueFlags &
-                                                                                       (VK_QUEUE_GRAPHICS_BIT |
-                                                                                        VK_QUEUE_TRANSFER_BIT));
-                                                                           });
-        if (iter == queueFamilyProperties.end()) {
+        std::optional<uint32_t> graphicsIndex = find_queue_family(queueFamilyProperties, VK_QUEUE_GRAPHICS_BIT, 0);
+        if (!graphicsIndex.has_value()) {
             LOG_ERROR("No valid queue found for graphics display in device");
             std::exit(EXIT_FAILURE);
         }
-        m_queue_family_index.graphicsIndex = iter - queueFamilyProperties.begin();
-        std::vector<VkQueueFamilyProperties>::iterator iterComp = std::find_if(queueFamilyProperties.begin(),
-                                                                               queueFamilyProperties.end(),
-                                                                               [](VkQueueFamilyProperties pr) -> bool {
-                                                                                   return pr.queueFlags &
-                                                                                          VK_QUEUE_COMPUTE_BIT;
-                                                                               });
-        if (iterComp == queueFamilyProperties.end()) {
-            LOG_INFO("No valid compute queue found");
-        } else {
-            m_queue_family_index.computeIndex = iter - queueFamilyProperties.begin();
+        m_queue_family_index.graphicsIndex = graphicsIndex;
+        // An async compute family lets the filter chain overlap the graphics work, a DMA family the plane uploads.
+        m_queue_family_index.computeIndex = find_queue_family(queueFamilyProperties, VK_QUEUE_COMPUTE_BIT,
+                                                              VK_QUEUE_GRAPHICS_BIT);
+        if (!m_queue_family_index.computeIndex.has_value()) {
+            // Graphics families always support compute.
+            m_queue_family_index.computeIndex = graphicsIndex;
+        }
+        m_queue_family_index.transferIndex = find_queue_family(queueFamilyProperties, VK_QUEUE_TRANSFER_BIT,
+                                                               VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+        if (!m_queue_family_index.transferIndex.has_value()) {
+            m_queue_family_index.transferIndex = m_queue_family_index.computeIndex;
         }
 
-        LOG_INFO("Graphics Queue {} Compute Queue {}", m_queue_family_index.graphicsIndex.value(),
-                 m_queue_family_index.computeIndex.value());
+        LOG_INFO("Graphics Queue {} Compute Queue {} Transfer Queue {}", m_queue_family_index.graphicsIndex.value(),
+                 m_queue_family_index.computeIndex.value(), m_queue_family_index.transferIndex.value());
         for (int i = 0; i < queueFamilyProperties.size(); i++) {
             VkBool32 hasPresentationQueue = VK_FALSE;
             vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &hasPresentationQueue);
@@ -224,38 +460,90 @@ namespace fd {
         return m_queue_family_index.is_valid();
     }
 
+    std::optional<uint32_t> VulkanGraphics::find_queue_family(const std::vector<VkQueueFamilyProperties> &properties,
+                                                              VkQueueFlags required, VkQueueFlags excluded) {
+        for (uint32_t i = 0; i < properties.size(); i++) {
+            if ((properties[i].queueFlags & required) == required && (properties[i].queueFlags & excluded) == 0) {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
+
     void VulkanGraphics::create_logical_device(VkPhysicalDevice &device) {
 
-        float priority = 1.0f;
-        std::set<uint32_t> indexes{m_queue_family_index.graphicsIndex.value(),
-                                   m_queue_family_index.presentationIndex.value(),
-                                   m_queue_family_index.computeIndex.value()};
+        std::vector<const char *> &requiredExtensions = m_device_extensions;
+        requiredExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        m_present_timing_mode = PresentScheduler::select_device_extensions(device, requiredExtensions,
+                                                                           m_present_timing_features);
+        uint32_t decodeFamily = 0;
+        if (VulkanHwDecode::is_requested() &&
+            VulkanHwDecode::select_device_extensions(device, requiredExtensions, m_hw_decode_features, decodeFamily)) {
+            m_queue_family_index.decodeIndex = decodeFamily;
+        }
+        uint32_t count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &count, queueFamilyProperties.data());
+
+        // Graphics and presentation take queue 0 of their families, compute and transfer the next free queue of theirs
+        // so that sharing a family doesn't serialise them, or the last queue once the family has run out.
+        std::map<uint32_t, uint32_t> queueCounts{{m_queue_family_index.graphicsIndex.value(), 1}};
+        queueCounts[m_queue_family_index.presentationIndex.value()] = 1;
+        auto nextQueue = [&queueCounts, &queueFamilyProperties](uint32_t family) -> uint32_t {
+            uint32_t &used = queueCounts[family];
+            if (used < queueFamilyProperties[family].queueCount) {
+                used++;
+            }
+            return used - 1;
+        };
+        m_queue_family_index.computeQueue = nextQueue(m_queue_family_index.computeIndex.value());
+        m_queue_family_index.transferQueue = nextQueue(m_queue_family_index.transferIndex.value());
+        if (m_queue_family_index.decodeIndex.has_value() && queueCounts[m_queue_family_index.decodeIndex.value()] == 0) {
+            queueCounts[m_queue_family_index.decodeIndex.value()] = 1;
+        }
+        uint32_t maxQueues = 0;
+        for (const auto &[family, queues]: queueCounts) {
+            maxQueues = (std::max)(maxQueues, queues);
+        }
+        std::vector<float> priorities(maxQueues, 1.0f);
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos{};
-        for (std::uint32_t i: indexes) {
+        for (const auto &[family, queues]: queueCounts) {
             VkDeviceQueueCreateInfo deviceQueueCreateInfo{};
             deviceQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-            deviceQueueCreateInfo.queueFamilyIndex = i;
-            deviceQueueCreateInfo.queueCount = 1;
-            deviceQueueCreateInfo.pQueuePriorities = &priority;
+            deviceQueueCreateInfo.queueFamilyIndex = family;
+            deviceQueueCreateInfo.queueCount = queues;
+            deviceQueueCreateInfo.pQueuePriorities = priorities.data();
             queueCreateInfos.push_back(deviceQueueCreateInfo);
         }
 
 
-        std::vector<const char *> requiredExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
-
         VkDeviceCreateInfo deviceCreateInfo{};
         deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
         deviceCreateInfo.queueCreateInfoCount = queueCreateInfos.size();
         deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
         deviceCreateInfo.enabledExtensionCount = requiredExtensions.size();
         deviceCreateInfo.ppEnabledExtensionNames = requiredExtensions.data();
+        if (m_present_timing_mode == PresentTimingMode::PRESENT_WAIT) {
+            deviceCreateInfo.pNext = &m_present_timing_features.presentId;
+        }
+        if (m_queue_family_index.decodeIndex.has_value()) {
+            m_hw_decode_features.vulkan13.pNext = const_cast<void *>(deviceCreateInfo.pNext);
+            deviceCreateInfo.pNext = &m_hw_decode_features.features2;
+        }
 
         VK_CHECK(vkCreateDevice(device, &deviceCreateInfo, nullptr, &m_device.logicalDevice),
                  "Failed to create the logical device");
         vkGetDeviceQueue(m_device.logicalDevice, m_queue_family_index.graphicsIndex.value(), 0, &m_graphics_queue);
         vkGetDeviceQueue(m_device.logicalDevice, m_queue_family_index.presentationIndex.value(), 0,
                          &m_presentation_queue);
-        vkGetDeviceQueue(m_device.logicalDevice, m_queue_family_index.computeIndex.value(), 0, &m_compute_queue);
+        vkGetDeviceQueue(m_device.logicalDevice, m_queue_family_index.computeIndex.value(),
+                         m_queue_family_index.computeQueue, &m_compute_queue);
+        vkGetDeviceQueue(m_device.logicalDevice, m_queue_family_index.transferIndex.value(),
+                         m_queue_family_index.transferQueue, &m_transfer_queue);
+        LOG_INFO("Compute on queue {}.{}, transfers on queue {}.{}", m_queue_family_index.computeIndex.value(),
+                 m_queue_family_index.computeQueue, m_queue_family_index.transferIndex.value(),
+                 m_queue_family_index.transferQueue);
     }
 
 #pragma endregion
@@ -275,25 +563,64 @@ namespace fd {
         return formats[0];
     }
 
+    VulkanGraphics::LatencyMode VulkanGraphics::parse_latency_mode(const char *name) {
+        std::string mode = name != nullptr ? name : "";
+        if (mode == "fifo" || mode == "vsync") {
+            return LatencyMode::VSYNC;
+        }
+        if (mode == "immediate" || mode == "unthrottled") {
+            return LatencyMode::UNTHROTTLED;
+        }
+        return LatencyMode::LOW_LATENCY;
+    }
+
     VkPresentModeKHR VulkanGraphics::select_present_mode() {
         uint32_t count = 0;
         vkGetPhysicalDeviceSurfacePresentModesKHR(m_device.physicalDevice, m_surface, &count, nullptr);
         std::vector<VkPresentModeKHR> modes(count);
         vkGetPhysicalDeviceSurfacePresentModesKHR(m_device.physicalDevice, m_surface, &count, modes.data());
+        VkPresentModeKHR wanted = VK_PRESENT_MODE_FIFO_KHR;
+        if (m_latency_mode == LatencyMode::LOW_LATENCY) {
+            wanted = VK_PRESENT_MODE_MAILBOX_KHR;
+        } else if (m_latency_mode == LatencyMode::UNTHROTTLED) {
+            wanted = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        }
         for (int i = 0; i < count; i++) {
-            if (modes[i] == VK_PRESENT_MODE_MAILBOX_KHR) {
+            if (modes[i] == wanted) {
                 return modes[i];
             }
         }
+        // FIFO is the only mode every surface supports.
+        LOG_WARN("Requested present mode is not supported, falling back to FIFO");
+        m_latency_mode = LatencyMode::VSYNC;
         return VK_PRESENT_MODE_FIFO_KHR;
     }
 
+    // Mailbox needs a spare image to replace while one is queued, FIFO and immediate keep the queue as short as the
+    // surface allows since every extra image is a frame of latency.
+    uint32_t VulkanGraphics::select_image_count() const {
+        uint32_t imageCount = m_surface_capabilities.minImageCount;
+        if (m_latency_mode == LatencyMode::LOW_LATENCY) {
+            imageCount = imageCount + 1 > 3 ? imageCount + 1 : 3;
+        } else if (imageCount < 2) {
+            imageCount = 2;
+        }
+        if (m_surface_capabilities.maxImageCount > 0 && imageCount > m_surface_capabilities.maxImageCount) {
+            imageCount = m_surface_capabilities.maxImageCount;
+        }
+        return imageCount;
+    }
+
     void VulkanGraphics::create_swapchain() {
         vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_device.physicalDevice, m_surface,
                                                   &m_surface_capabilities);
         m_format = select_format();
+        const char *latencyMode = std::getenv("FD_LATENCY_MODE");
+        // A transcode should not be held to the display's refresh unless asked to.
+        m_latency_mode = latencyMode == nullptr && FrameEncoder::requested_path() != nullptr ?
+                         LatencyMode::UNTHROTTLED : parse_latency_mode(latencyMode);
         m_present_mode = select_present_mode();
-        m_image_count = m_surface_capabilities.minImageCount + 1;
+        m_image_count = select_image_count();
 
         VkSwapchainCreateInfoKHR createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -333,7 +660,7 @@ namespace fd {
         for (int i = 0; i < m_image_count; i++) {
             create_image_view(m_device.logicalDevice, m_images[i], m_image_views[i], m_format.format);
         }
-        LOG_INFO("Swapchain Configured Successfully");
+        LOG_INFO("Swapchain Configured Successfully with {} images", m_image_count);
     }
 
 #pragma endregion
@@ -401,10 +728,9 @@ namespace fd {
     }
 
     void VulkanGraphics::create_pipeline() {
-        VkShaderModule vertexShaderModule = create_shader_module(m_device.logicalDevice,
-                                                                 R"(D:\cProjects\realTimeFrameDisplay\shaders\default.vert.spv)");
-        VkShaderModule fragShaderModule = create_shader_module(m_device.logicalDevice,
-                                                               R"(D:\cProjects\realTimeFrameDisplay\shaders\default.frag.spv)");
+        ScopedMsTimer timer{m_ctx->pipelineCreationMs};
+        VkShaderModule vertexShaderModule = create_shader_module(m_device.logicalDevice, SHADER_DEFAULT_VERT);
+        VkShaderModule fragShaderModule = create_shader_module(m_device.logicalDevice, SHADER_DEFAULT_FRAG);
 
         VkPipelineShaderStageCreateInfo vertexStage{};
         vertexStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -514,13 +840,95 @@ namespace fd {
         createInfo.pViewportState = &viewportStateCreateInfo;
         createInfo.pColorBlendState = &colorBlendStateCreateInfo;
 
-        VK_CHECK(vkCreateGraphicsPipelines(m_device.logicalDevice, nullptr, 1, &createInfo, nullptr,
+        VK_CHECK(vkCreateGraphicsPipelines(m_device.logicalDevice, m_pipeline_cache, 1, &createInfo, nullptr,
                                            &m_graphics_pipeline), "Failed to create the graphics pipeline");
 
         vkDestroyShaderModule(m_device.logicalDevice, vertexShaderModule, nullptr);
         vkDestroyShaderModule(m_device.logicalDevice, fragShaderModule, nullptr);
     }
 
+#pragma endregion
+#pragma region PIPELINE_CACHE
+
+    // File layout is the magic, the file version and then the driver's pipeline cache blob.
+    static constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x43504446;
+    static constexpr uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+    void VulkanGraphics::create_pipeline_cache() {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(m_device.physicalDevice, &properties);
+        std::ostringstream path{};
+        path << "pipeline_cache_";
+        for (uint8_t byte: properties.pipelineCacheUUID) {
+            path << std::hex << ((byte >> 4) & 0xF) << (byte & 0xF);
+        }
+        path << "_" << std::hex << properties.driverVersion << ".bin";
+        m_pipeline_cache_path = path.str();
+
+        std::vector<uint8_t> fileBytes{};
+        std::ifstream inputStream(m_pipeline_cache_path, std::ios::binary);
+        if (inputStream) {
+            read_binary_file(m_pipeline_cache_path.c_str(), fileBytes);
+        }
+
+        // The driver is meant to reject a foreign blob, but not every driver does, so the header is checked here.
+        const uint8_t *initialData = nullptr;
+        size_t initialSize = 0;
+        constexpr size_t fileHeaderSize = 2 * sizeof(uint32_t);
+        if (fileBytes.size() > fileHeaderSize + sizeof(VkPipelineCacheHeaderVersionOne)) {
+            uint32_t magic = 0;
+            uint32_t version = 0;
+            VkPipelineCacheHeaderVersionOne header{};
+            memcpy(&magic, fileBytes.data(), sizeof(uint32_t));
+            memcpy(&version, fileBytes.data() + sizeof(uint32_t), sizeof(uint32_t));
+            memcpy(&header, fileBytes.data() + fileHeaderSize, sizeof(VkPipelineCacheHeaderVersionOne));
+            if (magic == PIPELINE_CACHE_MAGIC && version == PIPELINE_CACHE_FILE_VERSION &&
+                header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+                memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0) {
+                initialData = fileBytes.data() + fileHeaderSize;
+                initialSize = fileBytes.size() - fileHeaderSize;
+            } else {
+                LOG_WARN("Ignoring stale pipeline cache {}", m_pipeline_cache_path);
+            }
+        }
+
+        VkPipelineCacheCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        createInfo.initialDataSize = initialSize;
+        createInfo.pInitialData = initialData;
+        VK_CHECK(vkCreatePipelineCache(m_device.logicalDevice, &createInfo, nullptr, &m_pipeline_cache),
+                 "Failed to create the pipeline cache");
+        m_pipeline_cache_warm = initialSize > 0;
+        LOG_INFO("Pipeline cache {} loaded {} bytes", m_pipeline_cache_path, initialSize);
+    }
+
+    void VulkanGraphics::save_pipeline_cache() {
+        size_t size = 0;
+        vkGetPipelineCacheData(m_device.logicalDevice, m_pipeline_cache, &size, nullptr);
+        std::vector<uint8_t> data(size);
+        if (size == 0 ||
+            vkGetPipelineCacheData(m_device.logicalDevice, m_pipeline_cache, &size, data.data()) != VK_SUCCESS) {
+            return;
+        }
+        // Written aside and renamed so a crash mid write never leaves a truncated cache behind.
+        std::string tempPath = m_pipeline_cache_path + ".tmp";
+        {
+            std::ofstream outputStream(tempPath, std::ios::binary | std::ios::trunc);
+            if (!outputStream) {
+                LOG_WARN("Failed to write the pipeline cache {}", tempPath);
+                return;
+            }
+            outputStream.write(reinterpret_cast<const char *>(&PIPELINE_CACHE_MAGIC), sizeof(uint32_t));
+            outputStream.write(reinterpret_cast<const char *>(&PIPELINE_CACHE_FILE_VERSION), sizeof(uint32_t));
+            outputStream.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(size));
+        }
+        std::remove(m_pipeline_cache_path.c_str());
+        if (std::rename(tempPath.c_str(), m_pipeline_cache_path.c_str()) != 0) {
+            LOG_WARN("Failed to replace the pipeline cache {}", m_pipeline_cache_path);
+        }
+    }
+
 #pragma endregion
 #pragma region RENDER
 
@@ -532,46 +940,81 @@ namespace fd {
 
         VK_CHECK(vkCreateCommandPool(m_device.logicalDevice, &commandPoolCreateInfo, nullptr, &m_command_pool),
                  "Failed to create the command pool");
+        commandPoolCreateInfo.queueFamilyIndex = m_queue_family_index.computeIndex.value();
+        VK_CHECK(vkCreateCommandPool(m_device.logicalDevice, &commandPoolCreateInfo, nullptr, &m_compute_command_pool),
+                 "Failed to create the compute command pool");
         VkCommandBufferAllocateInfo allocateInfo{};
         allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocateInfo.commandPool = m_command_pool;
-        allocateInfo.commandBufferCount = 1;
-        VK_CHECK(vkAllocateCommandBuffers(m_device.logicalDevice, &allocateInfo, &m_command_buffer),
-                 "failed to allocate the command buffer");
-
+        allocateInfo.commandBufferCount = m_image_count;
+        std::vector<VkCommandBuffer> commandBuffers(m_image_count);
+        VK_CHECK(vkAllocateCommandBuffers(m_device.logicalDevice, &allocateInfo, commandBuffers.data()),
+                 "failed to allocate the command buffers");
+        m_frames.resize(m_image_count);
+        for (uint32_t i = 0; i < m_image_count; i++) {
+            m_frames[i].commandBuffer = commandBuffers[i];
+        }
+        m_command_buffer = m_frames[0].commandBuffer;
     }
 
     void VulkanGraphics::create_semaphore_and_fences() {
         VkSemaphoreCreateInfo semaphoreCreateInfo{};
         semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-        VK_CHECK(vkCreateSemaphore(m_device.logicalDevice, &semaphoreCreateInfo, nullptr, &m_get_image_semaphore),
-                 "failed to create the get image semaphore");
-        VK_CHECK(vkCreateSemaphore(m_device.logicalDevice, &semaphoreCreateInfo, nullptr, &m_render_image_semaphore),
-                 "failed to create the render image semaphore");
-
         VkFenceCreateInfo fenceCreateInfo{};
         fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        VK_CHECK(vkCreateFence(m_device.logicalDevice, &fenceCreateInfo, nullptr, &m_render_fence),
-                 "failed to create the render fence");
-
+        for (FrameSlot &frame: m_frames) {
+            VK_CHECK(vkCreateSemaphore(m_device.logicalDevice, &semaphoreCreateInfo, nullptr,
+                                       &frame.getImageSemaphore), "failed to create the get image semaphore");
+            VK_CHECK(vkCreateFence(m_device.logicalDevice, &fenceCreateInfo, nullptr, &frame.renderFence),
+                     "failed to create the render fence");
+        }
+        // The render semaphore belongs to the image, a present may still be waiting on it when the slot is reused.
+        m_render_image_semaphores.resize(m_image_count);
+        for (VkSemaphore &semaphore: m_render_image_semaphores) {
+            VK_CHECK(vkCreateSemaphore(m_device.logicalDevice, &semaphoreCreateInfo, nullptr, &semaphore),
+                     "failed to create the render image semaphore");
+        }
+        m_image_fences.assign(m_image_count, VK_NULL_HANDLE);
     }
 
     void VulkanGraphics::begin_frame() {
-        vkWaitForFences(m_device.logicalDevice, 1, &m_render_fence, VK_TRUE, UINT64_MAX);
+        FrameSlot &frame = m_frames[m_curr_frame];
+        {
+            TRACE_SCOPE("wait render fence");
+            vkWaitForFences(m_device.logicalDevice, 1, &frame.renderFence, VK_TRUE, UINT64_MAX);
+        }
+        // The slot's fence is reset when this frame is submitted, readbacks it carried are collected before that.
+        if (m_encoder != nullptr) {
+            m_encoder->collect();
+        }
+        if (m_checksums != nullptr) {
+            m_checksums->poll();
+        }
+        {
+            TRACE_SCOPE("vkAcquireNextImageKHR");
+            vkAcquireNextImageKHR(m_device.logicalDevice, m_swap_chain, UINT64_MAX, frame.getImageSemaphore, nullptr,
+                                  &m_curr_image);
+        }
+        // The acquired image can still be in use by a frame recorded from another slot.
+        VkFence &imageFence = m_image_fences[m_curr_image];
+        if (imageFence != VK_NULL_HANDLE && imageFence != frame.renderFence) {
+            TRACE_SCOPE("wait image fence");
+            vkWaitForFences(m_device.logicalDevice, 1, &imageFence, VK_TRUE, UINT64_MAX);
+        }
+        imageFence = frame.renderFence;
+
+        m_command_buffer = frame.commandBuffer;
         vkResetCommandBuffer(m_command_buffer, 0);
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         VK_CHECK(vkBeginCommandBuffer(m_command_buffer, &beginInfo), "Failed to begin the command buffer");
+    }
 
+    // Uploads are recorded ahead of the render pass, copies are not allowed inside it.
+    void VulkanGraphics::begin_render_pass() {
         VkViewport viewport{0, 0, WIN_WIDTH, WIN_HEIGHT, 0, 1};
-        VkRect2D scissors{0, 0, WIN_WIDTH, WIN_HEIGHT};
-        vkAcquireNextImageKHR(m_device.logicalDevice, m_swap_chain, UINT64_MAX, m_get_image_semaphore, nullptr,
-                              &m_curr_image);
         vkCmdBindPipeline(m_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphics_pipeline);
-        vkCmdSetViewport(m_command_buffer, 0, 1, &viewport);
-        vkCmdSetScissor(m_command_buffer, 0, 1, &scissors);
 
         // Starting the render pass.
         VkClearValue clearValue{};
@@ -586,77 +1029,221 @@ namespace fd {
         renderPassBeginInfo.clearValueCount = 1;
         renderPassBeginInfo.pClearValues = &clearValue;
 
+        // Timestamps are written outside the render pass, the draw stage covers every stream's draw.
+        m_draw_profile_scope = gpu_profile_begin(m_ctx, m_command_buffer, GpuStage::DRAW,
+                                                 m_queue_family_index.graphicsIndex.value());
         vkCmdBeginRenderPass(m_command_buffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-    }
-
-    void VulkanGraphics::draw() {
-        VkDeviceSize offset{};
-        vkCmdBindVertexBuffers(m_command_buffer, 0, 1, &quadVertBuffer, &offset);
+        VkDeviceSize vertOffset{};
+        vkCmdBindVertexBuffers(m_command_buffer, 0, 1, &quadVertBuffer, &vertOffset);
         vkCmdBindIndexBuffer(m_command_buffer, quadIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    }
 
-        vkCmdBindDescriptorSets(m_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphics_layout, 0, 1,
-                                &m_ctx->desSetFrame[m_curr_image], 0,
-                                nullptr);
+    void VulkanGraphics::upload_frames(std::vector<VideoFrame *> &videoFrames) {
+        // The batch staging buffers and array images are single buffered like the per stream ones.
+        if (m_batch != nullptr && m_batch_fence != VK_NULL_HANDLE) {
+            TRACE_SCOPE("wait batch fence");
+            vkWaitForFences(m_device.logicalDevice, 1, &m_batch_fence, VK_TRUE, UINT64_MAX);
+        }
+        for (VideoStream &stream: m_streams) {
+            VideoFrame *videoFrame = videoFrames[stream.id];
+            // A repeated frame draws the image already on the quad, nothing is converted or uploaded.
+            if (videoFrame != nullptr) {
+                upload(stream, *videoFrame);
+            }
+            if (stream.id == 0) {
+                schedule_present(stream, videoFrame);
+            } else if (videoFrame != nullptr) {
+                stream.pendingPts = videoFrame->pts_seconds;
+            }
+        }
+        // One submit converts every staged layer, the copies out of the layers ride in the frame's command buffer.
+        if (m_batch != nullptr && m_batch->compute()) {
+            m_batch->record_acquire(m_command_buffer);
+            uint32_t profileScope = gpu_profile_begin(m_ctx, m_command_buffer, GpuStage::COPY,
+                                                      m_queue_family_index.graphicsIndex.value());
+            for (VideoStream &stream: m_streams) {
+                if (!stream.batchStaged) continue;
+                stream.frameHandler->record_copy(m_command_buffer, m_batch->get_rgba_image(),
+                                                 static_cast<uint32_t>(stream.batchLayer), stream.batchCacheImage);
+                stream.batchStaged = false;
+            }
+            gpu_profile_end(m_ctx, m_command_buffer, profileScope);
+            m_batch->record_release(m_command_buffer);
+            m_batch_submitted = true;
+        }
+    }
 
-        {
-            m_fmGenerator->get_vid_mutex().lock();
-            VideoFrame videoFrame = std::move(m_fmGenerator->get_vide_frame_queue().front());
-            m_fmGenerator->notify_video_frame_processed();
-            m_fmGenerator->get_vid_mutex().unlock();
+    void VulkanGraphics::upload(VideoStream &stream, VideoFrame &videoFrame) {
+        // The staging buffers, the converted image and the presented image are single buffered, the frame that last
+        // read them, normally the previous one, has to finish before they are overwritten.
+        if (stream.uploadFence != VK_NULL_HANDLE) {
+            TRACE_SCOPE("wait upload fence");
+            vkWaitForFences(m_device.logicalDevice, 1, &stream.uploadFence, VK_TRUE, UINT64_MAX);
+        }
+        VkImage cachedImage = VK_NULL_HANDLE;
+        if (stream.frameCache->lookup(stream.id, videoFrame.pts_seconds, cachedImage)) {
+            stream.frameHandler->render_from_cached_image(cachedImage);
+            // The copy is recorded, a later insert reusing the entry is ordered after it on the graphics queue.
+            videoFrame.cachePin.reset();
+            // The presented image no longer holds what the converter last produced.
+            if (stream.compute != nullptr) stream.compute->reset_tile_diff();
+            stream.uploadedThisFrame = true;
+            stream.handlerSubmitted = true;
+        } else if (videoFrame.hwFrame) {
+            // The decoder image's semaphore orders its reuse after the copy, the frame can go back to its pool.
+            VkImage cacheImage = stream.frameCache->insert(stream.id, videoFrame.pts_seconds);
+            stream.compute->compute_hw(videoFrame.hwFrame.get());
+            videoFrame.hwFrame.reset();
+            stream.frameHandler->render_with_compute_image(stream.compute->get_rgba_image(),
+                                                           stream.compute->get_compute_semaphore(), cacheImage);
+            stream.handlerSubmitted = true;
+            stream.uploadedThisFrame = true;
+        } else if (videoFrame.yPlane) {
             std::unique_ptr<uint8_t[]> yPlane = std::move(videoFrame.yPlane);
             std::unique_ptr<uint8_t[]> vPlane = std::move(videoFrame.vPlane);
             std::unique_ptr<uint8_t[]> uPlane = std::move(videoFrame.uPlane);
-            m_computeYuvRgba->compute(yPlane.get(), uPlane.get(), vPlane.get());
-            //Scalar RGBA conversion.
-   //         uint32_t *rgba = new uint32_t[m_fmGenerator->get_vid_frame_width() * m_fmGenerator->get_vid_frame_height()];
-//            yuv_to_rgba(m_fmGenerator->get_vid_frame_width(), m_fmGenerator->get_vid_frame_height(), yPlane.get(),
-//                        vPlane.get(), uPlane.get(), rgba);
-            FrameHandler::get_instance(m_ctx, 0, 0)->render_with_compute_image(m_computeYuvRgba->get_rgba_image(),
-                                                                               m_computeYuvRgba->get_compute_semaphore());
-            //FrameHandler::get_instance(m_ctx, 0, 0)->render(rgba);
-            double pts = videoFrame.pts_seconds;
-            double timePassed = std::chrono::duration<double>(
-                    std::chrono::steady_clock::now() - m_fmGenerator->frame_start).count();
-
-            if (timePassed < pts) {
-                std::this_thread::sleep_for(std::chrono::duration<double>(pts - timePassed));
-            } else if (pts < timePassed) {
-                LOG_INFO("Bad Frame");
+            VkImage cacheImage = stream.frameCache->insert(stream.id, videoFrame.pts_seconds);
+            if (stream.batchLayer >= 0) {
+                m_batch->stage(static_cast<uint32_t>(stream.batchLayer), yPlane.get(), uPlane.get(), vPlane.get());
+                stream.batchCacheImage = cacheImage;
+                stream.batchStaged = true;
+            } else {
+                stream.compute->compute(yPlane.get(), uPlane.get(), vPlane.get());
+                stream.frameHandler->render_with_compute_image(stream.compute->get_rgba_image(),
+                                                               stream.compute->get_compute_semaphore(), cacheImage,
+                                                               stream.compute->get_converted_rects());
+                stream.handlerSubmitted = true;
             }
-          //  delete[] rgba;
-
+            stream.uploadedThisFrame = true;
         }
+    }
 
+    void VulkanGraphics::draw(VideoStream &stream) {
+        // Until its first frame lands the stream's image is not in a sampled layout, its cell keeps the clear color.
+        if (!stream.uploadedThisFrame && !stream.hasShownFrame) return;
+        VkViewport viewport{static_cast<float>(stream.cell.offset.x), static_cast<float>(stream.cell.offset.y),
+                            static_cast<float>(stream.cell.extent.width),
+                            static_cast<float>(stream.cell.extent.height), 0, 1};
+        vkCmdSetViewport(m_command_buffer, 0, 1, &viewport);
+        vkCmdSetScissor(m_command_buffer, 0, 1, &stream.cell);
+        vkCmdBindDescriptorSets(m_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphics_layout, 0, 1,
+                                &stream.frameHandler->get_des_sets()[m_curr_image], 0,
+                                nullptr);
         vkCmdDrawIndexed(m_command_buffer, 6, 1, 0, 0, 0);
     }
 
     void VulkanGraphics::end_frame() {
         vkCmdEndRenderPass(m_command_buffer);
+        gpu_profile_end(m_ctx, m_command_buffer, m_draw_profile_scope);
+        VideoStream &encoded = m_streams.front();
+        if (m_encoder != nullptr && encoded.uploadedThisFrame) {
+            m_encoder->record_readback(m_command_buffer, encoded.frameHandler->get_image(), encoded.pendingPts);
+        }
+        if (m_checksums != nullptr && encoded.uploadedThisFrame) {
+            double pts = encoded.pendingPts;
+            ReadbackRegion region{encoded.frameHandler->get_image(), encoded.frameWidth, encoded.frameHeight,
+                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT,
+                                  VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT};
+            m_checksums->record(m_command_buffer, m_checksum_frames++, region,
+                                [pts](uint64_t frameId, const uint8_t *data, VkDeviceSize size) -> void {
+                                    // FNV-1a
+                                    uint64_t hash = 14695981039346656037ull;
+                                    for (VkDeviceSize i = 0; i < size; i++) {
+                                        hash = (hash ^ data[i]) * 1099511628211ull;
+                                    }
+                                    LOG_INFO("Frame {} at {:.3f} s checksum {:016x}", frameId, pts, hash);
+                                });
+        }
         vkEndCommandBuffer(m_command_buffer);
-        std::vector<VkPipelineStageFlags> waitFlags{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT};
-        std::array<VkSemaphore, 2> semaphores{m_get_image_semaphore, FrameHandler::get_instance(m_ctx, 0, 0)->get_frame_handler_semaphore()};
+        FrameSlot &frame = m_frames[m_curr_frame];
+        std::vector<VkSemaphore> semaphores{frame.getImageSemaphore};
+        std::vector<VkPipelineStageFlags> waitFlags{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+        // A frame handler only signals when it submitted its own copy, a repeated stream must not be waited on.
+        for (VideoStream &stream: m_streams) {
+            if (stream.handlerSubmitted) {
+                semaphores.push_back(stream.frameHandler->get_frame_handler_semaphore());
+                waitFlags.push_back(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+            }
+        }
+        // Batched layers are copied at the top of this command buffer.
+        if (m_batch_submitted) {
+            semaphores.push_back(m_batch->get_semaphore());
+            waitFlags.push_back(VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
 
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &m_command_buffer;
-        submitInfo.waitSemaphoreCount = semaphores.size();
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(semaphores.size());
         submitInfo.pWaitSemaphores = semaphores.data();
         submitInfo.pWaitDstStageMask = waitFlags.data();
         submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = &m_render_image_semaphore;
-        vkResetFences(m_device.logicalDevice, 1, &m_render_fence);
-        vkQueueSubmit(m_graphics_queue, 1, &submitInfo, m_render_fence);
+        submitInfo.pSignalSemaphores = &m_render_image_semaphores[m_curr_image];
+        vkResetFences(m_device.logicalDevice, 1, &frame.renderFence);
+        queue_submit(m_ctx, m_graphics_queue, submitInfo, frame.renderFence);
+        if (m_encoder != nullptr) {
+            m_encoder->on_submitted(frame.renderFence);
+        }
+        if (m_checksums != nullptr) {
+            m_checksums->on_submitted(frame.renderFence);
+        }
+        for (VideoStream &stream: m_streams) {
+            // A repeated frame still samples the presented image, the next upload overwrites it after this frame.
+            if (stream.uploadedThisFrame || stream.hasShownFrame) {
+                stream.uploadFence = frame.renderFence;
+            }
+            stream.handlerSubmitted = false;
+        }
+        if (m_batch_submitted) {
+            m_batch_fence = frame.renderFence;
+            m_batch_submitted = false;
+        }
 
+        // The frame is recorded and submitted ahead, only the present is held back until its target time.
+        {
+            TRACE_SCOPE("wait present target");
+            m_present_scheduler.wait_for_target(m_present_target);
+        }
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = &m_render_image_semaphore;
+        presentInfo.pWaitSemaphores = &m_render_image_semaphores[m_curr_image];
         presentInfo.swapchainCount = 1;
         presentInfo.pSwapchains = &m_swap_chain;
         presentInfo.pImageIndices = &m_curr_image;
+        m_present_scheduler.prepare_present(presentInfo, m_present_target);
 
-        vkQueuePresentKHR(m_presentation_queue, &presentInfo);
+        {
+            TRACE_SCOPE("vkQueuePresentKHR");
+            std::lock_guard<std::mutex> lock{m_ctx->queueMutex};
+            vkQueuePresentKHR(m_presentation_queue, &presentInfo);
+        }
+        m_present_scheduler.on_presented();
+        if (!m_first_frame_shown) {
+            log_time_to_first_frame();
+        }
+        for (VideoStream &stream: m_streams) {
+            if (stream.uploadedThisFrame) {
+                stream.generator->get_master_clock().on_video_shown(stream.pendingPts);
+                stream.hasShownFrame = true;
+                stream.uploadedThisFrame = false;
+            }
+        }
+        m_curr_frame = (m_curr_frame + 1) % static_cast<uint32_t>(m_frames.size());
+    }
+
+    // Counted from the start of init to the first present that carries a decoded frame.
+    void VulkanGraphics::log_time_to_first_frame() {
+        bool hasFrame = std::any_of(m_streams.begin(), m_streams.end(), [](const VideoStream &stream) -> bool {
+            return stream.uploadedThisFrame;
+        });
+        if (!hasFrame) return;
+        m_first_frame_shown = true;
+        m_time_to_first_frame_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                                             m_startup_start).count();
+        LOG_INFO("Time to first frame {:.2f} ms, the device was ready at {:.2f} ms and waited {:.2f} ms on probing",
+                 m_time_to_first_frame_ms, m_device_ready_ms, m_probe_wait_ms);
     }
 
     void VulkanGraphics::prepare_quad_display() {
@@ -705,13 +1292,41 @@ namespace fd {
     }
 
     void VulkanGraphics::render() {
+        // Only the first stream paces the loop, the others show whatever their clocks allow at this present.
+        FrameGeneratorTwo *pacing = m_streams.front().generator;
+        bool transcoded = false;
         {
-            std::unique_lock<std::mutex> lock{m_fmGenerator->get_vid_mutex()};
-            m_fmGenerator->get_vid_cv().wait(lock,
-                                             [this]() -> bool { return !m_fmGenerator->get_vide_frame_queue().empty(); });
+            TRACE_SCOPE("wait video frame");
+            std::unique_lock<std::mutex> lock{pacing->get_vid_mutex()};
+            bool encoding = m_encoder != nullptr;
+            pacing->get_vid_cv().wait(lock, [pacing, encoding]() -> bool {
+                return !pacing->get_vide_frame_queue().empty() || (encoding && pacing->is_video_finished());
+            });
+            transcoded = pacing->get_vide_frame_queue().empty();
+        }
+        if (transcoded) {
+            finish_encoding();
+            return;
+        }
+        Trace::poll();
+        if (m_ctx->profiler != nullptr) {
+            m_ctx->profiler->next_frame();
         }
         begin_frame();
-        draw();
+        std::vector<VideoFrame> videoFrames(m_streams.size());
+        std::vector<VideoFrame *> shownFrames(m_streams.size(), nullptr);
+        for (VideoStream &stream: m_streams) {
+            if (next_frame_for_clock(stream, videoFrames[stream.id]) == FrameAction::SHOW) {
+                shownFrames[stream.id] = &videoFrames[stream.id];
+            } else {
+                stream.repeatedFrames++;
+            }
+        }
+        upload_frames(shownFrames);
+        begin_render_pass();
+        for (VideoStream &stream: m_streams) {
+            draw(stream);
+        }
         end_frame();
     }
 
@@ -746,4 +1361,104 @@ namespace fd {
     }
 
 #pragma endregion
-}
\ No newline at end of file
+#pragma region ENCODE
+
+    // FD_ENCODE turns the player into a transcoder of the first stream, the window shows the frames as they go.
+    void VulkanGraphics::create_encoder() {
+        const char *path = FrameEncoder::requested_path();
+        if (path == nullptr) return;
+        VideoStream &stream = m_streams.front();
+        m_encoder = new FrameEncoder(m_ctx, stream.frameWidth, stream.frameHeight,
+                                     stream.generator->get_frame_duration(), path);
+        if (!m_encoder->is_open()) {
+            LOG_ERROR("Transcoding to {} is disabled", path);
+            m_encoder->clean_up();
+            delete m_encoder;
+            m_encoder = nullptr;
+        }
+    }
+
+    void VulkanGraphics::finish_encoding() {
+        m_encoder->finish();
+        glfwSetWindowShouldClose(m_window, GLFW_TRUE);
+    }
+
+    void VulkanGraphics::create_checksums() {
+        const char *checksums = std::getenv("FD_FRAME_CHECKSUMS");
+        if (checksums == nullptr || std::strcmp(checksums, "1") != 0) return;
+        VideoStream &stream = m_streams.front();
+        VkDeviceSize frameSize = static_cast<VkDeviceSize>(stream.frameWidth) * stream.frameHeight * sizeof(uint32_t);
+        m_checksums = new ReadbackRing(m_ctx, frameSize, ReadbackRing::depth_from_env(3), "checksums");
+    }
+
+#pragma endregion
+#pragma region THUMBNAILS
+
+    void VulkanGraphics::run_thumbnails(const char *listPath) {
+        ThumbnailBatch batch{m_ctx, listPath};
+        batch.run();
+        batch.clean_up();
+        save_pipeline_cache();
+        glfwSetWindowShouldClose(m_window, GLFW_TRUE);
+    }
+
+#pragma endregion
+#pragma region AV_SYNC
+
+    // Frames more than one frame late are dropped before any upload or conversion, frames more than one frame early
+    // leave the current image on screen for another present. Drift against the master clock stays under a frame.
+    VulkanGraphics::FrameAction VulkanGraphics::next_frame_for_clock(VideoStream &stream, VideoFrame &videoFrame) {
+        FrameGeneratorTwo *generator = stream.generator;
+        MasterClock &clock = generator->get_master_clock();
+        double frameDuration = generator->get_frame_duration();
+        std::lock_guard<std::mutex> lock{generator->get_vid_mutex()};
+        std::queue<VideoFrame> &frameQueue = generator->get_vide_frame_queue();
+        // A seek can flush the queue between the wait in render and here, streams other than the first never wait.
+        if (frameQueue.empty()) {
+            stream.repeatWait = frameDuration;
+            return FrameAction::REPEAT;
+        }
+        // A transcode shows every frame in order, nothing is dropped or held back for the clock.
+        if (m_encoder != nullptr && stream.id == 0) {
+            videoFrame = std::move(frameQueue.front());
+            generator->notify_video_frame_processed();
+            return FrameAction::SHOW;
+        }
+        double masterTime = clock.now();
+        FrameDecision decision{};
+        while ((decision = MasterClock::decide_frame(frameQueue.front().pts_seconds, masterTime, frameDuration,
+                                                     frameQueue.size() > 1, stream.hasShownFrame)) ==
+               FrameDecision::DROP) {
+            LOG_DEBUG_EVERY_MS(1000, "Stream {} dropped a frame {:.1f} ms late", stream.id,
+                               (masterTime - frameQueue.front().pts_seconds) * 1000.0);
+            generator->notify_video_frame_processed();
+            stream.droppedFrames++;
+        }
+        if (decision == FrameDecision::REPEAT) {
+            double early = frameQueue.front().pts_seconds - masterTime;
+            stream.repeatWait = early - frameDuration < frameDuration ? early - frameDuration : frameDuration;
+            return FrameAction::REPEAT;
+        }
+        videoFrame = std::move(frameQueue.front());
+        generator->notify_video_frame_processed();
+        return FrameAction::SHOW;
+    }
+
+    // Maps the frame pts onto steady_clock so the scheduler can aim the present, a repeat is aimed one wait ahead.
+    void VulkanGraphics::schedule_present(VideoStream &stream, VideoFrame *videoFrame) {
+        PresentScheduler::Clock::time_point now = PresentScheduler::Clock::now();
+        double wait = stream.repeatWait;
+        if (videoFrame != nullptr) {
+            stream.pendingPts = videoFrame->pts_seconds;
+            wait = stream.pendingPts - stream.generator->get_master_clock().now();
+        }
+        if (m_encoder != nullptr) wait = 0.0;
+        // Bounded to two frames so a clock jump can never stall the render thread.
+        double maxWait = 2.0 * stream.generator->get_frame_duration();
+        wait = wait < 0.0 ? 0.0 : (wait > maxWait ? maxWait : wait);
+        m_present_target = now + std::chrono::duration_cast<PresentScheduler::Clock::duration>(
+                std::chrono::duration<double>(wait));
+    }
+
+#pragma endregion
+}
@@ -0,0 +1,223 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include "VulkanHwDecode.h"
+
+extern "C" {
+#include "libavutil/hwcontext_vulkan.h"
+#include "libavutil/pixdesc.h"
+};
+
+namespace fd {
+    static void query_queue_families(VkPhysicalDevice physicalDevice,
+                                     std::vector<VkQueueFamilyProperties2> &familyProperties,
+                                     std::vector<VkQueueFamilyVideoPropertiesKHR> &videoProperties) {
+        uint32_t count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties2(physicalDevice, &count, nullptr);
+        familyProperties.assign(count, {VK_STRUCTURE_TYPE_QUEUE_FAMILY_PROPERTIES_2});
+        videoProperties.assign(count, {VK_STRUCTURE_TYPE_QUEUE_FAMILY_VIDEO_PROPERTIES_KHR});
+        for (uint32_t i = 0; i < count; i++) {
+            familyProperties[i].pNext = &videoProperties[i];
+        }
+        vkGetPhysicalDeviceQueueFamilyProperties2(physicalDevice, &count, familyProperties.data());
+    }
+
+    bool VulkanHwDecode::is_requested() {
+        const char *decode = std::getenv("FD_HW_DECODE");
+        return decode != nullptr && std::strcmp(decode, "vulkan") == 0;
+    }
+
+    uint32_t VulkanHwDecode::instance_api_version() {
+        uint32_t loaderVersion = VK_API_VERSION_1_0;
+        vkEnumerateInstanceVersion(&loaderVersion);
+        if (is_requested() && loaderVersion >= VK_API_VERSION_1_3) {
+            return VK_API_VERSION_1_3;
+        }
+        return VK_API_VERSION_1_1;
+    }
+
+    bool VulkanHwDecode::select_device_extensions(VkPhysicalDevice physicalDevice,
+                                                  std::vector<const char *> &extensions, HwDecodeFeatures &features,
+                                                  uint32_t &decodeFamily) {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        if (instance_api_version() < VK_API_VERSION_1_3 || properties.apiVersion < VK_API_VERSION_1_3) {
+            LOG_WARN("Vulkan decode needs Vulkan 1.3, decoding in software");
+            return false;
+        }
+        uint32_t count = 0;
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count, nullptr);
+        std::vector<VkExtensionProperties> available(count);
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count, available.data());
+        auto hasExtension = [&available](const char *name) -> bool {
+            return std::any_of(available.begin(), available.end(), [name](const VkExtensionProperties &extension) {
+                return strcmp(extension.extensionName, name) == 0;
+            });
+        };
+        std::vector<const char *> decodeExtensions{};
+        for (const char *name: {VK_KHR_VIDEO_DECODE_H264_EXTENSION_NAME, VK_KHR_VIDEO_DECODE_H265_EXTENSION_NAME,
+                                VK_KHR_VIDEO_DECODE_AV1_EXTENSION_NAME}) {
+            if (hasExtension(name)) decodeExtensions.push_back(name);
+        }
+        if (!hasExtension(VK_KHR_VIDEO_QUEUE_EXTENSION_NAME) || !hasExtension(VK_KHR_VIDEO_DECODE_QUEUE_EXTENSION_NAME) ||
+            decodeExtensions.empty()) {
+            LOG_WARN("The device has no Vulkan video decode extensions, decoding in software");
+            return false;
+        }
+
+        std::vector<VkQueueFamilyProperties2> familyProperties{};
+        std::vector<VkQueueFamilyVideoPropertiesKHR> videoProperties{};
+        query_queue_families(physicalDevice, familyProperties, videoProperties);
+        bool familyFound = false;
+        for (uint32_t i = 0; i < familyProperties.size(); i++) {
+            if ((familyProperties[i].queueFamilyProperties.queueFlags & VK_QUEUE_VIDEO_DECODE_BIT_KHR) &&
+                videoProperties[i].videoCodecOperations != 0) {
+                decodeFamily = i;
+                familyFound = true;
+                break;
+            }
+        }
+        if (!familyFound) {
+            LOG_WARN("The device has no video decode queue, decoding in software");
+            return false;
+        }
+
+        HwDecodeFeatures supported{};
+        supported.features2.pNext = &supported.vulkan11;
+        supported.vulkan11.pNext = &supported.vulkan12;
+        supported.vulkan12.pNext = &supported.vulkan13;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supported.features2);
+        if (!supported.vulkan11.samplerYcbcrConversion || !supported.vulkan12.timelineSemaphore ||
+            !supported.vulkan13.synchronization2) {
+            LOG_WARN("The device lacks features the Vulkan decoder needs, decoding in software");
+            return false;
+        }
+        features.features2.pNext = &features.vulkan11;
+        features.vulkan11.pNext = &features.vulkan12;
+        features.vulkan12.pNext = &features.vulkan13;
+        features.vulkan11.samplerYcbcrConversion = VK_TRUE;
+        features.vulkan12.timelineSemaphore = VK_TRUE;
+        features.vulkan12.hostQueryReset = supported.vulkan12.hostQueryReset;
+        features.vulkan13.synchronization2 = VK_TRUE;
+
+        extensions.push_back(VK_KHR_VIDEO_QUEUE_EXTENSION_NAME);
+        extensions.push_back(VK_KHR_VIDEO_DECODE_QUEUE_EXTENSION_NAME);
+        extensions.insert(extensions.end(), decodeExtensions.begin(), decodeExtensions.end());
+        return true;
+    }
+
+    bool VulkanHwDecode::init(RenderContext *ctx, VkInstance instance,
+                              const std::vector<const char *> &instanceExtensions,
+                              const std::vector<const char *> &deviceExtensions, const HwDecodeFeatures &features,
+                              uint32_t decodeFamily) {
+        m_ctx = ctx;
+        m_instance_extensions = instanceExtensions;
+        m_device_extensions = deviceExtensions;
+        m_device_ref = av_hwdevice_ctx_alloc(AV_HWDEVICE_TYPE_VULKAN);
+        if (m_device_ref == nullptr) {
+            LOG_WARN("Failed to allocate the Vulkan decode device, decoding in software");
+            return false;
+        }
+        auto *deviceContext = reinterpret_cast<AVHWDeviceContext *>(m_device_ref->data);
+        auto *vkDevice = static_cast<AVVulkanDeviceContext *>(deviceContext->hwctx);
+        deviceContext->user_opaque = this;
+        vkDevice->get_proc_addr = vkGetInstanceProcAddr;
+        vkDevice->inst = instance;
+        vkDevice->phys_dev = ctx->physicalDevice;
+        vkDevice->act_dev = ctx->logicalDevice;
+        vkDevice->device_features = features.features2;
+        vkDevice->enabled_inst_extensions = m_instance_extensions.data();
+        vkDevice->nb_enabled_inst_extensions = static_cast<int>(m_instance_extensions.size());
+        vkDevice->enabled_dev_extensions = m_device_extensions.data();
+        vkDevice->nb_enabled_dev_extensions = static_cast<int>(m_device_extensions.size());
+        vkDevice->lock_queue = &VulkanHwDecode::lock_queue;
+        vkDevice->unlock_queue = &VulkanHwDecode::unlock_queue;
+
+        // Every family we created a queue in, with the single queue it has.
+        std::vector<VkQueueFamilyProperties2> familyProperties{};
+        std::vector<VkQueueFamilyVideoPropertiesKHR> videoProperties{};
+        query_queue_families(ctx->physicalDevice, familyProperties, videoProperties);
+        std::set<uint32_t> families{ctx->graphicsQueueIndex, ctx->computeQueueIndex, ctx->transferQueueIndex,
+                                    decodeFamily};
+        for (uint32_t family: families) {
+            AVVulkanDeviceQueueFamily &queueFamily = vkDevice->qf[vkDevice->nb_qf++];
+            queueFamily.idx = static_cast<int>(family);
+            queueFamily.num = 1;
+            queueFamily.flags = static_cast<VkQueueFlagBits>(familyProperties[family].queueFamilyProperties.queueFlags);
+            queueFamily.video_caps = static_cast<VkVideoCodecOperationFlagBitsKHR>(
+                    videoProperties[family].videoCodecOperations);
+        }
+
+        if (av_hwdevice_ctx_init(m_device_ref) < 0) {
+            LOG_WARN("FFmpeg rejected the Vulkan decode device, decoding in software");
+            av_buffer_unref(&m_device_ref);
+            return false;
+        }
+        LOG_INFO("Decoding on the render device, video decode queue family {}", decodeFamily);
+        return true;
+    }
+
+    void VulkanHwDecode::lock_queue(AVHWDeviceContext *deviceContext, uint32_t queueFamily, uint32_t index) {
+        static_cast<VulkanHwDecode *>(deviceContext->user_opaque)->m_ctx->queueMutex.lock();
+    }
+
+    void VulkanHwDecode::unlock_queue(AVHWDeviceContext *deviceContext, uint32_t queueFamily, uint32_t index) {
+        static_cast<VulkanHwDecode *>(deviceContext->user_opaque)->m_ctx->queueMutex.unlock();
+    }
+
+    void VulkanHwDecode::attach(AVCodecContext *codecContext, AVBufferRef *device) {
+        codecContext->hw_device_ctx = av_buffer_ref(device);
+        codecContext->get_format = &VulkanHwDecode::get_format;
+        // The frame queues hold decoded images on top of the ones the decoder references.
+        codecContext->extra_hw_frames = 2 * MAX_FRAMES + 2;
+    }
+
+    AVPixelFormat VulkanHwDecode::get_format(AVCodecContext *codecContext, const AVPixelFormat *formats) {
+        for (const AVPixelFormat *format = formats; *format != AV_PIX_FMT_NONE; format++) {
+            if (*format == AV_PIX_FMT_VULKAN && create_frames_context(codecContext)) {
+                return AV_PIX_FMT_VULKAN;
+            }
+        }
+        for (const AVPixelFormat *format = formats; *format != AV_PIX_FMT_NONE; format++) {
+            if (!(av_pix_fmt_desc_get(*format)->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
+                LOG_WARN("No Vulkan decode for {}, decoding in software", avcodec_get_name(codecContext->codec_id));
+                return *format;
+            }
+        }
+        return AV_PIX_FMT_NONE;
+    }
+
+    bool VulkanHwDecode::create_frames_context(AVCodecContext *codecContext) {
+        AVBufferRef *framesRef = nullptr;
+        if (avcodec_get_hw_frames_parameters(codecContext, codecContext->hw_device_ctx, AV_PIX_FMT_VULKAN,
+                                             &framesRef) < 0) {
+            return false;
+        }
+        auto *framesContext = reinterpret_cast<AVHWFramesContext *>(framesRef->data);
+        // The converter copies an 8 bit luma plane and an interleaved chroma plane out of the decoded image.
+        if (framesContext->sw_format != AV_PIX_FMT_NV12) {
+            av_buffer_unref(&framesRef);
+            return false;
+        }
+        // Left at zero FFmpeg picks the usage itself and transfer source is among it.
+        auto *vkFrames = static_cast<AVVulkanFramesContext *>(framesContext->hwctx);
+        if (vkFrames->usage != 0) {
+            vkFrames->usage = static_cast<VkImageUsageFlagBits>(vkFrames->usage | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+        }
+        if (av_hwframe_ctx_init(framesRef) < 0) {
+            av_buffer_unref(&framesRef);
+            return false;
+        }
+        av_buffer_unref(&codecContext->hw_frames_ctx);
+        codecContext->hw_frames_ctx = framesRef;
+        return true;
+    }
+
+    void VulkanHwDecode::clean_up() {
+        av_buffer_unref(&m_device_ref);
+    }
+}
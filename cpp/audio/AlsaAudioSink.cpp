@@ -0,0 +1,108 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#ifdef FD_HAVE_ALSA
+
+#include "audio/AlsaAudioSink.h"
+#include "Util.h"
+
+namespace fd {
+    AlsaAudioSink::AlsaAudioSink(std::string deviceName) : m_device_name{std::move(deviceName)} {}
+
+    AlsaAudioSink::~AlsaAudioSink() {
+        close();
+    }
+
+    bool AlsaAudioSink::open(const AudioFormat &format) {
+        m_format = format;
+        int error = snd_pcm_open(&m_pcm, m_device_name.c_str(), SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
+        if (error < 0) {
+            LOG_ERROR("Failed to open the alsa device {}: {}", m_device_name, snd_strerror(error));
+            m_pcm = nullptr;
+            return false;
+        }
+        error = snd_pcm_set_params(m_pcm, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED, format.channels,
+                                   format.sampleRate, 1, LATENCY_US);
+        if (error < 0) {
+            LOG_ERROR("Failed to configure the alsa device {}: {}", m_device_name, snd_strerror(error));
+            close();
+            return false;
+        }
+        snd_pcm_uframes_t periodFrames = 0;
+        snd_pcm_get_params(m_pcm, &m_buffer_frames, &periodFrames);
+        return true;
+    }
+
+    bool AlsaAudioSink::start_device() {
+        // Playback starts on its own once the first period is written, prepare only resets a stopped stream.
+        return m_pcm && snd_pcm_prepare(m_pcm) >= 0;
+    }
+
+    void AlsaAudioSink::stop_device() {
+        if (m_pcm) {
+            snd_pcm_drop(m_pcm);
+        }
+    }
+
+    bool AlsaAudioSink::wait_for_device() {
+        if (!m_pcm) return false;
+        // A prepared but not yet running stream has no period interrupts, the empty buffer is writable right away.
+        if (snd_pcm_state(m_pcm) == SND_PCM_STATE_PREPARED) return true;
+        int result = snd_pcm_wait(m_pcm, WAIT_TIMEOUT_MS);
+        if (result < 0) {
+            recover(result);
+            return false;
+        }
+        return result > 0;
+    }
+
+    uint32_t AlsaAudioSink::writable_frames() {
+        if (!m_pcm) return 0;
+        snd_pcm_sframes_t available = snd_pcm_avail_update(m_pcm);
+        if (available < 0) {
+            recover(static_cast<int>(available));
+            return 0;
+        }
+        return static_cast<uint32_t>(available);
+    }
+
+    void AlsaAudioSink::close() {
+        stop();
+        if (m_pcm) {
+            snd_pcm_drain(m_pcm);
+            snd_pcm_close(m_pcm);
+            m_pcm = nullptr;
+        }
+    }
+
+    bool AlsaAudioSink::recover(int error) {
+        if (snd_pcm_recover(m_pcm, error, 1) < 0) {
+            LOG_ERROR_EVERY_MS(1000, "Alsa device {} failed: {}", m_device_name, snd_strerror(error));
+            return false;
+        }
+        return true;
+    }
+
+    uint32_t AlsaAudioSink::write(const int16_t *samples, uint32_t frames) {
+        if (!m_pcm) return 0;
+        snd_pcm_sframes_t written = snd_pcm_writei(m_pcm, samples, frames);
+        if (written == -EAGAIN) return 0;
+        if (written < 0) {
+            recover(static_cast<int>(written));
+            return 0;
+        }
+        return static_cast<uint32_t>(written);
+    }
+
+    uint32_t AlsaAudioSink::queued_frames() {
+        if (!m_pcm) return 0;
+        snd_pcm_sframes_t delay = 0;
+        int error = snd_pcm_delay(m_pcm, &delay);
+        if (error < 0) {
+            recover(error);
+            return 0;
+        }
+        return delay > 0 ? static_cast<uint32_t>(delay) : 0;
+    }
+}
+#endif
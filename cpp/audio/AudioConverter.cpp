@@ -0,0 +1,385 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <utility>
+#include "audio/AudioConverter.h"
+#include "Util.h"
+
+extern "C" {
+#include "libavutil/channel_layout.h"
+};
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FD_AUDIO_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace fd {
+    namespace {
+        constexpr double PI = 3.14159265358979323846;
+
+        void s16_to_float(const int16_t *src, float *dst, uint32_t count) {
+            uint32_t i = 0;
+#ifdef FD_AUDIO_SSE2
+            const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+            for (; i + 8 <= count; i += 8) {
+                __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+                // Sign extension by interleaving with itself and shifting the high halves down.
+                __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+                __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+                _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+            }
+#endif
+            for (; i < count; i++) {
+                dst[i] = static_cast<float>(src[i]) * (1.0f / 32768.0f);
+            }
+        }
+
+        void s32_to_float(const int32_t *src, float *dst, uint32_t count) {
+            uint32_t i = 0;
+#ifdef FD_AUDIO_SSE2
+            const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+            for (; i + 4 <= count; i += 4) {
+                __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(samples), scale));
+            }
+#endif
+            for (; i < count; i++) {
+                dst[i] = static_cast<float>(src[i]) * (1.0f / 2147483648.0f);
+            }
+        }
+
+        float dot(const float *a, const float *b, uint32_t count) {
+            uint32_t i = 0;
+            float sum = 0.0f;
+#ifdef FD_AUDIO_SSE2
+            __m128 acc = _mm_setzero_ps();
+            for (; i + 4 <= count; i += 4) {
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            }
+            alignas(16) float lanes[4];
+            _mm_store_ps(lanes, acc);
+            sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+            for (; i < count; i++) {
+                sum += a[i] * b[i];
+            }
+            return sum;
+        }
+
+        int16_t float_to_s16(float sample) {
+            float clamped = sample < -1.0f ? -1.0f : (sample > 1.0f ? 1.0f : sample);
+            return static_cast<int16_t>(std::lrintf(clamped * 32767.0f));
+        }
+
+        void interleave_stereo_s16(const float *left, const float *right, int16_t *dst, uint32_t count) {
+            uint32_t i = 0;
+#ifdef FD_AUDIO_SSE2
+            const __m128 scale = _mm_set1_ps(32767.0f);
+            const __m128 minValue = _mm_set1_ps(-1.0f);
+            const __m128 maxValue = _mm_set1_ps(1.0f);
+            for (; i + 4 <= count; i += 4) {
+                // Clamped before the integer conversion, out of range floats convert to INT32_MIN otherwise.
+                __m128 l = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(left + i), minValue), maxValue);
+                __m128 r = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(right + i), minValue), maxValue);
+                __m128i li = _mm_cvtps_epi32(_mm_mul_ps(l, scale));
+                __m128i ri = _mm_cvtps_epi32(_mm_mul_ps(r, scale));
+                __m128i packed = _mm_packs_epi32(_mm_unpacklo_epi32(li, ri), _mm_unpackhi_epi32(li, ri));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * i), packed);
+            }
+#endif
+            for (; i < count; i++) {
+                dst[2 * i + 0] = float_to_s16(left[i]);
+                dst[2 * i + 1] = float_to_s16(right[i]);
+            }
+        }
+
+        double sinc(double x) {
+            if (std::abs(x) < 1e-9) return 1.0;
+            return std::sin(PI * x) / (PI * x);
+        }
+    }
+
+#pragma region RESAMPLER
+
+    void PolyphaseResampler::configure(uint32_t inputRate, uint32_t outputRate, uint32_t channels, uint32_t taps) {
+        uint32_t divisor = std::gcd(inputRate, outputRate);
+        m_up = outputRate / divisor;
+        m_down = inputRate / divisor;
+        m_taps = taps;
+        m_time = 0;
+        m_history.assign(channels, std::vector<float>(m_taps - 1, 0.0f));
+        m_coefficients.clear();
+        if (is_passthrough()) return;
+
+        // Prototype at the upsampled rate, cut off below the lower of the two Nyquist frequencies.
+        uint32_t length = m_up * m_taps;
+        double cutoff = 0.5 / static_cast<double>(m_up > m_down ? m_up : m_down) * 0.95;
+        std::vector<double> prototype(length);
+        double center = (length - 1) / 2.0;
+        for (uint32_t n = 0; n < length; n++) {
+            double blackman = 0.42 - 0.5 * std::cos(2.0 * PI * n / (length - 1)) +
+                              0.08 * std::cos(4.0 * PI * n / (length - 1));
+            prototype[n] = 2.0 * cutoff * sinc(2.0 * cutoff * (n - center)) * blackman * m_up;
+        }
+        m_coefficients.resize(length);
+        for (uint32_t phase = 0; phase < m_up; phase++) {
+            for (uint32_t k = 0; k < m_taps; k++) {
+                m_coefficients[phase * m_taps + (m_taps - 1 - k)] = static_cast<float>(prototype[phase + k * m_up]);
+            }
+        }
+    }
+
+    uint32_t PolyphaseResampler::max_output_frames(uint32_t inputFrames) const {
+        if (is_passthrough()) return inputFrames;
+        return static_cast<uint32_t>((static_cast<uint64_t>(inputFrames) * m_up) / m_down + 2);
+    }
+
+    uint32_t PolyphaseResampler::process(const std::vector<std::vector<float>> &input, uint32_t frames,
+                                         std::vector<std::vector<float>> &output) {
+        uint32_t history = m_taps - 1;
+        uint32_t produced = 0;
+        uint64_t endTime = m_time;
+        for (size_t channel = 0; channel < m_history.size(); channel++) {
+            // The history stays at the front, so x[i - taps + 1 .. i] starts at buffer index i.
+            std::vector<float> &buffer = m_history[channel];
+            buffer.resize(history + frames);
+            memcpy(buffer.data() + history, input[channel].data(), frames * sizeof(float));
+
+            uint64_t time = m_time;
+            uint32_t count = 0;
+            float *out = output[channel].data();
+            while (time / m_up < frames) {
+                uint64_t index = time / m_up;
+                uint32_t phase = static_cast<uint32_t>(time % m_up);
+                out[count++] = dot(&m_coefficients[phase * m_taps], &buffer[index], m_taps);
+                time += m_down;
+            }
+            produced = count;
+            endTime = time;
+            memmove(buffer.data(), buffer.data() + frames, history * sizeof(float));
+            buffer.resize(history);
+        }
+        m_time = endTime - static_cast<uint64_t>(frames) * m_up;
+        return produced;
+    }
+
+#pragma endregion
+#pragma region CONVERTER
+
+    AudioConverter::AudioConverter(const AudioFormat &output) : m_output{output} {}
+
+    void AudioConverter::configure(const AVFrame *frame) {
+        m_input_rate = frame->sample_rate;
+        m_input_channels = frame->ch_layout.nb_channels;
+        m_input_format = frame->format;
+        m_planar.resize(m_input_channels);
+        m_remixed.resize(m_output.channels);
+        m_resampled.resize(m_output.channels);
+        build_remix_matrix(frame->ch_layout);
+        m_resampler.configure(m_input_rate, m_output.sampleRate, m_output.channels);
+        LOG_INFO("Audio conversion {} Hz {} channels {} -> {} Hz {} channels s16", m_input_rate, m_input_channels,
+                 av_get_sample_fmt_name(static_cast<AVSampleFormat>(m_input_format)), m_output.sampleRate,
+                 m_output.channels);
+    }
+
+    void AudioConverter::build_remix_matrix(const AVChannelLayout &layout) {
+        uint32_t outputs = m_output.channels;
+        uint32_t inputs = m_input_channels;
+        m_remix_matrix.assign(outputs * inputs, 0.0f);
+        if (inputs == outputs) {
+            for (uint32_t i = 0; i < inputs; i++) m_remix_matrix[i * inputs + i] = 1.0f;
+            return;
+        }
+        if (inputs == 1) {
+            for (uint32_t o = 0; o < outputs; o++) m_remix_matrix[o * inputs] = 1.0f;
+            return;
+        }
+        if (outputs == 1) {
+            for (uint32_t i = 0; i < inputs; i++) m_remix_matrix[i] = 1.0f / inputs;
+            return;
+        }
+        // Surround to stereo, centre and surrounds at -3 dB and the sum normalised so a full scale mix cannot clip.
+        auto index = [&layout](AVChannel channel) { return av_channel_layout_index_from_channel(&layout, channel); };
+        constexpr float minus3db = 0.7071f;
+        const std::array<std::pair<AVChannel, float>, 4> leftSources{{{AV_CHAN_FRONT_LEFT, 1.0f},
+                                                                      {AV_CHAN_FRONT_CENTER, minus3db},
+                                                                      {AV_CHAN_SIDE_LEFT, minus3db},
+                                                                      {AV_CHAN_BACK_LEFT, minus3db}}};
+        const std::array<std::pair<AVChannel, float>, 4> rightSources{{{AV_CHAN_FRONT_RIGHT, 1.0f},
+                                                                       {AV_CHAN_FRONT_CENTER, minus3db},
+                                                                       {AV_CHAN_SIDE_RIGHT, minus3db},
+                                                                       {AV_CHAN_BACK_RIGHT, minus3db}}};
+        float leftSum = 0.0f;
+        float rightSum = 0.0f;
+        for (const auto &[channel, gain]: leftSources) {
+            int i = index(channel);
+            if (i >= 0) {
+                m_remix_matrix[0 * inputs + i] += gain;
+                leftSum += gain;
+            }
+        }
+        for (const auto &[channel, gain]: rightSources) {
+            int i = index(channel);
+            if (i >= 0) {
+                m_remix_matrix[1 * inputs + i] += gain;
+                rightSum += gain;
+            }
+        }
+        if (leftSum == 0.0f || rightSum == 0.0f) {
+            // Unordered layouts carry no positions, the first two channels are taken as left and right.
+            std::fill(m_remix_matrix.begin(), m_remix_matrix.end(), 0.0f);
+            m_remix_matrix[0] = 1.0f;
+            m_remix_matrix[inputs + 1] = 1.0f;
+            return;
+        }
+        for (uint32_t i = 0; i < inputs; i++) {
+            m_remix_matrix[i] /= leftSum;
+            m_remix_matrix[inputs + i] /= rightSum;
+        }
+    }
+
+    bool AudioConverter::to_planar_float(const AVFrame *frame) {
+        uint32_t frames = frame->nb_samples;
+        int channels = m_input_channels;
+        for (std::vector<float> &plane: m_planar) {
+            if (plane.size() < frames) plane.resize(frames);
+        }
+        switch (frame->format) {
+            case AV_SAMPLE_FMT_FLTP:
+                for (int c = 0; c < channels; c++) {
+                    memcpy(m_planar[c].data(), frame->extended_data[c], frames * sizeof(float));
+                }
+                return true;
+            case AV_SAMPLE_FMT_S16P:
+                for (int c = 0; c < channels; c++) {
+                    s16_to_float(reinterpret_cast<const int16_t *>(frame->extended_data[c]), m_planar[c].data(),
+                                 frames);
+                }
+                return true;
+            case AV_SAMPLE_FMT_S32P:
+                for (int c = 0; c < channels; c++) {
+                    s32_to_float(reinterpret_cast<const int32_t *>(frame->extended_data[c]), m_planar[c].data(),
+                                 frames);
+                }
+                return true;
+            case AV_SAMPLE_FMT_DBLP:
+                for (int c = 0; c < channels; c++) {
+                    const double *src = reinterpret_cast<const double *>(frame->extended_data[c]);
+                    for (uint32_t i = 0; i < frames; i++) m_planar[c][i] = static_cast<float>(src[i]);
+                }
+                return true;
+            case AV_SAMPLE_FMT_U8P:
+                for (int c = 0; c < channels; c++) {
+                    const uint8_t *src = frame->extended_data[c];
+                    for (uint32_t i = 0; i < frames; i++) m_planar[c][i] = (src[i] - 128) * (1.0f / 128.0f);
+                }
+                return true;
+            case AV_SAMPLE_FMT_FLT: {
+                const float *src = reinterpret_cast<const float *>(frame->data[0]);
+                for (uint32_t i = 0; i < frames; i++) {
+                    for (int c = 0; c < channels; c++) m_planar[c][i] = src[i * channels + c];
+                }
+                return true;
+            }
+            case AV_SAMPLE_FMT_S16: {
+                const int16_t *src = reinterpret_cast<const int16_t *>(frame->data[0]);
+                for (uint32_t i = 0; i < frames; i++) {
+                    for (int c = 0; c < channels; c++) m_planar[c][i] = src[i * channels + c] * (1.0f / 32768.0f);
+                }
+                return true;
+            }
+            case AV_SAMPLE_FMT_S32: {
+                const int32_t *src = reinterpret_cast<const int32_t *>(frame->data[0]);
+                for (uint32_t i = 0; i < frames; i++) {
+                    for (int c = 0; c < channels; c++) {
+                        m_planar[c][i] = static_cast<float>(src[i * channels + c]) * (1.0f / 2147483648.0f);
+                    }
+                }
+                return true;
+            }
+            case AV_SAMPLE_FMT_DBL: {
+                const double *src = reinterpret_cast<const double *>(frame->data[0]);
+                for (uint32_t i = 0; i < frames; i++) {
+                    for (int c = 0; c < channels; c++) m_planar[c][i] = static_cast<float>(src[i * channels + c]);
+                }
+                return true;
+            }
+            case AV_SAMPLE_FMT_U8: {
+                const uint8_t *src = frame->data[0];
+                for (uint32_t i = 0; i < frames; i++) {
+                    for (int c = 0; c < channels; c++) m_planar[c][i] = (src[i * channels + c] - 128) * (1.0f / 128.0f);
+                }
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    void AudioConverter::remix(uint32_t frames) {
+        uint32_t inputs = m_input_channels;
+        for (uint32_t o = 0; o < m_output.channels; o++) {
+            std::vector<float> &out = m_remixed[o];
+            if (out.size() < frames) out.resize(frames);
+            std::fill(out.begin(), out.begin() + frames, 0.0f);
+            for (uint32_t i = 0; i < inputs; i++) {
+                float gain = m_remix_matrix[o * inputs + i];
+                if (gain == 0.0f) continue;
+                const float *in = m_planar[i].data();
+                for (uint32_t s = 0; s < frames; s++) out[s] += gain * in[s];
+            }
+        }
+    }
+
+    const int16_t *AudioConverter::convert(const AVFrame *frame, uint32_t &framesOut) {
+        framesOut = 0;
+        if (frame->sample_rate != m_input_rate || frame->ch_layout.nb_channels != m_input_channels ||
+            frame->format != m_input_format) {
+            configure(frame);
+        }
+        uint32_t frames = frame->nb_samples;
+        if (m_input_channels == 0 || frames == 0) return m_interleaved.data();
+        if (!to_planar_float(frame)) {
+            LOG_WARN("Unsupported audio sample format {}",
+                     av_get_sample_fmt_name(static_cast<AVSampleFormat>(frame->format)));
+            return m_interleaved.data();
+        }
+        remix(frames);
+
+        std::vector<std::vector<float>> *planes = &m_remixed;
+        uint32_t outputFrames = frames;
+        if (!m_resampler.is_passthrough()) {
+            uint32_t capacity = m_resampler.max_output_frames(frames);
+            for (std::vector<float> &plane: m_resampled) {
+                if (plane.size() < capacity) plane.resize(capacity);
+            }
+            outputFrames = m_resampler.process(m_remixed, frames, m_resampled);
+            planes = &m_resampled;
+        }
+
+        uint32_t channels = m_output.channels;
+        if (m_interleaved.size() < static_cast<size_t>(outputFrames) * channels) {
+            m_interleaved.resize(static_cast<size_t>(outputFrames) * channels);
+        }
+        if (channels == 2) {
+            interleave_stereo_s16((*planes)[0].data(), (*planes)[1].data(), m_interleaved.data(), outputFrames);
+        } else {
+            for (uint32_t s = 0; s < outputFrames; s++) {
+                for (uint32_t c = 0; c < channels; c++) {
+                    m_interleaved[s * channels + c] = float_to_s16((*planes)[c][s]);
+                }
+            }
+        }
+        framesOut = outputFrames;
+        return m_interleaved.data();
+    }
+
+#pragma endregion
+}
@@ -0,0 +1,87 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "audio/AudioSink.h"
+#include "audio/PcmRing.h"
+#include "audio/NullAudioSink.h"
+#include "audio/WasapiAudioSink.h"
+#include "audio/AlsaAudioSink.h"
+#include "Util.h"
+
+namespace fd {
+    void AudioSink::start(PcmRing *ring, AudioWrittenCallback onWritten) {
+        m_ring = ring;
+        m_on_written = std::move(onWritten);
+        m_running = true;
+        m_device_thread = std::thread{[this]() -> void { device_loop(); }};
+    }
+
+    void AudioSink::stop() {
+        m_running = false;
+        if (m_device_thread.joinable()) {
+            m_device_thread.join();
+        }
+    }
+
+    void AudioSink::device_loop() {
+        if (!start_device()) {
+            LOG_ERROR("Failed to start the {} audio device", name());
+            return;
+        }
+        while (m_running) {
+            if (!wait_for_device()) continue;
+            uint32_t room = writable_frames();
+            uint32_t written = 0;
+            // Two runs cover the ring wrapping around.
+            for (int run = 0; run < 2 && written < room; run++) {
+                const int16_t *samples = nullptr;
+                uint32_t frames = m_ring->peek(samples, room - written);
+                if (frames == 0) break;
+                uint32_t accepted = write(samples, frames);
+                m_ring->consume(accepted);
+                written += accepted;
+                if (accepted < frames) break;
+            }
+            if (written > 0) {
+                m_on_written(written, queued_frames());
+            } else if (room > 0) {
+                // Starved, the decoder is behind. A short sleep keeps a device that is always ready from spinning.
+                if (queued_frames() == 0) {
+                    m_underruns++;
+                    LOG_WARN_EVERY_MS(1000, "Audio sink {} underran, {} underruns so far", name(), m_underruns);
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        stop_device();
+    }
+
+    std::unique_ptr<AudioSink> create_audio_sink(const char *spec) {
+        std::string sinkSpec = spec ? spec : "";
+        if (sinkSpec.rfind("wav:", 0) == 0) {
+            return std::make_unique<NullAudioSink>(sinkSpec.substr(4));
+        }
+        if (sinkSpec.rfind("null", 0) == 0) {
+            double speed = sinkSpec.size() > 5 ? std::atof(sinkSpec.c_str() + 5) : 1.0;
+            return std::make_unique<NullAudioSink>(std::string{}, speed);
+        }
+#ifdef _WIN32
+        if (sinkSpec.empty() || sinkSpec == "wasapi") {
+            return std::make_unique<WasapiAudioSink>();
+        }
+#endif
+#ifdef FD_HAVE_ALSA
+        if (sinkSpec.empty() || sinkSpec == "alsa") {
+            return std::make_unique<AlsaAudioSink>();
+        }
+#endif
+        if (!sinkSpec.empty()) {
+            LOG_WARN("Audio sink {} is not available in this build, using the null sink", sinkSpec);
+        }
+        return std::make_unique<NullAudioSink>();
+    }
+}
@@ -0,0 +1,113 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include "audio/NullAudioSink.h"
+#include "Util.h"
+
+namespace fd {
+    NullAudioSink::NullAudioSink(std::string wavPath, double speed) : m_wav_path{std::move(wavPath)},
+                                                                      m_speed{speed > 0.0 ? speed : 1.0} {}
+
+    NullAudioSink::~NullAudioSink() {
+        close();
+    }
+
+    bool NullAudioSink::open(const AudioFormat &format) {
+        m_format = format;
+        m_buffer_frames = format.sampleRate * BUFFER_MS / 1000;
+        m_queued = 0.0;
+        if (!m_wav_path.empty()) {
+            m_wav_stream.open(m_wav_path, std::ios::binary | std::ios::trunc);
+            if (!m_wav_stream) {
+                LOG_ERROR("Failed to open the wav sink {}", m_wav_path);
+                return false;
+            }
+            m_wav_data_bytes = 0;
+            write_wav_header();
+        }
+        LOG_INFO("Null audio sink at {} Hz, {} channels, {}x speed", format.sampleRate, format.channels, m_speed);
+        return true;
+    }
+
+    bool NullAudioSink::start_device() {
+        m_started = true;
+        m_last_drain = Clock::now();
+        return true;
+    }
+
+    void NullAudioSink::stop_device() {
+        m_started = false;
+        m_queued = 0.0;
+    }
+
+    bool NullAudioSink::wait_for_device() {
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(PERIOD_MS / m_speed));
+        return true;
+    }
+
+    uint32_t NullAudioSink::writable_frames() {
+        return m_buffer_frames - queued_frames();
+    }
+
+    void NullAudioSink::close() {
+        stop();
+        if (m_wav_stream.is_open()) {
+            // The sizes are only known now, the header written on open is patched in place.
+            write_wav_header();
+            m_wav_stream.close();
+        }
+        m_started = false;
+    }
+
+    void NullAudioSink::drain() {
+        if (!m_started) return;
+        Clock::time_point now = Clock::now();
+        double elapsed = std::chrono::duration<double>(now - m_last_drain).count();
+        m_last_drain = now;
+        m_queued = std::max(0.0, m_queued - elapsed * m_format.sampleRate * m_speed);
+    }
+
+    uint32_t NullAudioSink::write(const int16_t *samples, uint32_t frames) {
+        uint32_t available = writable_frames();
+        uint32_t framesToWrite = std::min(available, frames);
+        if (framesToWrite == 0) return 0;
+        if (m_wav_stream.is_open()) {
+            size_t bytes = static_cast<size_t>(framesToWrite) * m_format.bytes_per_frame();
+            m_wav_stream.write(reinterpret_cast<const char *>(samples), static_cast<std::streamsize>(bytes));
+            m_wav_data_bytes += bytes;
+        }
+        m_queued += framesToWrite;
+        return framesToWrite;
+    }
+
+    uint32_t NullAudioSink::queued_frames() {
+        drain();
+        return static_cast<uint32_t>(std::ceil(m_queued));
+    }
+
+    void NullAudioSink::write_wav_header() {
+        auto writeU32 = [this](uint32_t value) { m_wav_stream.write(reinterpret_cast<const char *>(&value), 4); };
+        auto writeU16 = [this](uint16_t value) { m_wav_stream.write(reinterpret_cast<const char *>(&value), 2); };
+        std::streampos position = m_wav_stream.tellp();
+        m_wav_stream.seekp(0);
+        uint32_t dataBytes = static_cast<uint32_t>(std::min<uint64_t>(m_wav_data_bytes, UINT32_MAX - 36));
+        m_wav_stream.write("RIFF", 4);
+        writeU32(36 + dataBytes);
+        m_wav_stream.write("WAVEfmt ", 8);
+        writeU32(16);
+        writeU16(1);
+        writeU16(static_cast<uint16_t>(m_format.channels));
+        writeU32(m_format.sampleRate);
+        writeU32(m_format.sampleRate * m_format.bytes_per_frame());
+        writeU16(static_cast<uint16_t>(m_format.bytes_per_frame()));
+        writeU16(16);
+        m_wav_stream.write("data", 4);
+        writeU32(dataBytes);
+        if (position > 0) {
+            m_wav_stream.seekp(position);
+        }
+    }
+}
@@ -0,0 +1,62 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <algorithm>
+#include <cstring>
+#include "audio/PcmRing.h"
+
+namespace fd {
+    PcmRing::PcmRing(uint32_t capacityFrames, uint32_t channels) : m_channels{channels} {
+        m_capacity = 1;
+        while (m_capacity < capacityFrames) m_capacity <<= 1;
+        m_mask = m_capacity - 1;
+        m_samples.resize(static_cast<size_t>(m_capacity) * m_channels);
+    }
+
+    uint32_t PcmRing::readable_frames() const {
+        return static_cast<uint32_t>(m_write_pos.load(std::memory_order_acquire) -
+                                     m_read_pos.load(std::memory_order_acquire));
+    }
+
+    uint32_t PcmRing::writable_frames() const {
+        return m_capacity - readable_frames();
+    }
+
+    uint32_t PcmRing::write(const int16_t *samples, uint32_t frames) {
+        uint64_t writePos = m_write_pos.load(std::memory_order_relaxed);
+        uint64_t readPos = m_read_pos.load(std::memory_order_acquire);
+        uint32_t framesToWrite = std::min(frames, m_capacity - static_cast<uint32_t>(writePos - readPos));
+        uint32_t offset = static_cast<uint32_t>(writePos & m_mask);
+        uint32_t firstRun = std::min(framesToWrite, m_capacity - offset);
+        memcpy(&m_samples[static_cast<size_t>(offset) * m_channels], samples,
+               static_cast<size_t>(firstRun) * m_channels * sizeof(int16_t));
+        memcpy(m_samples.data(), samples + static_cast<size_t>(firstRun) * m_channels,
+               static_cast<size_t>(framesToWrite - firstRun) * m_channels * sizeof(int16_t));
+        m_write_pos.store(writePos + framesToWrite, std::memory_order_release);
+        return framesToWrite;
+    }
+
+    void PcmRing::wait_for_space(uint32_t minFrames, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock{m_space_mutex};
+        m_space_cv.wait_for(lock, timeout, [this, minFrames]() -> bool { return writable_frames() >= minFrames; });
+    }
+
+    uint32_t PcmRing::peek(const int16_t *&samples, uint32_t maxFrames) const {
+        uint64_t readPos = m_read_pos.load(std::memory_order_relaxed);
+        uint32_t readable = static_cast<uint32_t>(m_write_pos.load(std::memory_order_acquire) - readPos);
+        uint32_t offset = static_cast<uint32_t>(readPos & m_mask);
+        samples = &m_samples[static_cast<size_t>(offset) * m_channels];
+        return std::min({readable, maxFrames, m_capacity - offset});
+    }
+
+    void PcmRing::consume(uint32_t frames) {
+        m_read_pos.store(m_read_pos.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+        // No lock on the device thread, a wake up lost to the race is covered by the producer's timeout.
+        m_space_cv.notify_one();
+    }
+
+    void PcmRing::clear() {
+        m_read_pos.store(m_write_pos.load(std::memory_order_acquire), std::memory_order_release);
+        m_space_cv.notify_one();
+    }
+}
@@ -0,0 +1,152 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#ifdef _WIN32
+
+#include <cstring>
+#include <windows.h>
+#include <mmdeviceapi.h>
+#include <uuids.h>
+#include "audio/WasapiAudioSink.h"
+#include "Util.h"
+
+namespace fd {
+    WasapiAudioSink::~WasapiAudioSink() {
+        close();
+    }
+
+    bool WasapiAudioSink::open(const AudioFormat &format) {
+        m_format = format;
+        HRESULT result = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        if (FAILED(result)) {
+            LOG_INFO("The com init failed");
+        } else {
+            m_com_initialized = true;
+        }
+        IMMDeviceEnumerator *enumerator = nullptr;
+        CoCreateInstance(
+                __uuidof(MMDeviceEnumerator),
+                nullptr,
+                CLSCTX_ALL,
+                __uuidof(IMMDeviceEnumerator),
+                (void **) &enumerator
+        );
+        if (!enumerator) {
+            LOG_ERROR("Failed to create the audio device enumerator");
+            return false;
+        }
+        IMMDevice *audioDevice = nullptr;
+        enumerator->GetDefaultAudioEndpoint(eRender, eConsole, &audioDevice);
+        enumerator->Release();
+        if (!audioDevice) {
+            LOG_ERROR("No default audio render endpoint");
+            return false;
+        }
+        audioDevice->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, (void **) &m_audioClient);
+        audioDevice->Release();
+        if (!m_audioClient) {
+            LOG_ERROR("Failed to activate the audio client");
+            return false;
+        }
+        // Shared mode mixes at the engine rate, running at that rate leaves the resampling to our converter.
+        WAVEFORMATEX *mixFormat = nullptr;
+        if (SUCCEEDED(m_audioClient->GetMixFormat(&mixFormat)) && mixFormat) {
+            m_format.sampleRate = mixFormat->nSamplesPerSec;
+            CoTaskMemFree(mixFormat);
+        }
+        WAVEFORMATEX waveFormat{};
+        waveFormat.wFormatTag = WAVE_FORMAT_PCM;
+        waveFormat.nChannels = static_cast<WORD>(m_format.channels);
+        waveFormat.nSamplesPerSec = m_format.sampleRate;
+        waveFormat.wBitsPerSample = 16;
+        waveFormat.nBlockAlign = waveFormat.nChannels * waveFormat.wBitsPerSample / 8;
+        waveFormat.nAvgBytesPerSec = waveFormat.nSamplesPerSec * waveFormat.nBlockAlign;
+
+        REFERENCE_TIME bufferDurationTime = 10000000;
+
+        // Only the bit depth can differ from the mix format here, AUTOCONVERTPCM covers the s16 to float step.
+        DWORD streamFlags = AUDCLNT_STREAMFLAGS_EVENTCALLBACK | AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM |
+                            AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY;
+        HRESULT initResult = m_audioClient->Initialize(AUDCLNT_SHAREMODE_SHARED, streamFlags, bufferDurationTime, 0,
+                                                       &waveFormat, nullptr);
+        if (FAILED(initResult)) {
+            LOG_ERROR("Failed to initialize the audio client");
+            return false;
+        }
+        m_buffer_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        m_audioClient->SetEventHandle(m_buffer_event);
+        HRESULT clientResult = m_audioClient->GetService(__uuidof(IAudioRenderClient),
+                                                         (void **) &m_audio_render_client);
+        if (FAILED(clientResult) || !m_audio_render_client) {
+            LOG_INFO("Failed to get the render client");
+            return false;
+        }
+        m_audioClient->GetBufferSize(&bufferFrameCount);
+        return true;
+    }
+
+    bool WasapiAudioSink::start_device() {
+        if (!m_audioClient) return false;
+        // The device thread makes COM calls of its own and needs its own apartment.
+        CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        return SUCCEEDED(m_audioClient->Start());
+    }
+
+    void WasapiAudioSink::stop_device() {
+        if (m_audioClient) {
+            m_audioClient->Stop();
+            // Drops what is still buffered, a restart after a seek must not play the old position.
+            m_audioClient->Reset();
+        }
+        CoUninitialize();
+    }
+
+    bool WasapiAudioSink::wait_for_device() {
+        return WaitForSingleObject(m_buffer_event, EVENT_TIMEOUT_MS) == WAIT_OBJECT_0;
+    }
+
+    uint32_t WasapiAudioSink::writable_frames() {
+        return bufferFrameCount - queued_frames();
+    }
+
+    void WasapiAudioSink::close() {
+        stop();
+        if (m_audio_render_client) {
+            m_audio_render_client->Release();
+            m_audio_render_client = nullptr;
+        }
+        if (m_audioClient) {
+            m_audioClient->Release();
+            m_audioClient = nullptr;
+        }
+        if (m_buffer_event) {
+            CloseHandle(m_buffer_event);
+            m_buffer_event = nullptr;
+        }
+        if (m_com_initialized) {
+            CoUninitialize();
+            m_com_initialized = false;
+        }
+    }
+
+    uint32_t WasapiAudioSink::write(const int16_t *samples, uint32_t frames) {
+        if (!m_audio_render_client) return 0;
+        UINT32 frameAvailable = writable_frames();
+        UINT32 framesToWrite = frameAvailable > frames ? frames : frameAvailable;
+        if (framesToWrite == 0) return 0;
+        BYTE *data = nullptr;
+        if (FAILED(m_audio_render_client->GetBuffer(framesToWrite, &data))) return 0;
+        memcpy(data, samples, framesToWrite * m_format.bytes_per_frame());
+        m_audio_render_client->ReleaseBuffer(framesToWrite, 0);
+        return framesToWrite;
+    }
+
+    uint32_t WasapiAudioSink::queued_frames() {
+        UINT32 padding = 0;
+        if (m_audioClient) {
+            m_audioClient->GetCurrentPadding(&padding);
+        }
+        return padding;
+    }
+}
+#endif
@@ -0,0 +1,328 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include "computes/BatchedYuvRgba.h"
+
+namespace fd {
+    BatchedYuvRgba::BatchedYuvRgba(RenderContext *ctx, uint32_t width, uint32_t height, uint32_t layers,
+                                   const KernelConfigs &configs) : m_ctx{ctx}, m_width{width}, m_height{height},
+                                                                   m_layers{layers}, m_configs{configs} {
+        VkCommandPoolCreateInfo commandPoolCreateInfo{};
+        commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        commandPoolCreateInfo.queueFamilyIndex = m_ctx->computeQueueIndex;
+        commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        VK_CHECK(vkCreateCommandPool(m_ctx->logicalDevice, &commandPoolCreateInfo, nullptr, &m_command_pool),
+                 "Failed to create the batched compute command pool");
+        VkCommandBufferAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.commandBufferCount = 1;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandPool = m_command_pool;
+        VK_CHECK(vkAllocateCommandBuffers(m_ctx->logicalDevice, &allocateInfo, &m_command_buffer),
+                 "Failed to allocate the batched compute command buffer");
+        VkSemaphoreCreateInfo semaphoreCreateInfo{};
+        semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        vkCreateSemaphore(m_ctx->logicalDevice, &semaphoreCreateInfo, nullptr, &m_semaphore);
+        create_sampler(m_ctx->logicalDevice, m_sampler);
+        prepare_buffers_and_images();
+        setup_descriptors();
+        create_pipeline();
+        m_staged_layers.reserve(m_layers);
+        LOG_INFO("Batched conversion of {} streams of {}x{}", m_layers, m_width, m_height);
+    }
+
+    bool BatchedYuvRgba::is_requested() {
+        const char *batched = std::getenv("FD_BATCHED_YUV");
+        return batched != nullptr && std::strcmp(batched, "1") == 0;
+    }
+
+    void BatchedYuvRgba::prepare_buffers_and_images() {
+        uint32_t chromaW = m_width >> 1;
+        uint32_t chromaH = m_height >> 1;
+        VkDeviceSize size = static_cast<VkDeviceSize>(m_width) * m_height;
+        VkDeviceSize chromaSize = static_cast<VkDeviceSize>(chromaW) * chromaH;
+        create_buffer(m_ctx, m_y_plane_buffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, m_y_plane_buffer_memory,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, size * m_layers);
+        create_buffer(m_ctx, m_u_plane_buffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, m_u_plane_buffer_memory,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      chromaSize * m_layers);
+        create_buffer(m_ctx, m_v_plane_buffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, m_v_plane_buffer_memory,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      chromaSize * m_layers);
+        vkMapMemory(m_ctx->logicalDevice, m_y_plane_buffer_memory, 0, size * m_layers, 0, &m_y_data);
+        vkMapMemory(m_ctx->logicalDevice, m_u_plane_buffer_memory, 0, chromaSize * m_layers, 0, &m_u_data);
+        vkMapMemory(m_ctx->logicalDevice, m_v_plane_buffer_memory, 0, chromaSize * m_layers, 0, &m_v_data);
+
+        create_image(m_ctx, m_y_image, m_width, m_height, m_y_image_memory, VK_FORMAT_R8_UNORM,
+                     VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_layers);
+        create_image_view(m_ctx->logicalDevice, m_y_image, m_y_image_view, VK_FORMAT_R8_UNORM,
+                          VK_IMAGE_VIEW_TYPE_2D_ARRAY, m_layers);
+        create_image(m_ctx, m_u_image, chromaW, chromaH, m_u_image_memory, VK_FORMAT_R8_UNORM,
+                     VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_layers);
+        create_image_view(m_ctx->logicalDevice, m_u_image, m_u_image_view, VK_FORMAT_R8_UNORM,
+                          VK_IMAGE_VIEW_TYPE_2D_ARRAY, m_layers);
+        create_image(m_ctx, m_v_image, chromaW, chromaH, m_v_image_memory, VK_FORMAT_R8_UNORM,
+                     VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_layers);
+        create_image_view(m_ctx->logicalDevice, m_v_image, m_v_image_view, VK_FORMAT_R8_UNORM,
+                          VK_IMAGE_VIEW_TYPE_2D_ARRAY, m_layers);
+        create_image(m_ctx, m_rgba_image, m_width, m_height, m_rgba_image_memory, VK_FORMAT_R8G8B8A8_UNORM,
+                     VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_layers);
+        create_image_view(m_ctx->logicalDevice, m_rgba_image, m_rgba_image_view, VK_FORMAT_R8G8B8A8_UNORM,
+                          VK_IMAGE_VIEW_TYPE_2D_ARRAY, m_layers);
+
+        // Layers a tick does not stage are still converted, they start cleared to black.
+        VkCommandBuffer commandBuffer = start_command_buffer(m_ctx);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo), "Failed to begin the command buffer");
+        VkClearColorValue clearColor{};
+        VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, m_layers};
+        for (VkImage image: {m_y_image, m_u_image, m_v_image}) {
+            record_transition_image(commandBuffer, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                    VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, m_layers);
+            vkCmdClearColorImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &range);
+        }
+        record_transition_image(commandBuffer, m_rgba_image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                                VK_IMAGE_LAYOUT_GENERAL, 0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, m_layers);
+        submit_queue(m_ctx, commandBuffer);
+        vkFreeCommandBuffers(m_ctx->logicalDevice, m_ctx->commandPool, 1, &commandBuffer);
+    }
+
+    void BatchedYuvRgba::setup_descriptors() {
+        VkDescriptorSetLayoutBinding yuvBinding{};
+        yuvBinding.binding = 0;
+        yuvBinding.descriptorCount = 3;
+        yuvBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        yuvBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutBinding rgbaBinding{};
+        rgbaBinding.binding = 1;
+        rgbaBinding.descriptorCount = 1;
+        rgbaBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        rgbaBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        std::array<VkDescriptorSetLayoutBinding, 2> bindings{yuvBinding, rgbaBinding};
+        VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
+        layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutCreateInfo.bindingCount = bindings.size();
+        layoutCreateInfo.pBindings = bindings.data();
+        VK_CHECK(vkCreateDescriptorSetLayout(m_ctx->logicalDevice, &layoutCreateInfo, nullptr, &m_des_layout),
+                 "failed to create the descriptor set layout for batched rgba");
+
+        VkDescriptorPoolSize inputSize{};
+        inputSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        inputSize.descriptorCount = 3;
+        VkDescriptorPoolSize outputSize{};
+        outputSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        outputSize.descriptorCount = 1;
+        std::array<VkDescriptorPoolSize, 2> sizes{inputSize, outputSize};
+        VkDescriptorPoolCreateInfo poolCreateInfo{};
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolCreateInfo.poolSizeCount = sizes.size();
+        poolCreateInfo.pPoolSizes = sizes.data();
+        poolCreateInfo.maxSets = 1;
+        VK_CHECK(vkCreateDescriptorPool(m_ctx->logicalDevice, &poolCreateInfo, nullptr, &m_des_pool),
+                 "Failed to create the batched descriptor pool");
+
+        VkDescriptorSetAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateInfo.pSetLayouts = &m_des_layout;
+        allocateInfo.descriptorPool = m_des_pool;
+        allocateInfo.descriptorSetCount = 1;
+        vkAllocateDescriptorSets(m_ctx->logicalDevice, &allocateInfo, &m_des_set);
+
+        std::array<VkDescriptorImageInfo, 3> imageInfos{};
+        std::array<VkImageView, 3> planeViews{m_y_image_view, m_u_image_view, m_v_image_view};
+        for (size_t i = 0; i < imageInfos.size(); i++) {
+            imageInfos[i].sampler = m_sampler;
+            imageInfos[i].imageView = planeViews[i];
+            imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        }
+        VkWriteDescriptorSet yuvWrite{};
+        yuvWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        yuvWrite.descriptorCount = imageInfos.size();
+        yuvWrite.dstBinding = 0;
+        yuvWrite.dstSet = m_des_set;
+        yuvWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        yuvWrite.pImageInfo = imageInfos.data();
+
+        VkDescriptorImageInfo rgbaInfo{};
+        rgbaInfo.imageView = m_rgba_image_view;
+        rgbaInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        VkWriteDescriptorSet rgbaWrite{};
+        rgbaWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        rgbaWrite.descriptorCount = 1;
+        rgbaWrite.dstBinding = 1;
+        rgbaWrite.dstSet = m_des_set;
+        rgbaWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        rgbaWrite.pImageInfo = &rgbaInfo;
+
+        std::array<VkWriteDescriptorSet, 2> writeInfo{yuvWrite, rgbaWrite};
+        vkUpdateDescriptorSets(m_ctx->logicalDevice, writeInfo.size(), writeInfo.data(), 0, nullptr);
+    }
+
+    void BatchedYuvRgba::create_pipeline() {
+        ScopedMsTimer timer{m_ctx->pipelineCreationMs};
+        VkShaderModule computeModule = create_shader_module(m_ctx->logicalDevice, SHADER_YUV_RGBA_BATCHED);
+        VkPipelineShaderStageCreateInfo computeStage{};
+        computeStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        computeStage.pName = "main";
+        computeStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        computeStage.module = computeModule;
+        std::array<VkSpecializationMapEntry, 3> specializationEntries{};
+        VkSpecializationInfo specializationInfo = kernel_specialization_info(m_configs.yuvRgba,
+                                                                             specializationEntries);
+        computeStage.pSpecializationInfo = &specializationInfo;
+
+        VkPipelineLayoutCreateInfo layoutCreateInfo{};
+        layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutCreateInfo.setLayoutCount = 1;
+        layoutCreateInfo.pSetLayouts = &m_des_layout;
+        VK_CHECK(vkCreatePipelineLayout(m_ctx->logicalDevice, &layoutCreateInfo, nullptr, &m_pipeline_layout),
+                 "failed to create the pipeline layout for batched rgba");
+
+        VkComputePipelineCreateInfo computePipelineCreateInfo{};
+        computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        computePipelineCreateInfo.layout = m_pipeline_layout;
+        computePipelineCreateInfo.stage = computeStage;
+        VK_CHECK(vkCreateComputePipelines(m_ctx->logicalDevice, m_ctx->pipelineCache, 1, &computePipelineCreateInfo,
+                                          nullptr, &m_pipeline), "Failed to create the batched rgba pipeline");
+        vkDestroyShaderModule(m_ctx->logicalDevice, computeModule, nullptr);
+    }
+
+    void BatchedYuvRgba::stage(uint32_t layer, const uint8_t *yPlane, const uint8_t *uPlane, const uint8_t *vPlane) {
+        size_t size = static_cast<size_t>(m_width) * m_height;
+        size_t chromaSize = static_cast<size_t>(m_width >> 1) * (m_height >> 1);
+        memcpy(static_cast<uint8_t *>(m_y_data) + layer * size, yPlane, size);
+        memcpy(static_cast<uint8_t *>(m_u_data) + layer * chromaSize, uPlane, chromaSize);
+        memcpy(static_cast<uint8_t *>(m_v_data) + layer * chromaSize, vPlane, chromaSize);
+        m_staged_layers.push_back(layer);
+    }
+
+    void BatchedYuvRgba::record_plane_barriers(VkImageLayout oldLayout, VkImageLayout newLayout,
+                                               VkAccessFlags srcAccess, VkPipelineStageFlags srcStage,
+                                               VkAccessFlags dstAccess, VkPipelineStageFlags dstStage) {
+        for (VkImage image: {m_y_image, m_u_image, m_v_image}) {
+            record_transition_image(m_command_buffer, image, VK_IMAGE_ASPECT_COLOR_BIT, oldLayout, newLayout,
+                                    srcAccess, srcStage, dstAccess, dstStage, VK_QUEUE_FAMILY_IGNORED,
+                                    VK_QUEUE_FAMILY_IGNORED, m_layers);
+        }
+    }
+
+    bool BatchedYuvRgba::compute() {
+        if (m_staged_layers.empty()) return false;
+        vkResetCommandBuffer(m_command_buffer, 0);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK(vkBeginCommandBuffer(m_command_buffer, &beginInfo), "Failed to begin the batched command buffer");
+
+        if (!m_first_compute) {
+            record_plane_barriers(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                  VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                  VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+            record_transition_image(m_command_buffer, m_rgba_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
+                                    0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_ctx->graphicsQueueIndex,
+                                    m_ctx->computeQueueIndex, m_layers);
+        }
+        VkDeviceSize size = static_cast<VkDeviceSize>(m_width) * m_height;
+        VkDeviceSize chromaSize = static_cast<VkDeviceSize>(m_width >> 1) * (m_height >> 1);
+        for (uint32_t layer: m_staged_layers) {
+            record_buffer_to_image(m_command_buffer, m_y_plane_buffer, m_y_image, m_width, m_height,
+                                   VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layer * size,
+                                   layer);
+            record_buffer_to_image(m_command_buffer, m_u_plane_buffer, m_u_image, m_width >> 1, m_height >> 1,
+                                   VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   layer * chromaSize, layer);
+            record_buffer_to_image(m_command_buffer, m_v_plane_buffer, m_v_image, m_width >> 1, m_height >> 1,
+                                   VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   layer * chromaSize, layer);
+        }
+        record_plane_barriers(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                              VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        vkCmdBindPipeline(m_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+        vkCmdBindDescriptorSets(m_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1,
+                                &m_des_set, 0, nullptr);
+        vkCmdDispatch(m_command_buffer, group_count(m_width, m_configs.yuvRgba.localSizeX),
+                      group_count(m_height, m_configs.yuvRgba.localSizeY), m_layers);
+
+        record_transition_image(m_command_buffer, m_rgba_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                m_ctx->computeQueueIndex, m_ctx->graphicsQueueIndex, m_layers);
+        vkEndCommandBuffer(m_command_buffer);
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &m_command_buffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &m_semaphore;
+        queue_submit(m_ctx, m_ctx->computeQueue, submitInfo, nullptr);
+        m_staged_layers.clear();
+        m_first_compute = false;
+        return true;
+    }
+
+    void BatchedYuvRgba::record_acquire(VkCommandBuffer commandBuffer) {
+        if (m_ctx->computeQueueIndex == m_ctx->graphicsQueueIndex) return;
+        record_transition_image(commandBuffer, m_rgba_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                m_ctx->computeQueueIndex, m_ctx->graphicsQueueIndex, m_layers);
+    }
+
+    void BatchedYuvRgba::record_release(VkCommandBuffer commandBuffer) {
+        if (m_ctx->computeQueueIndex == m_ctx->graphicsQueueIndex) return;
+        record_transition_image(commandBuffer, m_rgba_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
+                                VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                0, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                m_ctx->graphicsQueueIndex, m_ctx->computeQueueIndex, m_layers);
+    }
+
+    void BatchedYuvRgba::clean_up() {
+        vkDestroyBuffer(m_ctx->logicalDevice, m_y_plane_buffer, nullptr);
+        vkDestroyBuffer(m_ctx->logicalDevice, m_u_plane_buffer, nullptr);
+        vkDestroyBuffer(m_ctx->logicalDevice, m_v_plane_buffer, nullptr);
+        vkFreeMemory(m_ctx->logicalDevice, m_y_plane_buffer_memory, nullptr);
+        vkFreeMemory(m_ctx->logicalDevice, m_u_plane_buffer_memory, nullptr);
+        vkFreeMemory(m_ctx->logicalDevice, m_v_plane_buffer_memory, nullptr);
+        vkDestroyImageView(m_ctx->logicalDevice, m_y_image_view, nullptr);
+        vkDestroyImage(m_ctx->logicalDevice, m_y_image, nullptr);
+        vkFreeMemory(m_ctx->logicalDevice, m_y_image_memory, nullptr);
+        vkDestroyImageView(m_ctx->logicalDevice, m_u_image_view, nullptr);
+        vkDestroyImage(m_ctx->logicalDevice, m_u_image, nullptr);
+        vkFreeMemory(m_ctx->logicalDevice, m_u_image_memory, nullptr);
+        vkDestroyImageView(m_ctx->logicalDevice, m_v_image_view, nullptr);
+        vkDestroyImage(m_ctx->logicalDevice, m_v_image, nullptr);
+        vkFreeMemory(m_ctx->logicalDevice, m_v_image_memory, nullptr);
+        vkDestroyImageView(m_ctx->logicalDevice, m_rgba_image_view, nullptr);
+        vkDestroyImage(m_ctx->logicalDevice, m_rgba_image, nullptr);
+        vkFreeMemory(m_ctx->logicalDevice, m_rgba_image_memory, nullptr);
+        vkDestroyPipeline(m_ctx->logicalDevice, m_pipeline, nullptr);
+        vkDestroyPipelineLayout(m_ctx->logicalDevice, m_pipeline_layout, nullptr);
+        vkDestroyDescriptorPool(m_ctx->logicalDevice, m_des_pool, nullptr);
+        vkDestroyDescriptorSetLayout(m_ctx->logicalDevice, m_des_layout, nullptr);
+        vkDestroySampler(m_ctx->logicalDevice, m_sampler, nullptr);
+        vkDestroySemaphore(m_ctx->logicalDevice, m_semaphore, nullptr);
+        vkDestroyCommandPool(m_ctx->logicalDevice, m_command_pool, nullptr);
+    }
+}
@@ -0,0 +1,275 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include "computes/KernelAutotuner.h"
+#include "computes/VulkanYuvToRgba.h"
+
+namespace fd {
+    KernelAutotuner::KernelAutotuner(RenderContext *ctx, uint32_t width, uint32_t height, const char *cachePath)
+            : m_ctx{ctx}, m_width{width}, m_height{height}, m_cache_path{cachePath} {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(m_ctx->physicalDevice, &properties);
+        std::ostringstream key{};
+        key << std::hex << properties.vendorID << ":" << properties.deviceID << ":" << properties.driverVersion;
+        m_device_key = key.str();
+    }
+
+    KernelConfigs KernelAutotuner::tune(const KernelConfigs &defaults) {
+        // The temporal workgroup is its motion block, the denoise and the scene cut stats depend on it, so it keeps
+        // the default shape on every device.
+        KernelConfigs configs = defaults;
+        if (load_cache(configs)) {
+            LOG_INFO("Kernel configs loaded from {} for device {}", m_cache_path, m_device_key);
+            return configs;
+        }
+        create_timing_resources();
+        configs.blur = tune_kernel("blur", defaults.blur, [this](const KernelConfig &config) -> double {
+            VulkanFilterR8 blur{m_ctx, SHADER_GAUSSIAN_BLUR, m_width, m_height, config};
+            double ms = time_recording([this, &blur](VkCommandBuffer commandBuffer) -> void {
+                blur.compute(commandBuffer, m_scratch_image);
+            });
+            blur.cleanup();
+            return ms;
+        });
+        configs.yuvRgba = tune_kernel("yuvRgba", defaults.yuvRgba,
+                                      [this, &defaults](const KernelConfig &config) -> double {
+            KernelConfigs variant = defaults;
+            variant.yuvRgba = config;
+            ComputeYuvRgba yuvRgba{m_ctx, SHADER_YUV_RGBA, m_width, m_height, variant};
+            double ms = time_recording([&yuvRgba](VkCommandBuffer commandBuffer) -> void {
+                yuvRgba.record_dispatch(commandBuffer);
+            });
+            yuvRgba.clean_up();
+            return ms;
+        });
+        destroy_timing_resources();
+        save_cache(configs);
+        return configs;
+    }
+
+    void KernelAutotuner::create_timing_resources() {
+        m_commandBuffer = start_command_buffer(m_ctx, m_ctx->computeCommandPool);
+        m_fence = get_fence(m_ctx);
+
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(m_ctx->physicalDevice, &properties);
+        uint32_t count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(m_ctx->physicalDevice, &count, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+        vkGetPhysicalDeviceQueueFamilyProperties(m_ctx->physicalDevice, &count, queueFamilyProperties.data());
+        m_timestamp_period = properties.limits.timestampPeriod;
+        m_has_timestamps = queueFamilyProperties[m_ctx->computeQueueIndex].timestampValidBits > 0 &&
+                           m_timestamp_period > 0.0f;
+        if (m_has_timestamps) {
+            VkQueryPoolCreateInfo queryPoolCreateInfo{};
+            queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            queryPoolCreateInfo.queryCount = 2;
+            VK_CHECK(vkCreateQueryPool(m_ctx->logicalDevice, &queryPoolCreateInfo, nullptr, &m_query_pool),
+                     "Failed to create the autotune query pool");
+        } else {
+            LOG_WARN("Compute queue has no timestamps, autotuning with the host clock");
+        }
+
+        // The kernels read a zeroed luma image so the temporal stats stay quiet while timing.
+        create_image(m_ctx, m_scratch_image, m_width, m_height, m_scratch_image_memory, VK_FORMAT_R8_UNORM,
+                     VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        submit_and_wait([this](VkCommandBuffer commandBuffer) -> void {
+            record_transition_image(commandBuffer, m_scratch_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                    0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                    VK_PIPELINE_STAGE_TRANSFER_BIT);
+            VkClearColorValue clearColor{};
+            VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+            vkCmdClearColorImage(commandBuffer, m_scratch_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1,
+                                 &range);
+        });
+    }
+
+    void KernelAutotuner::destroy_timing_resources() {
+        vkDestroyImage(m_ctx->logicalDevice, m_scratch_image, nullptr);
+        vkFreeMemory(m_ctx->logicalDevice, m_scratch_image_memory, nullptr);
+        if (m_query_pool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(m_ctx->logicalDevice, m_query_pool, nullptr);
+        }
+        vkDestroyFence(m_ctx->logicalDevice, m_fence, nullptr);
+        vkFreeCommandBuffers(m_ctx->logicalDevice, m_ctx->computeCommandPool, 1, &m_commandBuffer);
+    }
+
+    std::vector<KernelConfig> KernelAutotuner::candidates(const KernelConfig &base) {
+        std::vector<KernelConfig> shapes{
+                {8,  8,  base.radius},
+                {16, 8,  base.radius},
+                {8,  16, base.radius},
+                {16, 16, base.radius},
+                {32, 8,  base.radius}
+        };
+        std::vector<KernelConfig> supported{};
+        for (KernelConfig &shape: shapes) {
+            if (is_supported(shape)) supported.push_back(shape);
+        }
+        return supported;
+    }
+
+    bool KernelAutotuner::is_supported(const KernelConfig &config) {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(m_ctx->physicalDevice, &properties);
+        const VkPhysicalDeviceLimits &limits = properties.limits;
+        // Largest tile a tuned kernel keeps in shared memory, a block and its apron.
+        uint32_t apron = 2 * config.radius;
+        uint32_t sharedBytes = (config.localSizeX * config.localSizeY +
+                                (config.localSizeX + apron) * (config.localSizeY + apron)) * sizeof(float) + 16;
+        return config.localSizeX <= limits.maxComputeWorkGroupSize[0] &&
+               config.localSizeY <= limits.maxComputeWorkGroupSize[1] &&
+               config.localSizeX * config.localSizeY <= limits.maxComputeWorkGroupInvocations &&
+               sharedBytes <= limits.maxComputeSharedMemorySize;
+    }
+
+    double KernelAutotuner::submit_and_wait(const std::function<void(VkCommandBuffer)> &record) {
+        vkResetCommandBuffer(m_commandBuffer, 0);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK(vkBeginCommandBuffer(m_commandBuffer, &beginInfo), "Failed to begin the autotune command buffer");
+        if (m_has_timestamps) {
+            vkCmdResetQueryPool(m_commandBuffer, m_query_pool, 0, 2);
+            vkCmdWriteTimestamp(m_commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_query_pool, 0);
+        }
+        record(m_commandBuffer);
+        if (m_has_timestamps) {
+            vkCmdWriteTimestamp(m_commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_query_pool, 1);
+        }
+        vkEndCommandBuffer(m_commandBuffer);
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &m_commandBuffer;
+        std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+        vkResetFences(m_ctx->logicalDevice, 1, &m_fence);
+        queue_submit(m_ctx, m_ctx->computeQueue, submitInfo, m_fence);
+        vkWaitForFences(m_ctx->logicalDevice, 1, &m_fence, VK_TRUE, UINT64_MAX);
+        double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (m_has_timestamps) {
+            std::array<uint64_t, 2> timestamps{};
+            vkGetQueryPoolResults(m_ctx->logicalDevice, m_query_pool, 0, 2, sizeof(timestamps),
+                                  timestamps.data(), sizeof(uint64_t),
+                                  VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+            elapsedMs = static_cast<double>(timestamps[1] - timestamps[0]) * m_timestamp_period * 1e-6;
+        }
+        return elapsedMs;
+    }
+
+    double KernelAutotuner::time_recording(const std::function<void(VkCommandBuffer)> &record) {
+        for (int run = 0; run < WARMUP_RUNS; run++) {
+            submit_and_wait(record);
+        }
+        double totalMs = 0.0;
+        for (int run = 0; run < TIMED_RUNS; run++) {
+            totalMs += submit_and_wait(record);
+        }
+        return totalMs / TIMED_RUNS;
+    }
+
+    KernelConfig KernelAutotuner::tune_kernel(const char *name, const KernelConfig &base,
+                                              const std::function<double(const KernelConfig &)> &timeVariant) {
+        KernelConfig best = base;
+        double bestMs = -1.0;
+        for (const KernelConfig &config: candidates(base)) {
+            double ms = timeVariant(config);
+            LOG_INFO("Autotune {} {}x{} : {:.3f} ms", name, config.localSizeX, config.localSizeY, ms);
+            if (bestMs < 0.0 || ms < bestMs) {
+                bestMs = ms;
+                best = config;
+            }
+        }
+        LOG_INFO("Autotune {} picked {}x{}", name, best.localSizeX, best.localSizeY);
+        return best;
+    }
+
+    bool KernelAutotuner::load_cache(KernelConfigs &configs) {
+        std::ifstream inputStream(m_cache_path);
+        if (!inputStream) return false;
+        // A driver update keeps the key but can lower the limits, or the file was edited by hand.
+        return parse_cache(inputStream, m_device_key, m_width, m_height, [this](const KernelConfig &config) -> bool {
+            if (is_supported(config)) return true;
+            LOG_WARN("Dropping the cached {}x{} kernel, the device does not support it", config.localSizeX,
+                     config.localSizeY);
+            return false;
+        }, configs);
+    }
+
+    bool KernelAutotuner::parse_cache(std::istream &input, const std::string &deviceKey, uint32_t width,
+                                      uint32_t height, const std::function<bool(const KernelConfig &)> &isSupported,
+                                      KernelConfigs &configs) {
+        KernelConfigs cached = configs;
+        int found = 0;
+        std::string line{};
+        while (std::getline(input, line)) {
+            std::istringstream fields(line);
+            std::string key{}, kernel{};
+            uint32_t entryWidth = 0, entryHeight = 0;
+            KernelConfig config{};
+            if (!(fields >> key >> entryWidth >> entryHeight >> kernel >> config.localSizeX >> config.localSizeY >>
+                         config.radius)) {
+                continue;
+            }
+            if (key != deviceKey || entryWidth != width || entryHeight != height) continue;
+            if (config.localSizeX == 0 || config.localSizeY == 0 || !isSupported(config)) continue;
+            // Entries tuned for another radius do not apply.
+            if (kernel == "blur" && config.radius == configs.blur.radius) {
+                cached.blur = config;
+                found |= 1;
+            } else if (kernel == "yuvRgba") {
+                cached.yuvRgba = config;
+                found |= 2;
+            }
+        }
+        if (found != 3) return false;
+        configs = cached;
+        return true;
+    }
+
+    void KernelAutotuner::save_cache(const KernelConfigs &configs) {
+        std::vector<std::string> lines{};
+        {
+            std::ifstream inputStream(m_cache_path);
+            std::string line{};
+            std::ostringstream prefix{};
+            prefix << m_device_key << " " << m_width << " " << m_height << " ";
+            while (std::getline(inputStream, line)) {
+                if (line.rfind(prefix.str(), 0) != 0) lines.push_back(line);
+            }
+        }
+        // Written aside and renamed so a crash mid write never leaves a truncated cache behind.
+        std::string path = m_cache_path;
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream outputStream(tempPath, std::ios::trunc);
+            if (!outputStream) {
+                LOG_WARN("Failed to write the kernel autotune cache {}", tempPath);
+                return;
+            }
+            for (std::string &line: lines) {
+                outputStream << line << "\n";
+            }
+            std::array<std::pair<const char *, const KernelConfig *>, 2> entries{
+                    std::make_pair("yuvRgba", &configs.yuvRgba),
+                    std::make_pair("blur", &configs.blur)
+            };
+            for (auto &entry: entries) {
+                outputStream << m_device_key << " " << m_width << " " << m_height << " " << entry.first << " "
+                             << entry.second->localSizeX << " " << entry.second->localSizeY << " "
+                             << entry.second->radius << "\n";
+            }
+        }
+        std::remove(path.c_str());
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            LOG_WARN("Failed to replace the kernel autotune cache {}", path);
+        }
+    }
+}
@@ -0,0 +1,236 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include "computes/SeparableScaler.h"
+#include "GpuProfiler.h"
+
+namespace fd {
+    SeparableScaler::SeparableScaler(RenderContext *ctx, VkImageView srcImageView, uint32_t srcWidth,
+                                     uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, ScaleFilter filter,
+                                     const KernelConfig &config) : m_ctx{ctx}, m_src_width{srcWidth},
+                                                                   m_src_height{srcHeight}, m_dst_width{dstWidth},
+                                                                   m_dst_height{dstHeight}, m_filter{filter},
+                                                                   m_config{config} {
+        create_sampler(m_ctx->logicalDevice, m_src_sampler);
+        prepare_images();
+        setup_descriptors(srcImageView);
+        create_pipeline();
+    }
+
+    bool SeparableScaler::is_available() {
+        return find_embedded_shader(SHADER_SEPARABLE_SCALE) != nullptr;
+    }
+
+    bool SeparableScaler::filter_from_env(ScaleFilter &filter) {
+        const char *name = std::getenv("FD_SCALER");
+        filter = ScaleFilter::LANCZOS;
+        if (name == nullptr) return true;
+        if (std::strcmp(name, "off") == 0 || std::strcmp(name, "0") == 0) return false;
+        if (std::strcmp(name, "bilinear") == 0) {
+            filter = ScaleFilter::BILINEAR;
+        } else if (std::strcmp(name, "bicubic") == 0) {
+            filter = ScaleFilter::BICUBIC;
+        } else if (std::strcmp(name, "lanczos") != 0) {
+            LOG_WARN("Unknown FD_SCALER {}, scaling with lanczos", name);
+        }
+        return true;
+    }
+
+    ScaleStage SeparableScaler::choose_stage(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth,
+                                             uint32_t dstHeight) {
+        const char *stage = std::getenv("FD_SCALER_STAGE");
+        if (stage != nullptr && std::strcmp(stage, "early") == 0) return ScaleStage::EARLY;
+        if (stage != nullptr && std::strcmp(stage, "late") == 0) return ScaleStage::LATE;
+        // The scale itself costs the same at either end of the chain, the filters and the conversion run at the
+        // destination size when it is early and at the source size when it is late, so the smaller one wins.
+        uint64_t srcPixels = static_cast<uint64_t>(srcWidth) * srcHeight;
+        uint64_t dstPixels = static_cast<uint64_t>(dstWidth) * dstHeight;
+        return dstPixels <= srcPixels ? ScaleStage::EARLY : ScaleStage::LATE;
+    }
+
+    const char *SeparableScaler::filter_name(ScaleFilter filter) {
+        switch (filter) {
+            case ScaleFilter::BILINEAR:
+                return "bilinear";
+            case ScaleFilter::BICUBIC:
+                return "bicubic";
+            default:
+                return "lanczos";
+        }
+    }
+
+    void SeparableScaler::prepare_images() {
+        create_image(m_ctx, m_mid_image, m_dst_width, m_src_height, m_mid_image_memory, VK_FORMAT_R32_SFLOAT,
+                     VK_IMAGE_USAGE_STORAGE_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        create_image_view(m_ctx->logicalDevice, m_mid_image, m_mid_image_view, VK_FORMAT_R32_SFLOAT);
+        create_image(m_ctx, m_output_image, m_dst_width, m_dst_height, m_output_image_memory, VK_FORMAT_R8_UNORM,
+                     VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                     VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        create_image_view(m_ctx->logicalDevice, m_output_image, m_output_image_view, VK_FORMAT_R8_UNORM);
+        // The intermediate stays in GENERAL, only the scaler touches it.
+        VkCommandBuffer commandBuffer = start_command_buffer(m_ctx);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo), "Failed to begin the command buffer");
+        record_transition_image(commandBuffer, m_mid_image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                                VK_IMAGE_LAYOUT_GENERAL, 0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        submit_queue(m_ctx, commandBuffer);
+        vkFreeCommandBuffers(m_ctx->logicalDevice, m_ctx->commandPool, 1, &commandBuffer);
+    }
+
+    void SeparableScaler::setup_descriptors(VkImageView srcImageView) {
+        std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+        for (uint32_t i = 0; i < bindings.size(); i++) {
+            bindings[i].binding = i;
+            bindings[i].descriptorCount = 1;
+            bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+                                                : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
+        layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutCreateInfo.bindingCount = bindings.size();
+        layoutCreateInfo.pBindings = bindings.data();
+        VK_CHECK(vkCreateDescriptorSetLayout(m_ctx->logicalDevice, &layoutCreateInfo, nullptr, &m_des_layout),
+                 "failed to create the descriptor set layout for the scaler");
+
+        VkDescriptorPoolSize inputSize{};
+        inputSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        inputSize.descriptorCount = 1;
+        VkDescriptorPoolSize storageSize{};
+        storageSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        storageSize.descriptorCount = 2;
+        std::array<VkDescriptorPoolSize, 2> sizes{inputSize, storageSize};
+        VkDescriptorPoolCreateInfo poolCreateInfo{};
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolCreateInfo.poolSizeCount = sizes.size();
+        poolCreateInfo.pPoolSizes = sizes.data();
+        poolCreateInfo.maxSets = 1;
+        VK_CHECK(vkCreateDescriptorPool(m_ctx->logicalDevice, &poolCreateInfo, nullptr, &m_des_pool),
+                 "Failed to create the scaler descriptor pool");
+
+        VkDescriptorSetAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateInfo.pSetLayouts = &m_des_layout;
+        allocateInfo.descriptorPool = m_des_pool;
+        allocateInfo.descriptorSetCount = 1;
+        vkAllocateDescriptorSets(m_ctx->logicalDevice, &allocateInfo, &m_des_set);
+
+        VkDescriptorImageInfo srcInfo{};
+        srcInfo.sampler = m_src_sampler;
+        srcInfo.imageView = srcImageView;
+        srcInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        VkDescriptorImageInfo midInfo{};
+        midInfo.imageView = m_mid_image_view;
+        midInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        VkDescriptorImageInfo dstInfo{};
+        dstInfo.imageView = m_output_image_view;
+        dstInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        std::array<VkDescriptorImageInfo, 3> imageInfos{srcInfo, midInfo, dstInfo};
+        std::array<VkWriteDescriptorSet, 3> writeInfo{};
+        for (uint32_t i = 0; i < writeInfo.size(); i++) {
+            writeInfo[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writeInfo[i].descriptorCount = 1;
+            writeInfo[i].dstBinding = i;
+            writeInfo[i].dstSet = m_des_set;
+            writeInfo[i].descriptorType = bindings[i].descriptorType;
+            writeInfo[i].pImageInfo = &imageInfos[i];
+        }
+        vkUpdateDescriptorSets(m_ctx->logicalDevice, writeInfo.size(), writeInfo.data(), 0, nullptr);
+    }
+
+    void SeparableScaler::create_pipeline() {
+        ScopedMsTimer timer{m_ctx->pipelineCreationMs};
+        VkShaderModule computeModule = create_shader_module(m_ctx->logicalDevice, SHADER_SEPARABLE_SCALE);
+        VkPipelineShaderStageCreateInfo computeStage{};
+        computeStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        computeStage.pName = "main";
+        computeStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        computeStage.module = computeModule;
+        std::array<VkSpecializationMapEntry, 3> specializationEntries{};
+        VkSpecializationInfo specializationInfo = kernel_specialization_info(m_config, specializationEntries);
+        computeStage.pSpecializationInfo = &specializationInfo;
+
+        VkPushConstantRange scaleRange{};
+        scaleRange.size = sizeof(ScaleInfo);
+        scaleRange.offset = 0;
+        scaleRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkPipelineLayoutCreateInfo layoutCreateInfo{};
+        layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutCreateInfo.setLayoutCount = 1;
+        layoutCreateInfo.pSetLayouts = &m_des_layout;
+        layoutCreateInfo.pushConstantRangeCount = 1;
+        layoutCreateInfo.pPushConstantRanges = &scaleRange;
+        VK_CHECK(vkCreatePipelineLayout(m_ctx->logicalDevice, &layoutCreateInfo, nullptr, &m_pipeline_layout),
+                 "failed to create the pipeline layout for the scaler");
+
+        VkComputePipelineCreateInfo computePipelineCreateInfo{};
+        computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        computePipelineCreateInfo.layout = m_pipeline_layout;
+        computePipelineCreateInfo.stage = computeStage;
+        VK_CHECK(vkCreateComputePipelines(m_ctx->logicalDevice, m_ctx->pipelineCache, 1, &computePipelineCreateInfo,
+                                          nullptr, &m_pipeline), "Failed to create the scaler pipeline");
+        vkDestroyShaderModule(m_ctx->logicalDevice, computeModule, nullptr);
+    }
+
+    void SeparableScaler::record(VkCommandBuffer commandBuffer, VkImageLayout layout, VkAccessFlags dstAccess,
+                                 VkPipelineStageFlags dstStage) {
+        uint32_t profileScope = gpu_profile_begin(m_ctx, commandBuffer, GpuStage::SCALE, m_ctx->computeQueueIndex);
+        // The last frame's vertical pass read the intermediate and the filters read the output.
+        record_transition_image(commandBuffer, m_mid_image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL,
+                                VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        record_transition_image(commandBuffer, m_output_image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                                VK_IMAGE_LAYOUT_GENERAL, 0,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1, &m_des_set, 0,
+                                nullptr);
+
+        ScaleInfo info{};
+        info.srcSize[0] = static_cast<int32_t>(m_src_width);
+        info.srcSize[1] = static_cast<int32_t>(m_src_height);
+        info.dstSize[0] = static_cast<int32_t>(m_dst_width);
+        info.dstSize[1] = static_cast<int32_t>(m_dst_height);
+        info.filterType = static_cast<int32_t>(m_filter);
+        info.vertical = 0;
+        vkCmdPushConstants(commandBuffer, m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ScaleInfo), &info);
+        vkCmdDispatch(commandBuffer, group_count(m_dst_width, m_config.localSizeX),
+                      group_count(m_src_height, m_config.localSizeY), 1);
+
+        record_transition_image(commandBuffer, m_mid_image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL,
+                                VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        info.vertical = 1;
+        vkCmdPushConstants(commandBuffer, m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ScaleInfo), &info);
+        vkCmdDispatch(commandBuffer, group_count(m_dst_width, m_config.localSizeX),
+                      group_count(m_dst_height, m_config.localSizeY), 1);
+
+        record_transition_image(commandBuffer, m_output_image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL,
+                                layout, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstAccess,
+                                dstStage);
+        gpu_profile_end(m_ctx, commandBuffer, profileScope);
+    }
+
+    void SeparableScaler::clean_up() {
+        vkDestroyImageView(m_ctx->logicalDevice, m_mid_image_view, nullptr);
+        vkDestroyImage(m_ctx->logicalDevice, m_mid_image, nullptr);
+        vkFreeMemory(m_ctx->logicalDevice, m_mid_image_memory, nullptr);
+        vkDestroyImageView(m_ctx->logicalDevice, m_output_image_view, nullptr);
+        vkDestroyImage(m_ctx->logicalDevice, m_output_image, nullptr);
+        vkFreeMemory(m_ctx->logicalDevice, m_output_image_memory, nullptr);
+        vkDestroySampler(m_ctx->logicalDevice, m_src_sampler, nullptr);
+        vkDestroyPipeline(m_ctx->logicalDevice, m_pipeline, nullptr);
+        vkDestroyPipelineLayout(m_ctx->logicalDevice, m_pipeline_layout, nullptr);
+        vkDestroyDescriptorPool(m_ctx->logicalDevice, m_des_pool, nullptr);
+        vkDestroyDescriptorSetLayout(m_ctx->logicalDevice, m_des_layout, nullptr);
+    }
+}
@@ -0,0 +1,178 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <memory>
+#include "computes/StreamBenchmark.h"
+#include "computes/VulkanYuvToRgba.h"
+#include "computes/BatchedYuvRgba.h"
+#include "FrameHandler.h"
+
+namespace fd {
+    StreamBenchmark::StreamBenchmark(RenderContext *ctx, uint32_t width, uint32_t height,
+                                     const KernelConfigs &configs) : m_ctx{ctx}, m_width{width}, m_height{height},
+                                                                     m_configs{configs} {}
+
+    uint32_t StreamBenchmark::max_streams_from_env() {
+        const char *streams = std::getenv("FD_STREAM_BENCHMARK");
+        if (streams == nullptr) return 0;
+        return static_cast<uint32_t>(std::strtoul(streams, nullptr, 10));
+    }
+
+    std::vector<StreamBenchmarkResult> StreamBenchmark::run(uint32_t maxStreams, double frameBudgetMs) {
+        std::vector<StreamBenchmarkResult> results{};
+        if (maxStreams == 0) return results;
+        m_commandBuffer = start_command_buffer(m_ctx);
+        m_fence = get_fence(m_ctx);
+        uint32_t bestStreams = 0;
+        // Powers of two, the last step is maxStreams itself.
+        for (uint32_t streams = 1;; streams = (std::min)(streams * 2, maxStreams)) {
+            double ms = time_streams(streams);
+            results.push_back({streams, ms, -1.0});
+            if (streams > 1 && BatchedYuvRgba::is_requested()) {
+                results.back().batchedMsPerTick = time_batched(streams);
+                ms = (std::min)(ms, results.back().batchedMsPerTick);
+            }
+            LOG_INFO("Stream benchmark {}x{} : {} streams take {:.3f} ms per tick, {:.3f} ms batched", m_width,
+                     m_height, streams, results.back().msPerTick, results.back().batchedMsPerTick);
+            if (ms <= frameBudgetMs) bestStreams = streams;
+            if (streams == maxStreams) break;
+        }
+        LOG_INFO("Stream benchmark: {} streams of {}x{} fit a {:.2f} ms frame", bestStreams, m_width, m_height,
+                 frameBudgetMs);
+        vkDestroyFence(m_ctx->logicalDevice, m_fence, nullptr);
+        vkFreeCommandBuffers(m_ctx->logicalDevice, m_ctx->commandPool, 1, &m_commandBuffer);
+        return results;
+    }
+
+    double StreamBenchmark::time_streams(uint32_t streams) {
+        size_t lumaSize = static_cast<size_t>(m_width) * m_height;
+        size_t chromaSize = static_cast<size_t>(m_width >> 1) * (m_height >> 1);
+        // Mid grey, every stream reads the same planes.
+        std::unique_ptr<uint8_t[]> yPlane = std::make_unique<uint8_t[]>(lumaSize);
+        std::unique_ptr<uint8_t[]> uPlane = std::make_unique<uint8_t[]>(chromaSize);
+        std::unique_ptr<uint8_t[]> vPlane = std::make_unique<uint8_t[]>(chromaSize);
+        memset(yPlane.get(), 128, lumaSize);
+        memset(uPlane.get(), 128, chromaSize);
+        memset(vPlane.get(), 128, chromaSize);
+
+        std::vector<ComputeYuvRgba *> computes{};
+        std::vector<FrameHandler *> frameHandlers{};
+        for (uint32_t i = 0; i < streams; i++) {
+            computes.push_back(new ComputeYuvRgba(m_ctx, SHADER_YUV_RGBA, m_width, m_height, m_configs,
+                                                  computes.empty() ? nullptr : computes.front()));
+            frameHandlers.push_back(new FrameHandler(m_ctx, m_width, m_height));
+        }
+        std::vector<VkSemaphore> semaphores(streams);
+        std::vector<VkPipelineStageFlags> waitFlags(streams, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        double totalMs = 0.0;
+        for (int tick = 0; tick < WARMUP_TICKS + TIMED_TICKS; tick++) {
+            std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < streams; i++) {
+                computes[i]->compute(yPlane.get(), uPlane.get(), vPlane.get());
+                frameHandlers[i]->render_with_compute_image(computes[i]->get_rgba_image(),
+                                                            computes[i]->get_compute_semaphore());
+                semaphores[i] = frameHandlers[i]->get_frame_handler_semaphore();
+            }
+            // An empty submit stands in for the render pass, it consumes every frame handler semaphore.
+            vkResetCommandBuffer(m_commandBuffer, 0);
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+            vkEndCommandBuffer(m_commandBuffer);
+            VkSubmitInfo submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &m_commandBuffer;
+            submitInfo.waitSemaphoreCount = streams;
+            submitInfo.pWaitSemaphores = semaphores.data();
+            submitInfo.pWaitDstStageMask = waitFlags.data();
+            vkResetFences(m_ctx->logicalDevice, 1, &m_fence);
+            queue_submit(m_ctx, m_ctx->graphicsQueue, submitInfo, m_fence);
+            vkWaitForFences(m_ctx->logicalDevice, 1, &m_fence, VK_TRUE, UINT64_MAX);
+            // The compute queue may still be releasing images the graphics queue has already acquired.
+            {
+                std::lock_guard<std::mutex> lock{m_ctx->queueMutex};
+                vkQueueWaitIdle(m_ctx->computeQueue);
+            }
+            if (tick >= WARMUP_TICKS) {
+                totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+        }
+
+        for (uint32_t i = 0; i < streams; i++) {
+            frameHandlers[i]->cleanup();
+            delete frameHandlers[i];
+        }
+        // The first instance owns the shared pipeline, it goes last.
+        for (uint32_t i = streams; i-- > 0;) {
+            computes[i]->clean_up();
+            delete computes[i];
+        }
+        return totalMs / TIMED_TICKS;
+    }
+
+    double StreamBenchmark::time_batched(uint32_t streams) {
+        size_t lumaSize = static_cast<size_t>(m_width) * m_height;
+        size_t chromaSize = static_cast<size_t>(m_width >> 1) * (m_height >> 1);
+        std::unique_ptr<uint8_t[]> yPlane = std::make_unique<uint8_t[]>(lumaSize);
+        std::unique_ptr<uint8_t[]> uPlane = std::make_unique<uint8_t[]>(chromaSize);
+        std::unique_ptr<uint8_t[]> vPlane = std::make_unique<uint8_t[]>(chromaSize);
+        memset(yPlane.get(), 128, lumaSize);
+        memset(uPlane.get(), 128, chromaSize);
+        memset(vPlane.get(), 128, chromaSize);
+
+        BatchedYuvRgba batch{m_ctx, m_width, m_height, streams, m_configs};
+        std::vector<FrameHandler *> frameHandlers{};
+        for (uint32_t i = 0; i < streams; i++) {
+            frameHandlers.push_back(new FrameHandler(m_ctx, m_width, m_height));
+        }
+        VkPipelineStageFlags waitFlags = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+        double totalMs = 0.0;
+        for (int tick = 0; tick < WARMUP_TICKS + TIMED_TICKS; tick++) {
+            std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < streams; i++) {
+                batch.stage(i, yPlane.get(), uPlane.get(), vPlane.get());
+            }
+            batch.compute();
+            // The copies out of the layers go into one graphics command buffer, as in the player.
+            vkResetCommandBuffer(m_commandBuffer, 0);
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+            batch.record_acquire(m_commandBuffer);
+            for (uint32_t i = 0; i < streams; i++) {
+                frameHandlers[i]->record_copy(m_commandBuffer, batch.get_rgba_image(), i);
+            }
+            batch.record_release(m_commandBuffer);
+            vkEndCommandBuffer(m_commandBuffer);
+            VkSubmitInfo submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &m_commandBuffer;
+            submitInfo.waitSemaphoreCount = 1;
+            submitInfo.pWaitSemaphores = &batch.get_semaphore();
+            submitInfo.pWaitDstStageMask = &waitFlags;
+            vkResetFences(m_ctx->logicalDevice, 1, &m_fence);
+            queue_submit(m_ctx, m_ctx->graphicsQueue, submitInfo, m_fence);
+            vkWaitForFences(m_ctx->logicalDevice, 1, &m_fence, VK_TRUE, UINT64_MAX);
+            if (tick >= WARMUP_TICKS) {
+                totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+        }
+
+        for (FrameHandler *frameHandler: frameHandlers) {
+            frameHandler->cleanup();
+            delete frameHandler;
+        }
+        batch.clean_up();
+        return totalMs / TIMED_TICKS;
+    }
+}
@@ -3,19 +3,20 @@
 //
 #include <array>
 #include "computes/TemporalHistoryTwoImg.h"
+#include "GpuProfiler.h"
 
 namespace fd {
-    TemporalHistoryTwoImg::TemporalHistoryTwoImg(fd::RenderContext *ctx, const char *shaderPath, uint32_t width,
-                                                 uint32_t height) : m_ctx{ctx}, m_width{width}, m_height{height},
-                                                                    m_shader_path{shaderPath} {
-        m_motion_vector_buffer_size = ((m_width + 7) / 8) * ((m_height + 7) / 8);
+    TemporalHistoryTwoImg::TemporalHistoryTwoImg(fd::RenderContext *ctx, const char *shaderName, uint32_t width,
+                                                 uint32_t height, const KernelConfig &config) :
+            m_ctx{ctx}, m_width{width}, m_height{height}, m_shader_name{shaderName}, m_config{config} {
+        // One motion vector per workgroup, the workgroup shape is the motion block.
+        m_motion_vector_buffer_size = group_count(m_width, m_config.localSizeX) *
+                                      group_count(m_height, m_config.localSizeY);
         setup_images_and_history();
         setup_descriptors();
         create_pipeline();
     }
 
-    uint32_t TemporalHistoryTwoImg::m_frame_count = 0;
-
     void TemporalHistoryTwoImg::setup_images_and_history() {
         VkCommandBuffer commandBuffer = start_command_buffer(m_ctx);
         create_image(m_ctx, m_img_one, m_width, m_height, m_img_one_memory, VK_FORMAT_R8_UNORM,
@@ -69,7 +70,20 @@ namespace fd {
                       m_motion_vectors_buffer_memory,
                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                       sizeof(MotionVector) * m_motion_vector_buffer_size);
-
+        create_buffer(m_ctx, m_block_sad_buffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                      m_block_sad_buffer_memory,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                      sizeof(float) * m_motion_vector_buffer_size);
+
+        // Scene stats are read back by the host once the frame has retired.
+        create_buffer(m_ctx, m_scene_stats_buffer,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                      m_scene_stats_buffer_memory,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      sizeof(SceneStats));
+        vkMapMemory(m_ctx->logicalDevice, m_scene_stats_buffer_memory, 0, sizeof(SceneStats), 0,
+                    reinterpret_cast<void **>(&m_scene_stats));
+        m_stats_fence = get_fence(m_ctx);
     }
 
     void TemporalHistoryTwoImg::setup_descriptors() {
@@ -94,7 +108,22 @@ namespace fd {
         motionVectorBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
         motionVectorBinding.pImmutableSamplers = nullptr;
 
-        std::array<VkDescriptorSetLayoutBinding, 3> bindings{inBinding, outBinding, motionVectorBinding};
+        VkDescriptorSetLayoutBinding sceneStatsBinding{};
+        sceneStatsBinding.binding = 3;
+        sceneStatsBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        sceneStatsBinding.descriptorCount = 1;
+        sceneStatsBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        sceneStatsBinding.pImmutableSamplers = nullptr;
+
+        VkDescriptorSetLayoutBinding blockSadBinding{};
+        blockSadBinding.binding = 4;
+        blockSadBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        blockSadBinding.descriptorCount = 1;
+        blockSadBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        blockSadBinding.pImmutableSamplers = nullptr;
+
+        std::array<VkDescriptorSetLayoutBinding, 5> bindings{inBinding, outBinding, motionVectorBinding,
+                                                             sceneStatsBinding, blockSadBinding};
         VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
         layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
         layoutCreateInfo.bindingCount = bindings.size();
@@ -109,7 +138,7 @@ namespace fd {
         sizeOut.descriptorCount = 1;
         sizeOut.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
         VkDescriptorPoolSize sizeMotionVector{};
-        sizeMotionVector.descriptorCount = 1;
+        sizeMotionVector.descriptorCount = 3;
         sizeMotionVector.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 
         std::array<VkDescriptorPoolSize, 3> sizes{sizeIn, sizeOut, sizeMotionVector};
@@ -178,17 +207,48 @@ namespace fd {
         motionVectorWriteInfo.dstSet = m_des_set;
         motionVectorWriteInfo.pBufferInfo = &motionVectorBufferInfo;
 
-        std::array<VkWriteDescriptorSet, 3> writes{writeIn, writeOut, motionVectorWriteInfo};
+        VkDescriptorBufferInfo sceneStatsBufferInfo{};
+        sceneStatsBufferInfo.offset = 0;
+        sceneStatsBufferInfo.buffer = m_scene_stats_buffer;
+        sceneStatsBufferInfo.range = sizeof(SceneStats);
+        VkWriteDescriptorSet sceneStatsWriteInfo{};
+        sceneStatsWriteInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        sceneStatsWriteInfo.descriptorCount = 1;
+        sceneStatsWriteInfo.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        sceneStatsWriteInfo.dstBinding = 3;
+        sceneStatsWriteInfo.dstArrayElement = 0;
+        sceneStatsWriteInfo.dstSet = m_des_set;
+        sceneStatsWriteInfo.pBufferInfo = &sceneStatsBufferInfo;
+
+        VkDescriptorBufferInfo blockSadBufferInfo{};
+        blockSadBufferInfo.offset = 0;
+        blockSadBufferInfo.buffer = m_block_sad_buffer;
+        blockSadBufferInfo.range = sizeof(float) * m_motion_vector_buffer_size;
+        VkWriteDescriptorSet blockSadWriteInfo{};
+        blockSadWriteInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        blockSadWriteInfo.descriptorCount = 1;
+        blockSadWriteInfo.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        blockSadWriteInfo.dstBinding = 4;
+        blockSadWriteInfo.dstArrayElement = 0;
+        blockSadWriteInfo.dstSet = m_des_set;
+        blockSadWriteInfo.pBufferInfo = &blockSadBufferInfo;
+
+        std::array<VkWriteDescriptorSet, 5> writes{writeIn, writeOut, motionVectorWriteInfo, sceneStatsWriteInfo,
+                                                   blockSadWriteInfo};
         vkUpdateDescriptorSets(m_ctx->logicalDevice, writes.size(), writes.data(), 0, nullptr);
     }
 
     void TemporalHistoryTwoImg::create_pipeline() {
-        VkShaderModule computeModule = create_shader_module(m_ctx->logicalDevice, m_shader_path);
+        ScopedMsTimer timer{m_ctx->pipelineCreationMs};
+        VkShaderModule computeModule = create_shader_module(m_ctx->logicalDevice, m_shader_name);
         VkPipelineShaderStageCreateInfo computeStage{};
         computeStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         computeStage.pName = "main";
         computeStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
         computeStage.module = computeModule;
+        std::array<VkSpecializationMapEntry, 3> specializationEntries{};
+        VkSpecializationInfo specializationInfo = kernel_specialization_info(m_config, specializationEntries);
+        computeStage.pSpecializationInfo = &specializationInfo;
 
         VkPushConstantRange extentRange{};
         extentRange.size = sizeof(TemporalInfo);
@@ -210,12 +270,49 @@ namespace fd {
         computePipelineCreateInfo.basePipelineIndex = 0;
         computePipelineCreateInfo.stage = computeStage;
 
-        VK_CHECK(vkCreateComputePipelines(m_ctx->logicalDevice, nullptr, 1, &computePipelineCreateInfo, nullptr,
-                                          &m_pipeline), "Failed to create the pipeline for temporal history");
+        VK_CHECK(vkCreateComputePipelines(m_ctx->logicalDevice, m_ctx->pipelineCache, 1, &computePipelineCreateInfo,
+                                          nullptr, &m_pipeline), "Failed to create the pipeline for temporal history");
         vkDestroyShaderModule(m_ctx->logicalDevice, computeModule, nullptr);
     }
 
+    void TemporalHistoryTwoImg::collect_scene_stats() {
+        if (m_scene_stats->blockCount == 0) return;
+        float meanSad = static_cast<float>(m_scene_stats->sadSum) / SCENE_SAD_FIXED_SCALE /
+                        static_cast<float>(m_scene_stats->blockCount);
+        uint32_t highBlocks = 0;
+        for (uint32_t i = 4; i < SCENE_SAD_HISTOGRAM_BINS; i++) {
+            highBlocks += m_scene_stats->histogram[i];
+        }
+        float highFraction = static_cast<float>(highBlocks) / static_cast<float>(m_scene_stats->blockCount);
+        if (meanSad > m_cut_mean_sad && highFraction > m_cut_high_fraction) {
+            LOG_INFO("Scene cut at frame {}, mean sad {}, high sad blocks {}", m_frame_count - 1, meanSad,
+                     highFraction);
+            std::lock_guard<std::mutex> lock{m_scene_cut_mutex};
+            m_scene_cuts.push_back({m_frame_count - 1, meanSad, highFraction});
+        }
+    }
+
+    std::vector<SceneCutEvent> TemporalHistoryTwoImg::take_scene_cut_events() {
+        std::lock_guard<std::mutex> lock{m_scene_cut_mutex};
+        std::vector<SceneCutEvent> events{};
+        events.swap(m_scene_cuts);
+        return events;
+    }
+
     void TemporalHistoryTwoImg::compute(VkCommandBuffer commandBuffer, VkImage &r8Image) {
+        if (m_frame_count > 0) {
+            // The stats buffer is single buffered, the last frame's submission has to retire before it is read.
+            TRACE_SCOPE("wait scene stats");
+            vkWaitForFences(m_ctx->logicalDevice, 1, &m_stats_fence, VK_TRUE, UINT64_MAX);
+            collect_scene_stats();
+        }
+        vkResetFences(m_ctx->logicalDevice, 1, &m_stats_fence);
+        uint32_t profileScope = gpu_profile_begin(m_ctx, commandBuffer, GpuStage::TEMPORAL, m_ctx->computeQueueIndex);
+        vkCmdFillBuffer(commandBuffer, m_scene_stats_buffer, 0, sizeof(SceneStats), 0);
+        record_buffer_barrier(commandBuffer, m_scene_stats_buffer, VK_ACCESS_TRANSFER_WRITE_BIT,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
         record_transition_image(commandBuffer, r8Image, VK_IMAGE_ASPECT_COLOR_BIT,
                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
                                 VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
@@ -254,10 +351,30 @@ namespace fd {
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
         vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1, &m_des_set, 0,
                                 nullptr);
-        TemporalInfo info{m_width, m_height, m_frame_count};
+        TemporalInfo info{m_width, m_height, m_frame_count, 0, m_cut_mean_sad, m_cut_high_fraction};
+        vkCmdPushConstants(commandBuffer, m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(TemporalInfo),
+                           &info);
+        vkCmdDispatch(commandBuffer, group_count(m_width, m_config.localSizeX),
+                      group_count(m_height, m_config.localSizeY), 1);
+
+        // The blend pass needs every block's SAD reduced before it can tell a scene cut.
+        record_buffer_barrier(commandBuffer, m_scene_stats_buffer, VK_ACCESS_SHADER_WRITE_BIT,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        record_buffer_barrier(commandBuffer, m_block_sad_buffer, VK_ACCESS_SHADER_WRITE_BIT,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        record_buffer_barrier(commandBuffer, m_motion_vectors_buffer, VK_ACCESS_SHADER_WRITE_BIT,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        info.pass = 1;
         vkCmdPushConstants(commandBuffer, m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(TemporalInfo),
                            &info);
-        vkCmdDispatch(commandBuffer, (m_width + 7) / 8, (m_height + 7) / 8, 1);
+        vkCmdDispatch(commandBuffer, group_count(m_width, m_config.localSizeX),
+                      group_count(m_height, m_config.localSizeY), 1);
+        record_buffer_barrier(commandBuffer, m_scene_stats_buffer, VK_ACCESS_SHADER_WRITE_BIT,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_HOST_READ_BIT,
+                              VK_PIPELINE_STAGE_HOST_BIT);
         record_transition_image(commandBuffer, r8Image, VK_IMAGE_ASPECT_COLOR_BIT,
                                 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                                 VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
@@ -280,6 +397,7 @@ namespace fd {
                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                                 VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
                                 VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        gpu_profile_end(m_ctx, commandBuffer, profileScope);
         m_frame_count++;
 
     }
@@ -288,6 +406,12 @@ namespace fd {
 
         vkDestroyBuffer(m_ctx->logicalDevice, m_motion_vectors_buffer, nullptr);
         vkFreeMemory(m_ctx->logicalDevice, m_motion_vectors_buffer_memory, nullptr);
+        vkDestroyBuffer(m_ctx->logicalDevice, m_block_sad_buffer, nullptr);
+        vkFreeMemory(m_ctx->logicalDevice, m_block_sad_buffer_memory, nullptr);
+        vkUnmapMemory(m_ctx->logicalDevice, m_scene_stats_buffer_memory);
+        vkDestroyBuffer(m_ctx->logicalDevice, m_scene_stats_buffer, nullptr);
+        vkFreeMemory(m_ctx->logicalDevice, m_scene_stats_buffer_memory, nullptr);
+        vkDestroyFence(m_ctx->logicalDevice, m_stats_fence, nullptr);
         vkDestroyImageView(m_ctx->logicalDevice, m_img_one_view, nullptr);
         vkDestroyImageView(m_ctx->logicalDevice, m_img_two_view, nullptr);
         vkDestroyImageView(m_ctx->logicalDevice, m_img_three_view, nullptr);
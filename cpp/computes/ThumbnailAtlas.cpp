@@ -0,0 +1,289 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include "computes/ThumbnailAtlas.h"
+
+namespace fd {
+    ThumbnailAtlas::ThumbnailAtlas(RenderContext *ctx, uint32_t tileWidth, uint32_t tileHeight, uint32_t columns,
+                                   uint32_t rows, const KernelConfigs &configs) : m_ctx{ctx}, m_tile_width{tileWidth},
+                                                                                  m_tile_height{tileHeight},
+                                                                                  m_columns{columns}, m_rows{rows},
+                                                                                  m_configs{configs} {
+        VkCommandPoolCreateInfo commandPoolCreateInfo{};
+        commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        commandPoolCreateInfo.queueFamilyIndex = m_ctx->computeQueueIndex;
+        commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        VK_CHECK(vkCreateCommandPool(m_ctx->logicalDevice, &commandPoolCreateInfo, nullptr, &m_command_pool),
+                 "Failed to create the thumbnail command pool");
+        prepare_images_and_batches();
+        setup_descriptors();
+        create_pipeline();
+        LOG_INFO("Thumbnail atlas of {}x{} tiles of {}x{}", m_columns, m_rows, m_tile_width, m_tile_height);
+    }
+
+    bool ThumbnailAtlas::is_available() {
+        return find_embedded_shader(SHADER_THUMBNAIL_DOWNSCALE) != nullptr;
+    }
+
+    void ThumbnailAtlas::prepare_images_and_batches() {
+        create_image(m_ctx, m_atlas_image, get_width(), get_height(), m_atlas_image_memory, VK_FORMAT_R8G8B8A8_UNORM,
+                     VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        create_image_view(m_ctx->logicalDevice, m_atlas_image, m_atlas_image_view, VK_FORMAT_R8G8B8A8_UNORM);
+        // The atlas stays in GENERAL, the kernel writes it and record_clear and readbacks move it in between.
+        VkCommandBuffer commandBuffer = start_command_buffer(m_ctx);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo), "Failed to begin the command buffer");
+        record_transition_image(commandBuffer, m_atlas_image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                                VK_IMAGE_LAYOUT_GENERAL, 0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        submit_queue(m_ctx, commandBuffer);
+        vkFreeCommandBuffers(m_ctx->logicalDevice, m_ctx->commandPool, 1, &commandBuffer);
+
+        for (Batch &batch: m_batches) {
+            create_buffer(m_ctx, batch.planes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, batch.memory,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, PLANE_BYTES);
+            void *data = nullptr;
+            vkMapMemory(m_ctx->logicalDevice, batch.memory, 0, PLANE_BYTES, 0, &data);
+            batch.mapped = static_cast<uint8_t *>(data);
+            batch.commandBuffer = start_command_buffer(m_ctx, m_command_pool);
+            batch.fence = get_fence(m_ctx);
+        }
+    }
+
+    void ThumbnailAtlas::setup_descriptors() {
+        VkDescriptorSetLayoutBinding planesBinding{};
+        planesBinding.binding = 0;
+        planesBinding.descriptorCount = 1;
+        planesBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        planesBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutBinding atlasBinding{};
+        atlasBinding.binding = 1;
+        atlasBinding.descriptorCount = 1;
+        atlasBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        atlasBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        std::array<VkDescriptorSetLayoutBinding, 2> bindings{planesBinding, atlasBinding};
+        VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
+        layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutCreateInfo.bindingCount = bindings.size();
+        layoutCreateInfo.pBindings = bindings.data();
+        VK_CHECK(vkCreateDescriptorSetLayout(m_ctx->logicalDevice, &layoutCreateInfo, nullptr, &m_des_layout),
+                 "failed to create the descriptor set layout for thumbnails");
+
+        VkDescriptorPoolSize planesSize{};
+        planesSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        planesSize.descriptorCount = BATCHES;
+        VkDescriptorPoolSize atlasSize{};
+        atlasSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        atlasSize.descriptorCount = BATCHES;
+        std::array<VkDescriptorPoolSize, 2> sizes{planesSize, atlasSize};
+        VkDescriptorPoolCreateInfo poolCreateInfo{};
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolCreateInfo.poolSizeCount = sizes.size();
+        poolCreateInfo.pPoolSizes = sizes.data();
+        poolCreateInfo.maxSets = BATCHES;
+        VK_CHECK(vkCreateDescriptorPool(m_ctx->logicalDevice, &poolCreateInfo, nullptr, &m_des_pool),
+                 "Failed to create the thumbnail descriptor pool");
+
+        for (Batch &batch: m_batches) {
+            VkDescriptorSetAllocateInfo allocateInfo{};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocateInfo.pSetLayouts = &m_des_layout;
+            allocateInfo.descriptorPool = m_des_pool;
+            allocateInfo.descriptorSetCount = 1;
+            vkAllocateDescriptorSets(m_ctx->logicalDevice, &allocateInfo, &batch.desSet);
+
+            VkDescriptorBufferInfo planesInfo{};
+            planesInfo.buffer = batch.planes;
+            planesInfo.offset = 0;
+            planesInfo.range = VK_WHOLE_SIZE;
+            VkWriteDescriptorSet planesWrite{};
+            planesWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            planesWrite.descriptorCount = 1;
+            planesWrite.dstBinding = 0;
+            planesWrite.dstSet = batch.desSet;
+            planesWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            planesWrite.pBufferInfo = &planesInfo;
+
+            VkDescriptorImageInfo atlasInfo{};
+            atlasInfo.imageView = m_atlas_image_view;
+            atlasInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            VkWriteDescriptorSet atlasWrite{};
+            atlasWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            atlasWrite.descriptorCount = 1;
+            atlasWrite.dstBinding = 1;
+            atlasWrite.dstSet = batch.desSet;
+            atlasWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            atlasWrite.pImageInfo = &atlasInfo;
+
+            std::array<VkWriteDescriptorSet, 2> writeInfo{planesWrite, atlasWrite};
+            vkUpdateDescriptorSets(m_ctx->logicalDevice, writeInfo.size(), writeInfo.data(), 0, nullptr);
+        }
+    }
+
+    void ThumbnailAtlas::create_pipeline() {
+        ScopedMsTimer timer{m_ctx->pipelineCreationMs};
+        VkShaderModule computeModule = create_shader_module(m_ctx->logicalDevice, SHADER_THUMBNAIL_DOWNSCALE);
+        VkPipelineShaderStageCreateInfo computeStage{};
+        computeStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        computeStage.pName = "main";
+        computeStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        computeStage.module = computeModule;
+        std::array<VkSpecializationMapEntry, 3> specializationEntries{};
+        VkSpecializationInfo specializationInfo = kernel_specialization_info(m_configs.yuvRgba,
+                                                                             specializationEntries);
+        computeStage.pSpecializationInfo = &specializationInfo;
+
+        VkPushConstantRange tileRange{};
+        tileRange.size = sizeof(TileInfo);
+        tileRange.offset = 0;
+        tileRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkPipelineLayoutCreateInfo layoutCreateInfo{};
+        layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutCreateInfo.setLayoutCount = 1;
+        layoutCreateInfo.pSetLayouts = &m_des_layout;
+        layoutCreateInfo.pushConstantRangeCount = 1;
+        layoutCreateInfo.pPushConstantRanges = &tileRange;
+        VK_CHECK(vkCreatePipelineLayout(m_ctx->logicalDevice, &layoutCreateInfo, nullptr, &m_pipeline_layout),
+                 "failed to create the pipeline layout for thumbnails");
+
+        VkComputePipelineCreateInfo computePipelineCreateInfo{};
+        computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        computePipelineCreateInfo.layout = m_pipeline_layout;
+        computePipelineCreateInfo.stage = computeStage;
+        VK_CHECK(vkCreateComputePipelines(m_ctx->logicalDevice, m_ctx->pipelineCache, 1, &computePipelineCreateInfo,
+                                          nullptr, &m_pipeline), "Failed to create the thumbnail pipeline");
+        vkDestroyShaderModule(m_ctx->logicalDevice, computeModule, nullptr);
+    }
+
+    VkCommandBuffer ThumbnailAtlas::begin_batch() {
+        Batch &batch = m_batches[m_batch];
+        {
+            TRACE_SCOPE("wait thumbnail batch");
+            vkWaitForFences(m_ctx->logicalDevice, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+        }
+        batch.used = 0;
+        batch.tiles = 0;
+        vkResetCommandBuffer(batch.commandBuffer, 0);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK(vkBeginCommandBuffer(batch.commandBuffer, &beginInfo), "Failed to begin the thumbnail command buffer");
+        vkCmdBindPipeline(batch.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+        vkCmdBindDescriptorSets(batch.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1,
+                                &batch.desSet, 0, nullptr);
+        return batch.commandBuffer;
+    }
+
+    void ThumbnailAtlas::record_clear() {
+        VkCommandBuffer commandBuffer = m_batches[m_batch].commandBuffer;
+        // The previous sheet's tiles and its readback come first.
+        record_transition_image(commandBuffer, m_atlas_image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL,
+                                VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkClearColorValue clearColor{};
+        clearColor.float32[3] = 1.0f;
+        VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdClearColorImage(commandBuffer, m_atlas_image, VK_IMAGE_LAYOUT_GENERAL, &clearColor, 1, &range);
+        record_transition_image(commandBuffer, m_atlas_image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL,
+                                VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    bool ThumbnailAtlas::add_tile(uint32_t tile, uint32_t width, uint32_t height, const uint8_t *const planes[3],
+                                  const int strides[3], bool fullRange, double pixelAspect) {
+        Batch &batch = m_batches[m_batch];
+        uint32_t chromaW = (width + 1) / 2;
+        uint32_t chromaH = (height + 1) / 2;
+        // Offsets stay word aligned, the kernel reads whole words.
+        auto align = [](VkDeviceSize size) -> VkDeviceSize { return (size + 3) & ~VkDeviceSize{3}; };
+        VkDeviceSize lumaSize = align(static_cast<VkDeviceSize>(width) * height);
+        VkDeviceSize chromaSize = align(static_cast<VkDeviceSize>(chromaW) * chromaH);
+        if (batch.used + lumaSize + 2 * chromaSize > PLANE_BYTES) return false;
+
+        TileInfo info{};
+        info.yOffset = static_cast<uint32_t>(batch.used);
+        info.uOffset = static_cast<uint32_t>(batch.used + lumaSize);
+        info.vOffset = static_cast<uint32_t>(batch.used + lumaSize + chromaSize);
+        const uint32_t offsets[3] = {info.yOffset, info.uOffset, info.vOffset};
+        for (int plane = 0; plane < 3; plane++) {
+            uint32_t planeW = plane == 0 ? width : chromaW;
+            uint32_t planeH = plane == 0 ? height : chromaH;
+            uint8_t *dst = batch.mapped + offsets[plane];
+            for (uint32_t y = 0; y < planeH; y++) {
+                memcpy(dst + static_cast<size_t>(y) * planeW, planes[plane] + static_cast<ptrdiff_t>(y) * strides[plane],
+                       planeW);
+            }
+        }
+        batch.used += lumaSize + 2 * chromaSize;
+
+        // Letterboxed at the display aspect.
+        double displayW = static_cast<double>(width) * (pixelAspect > 0.0 ? pixelAspect : 1.0);
+        double scale = (std::min)(m_tile_width / displayW, m_tile_height / static_cast<double>(height));
+        auto pictureW = static_cast<int32_t>((std::max)(1.0, std::round(displayW * scale)));
+        auto pictureH = static_cast<int32_t>((std::max)(1.0, std::round(height * scale)));
+        info.srcSize[0] = static_cast<int32_t>(width);
+        info.srcSize[1] = static_cast<int32_t>(height);
+        info.tileOrigin[0] = static_cast<int32_t>((tile % m_columns) * m_tile_width);
+        info.tileOrigin[1] = static_cast<int32_t>((tile / m_columns) * m_tile_height);
+        info.tileSize[0] = static_cast<int32_t>(m_tile_width);
+        info.tileSize[1] = static_cast<int32_t>(m_tile_height);
+        info.pictureOrigin[0] = (static_cast<int32_t>(m_tile_width) - pictureW) / 2;
+        info.pictureOrigin[1] = (static_cast<int32_t>(m_tile_height) - pictureH) / 2;
+        info.pictureSize[0] = pictureW;
+        info.pictureSize[1] = pictureH;
+        info.fullRange = fullRange ? 1 : 0;
+        vkCmdPushConstants(batch.commandBuffer, m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(TileInfo),
+                           &info);
+        vkCmdDispatch(batch.commandBuffer, group_count(m_tile_width, m_configs.yuvRgba.localSizeX),
+                      group_count(m_tile_height, m_configs.yuvRgba.localSizeY), 1);
+        batch.tiles++;
+        return true;
+    }
+
+    VkFence ThumbnailAtlas::submit_batch() {
+        Batch &batch = m_batches[m_batch];
+        vkEndCommandBuffer(batch.commandBuffer);
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &batch.commandBuffer;
+        vkResetFences(m_ctx->logicalDevice, 1, &batch.fence);
+        queue_submit(m_ctx, m_ctx->computeQueue, submitInfo, batch.fence);
+        m_batch = (m_batch + 1) % BATCHES;
+        return batch.fence;
+    }
+
+    void ThumbnailAtlas::wait_idle() {
+        for (Batch &batch: m_batches) {
+            vkWaitForFences(m_ctx->logicalDevice, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+        }
+    }
+
+    void ThumbnailAtlas::clean_up() {
+        wait_idle();
+        for (Batch &batch: m_batches) {
+            vkUnmapMemory(m_ctx->logicalDevice, batch.memory);
+            vkDestroyBuffer(m_ctx->logicalDevice, batch.planes, nullptr);
+            vkFreeMemory(m_ctx->logicalDevice, batch.memory, nullptr);
+            vkDestroyFence(m_ctx->logicalDevice, batch.fence, nullptr);
+        }
+        vkDestroyImageView(m_ctx->logicalDevice, m_atlas_image_view, nullptr);
+        vkDestroyImage(m_ctx->logicalDevice, m_atlas_image, nullptr);
+        vkFreeMemory(m_ctx->logicalDevice, m_atlas_image_memory, nullptr);
+        vkDestroyPipeline(m_ctx->logicalDevice, m_pipeline, nullptr);
+        vkDestroyPipelineLayout(m_ctx->logicalDevice, m_pipeline_layout, nullptr);
+        vkDestroyDescriptorPool(m_ctx->logicalDevice, m_des_pool, nullptr);
+        vkDestroyDescriptorSetLayout(m_ctx->logicalDevice, m_des_layout, nullptr);
+        vkDestroyCommandPool(m_ctx->logicalDevice, m_command_pool, nullptr);
+    }
+}
@@ -3,12 +3,14 @@
 //
 #include <array>
 #include "computes/VulkanFilterR8Image.h"
+#include "GpuProfiler.h"
 
 namespace fd {
 
-    VulkanFilterR8::VulkanFilterR8(fd::RenderContext *ctx, const char *computeFilter, uint32_t width, uint32_t height)
+    VulkanFilterR8::VulkanFilterR8(fd::RenderContext *ctx, const char *computeFilter, uint32_t width, uint32_t height,
+                                   const KernelConfig &config)
             : m_ctx{ctx}, m_width{width},
-              m_height{height}, m_compute_path{computeFilter} {
+              m_height{height}, m_compute_shader{computeFilter}, m_config{config} {
         m_commandBuffer = start_command_buffer(m_ctx);
         VkSemaphoreCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -118,12 +120,16 @@ namespace fd {
     }
 
     void VulkanFilterR8::create_pipeline() {
-        VkShaderModule computeModule = create_shader_module(m_ctx->logicalDevice, m_compute_path);
+        ScopedMsTimer timer{m_ctx->pipelineCreationMs};
+        VkShaderModule computeModule = create_shader_module(m_ctx->logicalDevice, m_compute_shader);
         VkPipelineShaderStageCreateInfo computeStage{};
         computeStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         computeStage.pName = "main";
         computeStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
         computeStage.module = computeModule;
+        std::array<VkSpecializationMapEntry, 3> specializationEntries{};
+        VkSpecializationInfo specializationInfo = kernel_specialization_info(m_config, specializationEntries);
+        computeStage.pSpecializationInfo = &specializationInfo;
 
         VkPushConstantRange extentRange{};
         extentRange.size = sizeof(ImageExtent);
@@ -145,12 +151,13 @@ namespace fd {
         computePipelineCreateInfo.basePipelineIndex = 0;
         computePipelineCreateInfo.stage = computeStage;
 
-        VK_CHECK(vkCreateComputePipelines(m_ctx->logicalDevice, nullptr, 1, &computePipelineCreateInfo, nullptr,
-                                          &m_pipeline), "Failed to create the pipeline");
+        VK_CHECK(vkCreateComputePipelines(m_ctx->logicalDevice, m_ctx->pipelineCache, 1, &computePipelineCreateInfo,
+                                          nullptr, &m_pipeline), "Failed to create the pipeline");
         vkDestroyShaderModule(m_ctx->logicalDevice, computeModule, nullptr);
     }
 
     void VulkanFilterR8::compute(VkCommandBuffer commandBuffer, VkImage &r8Image) {
+        uint32_t profileScope = gpu_profile_begin(m_ctx, commandBuffer, GpuStage::BLUR, m_ctx->computeQueueIndex);
         if (!isFirstRender) {
             record_transition_image(commandBuffer, m_image_in, VK_IMAGE_ASPECT_COLOR_BIT,
                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
@@ -163,10 +170,11 @@ namespace fd {
         }
 
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+        // The plane was just written, by the upload copy or by the scaler.
         record_transition_image(commandBuffer, r8Image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                                 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                                0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
-                                VK_PIPELINE_STAGE_TRANSFER_BIT);
+                                VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
         record_image_to_image(commandBuffer, r8Image, m_image_in, m_width, m_height);
         record_transition_image(commandBuffer, m_image_in, VK_IMAGE_ASPECT_COLOR_BIT,
                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
@@ -183,13 +191,15 @@ namespace fd {
         vkCmdPushConstants(commandBuffer, m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ImageExtent),
                            &extent);
 
-        vkCmdDispatch(commandBuffer, (m_width + 7) / 8, (m_height + 7) / 8, 1);
+        vkCmdDispatch(commandBuffer, group_count(m_width, m_config.localSizeX),
+                      group_count(m_height, m_config.localSizeY), 1);
         record_transition_image(commandBuffer, m_image_out, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL,
                                 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
                                 VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
                                 VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
 
         record_image_to_image(commandBuffer, m_image_out, r8Image, m_width, m_height);
+        gpu_profile_end(m_ctx, commandBuffer, profileScope);
 
         if (isFirstRender) isFirstRender = false;
     }
@@ -2,30 +2,59 @@
 // Created by ghima on 15-01-2026.
 //
 #include <array>
+#include <vector>
 #include "computes/VulkanYuvToRgba.h"
+#include "GpuProfiler.h"
+#include "Trace.h"
+
+extern "C" {
+#include "libavutil/hwcontext.h"
+#include "libavutil/hwcontext_vulkan.h"
+};
 
 namespace fd {
-    ComputeYuvRgba::ComputeYuvRgba(RenderContext *ctx, const char *shaderPath, uint32_t width, uint32_t height) : m_ctx{
-            ctx}, m_shader_path{shaderPath}, m_width{width},
-                                                                                                                  m_height{
-                                                                                                                          height} {
+    ComputeYuvRgba::ComputeYuvRgba(RenderContext *ctx, const char *shaderName, uint32_t width, uint32_t height,
+                                   const KernelConfigs &configs, const ComputeYuvRgba *pipelineSource,
+                                   uint32_t outWidth, uint32_t outHeight)
+            : m_ctx{ctx}, m_shader_name{shaderName}, m_width{width}, m_height{height},
+              m_out_width{outWidth > 0 ? outWidth : width}, m_out_height{outHeight > 0 ? outHeight : height},
+              m_configs{configs} {
+        if (pipelineSource != nullptr) {
+            m_owns_pipeline = false;
+            m_configs.yuvRgba = pipelineSource->m_configs.yuvRgba;
+            m_des_layout = pipelineSource->m_des_layout;
+            m_pipeline_layout = pipelineSource->m_pipeline_layout;
+            m_pipeline = pipelineSource->m_pipeline;
+        }
         m_commandBuffer = start_command_buffer(m_ctx);
         VkSemaphoreCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
         vkCreateSemaphore(m_ctx->logicalDevice, &createInfo, nullptr, &m_compute_semaphore);
         vkCreateSemaphore(m_ctx->logicalDevice, &createInfo, nullptr, &m_filter_semaphore);
+        vkCreateSemaphore(m_ctx->logicalDevice, &createInfo, nullptr, &m_upload_semaphore);
         set_up_compute_command_buffer();
+        choose_scale();
         prepare_buffers_and_images();
         create_samplers();
+        if (m_out_width != m_width || m_out_height != m_height) {
+            m_scaler = new SeparableScaler(m_ctx, m_y_image_view, m_width, m_height, m_out_width, m_out_height,
+                                           m_scale_filter, m_configs.yuvRgba);
+        }
+        if (m_owns_pipeline) {
+            create_descriptor_layout();
+        }
         setup_descriptors();
-        create_pipeline();
-
-        m_blur = new VulkanFilterR8(m_ctx,
-                                    R"(D:\cProjects\realTimeFrameDisplay\shaders\gaussianBlurCompute.comp.spv)",
-                                    m_width, m_height);
-        m_temp = new TemporalHistoryTwoImg(m_ctx,
-                                           R"(D:\cProjects\realTimeFrameDisplay\shaders\temporalDiffTwoImg.comp.spv)",
-                                           m_width, m_height);
+        if (m_owns_pipeline) {
+            create_pipeline();
+        }
+
+        // The filters run at the size the scale stage leaves the luma at.
+        bool filtersScaled = m_scaler != nullptr && m_scale_stage == ScaleStage::EARLY;
+        uint32_t filterWidth = filtersScaled ? m_out_width : m_width;
+        uint32_t filterHeight = filtersScaled ? m_out_height : m_height;
+        m_blur = new VulkanFilterR8(m_ctx, SHADER_GAUSSIAN_BLUR, filterWidth, filterHeight, m_configs.blur);
+        m_temp = new TemporalHistoryTwoImg(m_ctx, SHADER_TEMPORAL_DIFF, filterWidth, filterHeight,
+                                           m_configs.temporal);
         vkMapMemory(m_ctx->logicalDevice, m_y_plane_buffer_memory, 0, m_width * m_height, 0, &yData);
         vkMapMemory(m_ctx->logicalDevice, m_u_plane_buffer_memory, 0, (m_width >> 1) * (m_height >> 1), 0, &uData);
         vkMapMemory(m_ctx->logicalDevice, m_v_plane_buffer_memory, 0, (m_width >> 1) * (m_height >> 1), 0, &vData);
@@ -57,7 +86,7 @@ namespace fd {
                      VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
         create_image_view(m_ctx->logicalDevice, m_v_image, m_v_image_view, VK_FORMAT_R8_UNORM);
 
-        create_image(m_ctx, m_rgba_image, m_width, m_height, m_rgba_image_memory, VK_FORMAT_R8G8B8A8_UNORM,
+        create_image(m_ctx, m_rgba_image, m_out_width, m_out_height, m_rgba_image_memory, VK_FORMAT_R8G8B8A8_UNORM,
                      VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
         create_image_view(m_ctx->logicalDevice, m_rgba_image, m_rgba_image_view, VK_FORMAT_R8G8B8A8_UNORM);
@@ -80,7 +109,7 @@ namespace fd {
                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
     }
 
-    void ComputeYuvRgba::setup_descriptors() {
+    void ComputeYuvRgba::create_descriptor_layout() {
         VkDescriptorSetLayoutBinding yuvBinding{};
         yuvBinding.binding = 0;
         yuvBinding.descriptorCount = 3;
@@ -102,20 +131,26 @@ namespace fd {
         createInfo.pBindings = bindings.data();
         VK_CHECK(vkCreateDescriptorSetLayout(m_ctx->logicalDevice, &createInfo, nullptr, &m_des_layout),
                  "failed to create the descriptor set for compute rgba");
+    }
 
-        // Creating a descriptor Pool.
+    void ComputeYuvRgba::setup_descriptors() {
+        // Creating a descriptor Pool, with room for the sets hardware decoded frames and dirty tiles are converted
+        // through.
         VkDescriptorPoolSize inputSize{};
         inputSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        inputSize.descriptorCount = 3;
+        inputSize.descriptorCount = 9;
         VkDescriptorPoolSize outputSize{};
         outputSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-        outputSize.descriptorCount = 1;
-        std::array<VkDescriptorPoolSize, 2> sizes{inputSize, outputSize};
+        outputSize.descriptorCount = 3;
+        VkDescriptorPoolSize tileSize{};
+        tileSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        tileSize.descriptorCount = 1;
+        std::array<VkDescriptorPoolSize, 3> sizes{inputSize, outputSize, tileSize};
         VkDescriptorPoolCreateInfo desPoolCreateInfo{};
         desPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         desPoolCreateInfo.poolSizeCount = sizes.size();
         desPoolCreateInfo.pPoolSizes = sizes.data();
-        desPoolCreateInfo.maxSets = 1;
+        desPoolCreateInfo.maxSets = 3;
 
 
         VK_CHECK(vkCreateDescriptorPool(m_ctx->logicalDevice, &desPoolCreateInfo, nullptr, &m_des_pool),
@@ -129,18 +164,22 @@ namespace fd {
         allocateInfo.descriptorSetCount = 1;
 
         vkAllocateDescriptorSets(m_ctx->logicalDevice, &allocateInfo, &m_des_set);
+        write_descriptor_set(m_des_set, m_u_image_view, m_v_image_view);
+    }
 
+    void ComputeYuvRgba::write_descriptor_set(VkDescriptorSet desSet, VkImageView uImageView,
+                                              VkImageView vImageView) {
         VkDescriptorImageInfo yImageInfo{};
         yImageInfo.sampler = m_sampler_y;
-        yImageInfo.imageView = m_y_image_view;
+        yImageInfo.imageView = m_scaler != nullptr ? m_scaler->get_output_image_view() : m_y_image_view;
         yImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         VkDescriptorImageInfo uImageInfo{};
         uImageInfo.sampler = m_sampler_u;
-        uImageInfo.imageView = m_u_image_view;
+        uImageInfo.imageView = uImageView;
         uImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         VkDescriptorImageInfo vImageInfo{};
         vImageInfo.sampler = m_sampler_v;
-        vImageInfo.imageView = m_v_image_view;
+        vImageInfo.imageView = vImageView;
         vImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
         std::array<VkDescriptorImageInfo, 3> imageInfos{yImageInfo, uImageInfo, vImageInfo};
@@ -149,7 +188,7 @@ namespace fd {
         yuvWrite.descriptorCount = imageInfos.size();
         yuvWrite.dstBinding = 0;
         yuvWrite.dstArrayElement = 0;
-        yuvWrite.dstSet = m_des_set;
+        yuvWrite.dstSet = desSet;
         yuvWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         yuvWrite.pImageInfo = imageInfos.data();
 
@@ -166,19 +205,42 @@ namespace fd {
         rgbaWrite.descriptorCount = 1;
         rgbaWrite.dstArrayElement = 0;
         rgbaWrite.dstBinding = 1;
-        rgbaWrite.dstSet = m_des_set;
+        rgbaWrite.dstSet = desSet;
 
         std::array<VkWriteDescriptorSet, 2> writeInfo{yuvWrite, rgbaWrite};
         vkUpdateDescriptorSets(m_ctx->logicalDevice, writeInfo.size(), writeInfo.data(), 0, nullptr);
     }
 
+    void ComputeYuvRgba::prepare_hw_images() {
+        create_image(m_ctx, m_uv_image, m_width >> 1, m_height >> 1, m_uv_image_memory, VK_FORMAT_R8G8_UNORM,
+                     VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        create_image_view(m_ctx->logicalDevice, m_uv_image, m_uv_image_view_u, VK_FORMAT_R8G8_UNORM);
+        create_image_view(m_ctx->logicalDevice, m_uv_image, m_uv_image_view_v, VK_FORMAT_R8G8_UNORM,
+                          VK_IMAGE_VIEW_TYPE_2D, 1,
+                          {VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_G,
+                           VK_COMPONENT_SWIZZLE_G});
+
+        VkDescriptorSetAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateInfo.pSetLayouts = &m_des_layout;
+        allocateInfo.descriptorPool = m_des_pool;
+        allocateInfo.descriptorSetCount = 1;
+        vkAllocateDescriptorSets(m_ctx->logicalDevice, &allocateInfo, &m_des_set_hw);
+        write_descriptor_set(m_des_set_hw, m_uv_image_view_u, m_uv_image_view_v);
+    }
+
     void ComputeYuvRgba::create_pipeline() {
-        VkShaderModule computeModule = create_shader_module(m_ctx->logicalDevice, m_shader_path);
+        ScopedMsTimer timer{m_ctx->pipelineCreationMs};
+        VkShaderModule computeModule = create_shader_module(m_ctx->logicalDevice, m_shader_name);
         VkPipelineShaderStageCreateInfo computeStage{};
         computeStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         computeStage.pName = "main";
         computeStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
         computeStage.module = computeModule;
+        std::array<VkSpecializationMapEntry, 3> specializationEntries{};
+        VkSpecializationInfo specializationInfo = kernel_specialization_info(m_configs.yuvRgba,
+                                                                             specializationEntries);
+        computeStage.pSpecializationInfo = &specializationInfo;
 
         VkPipelineLayoutCreateInfo layoutCreateInfo{};
         layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -193,8 +255,8 @@ namespace fd {
         computePipelineCreateInfo.basePipelineIndex = 0;
         computePipelineCreateInfo.stage = computeStage;
 
-        VK_CHECK(vkCreateComputePipelines(m_ctx->logicalDevice, nullptr, 1, &computePipelineCreateInfo, nullptr,
-                                          &m_pipeline), "Failed to create the pipeline");
+        VK_CHECK(vkCreateComputePipelines(m_ctx->logicalDevice, m_ctx->pipelineCache, 1, &computePipelineCreateInfo,
+                                          nullptr, &m_pipeline), "Failed to create the pipeline");
         vkDestroyShaderModule(m_ctx->logicalDevice, computeModule, nullptr);
     }
 
@@ -206,54 +268,407 @@ namespace fd {
     }
 
     void ComputeYuvRgba::compute(uint8_t *yPlane, uint8_t *uPlane, uint8_t *vPlane) {
-        vkResetCommandBuffer(m_compute_command_buffer, 0);
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        VK_CHECK(vkBeginCommandBuffer(m_compute_command_buffer, &beginInfo), "Failed to begin the command buffer");
-
-        if (!firstRender) {
-            record_transition_image(m_compute_command_buffer, m_y_image, VK_IMAGE_ASPECT_COLOR_BIT,
-                                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                    0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
-                                    VK_PIPELINE_STAGE_TRANSFER_BIT);
-            record_transition_image(m_compute_command_buffer, m_u_image, VK_IMAGE_ASPECT_COLOR_BIT,
-                                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                    0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
-                                    VK_PIPELINE_STAGE_TRANSFER_BIT);
-            record_transition_image(m_compute_command_buffer, m_v_image, VK_IMAGE_ASPECT_COLOR_BIT,
-                                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                    0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
-                                    VK_PIPELINE_STAGE_TRANSFER_BIT);
-            record_transition_image(m_compute_command_buffer, m_rgba_image, VK_IMAGE_ASPECT_COLOR_BIT,
-                                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
-                                    0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_ACCESS_SHADER_WRITE_BIT,
-                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_ctx->graphicsQueueIndex,
-                                    m_ctx->computeQueueIndex);
+        if (m_tiles != nullptr) {
+            compute_tiles(yPlane, uPlane, vPlane);
+            return;
         }
         memcpy(yData, yPlane, m_width * m_height);
         memcpy(uData, uPlane, (m_width >> 1) * (m_height >> 1));
         memcpy(vData, vPlane, (m_width >> 1) * (m_height >> 1));
 
-        record_buffer_to_image(m_compute_command_buffer, m_y_plane_buffer, m_y_image, m_width, m_height,
+        // The planes are uploaded on the transfer queue and handed to the compute queue for the filters.
+        vkResetCommandBuffer(m_upload_command_buffer, 0);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        VK_CHECK(vkBeginCommandBuffer(m_upload_command_buffer, &beginInfo), "Failed to begin the command buffer");
+        uint32_t uploadScope = gpu_profile_begin(m_ctx, m_upload_command_buffer, GpuStage::UPLOAD,
+                                                 m_ctx->transferQueueIndex);
+        // Every plane is overwritten whole, their previous contents and owner are discarded.
+        for (VkImage image: {m_y_image, m_u_image, m_v_image}) {
+            record_transition_image(m_upload_command_buffer, image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                    0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                    VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
+        record_buffer_to_image(m_upload_command_buffer, m_y_plane_buffer, m_y_image, m_width, m_height,
                                VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        record_buffer_to_image(m_compute_command_buffer, m_u_plane_buffer, m_u_image, (m_width >> 1), (m_height >> 1),
+        record_buffer_to_image(m_upload_command_buffer, m_u_plane_buffer, m_u_image, (m_width >> 1), (m_height >> 1),
                                VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        record_buffer_to_image(m_compute_command_buffer, m_v_plane_buffer, m_v_image, (m_width >> 1), (m_height >> 1),
+        record_buffer_to_image(m_upload_command_buffer, m_v_plane_buffer, m_v_image, (m_width >> 1), (m_height >> 1),
                                VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        gpu_profile_end(m_ctx, m_upload_command_buffer, uploadScope);
+        // Y stays a transfer destination for the filters, U and V go straight to the converter.
+        record_release_image(m_upload_command_buffer, m_y_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             m_ctx->transferQueueIndex, m_ctx->computeQueueIndex);
+        for (VkImage image: {m_u_image, m_v_image}) {
+            record_release_image(m_upload_command_buffer, image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 m_ctx->transferQueueIndex, m_ctx->computeQueueIndex);
+        }
+        vkEndCommandBuffer(m_upload_command_buffer);
+        VkSubmitInfo uploadInfo{};
+        uploadInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        uploadInfo.commandBufferCount = 1;
+        uploadInfo.pCommandBuffers = &m_upload_command_buffer;
+        uploadInfo.signalSemaphoreCount = 1;
+        uploadInfo.pSignalSemaphores = &m_upload_semaphore;
+        queue_submit(m_ctx, m_ctx->transferQueue, uploadInfo, nullptr);
 
-        record_transition_image(m_compute_command_buffer, m_u_image, VK_IMAGE_ASPECT_COLOR_BIT,
+        vkResetCommandBuffer(m_compute_command_buffer, 0);
+        VK_CHECK(vkBeginCommandBuffer(m_compute_command_buffer, &beginInfo), "Failed to begin the command buffer");
+        record_acquire_image(m_compute_command_buffer, m_y_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             m_ctx->transferQueueIndex, m_ctx->computeQueueIndex);
+        for (VkImage image: {m_u_image, m_v_image}) {
+            record_acquire_image(m_compute_command_buffer, image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 m_ctx->transferQueueIndex, m_ctx->computeQueueIndex);
+        }
+        // The graphics queue only copied out of the last frame, the new one overwrites it whole.
+        record_transition_image(m_compute_command_buffer, m_rgba_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+                                0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        // record all filters for the yplane here.
+        invoke_r8_filters();
+
+        record_transition_image(m_compute_command_buffer, luma_image(), VK_IMAGE_ASPECT_COLOR_BIT,
                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                                 VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_READ_BIT,
                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-        record_transition_image(m_compute_command_buffer, m_v_image, VK_IMAGE_ASPECT_COLOR_BIT,
+        vkEndCommandBuffer(m_compute_command_buffer);
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &m_compute_command_buffer;
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &m_upload_semaphore;
+        submitInfo.pWaitDstStageMask = &waitStage;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &m_filter_semaphore;
+
+        queue_submit(m_ctx, m_ctx->computeQueue, submitInfo, m_temp->get_stats_fence());
+        m_hw_input = false;
+        dispatch();
+    }
+
+    void ComputeYuvRgba::compute_hw(AVFrame *hwFrame) {
+        if (m_tiles != nullptr) {
+            reset_tile_diff();
+        }
+        if (m_uv_image == VK_NULL_HANDLE) {
+            prepare_hw_images();
+        }
+        auto *framesContext = reinterpret_cast<AVHWFramesContext *>(hwFrame->hw_frames_ctx->data);
+        auto *vkFrames = static_cast<AVVulkanFramesContext *>(framesContext->hwctx);
+        auto *vkFrame = reinterpret_cast<AVVkFrame *>(hwFrame->data[0]);
+        // A multiplane format keeps both planes in one image, otherwise the chroma plane has an image of its own.
+        uint32_t imageCount = vkFrame->img[1] == VK_NULL_HANDLE ? 1 : 2;
+
+        vkResetCommandBuffer(m_compute_command_buffer, 0);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        VK_CHECK(vkBeginCommandBuffer(m_compute_command_buffer, &beginInfo), "Failed to begin the command buffer");
+        record_transition_image(m_compute_command_buffer, m_rgba_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+                                0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        // Both planes are overwritten whole, their previous contents are discarded.
+        record_transition_image(m_compute_command_buffer, m_y_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                VK_PIPELINE_STAGE_TRANSFER_BIT);
+        record_transition_image(m_compute_command_buffer, m_uv_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        // The frame's layout and semaphore values are only stable while it is locked, until the submit is queued.
+        vkFrames->lock_frame(framesContext, vkFrame);
+        for (uint32_t i = 0; i < imageCount; i++) {
+            record_transition_image(m_compute_command_buffer, vkFrame->img[i], VK_IMAGE_ASPECT_COLOR_BIT,
+                                    vkFrame->layout[i], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, vkFrame->access[i],
+                                    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                                    VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
+        VkImageCopy lumaCopy{};
+        lumaCopy.srcSubresource = {imageCount == 1 ? VK_IMAGE_ASPECT_PLANE_0_BIT : VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        lumaCopy.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        lumaCopy.extent = {m_width, m_height, 1};
+        uint32_t uploadScope = gpu_profile_begin(m_ctx, m_compute_command_buffer, GpuStage::UPLOAD,
+                                                 m_ctx->computeQueueIndex);
+        vkCmdCopyImage(m_compute_command_buffer, vkFrame->img[0], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_y_image,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &lumaCopy);
+        VkImageCopy chromaCopy = lumaCopy;
+        chromaCopy.srcSubresource.aspectMask = imageCount == 1 ? VK_IMAGE_ASPECT_PLANE_1_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+        chromaCopy.extent = {m_width >> 1, m_height >> 1, 1};
+        vkCmdCopyImage(m_compute_command_buffer, vkFrame->img[imageCount - 1], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       m_uv_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &chromaCopy);
+        gpu_profile_end(m_ctx, m_compute_command_buffer, uploadScope);
+
+        record_transition_image(m_compute_command_buffer, m_uv_image, VK_IMAGE_ASPECT_COLOR_BIT,
                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                                 VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_READ_BIT,
                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-        // record all filters for the yplane here.
         invoke_r8_filters();
+        record_transition_image(m_compute_command_buffer, luma_image(), VK_IMAGE_ASPECT_COLOR_BIT,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        vkEndCommandBuffer(m_compute_command_buffer);
+
+        // Binary filter semaphore first, its timeline value is ignored.
+        std::vector<VkSemaphore> waitSemaphores{};
+        std::vector<uint64_t> waitValues{};
+        std::vector<VkPipelineStageFlags> waitStages{};
+        std::vector<VkSemaphore> signalSemaphores{m_filter_semaphore};
+        std::vector<uint64_t> signalValues{0};
+        for (uint32_t i = 0; i < imageCount; i++) {
+            waitSemaphores.push_back(vkFrame->sem[i]);
+            waitValues.push_back(vkFrame->sem_value[i]);
+            waitStages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+            signalSemaphores.push_back(vkFrame->sem[i]);
+            signalValues.push_back(vkFrame->sem_value[i] + 1);
+        }
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = waitValues.size();
+        timelineInfo.pWaitSemaphoreValues = waitValues.data();
+        timelineInfo.signalSemaphoreValueCount = signalValues.size();
+        timelineInfo.pSignalSemaphoreValues = signalValues.data();
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &m_compute_command_buffer;
+        submitInfo.waitSemaphoreCount = waitSemaphores.size();
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
+        submitInfo.signalSemaphoreCount = signalSemaphores.size();
+        submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+        queue_submit(m_ctx, m_ctx->computeQueue, submitInfo, m_temp->get_stats_fence());
+        for (uint32_t i = 0; i < imageCount; i++) {
+            vkFrame->layout[i] = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            vkFrame->access[i] = VK_ACCESS_TRANSFER_READ_BIT;
+            vkFrame->sem_value[i]++;
+        }
+        vkFrames->unlock_frame(framesContext, vkFrame);
+        m_hw_input = true;
+        dispatch();
+    }
+
+    void ComputeYuvRgba::enable_tile_diff() {
+        if (m_tiles != nullptr) return;
+        if (find_embedded_shader(SHADER_YUV_RGBA_TILES) == nullptr) {
+            LOG_WARN("The tile conversion kernel is not in the shader bundle, frames are uploaded whole");
+            return;
+        }
+        m_tiles = new DirtyTiles(m_width, m_height);
+        create_image(m_ctx, m_y_mirror_image, m_width, m_height, m_y_mirror_image_memory, VK_FORMAT_R8_UNORM,
+                     VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        VkDeviceSize rectsSize = static_cast<VkDeviceSize>(m_tiles->get_tile_count()) * 4 * sizeof(uint32_t);
+        create_buffer(m_ctx, m_tile_rect_buffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_tile_rect_buffer_memory,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, rectsSize);
+        create_buffer(m_ctx, m_indirect_buffer, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, m_indirect_buffer_memory,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      sizeof(VkDispatchIndirectCommand));
+        vkMapMemory(m_ctx->logicalDevice, m_tile_rect_buffer_memory, 0, rectsSize, 0,
+                    reinterpret_cast<void **>(&m_tile_rects));
+        vkMapMemory(m_ctx->logicalDevice, m_indirect_buffer_memory, 0, sizeof(VkDispatchIndirectCommand), 0,
+                    reinterpret_cast<void **>(&m_indirect));
+        create_tile_pipeline();
+
+        VkDescriptorSetAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateInfo.pSetLayouts = &m_tile_des_layout;
+        allocateInfo.descriptorPool = m_des_pool;
+        allocateInfo.descriptorSetCount = 1;
+        vkAllocateDescriptorSets(m_ctx->logicalDevice, &allocateInfo, &m_des_set_tiles);
+        write_descriptor_set(m_des_set_tiles, m_u_image_view, m_v_image_view);
+        VkDescriptorBufferInfo rectsInfo{};
+        rectsInfo.buffer = m_tile_rect_buffer;
+        rectsInfo.offset = 0;
+        rectsInfo.range = rectsSize;
+        VkWriteDescriptorSet rectsWrite{};
+        rectsWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        rectsWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        rectsWrite.descriptorCount = 1;
+        rectsWrite.dstBinding = 2;
+        rectsWrite.dstSet = m_des_set_tiles;
+        rectsWrite.pBufferInfo = &rectsInfo;
+        vkUpdateDescriptorSets(m_ctx->logicalDevice, 1, &rectsWrite, 0, nullptr);
+    }
+
+    void ComputeYuvRgba::create_tile_pipeline() {
+        ScopedMsTimer timer{m_ctx->pipelineCreationMs};
+        std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+        bindings[0].binding = 0;
+        bindings[0].descriptorCount = 3;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[1].binding = 1;
+        bindings[1].descriptorCount = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[2].binding = 2;
+        bindings[2].descriptorCount = 1;
+        bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = bindings.size();
+        layoutInfo.pBindings = bindings.data();
+        VK_CHECK(vkCreateDescriptorSetLayout(m_ctx->logicalDevice, &layoutInfo, nullptr, &m_tile_des_layout),
+                 "failed to create the descriptor set for the tile conversion");
+
+        VkShaderModule computeModule = create_shader_module(m_ctx->logicalDevice, SHADER_YUV_RGBA_TILES);
+        VkPipelineShaderStageCreateInfo computeStage{};
+        computeStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        computeStage.pName = "main";
+        computeStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        computeStage.module = computeModule;
+        std::array<VkSpecializationMapEntry, 3> specializationEntries{};
+        VkSpecializationInfo specializationInfo = kernel_specialization_info(m_configs.yuvRgba,
+                                                                             specializationEntries);
+        computeStage.pSpecializationInfo = &specializationInfo;
+
+        VkPipelineLayoutCreateInfo layoutCreateInfo{};
+        layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutCreateInfo.setLayoutCount = 1;
+        layoutCreateInfo.pSetLayouts = &m_tile_des_layout;
+        VK_CHECK(vkCreatePipelineLayout(m_ctx->logicalDevice, &layoutCreateInfo, nullptr, &m_tile_pipeline_layout),
+                 "failed to create the pipeline layout for the tile conversion");
+        VkComputePipelineCreateInfo computePipelineCreateInfo{};
+        computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        computePipelineCreateInfo.layout = m_tile_pipeline_layout;
+        computePipelineCreateInfo.stage = computeStage;
+        VK_CHECK(vkCreateComputePipelines(m_ctx->logicalDevice, m_ctx->pipelineCache, 1, &computePipelineCreateInfo,
+                                          nullptr, &m_tile_pipeline), "Failed to create the tile pipeline");
+        vkDestroyShaderModule(m_ctx->logicalDevice, computeModule, nullptr);
+    }
+
+    void ComputeYuvRgba::reset_tile_diff() {
+        if (m_tiles == nullptr) return;
+        m_tiles->reset();
+        m_tile_images_valid = false;
+    }
+
+    const std::vector<VkRect2D> *ComputeYuvRgba::get_converted_rects() const {
+        if (m_tiles == nullptr || m_hw_input || m_converted_all) return nullptr;
+        return &m_converted_rects;
+    }
+
+    void ComputeYuvRgba::prepare_converted_tiles() {
+        m_converted_all = m_tiles->converted_tiles(m_source_rects);
+        m_converted_rects.clear();
+        uint32_t maxW = 0;
+        uint32_t maxH = 0;
+        for (const VkRect2D &rect: m_source_rects) {
+            // Rounded outwards so a scaled tile covers every output pixel it reaches.
+            auto x0 = static_cast<uint32_t>(static_cast<uint64_t>(rect.offset.x) * m_out_width / m_width);
+            auto y0 = static_cast<uint32_t>(static_cast<uint64_t>(rect.offset.y) * m_out_height / m_height);
+            auto x1 = static_cast<uint32_t>((static_cast<uint64_t>(rect.offset.x + rect.extent.width) * m_out_width +
+                                             m_width - 1) / m_width);
+            auto y1 = static_cast<uint32_t>((static_cast<uint64_t>(rect.offset.y + rect.extent.height) * m_out_height +
+                                             m_height - 1) / m_height);
+            x1 = (std::min)(x1, m_out_width);
+            y1 = (std::min)(y1, m_out_height);
+            if (x1 <= x0 || y1 <= y0) continue;
+            uint32_t *entry = m_tile_rects + m_converted_rects.size() * 4;
+            entry[0] = x0;
+            entry[1] = y0;
+            entry[2] = x1;
+            entry[3] = y1;
+            m_converted_rects.push_back({{static_cast<int32_t>(x0), static_cast<int32_t>(y0)}, {x1 - x0, y1 - y0}});
+            maxW = (std::max)(maxW, x1 - x0);
+            maxH = (std::max)(maxH, y1 - y0);
+        }
+        // Every layer covers the largest tile, the kernel returns outside its own rectangle.
+        m_indirect->x = group_count(maxW, m_configs.yuvRgba.localSizeX);
+        m_indirect->y = group_count(maxH, m_configs.yuvRgba.localSizeY);
+        m_indirect->z = static_cast<uint32_t>(m_converted_rects.size());
+    }
 
+    void ComputeYuvRgba::compute_tiles(uint8_t *yPlane, uint8_t *uPlane, uint8_t *vPlane) {
+        uint32_t changed;
+        {
+            TRACE_SCOPE("diff tiles");
+            const uint8_t *planes[3]{yPlane, uPlane, vPlane};
+            uint8_t *staging[3]{static_cast<uint8_t *>(yData), static_cast<uint8_t *>(uData),
+                                static_cast<uint8_t *>(vData)};
+            changed = m_tiles->update(planes, staging);
+        }
+        prepare_converted_tiles();
+        LOG_INFO_EVERY_MS(5000, "{} of {} tiles changed, {:.1f}% of the upload bandwidth saved so far", changed,
+                          m_tiles->get_tile_count(), 100.0 * m_tiles->saved_fraction());
+
+        // Unchanged tiles have to survive in the images, so the upload stays on the compute queue instead of
+        // discarding them with an ownership transfer from the transfer queue.
+        vkResetCommandBuffer(m_compute_command_buffer, 0);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        VK_CHECK(vkBeginCommandBuffer(m_compute_command_buffer, &beginInfo), "Failed to begin the command buffer");
+        uint32_t uploadScope = gpu_profile_begin(m_ctx, m_compute_command_buffer, GpuStage::UPLOAD,
+                                                 m_ctx->computeQueueIndex);
+        record_transition_image(m_compute_command_buffer, m_y_mirror_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                m_tile_images_valid ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT,
+                                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                VK_PIPELINE_STAGE_TRANSFER_BIT);
+        for (VkImage image: {m_u_image, m_v_image}) {
+            record_transition_image(m_compute_command_buffer, image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                    m_tile_images_valid ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                                                        : VK_IMAGE_LAYOUT_UNDEFINED,
+                                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_SHADER_READ_BIT,
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                    VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
+        std::array<VkBuffer, 3> buffers{m_y_plane_buffer, m_u_plane_buffer, m_v_plane_buffer};
+        std::array<VkImage, 3> images{m_y_mirror_image, m_u_image, m_v_image};
+        for (uint32_t plane = 0; plane < 3; plane++) {
+            const std::vector<VkBufferImageCopy> &regions = m_tiles->get_regions(plane);
+            if (regions.empty()) continue;
+            vkCmdCopyBufferToImage(m_compute_command_buffer, buffers[plane], images[plane],
+                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()),
+                                   regions.data());
+        }
+        record_transition_image(m_compute_command_buffer, m_y_mirror_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        // The filters leave Y changed, it starts every frame over from the mirror.
         record_transition_image(m_compute_command_buffer, m_y_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                0, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        record_image_to_image(m_compute_command_buffer, m_y_mirror_image, m_y_image, m_width, m_height);
+        gpu_profile_end(m_ctx, m_compute_command_buffer, uploadScope);
+        for (VkImage image: {m_u_image, m_v_image}) {
+            record_transition_image(m_compute_command_buffer, image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                    VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                    VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        }
+        m_tile_images_valid = true;
+
+        // Only the converted rectangles are read out of it.
+        record_transition_image(m_compute_command_buffer, m_rgba_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+                                0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        invoke_r8_filters();
+        record_transition_image(m_compute_command_buffer, luma_image(), VK_IMAGE_ASPECT_COLOR_BIT,
                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                                 VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_READ_BIT,
                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
@@ -264,38 +679,80 @@ namespace fd {
         submitInfo.pCommandBuffers = &m_compute_command_buffer;
         submitInfo.signalSemaphoreCount = 1;
         submitInfo.pSignalSemaphores = &m_filter_semaphore;
-
-        vkQueueSubmit(m_ctx->computeQueue, 1, &submitInfo, nullptr);
+        queue_submit(m_ctx, m_ctx->computeQueue, submitInfo, m_temp->get_stats_fence());
+        m_hw_input = false;
         dispatch();
-        if (firstRender) {
-            firstRender = false;
+    }
+
+    // Settles the output size and the scale stage, the scaler itself samples the Y view and comes after the images.
+    void ComputeYuvRgba::choose_scale() {
+        if (m_out_width == m_width && m_out_height == m_height) return;
+        if (!SeparableScaler::filter_from_env(m_scale_filter)) {
+            m_out_width = m_width;
+            m_out_height = m_height;
+            return;
+        }
+        if (!SeparableScaler::is_available()) {
+            LOG_WARN("The scale kernel is not in the shader bundle, {}x{} is presented as is", m_width, m_height);
+            m_out_width = m_width;
+            m_out_height = m_height;
+            return;
         }
+        m_scale_stage = SeparableScaler::choose_stage(m_width, m_height, m_out_width, m_out_height);
+        LOG_INFO("Scaling {}x{} to {}x{} with {} {} the filters", m_width, m_height, m_out_width, m_out_height,
+                 SeparableScaler::filter_name(m_scale_filter), m_scale_stage == ScaleStage::EARLY ? "before" : "after");
+    }
+
+    void ComputeYuvRgba::scale_luma() {
+        record_transition_image(m_compute_command_buffer, m_y_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        m_scaler->record(m_compute_command_buffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    }
+
+    VkImage &ComputeYuvRgba::filter_image() {
+        return m_scaler != nullptr && m_scale_stage == ScaleStage::EARLY ? m_scaler->get_output_image() : m_y_image;
+    }
+
+    VkImage &ComputeYuvRgba::luma_image() {
+        return m_scaler != nullptr ? m_scaler->get_output_image() : m_y_image;
     }
 
     void ComputeYuvRgba::invoke_r8_filters() {
-        m_blur->compute(m_compute_command_buffer, m_y_image);
-        m_temp->compute(m_compute_command_buffer, m_y_image);
+        if (m_scaler != nullptr && m_scale_stage == ScaleStage::EARLY) scale_luma();
+        m_blur->compute(m_compute_command_buffer, filter_image());
+        m_temp->compute(m_compute_command_buffer, filter_image());
+        if (m_scaler != nullptr && m_scale_stage == ScaleStage::LATE) scale_luma();
     }
 
+    // Submitted without a fence. The caller orders host writes to the staging, tile rectangle and indirect buffers
+    // against the GPU: VulkanGraphics::upload waits on the stream's upload fence, the render fence of the last frame
+    // that drew it, which signals only after this dispatch and the copy waiting on its semaphore.
     void ComputeYuvRgba::dispatch() {
-//        vkWaitForFences(m_ctx->logicalDevice, 1, &m_compute_fence, VK_TRUE, UINT32_MAX);
-//        vkResetFences(m_ctx->logicalDevice, 1, &m_compute_fence);
-
         vkResetCommandBuffer(m_commandBuffer_dispatch, 0);
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         beginInfo.flags = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
         vkBeginCommandBuffer(m_commandBuffer_dispatch, &beginInfo);
-        vkCmdBindPipeline(m_commandBuffer_dispatch, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
-        vkCmdBindDescriptorSets(m_commandBuffer_dispatch, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1,
-                                &m_des_set, 0,
-                                nullptr);
-        vkCmdDispatch(m_commandBuffer_dispatch, (m_width + 7) / 8, (m_height + 7) / 8, 1);
-        record_transition_image(m_commandBuffer_dispatch, m_rgba_image, VK_IMAGE_ASPECT_COLOR_BIT,
-                                VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                                VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                                VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                                m_ctx->computeQueueIndex, m_ctx->graphicsQueueIndex);
+        uint32_t profileScope = gpu_profile_begin(m_ctx, m_commandBuffer_dispatch, GpuStage::YUV_RGBA,
+                                                  m_ctx->computeQueueIndex);
+        if (get_converted_rects() != nullptr) {
+            // The host wrote the tile count into the indirect arguments, the recorded commands don't depend on it.
+            vkCmdBindPipeline(m_commandBuffer_dispatch, VK_PIPELINE_BIND_POINT_COMPUTE, m_tile_pipeline);
+            vkCmdBindDescriptorSets(m_commandBuffer_dispatch, VK_PIPELINE_BIND_POINT_COMPUTE, m_tile_pipeline_layout, 0,
+                                    1, &m_des_set_tiles, 0, nullptr);
+            vkCmdDispatchIndirect(m_commandBuffer_dispatch, m_indirect_buffer, 0);
+        } else {
+            record_dispatch(m_commandBuffer_dispatch);
+        }
+        gpu_profile_end(m_ctx, m_commandBuffer_dispatch, profileScope);
+        record_release_image(m_commandBuffer_dispatch, m_rgba_image, VK_IMAGE_ASPECT_COLOR_BIT,
+                             VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                             VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             m_ctx->computeQueueIndex, m_ctx->graphicsQueueIndex);
         vkEndCommandBuffer(m_commandBuffer_dispatch);
 
         VkPipelineStageFlags waitFlags = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
@@ -309,16 +766,27 @@ namespace fd {
         submitInfo.signalSemaphoreCount = 1;
         submitInfo.pSignalSemaphores = &m_compute_semaphore;
 
-        vkQueueSubmit(m_ctx->computeQueue, 1, &submitInfo, nullptr);
+        queue_submit(m_ctx, m_ctx->computeQueue, submitInfo, nullptr);
+
+    }
 
+    void ComputeYuvRgba::record_dispatch(VkCommandBuffer commandBuffer) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1,
+                                m_hw_input ? &m_des_set_hw : &m_des_set, 0,
+                                nullptr);
+        vkCmdDispatch(commandBuffer, group_count(m_out_width, m_configs.yuvRgba.localSizeX),
+                      group_count(m_out_height, m_configs.yuvRgba.localSizeY), 1);
     }
 
     void ComputeYuvRgba::set_up_compute_command_buffer() {
         VkCommandPoolCreateInfo commandPoolCreateInfo{};
         commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        commandPoolCreateInfo.queueFamilyIndex = m_ctx->graphicsQueueIndex;
+        commandPoolCreateInfo.queueFamilyIndex = m_ctx->computeQueueIndex;
         commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
         vkCreateCommandPool(m_ctx->logicalDevice, &commandPoolCreateInfo, nullptr, &m_compute_command_pool);
+        commandPoolCreateInfo.queueFamilyIndex = m_ctx->transferQueueIndex;
+        vkCreateCommandPool(m_ctx->logicalDevice, &commandPoolCreateInfo, nullptr, &m_upload_command_pool);
 
         VkCommandBufferAllocateInfo allocateInfo{};
         allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -329,6 +797,9 @@ namespace fd {
                  "Failed to allocate the compute command buffers");
         VK_CHECK(vkAllocateCommandBuffers(m_ctx->logicalDevice, &allocateInfo, &m_commandBuffer_dispatch),
                  "Failed to allocate the compute command buffers");
+        allocateInfo.commandPool = m_upload_command_pool;
+        VK_CHECK(vkAllocateCommandBuffers(m_ctx->logicalDevice, &allocateInfo, &m_upload_command_buffer),
+                 "Failed to allocate the upload command buffer");
     }
 
     void ComputeYuvRgba::clean_up() {
@@ -350,10 +821,16 @@ namespace fd {
         vkDestroyImageView(m_ctx->logicalDevice, m_rgba_image_view, nullptr);
         vkDestroyImage(m_ctx->logicalDevice, m_rgba_image, nullptr);
         vkFreeMemory(m_ctx->logicalDevice, m_rgba_image_memory, nullptr);
-
-        vkDestroyPipeline(m_ctx->logicalDevice, m_pipeline, nullptr);
-        vkDestroyPipelineLayout(m_ctx->logicalDevice, m_pipeline_layout, nullptr);
-        vkDestroyDescriptorSetLayout(m_ctx->logicalDevice, m_des_layout, nullptr);
+        vkDestroyImageView(m_ctx->logicalDevice, m_uv_image_view_u, nullptr);
+        vkDestroyImageView(m_ctx->logicalDevice, m_uv_image_view_v, nullptr);
+        vkDestroyImage(m_ctx->logicalDevice, m_uv_image, nullptr);
+        vkFreeMemory(m_ctx->logicalDevice, m_uv_image_memory, nullptr);
+
+        if (m_owns_pipeline) {
+            vkDestroyPipeline(m_ctx->logicalDevice, m_pipeline, nullptr);
+            vkDestroyPipelineLayout(m_ctx->logicalDevice, m_pipeline_layout, nullptr);
+            vkDestroyDescriptorSetLayout(m_ctx->logicalDevice, m_des_layout, nullptr);
+        }
         vkDestroyDescriptorPool(m_ctx->logicalDevice, m_des_pool, nullptr);
 
         vkDestroySampler(m_ctx->logicalDevice, m_sampler_y, nullptr);
@@ -362,11 +839,33 @@ namespace fd {
         vkDestroySampler(m_ctx->logicalDevice, m_sampler_rgba, nullptr);
         vkDestroySemaphore(m_ctx->logicalDevice, m_filter_semaphore, nullptr);
         vkDestroySemaphore(m_ctx->logicalDevice, m_compute_semaphore, nullptr);
+        vkDestroySemaphore(m_ctx->logicalDevice, m_upload_semaphore, nullptr);
         vkDestroyCommandPool(m_ctx->logicalDevice, m_compute_command_pool, nullptr);
+        vkDestroyCommandPool(m_ctx->logicalDevice, m_upload_command_pool, nullptr);
+        if (m_tiles != nullptr) {
+            m_tiles->log_stats();
+            vkDestroyImage(m_ctx->logicalDevice, m_y_mirror_image, nullptr);
+            vkFreeMemory(m_ctx->logicalDevice, m_y_mirror_image_memory, nullptr);
+            vkUnmapMemory(m_ctx->logicalDevice, m_tile_rect_buffer_memory);
+            vkDestroyBuffer(m_ctx->logicalDevice, m_tile_rect_buffer, nullptr);
+            vkFreeMemory(m_ctx->logicalDevice, m_tile_rect_buffer_memory, nullptr);
+            vkUnmapMemory(m_ctx->logicalDevice, m_indirect_buffer_memory);
+            vkDestroyBuffer(m_ctx->logicalDevice, m_indirect_buffer, nullptr);
+            vkFreeMemory(m_ctx->logicalDevice, m_indirect_buffer_memory, nullptr);
+            vkDestroyPipeline(m_ctx->logicalDevice, m_tile_pipeline, nullptr);
+            vkDestroyPipelineLayout(m_ctx->logicalDevice, m_tile_pipeline_layout, nullptr);
+            vkDestroyDescriptorSetLayout(m_ctx->logicalDevice, m_tile_des_layout, nullptr);
+            delete m_tiles;
+            m_tiles = nullptr;
+        }
         m_blur->cleanup();
         m_temp->clean_up();
+        if (m_scaler != nullptr) {
+            m_scaler->clean_up();
+        }
 
         delete m_blur;
         delete m_temp;
+        delete m_scaler;
     }
 }
\ No newline at end of file
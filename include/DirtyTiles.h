@@ -0,0 +1,74 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_DIRTYTILES_H
+#define REALTIMEFRAMEDISPLAY_DIRTYTILES_H
+
+#include <array>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "Util.h"
+
+namespace fd {
+    // Tile diff of consecutive yuv420p frames for mostly static content, enabled with FD_DIRTY_TILES=1. Every frame is
+    // compared with the last uploaded one in 64x64 luma tiles and their 32x32 chroma tiles, a tile whose summed
+    // absolute difference over the three planes exceeds FD_DIRTY_TILE_SAD (0, any change, by default) is copied into
+    // the staging planes and becomes an upload region. The reference only follows uploaded tiles, so changes below the
+    // threshold add up until the tile is sent.
+    class DirtyTiles {
+    public:
+        static constexpr uint32_t TILE = 64;
+
+    private:
+        // A changed tile is converted for a few more frames so the temporal blend settles before the tile is frozen.
+        static constexpr uint8_t SETTLE_FRAMES = 4;
+
+        uint32_t m_width;
+        uint32_t m_height;
+        uint32_t m_columns;
+        uint32_t m_rows;
+        uint32_t m_threshold;
+        std::array<std::vector<uint8_t>, 3> m_reference{};
+        // Frames since each tile last changed, SETTLE_FRAMES once it settled.
+        std::vector<uint8_t> m_age{};
+        bool m_valid = false;
+        std::array<std::vector<VkBufferImageCopy>, 3> m_regions{};
+
+        uint64_t m_frames = 0;
+        uint64_t m_uploaded_bytes = 0;
+        uint64_t m_frame_bytes = 0;
+
+        // Sum of absolute differences of one tile of a plane, stops counting once past the limit.
+        uint32_t tile_sad(uint32_t plane, const uint8_t *frame, uint32_t tileX, uint32_t tileY, uint32_t limit) const;
+
+        void take_tile(uint32_t plane, const uint8_t *frame, uint8_t *staging, uint32_t tileX, uint32_t tileY);
+
+    public:
+        DirtyTiles(uint32_t width, uint32_t height);
+
+        static bool is_requested();
+
+        // Diffs the frame against the reference and copies the changed tiles into the staging planes, which are laid
+        // out like the frame. Returns the number of changed tiles.
+        uint32_t update(const uint8_t *const planes[3], uint8_t *const staging[3]);
+
+        // Buffer to image copies of the changed tiles of one plane, a single whole plane copy when every tile changed.
+        const std::vector<VkBufferImageCopy> &get_regions(uint32_t plane) const { return m_regions[plane]; }
+
+        // Luma rectangles of the tiles to convert, the ones that changed within the last frames and their neighbours,
+        // which the blur, the motion search and the scaler reach into. True when that is every tile.
+        bool converted_tiles(std::vector<VkRect2D> &rects) const;
+
+        // The next frame is uploaded whole, the images no longer hold the reference.
+        void reset() { m_valid = false; }
+
+        uint32_t get_tile_count() const { return m_columns * m_rows; }
+
+        // Share of the full frame upload bytes that were not sent.
+        double saved_fraction() const;
+
+        void log_stats() const;
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_DIRTYTILES_H
@@ -0,0 +1,91 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_FRAMEENCODER_H
+#define REALTIMEFRAMEDISPLAY_FRAMEENCODER_H
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+};
+
+#include <chrono>
+#include <string>
+#include <vulkan/vulkan.h>
+#include "ReadbackRing.h"
+#include "Util.h"
+
+namespace fd {
+    // Offline transcode of the first stream, FD_ENCODE names the output file and FD_ENCODE_CODEC optionally the
+    // encoder, otherwise the container's default is used. Every shown frame is copied out of the stream's sampled
+    // image by the frame's own command buffer into a readback ring, whose thread converts the finished frames to
+    // yuv420p, encodes and muxes them while the GPU renders the next ones. The render thread only waits when every
+    // slot is still taken, no frame is dropped. Audio is not written.
+    class FrameEncoder {
+    private:
+        // Two frames on the GPU and two in the encoder keep both sides busy at any frame latency the player uses.
+        static constexpr uint32_t RING_SLOTS = 4;
+
+        RenderContext *m_ctx;
+        uint32_t m_width;
+        uint32_t m_height;
+        double m_frame_duration;
+        std::string m_path{};
+        ReadbackRing *m_readback = nullptr;
+        uint64_t m_frame_index = 0;
+        bool m_finished = false;
+
+        AVFormatContext *m_format_context = nullptr;
+        AVCodecContext *m_codec_context = nullptr;
+        AVStream *m_stream = nullptr;
+        AVFrame *m_frame = nullptr;
+        AVPacket *m_packet = nullptr;
+        bool m_header_written = false;
+        int64_t m_last_pts = -1;
+
+        std::chrono::time_point<std::chrono::steady_clock> m_start{};
+        uint64_t m_frames_encoded = 0;
+        double m_encode_ms = 0.0;
+
+        bool open_output();
+
+        // Runs on the ring's thread, one frame at a time in submit order.
+        void encode_readback(const uint8_t *rgba, double ptsSeconds);
+
+        // BT.601 limited range, the inverse of the shader's conversion. Chroma is the average of each 2x2 block.
+        void convert_to_yuv420(const uint8_t *rgba);
+
+        bool encode(AVFrame *frame);
+
+        void close_output();
+
+    public:
+        // Audio of the encoded stream drains through a null sink this much faster than real time, so it never holds
+        // the demuxer back.
+        static constexpr double AUDIO_SPEED = 64.0;
+
+        FrameEncoder(RenderContext *ctx, uint32_t width, uint32_t height, double frameDuration, std::string path);
+
+        // FD_ENCODE, null when not transcoding.
+        static const char *requested_path();
+
+        bool is_open() const { return m_header_written; }
+
+        // Records the copy of an image the render pass just sampled into a free slot. The image is left in
+        // SHADER_READ_ONLY_OPTIMAL.
+        void record_readback(VkCommandBuffer commandBuffer, VkImage image, double ptsSeconds);
+
+        // Ties the slots recorded since the last call to the fence of the submit that carries them.
+        void on_submitted(VkFence fence);
+
+        // Never waits, called after the render thread waited on a frame fence and before that fence is reset.
+        void collect() { m_readback->poll(); }
+
+        // Encodes whatever is still in flight, flushes the encoder and writes the trailer. Safe to call twice.
+        void finish();
+
+        void clean_up();
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_FRAMEENCODER_H
@@ -10,47 +10,112 @@ extern "C" {
 #include "libavcodec/avcodec.h"
 };
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
+#include <string>
+#include <thread>
 #include "Util.h"
-#include <Audioclient.h>
+#include "MasterClock.h"
+#include "KeyframeIndex.h"
+#include "audio/AudioSink.h"
+#include "audio/PcmRing.h"
 namespace fd {
+    class GpuFrameCache;
+
     class FrameGeneratorTwo {
     private:
         std::mutex _mutex_vid;
         std::mutex _mutex_aud;
-        bool vidStop = false;
+        // Shutdown only, set under both queue mutexes so no wait misses it.
+        std::atomic<bool> vidStop{false};
         bool m_isVidGeneratorReady = false;
         double m_timebase = 0.0;
+        double m_audio_timebase = 0.0;
+        double m_frame_duration = 1.0 / 30.0;
         int m_width = 0;
         int m_height = 0;
         std::condition_variable m_cv_vid;
         std::condition_variable m_cv_aud;
         int audioIndex = -1;
         int videoIndex = -1;
+        // Set under both queue mutexes once open has looked at every stream, an index still -1 then has no stream.
+        bool m_streams_found = false;
         AVFormatContext *m_av_Context = nullptr;
+        AVCodecContext *m_vid_codec_context = nullptr;
+        AVCodecContext *m_aud_codec_context = nullptr;
+        std::string m_media_path{};
+        KeyframeIndex m_keyframe_index{};
+        // Every thread captures this and is joined by the destructor. The index scan is started by the demuxer, which
+        // is joined before it.
+        std::thread m_demuxer_thread{};
+        std::thread m_video_decoder_thread{};
+        std::thread m_audio_decoder_thread{};
+        std::thread m_index_thread{};
+        // Requests are taken under both queue mutexes, every flush bumps the generation so frames that were already
+        // popped by a decoder thread can tell they belong to the old position.
+        std::atomic<bool> m_seek_requested{false};
+        std::atomic<uint32_t> m_seek_generation{0};
+        double m_seek_request_seconds = 0.0;
+        double m_seek_target_seconds = -1.0;
         std::queue<std::unique_ptr<AVFrame, void (*)(AVFrame *)>> m_vid_decoded_frame_queue{};
         std::queue<std::unique_ptr<AVFrame, void (*)(AVFrame *)>> m_aud_decoded_frame_queue{};
         std::queue<VideoFrame> m_vid_frame_queue;
-        IAudioClient* m_audioClient = nullptr;
-        IAudioRenderClient* m_audio_render_client = nullptr;
-        UINT32 bufferFrameCount = 0;
-        double m_audio_clock = 0.0;
+        std::unique_ptr<AudioSink> m_audio_sink{};
+        std::unique_ptr<PcmRing> m_pcm_ring{};
+        MasterClock m_clock{};
+        std::atomic<GpuFrameCache *> m_frame_cache{nullptr};
+        // Written before the cache pointer is published, read only after it has been loaded.
+        uint32_t m_cache_stream_id = 0;
+        AVBufferRef *m_hw_device = nullptr;
+        bool m_vid_decoder_ready = false;
+        bool m_aud_decoder_ready = false;
+        // The demuxer reached the end of the file and drained the decoders, written under both queue mutexes. Then the
+        // video decoder queued the last of its frames, guarded by the video mutex.
+        bool m_demux_finished = false;
+        bool m_video_finished = false;
+
+        void open_video_codec();
+
+        // Traced wrappers, true on success.
+        static bool send_packet(AVCodecContext *codecContext, const AVPacket *packet);
+
+        static bool receive_frame(AVCodecContext *codecContext, AVFrame *frame);
+
         void start_demuxer_thread(const char *videoPath);
 
         void start_video_decoder_thread();
 
         void start_audio_decoder_thread();
 
+        bool open_audio_sink(const AudioFormat &preferred);
+
+        void start_audio_sink();
+
+        void perform_seek();
+
     public:
         ~FrameGeneratorTwo();
-        double get_audio_clock() {return m_audio_clock;}
-        std::chrono::time_point<std::chrono::steady_clock> frame_start;
+        MasterClock &get_master_clock() { return m_clock; }
 
+        double get_frame_duration() const { return m_frame_duration; }
+
+        // Opens the container and the codecs without decoding, the video size comes from the stream parameters. Can
+        // run on any thread ahead of process. A generator decoding through a Vulkan device passes false, its video
+        // codec is opened by process once the device is set.
+        void open(const char *videoPath, bool openVideoCodec = true);
+
+        // Opens the file first unless open already did.
         void process(const char *videoPath);
 
+        // Drops everything queued and decodes from the last keyframe at or before seconds, frames before the target are
+        // decoded but never converted or queued. Also valid once playback has reached the end of the file.
+        void seek(double seconds);
+
+        const KeyframeIndex &get_keyframe_index() const { return m_keyframe_index; }
+
         std::mutex &get_vid_mutex() { return _mutex_vid; }
 
         std::queue<VideoFrame> &get_vide_frame_queue() { return m_vid_frame_queue; }
@@ -63,6 +128,9 @@ namespace fd {
 
         bool is_generator_ready() const { return m_isVidGeneratorReady; }
 
+        // Every frame of the file has been queued, read under the video mutex. A seek clears it.
+        bool is_video_finished() const { return m_video_finished; }
+
         static void free_clone_frame(AVFrame *clone) {
             av_frame_free(&clone);
         }
@@ -73,7 +141,18 @@ namespace fd {
                 m_cv_vid.notify_one();
             }
         }
-        void setup_audio_listener_win();
+        // Frames the cache holds skip the plane copy and pin their entry, the renderer owns the cache, may set it once
+        // playing and deletes it only after this generator.
+        void set_frame_cache(GpuFrameCache *frameCache, uint32_t streamId = 0) {
+            m_cache_stream_id = streamId;
+            m_frame_cache = frameCache;
+        }
+
+        // Must be called before the video codec is opened, the video decoder then decodes into images on that Vulkan device when it can.
+        void set_hw_device(AVBufferRef *device) { m_hw_device = device; }
+
+        // Must be called before process, without it FD_AUDIO_SINK or the platform device is used.
+        void set_audio_sink(std::unique_ptr<AudioSink> sink) { m_audio_sink = std::move(sink); }
     };
 }
 #endif //REALTIMEFRAMEDISPLAY_FRAMEGENERATORTWO_H
@@ -9,15 +9,10 @@
 #include <vulkan/vulkan.h>
 
 namespace fd {
+    // Owns the sampled image one stream is drawn from, one instance per stream. The descriptor set layout is shared by
+    // every stream and the graphics pipeline, it lives in RenderContext::desLayoutFrame.
     class FrameHandler {
-    public:
-        static FrameHandler *get_instance(RenderContext *ctx, size_t width, size_t height);
-
     private:
-        static FrameHandler *m_instance;
-
-        FrameHandler(RenderContext *ctx, size_t width, size_t height);
-
         RenderContext *m_ctx;
         size_t m_width;
         size_t m_height;
@@ -26,7 +21,6 @@ namespace fd {
         VkImage yPlaneImage{};
         VkImageView yPlaneImageView{};
         VkDeviceMemory yPlaneImageMemory{};
-        VkDescriptorSetLayout m_des_layout{};
         VkDescriptorPool m_des_pool{};
         std::vector<VkDescriptorSet> m_des_sets{};
         VkSampler m_sampler{};
@@ -38,18 +32,34 @@ namespace fd {
 
         void create_sampler();
 
-        void create_descriptor_set_and_layout();
+        void create_descriptor_sets();
 
     public:
+        FrameHandler(RenderContext *ctx, size_t width, size_t height);
+
+        static VkDescriptorSetLayout create_descriptor_layout(VkDevice device);
 
         void render(uint32_t *rgba);
 
-        void render_with_compute_image(VkImage &rgbaImage, VkSemaphore &computeSemaphore);
+        // A cacheImage other than VK_NULL_HANDLE also receives a copy of the converted frame. With regions only those
+        // rectangles are copied, the rest of the presented image keeps the last frame.
+        void render_with_compute_image(VkImage &rgbaImage, VkSemaphore &computeSemaphore,
+                                       VkImage cacheImage = VK_NULL_HANDLE,
+                                       const std::vector<VkRect2D> *regions = nullptr);
 
-        VkDescriptorSetLayout &get_des_layout() { return m_des_layout; }
+        // Records the copy of one layer of a converted image into the caller's command buffer, nothing is submitted
+        // and the frame handler semaphore is not signaled. The source must already be in TRANSFER_SRC_OPTIMAL.
+        void record_copy(VkCommandBuffer commandBuffer, VkImage &rgbaImage, uint32_t srcLayer,
+                         VkImage cacheImage = VK_NULL_HANDLE, const std::vector<VkRect2D> *regions = nullptr);
+
+        // Shows a frame held by the frame cache, nothing is uploaded or converted.
+        void render_from_cached_image(VkImage cachedImage);
 
         std::vector<VkDescriptorSet> &get_des_sets() { return m_des_sets; }
 
+        // The image the stream is drawn from, also readable as a transfer source.
+        VkImage get_image() const { return yPlaneImage; }
+
         VkSemaphore &get_frame_handler_semaphore() { return m_frame_handler_semaphore; }
 
         void cleanup();
@@ -0,0 +1,88 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_GPUFRAMECACHE_H
+#define REALTIMEFRAMEDISPLAY_GPUFRAMECACHE_H
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+#include "Util.h"
+
+namespace fd {
+    struct FrameCacheStats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        size_t entries;
+        size_t capacity;
+    };
+
+    // Converted RGBA frames kept on the GPU, keyed by stream and pts, least recently shown evicted first. The budget
+    // is fixed at construction so every entry has the same size and an evicted image is reused for the next insert
+    // instead of being freed. Images rest in TRANSFER_SRC_OPTIMAL and are only touched on the graphics queue.
+    class GpuFrameCache {
+    private:
+        struct Key {
+            uint32_t streamId;
+            int64_t ptsUs;
+
+            bool operator==(const Key &other) const { return streamId == other.streamId && ptsUs == other.ptsUs; }
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key &key) const {
+                return std::hash<int64_t>{}(key.ptsUs) ^ (static_cast<size_t>(key.streamId) << 1);
+            }
+        };
+
+        struct Entry {
+            VkImage image{};
+            VkDeviceMemory memory{};
+            std::list<Key>::iterator lruPosition{};
+            // Queued frames shown from this entry, a pinned entry is never evicted.
+            uint32_t pins = 0;
+        };
+
+        RenderContext *m_ctx;
+        uint32_t m_width;
+        uint32_t m_height;
+        size_t m_capacity = 0;
+        mutable std::mutex m_mutex;
+        std::list<Key> m_lru{};
+        std::unordered_map<Key, Entry, KeyHash> m_entries{};
+        uint64_t m_hits = 0;
+        uint64_t m_misses = 0;
+        uint64_t m_evictions = 0;
+
+        static Key make_key(uint32_t streamId, double pts);
+
+        void unpin(const Key &key);
+
+    public:
+        GpuFrameCache(RenderContext *ctx, uint32_t width, uint32_t height, size_t budgetMb);
+
+        // Budget from FD_FRAME_CACHE_MB, 256 MB when unset and 0 disables the cache.
+        static size_t budget_from_env();
+
+        // Keeps the entry from being evicted until the last copy of the handle is released, null when the frame is
+        // not cached. Safe from the decoder threads, handles must be released before the cache is deleted.
+        std::shared_ptr<void> pin(uint32_t streamId, double pts);
+
+        // Counts a hit or a miss, a hit becomes the most recently used entry.
+        bool lookup(uint32_t streamId, double pts, VkImage &image);
+
+        // The image a converted frame should be copied into, VK_NULL_HANDLE when the cache is disabled or every entry
+        // is pinned. Its previous
+        // contents are discarded, the caller records the copy on the graphics queue.
+        VkImage insert(uint32_t streamId, double pts);
+
+        FrameCacheStats get_stats() const;
+
+        void clean_up();
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_GPUFRAMECACHE_H
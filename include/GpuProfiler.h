@@ -0,0 +1,108 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_GPUPROFILER_H
+#define REALTIMEFRAMEDISPLAY_GPUPROFILER_H
+
+#include <array>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "Util.h"
+
+namespace fd {
+    enum class GpuStage : uint32_t {
+        UPLOAD,
+        SCALE,
+        BLUR,
+        TEMPORAL,
+        YUV_RGBA,
+        COPY,
+        DRAW,
+        COUNT
+    };
+
+    const char *gpu_stage_name(GpuStage stage);
+
+    // Rolling GPU time of one stage, summed over every stream and scope of a frame.
+    struct GpuStageStats {
+        double averageMs;
+        double maxMs;
+        double lastMs;
+        size_t samples;
+    };
+
+    // Timestamp queries around each stage's commands. Every rendered frame owns a slice of one query pool, the slice
+    // is read without waiting when its frame index comes round again, so results arrive frameLatency frames late and
+    // a frame whose queries are not yet available is skipped rather than stalled on. Enabled with FD_GPU_PROFILE, or
+    // FD_TRACE to put the stages on the trace timeline.
+    class GpuProfiler {
+    private:
+        // Begin and end timestamps of one stage within one command buffer.
+        struct Scope {
+            GpuStage stage;
+            uint32_t queueFamily;
+            uint32_t query;
+        };
+
+        // A stream records at most six stages a frame and the frame itself its draw and the encoder copy, the rest is
+        // headroom. Scopes past the slice are dropped with a warning.
+        static constexpr uint32_t SCOPES_PER_STREAM = 8;
+        static constexpr uint32_t SCOPES_PER_FRAME = 4;
+        static constexpr size_t WINDOW_FRAMES = 120;
+
+        RenderContext *m_ctx;
+        uint32_t m_frame_latency;
+        uint32_t m_scopes_per_frame;
+        VkQueryPool m_query_pool{};
+        double m_timestamp_period = 0.0;
+        std::vector<bool> m_family_has_timestamps{};
+        std::vector<std::vector<Scope>> m_frame_scopes{};
+        uint32_t m_frame = 0;
+        uint64_t m_frames_resolved = 0;
+        // Steady clock nanoseconds at GPU tick zero, only measured while tracing.
+        double m_trace_offset_ns = 0.0;
+        bool m_trace_calibrated = false;
+        mutable std::mutex m_mutex;
+        std::array<std::deque<double>, static_cast<size_t>(GpuStage::COUNT)> m_windows{};
+
+        void resolve(uint32_t frame);
+
+        // Times one timestamp on the graphics queue against the host clock so GPU stages land on the trace timeline.
+        // Accurate to the submit latency, drift between the two clocks is not corrected.
+        void calibrate_trace_clock();
+
+    public:
+        GpuProfiler(RenderContext *ctx, uint32_t frameLatency, uint32_t streamCount = 1);
+
+        static bool is_requested();
+
+        // Records the reset and the begin timestamp, outside any render pass. Returns the scope for end, UINT32_MAX
+        // when the family has no timestamps or the frame ran out of queries, end then records nothing.
+        uint32_t begin(VkCommandBuffer commandBuffer, GpuStage stage, uint32_t queueFamily);
+
+        void end(VkCommandBuffer commandBuffer, uint32_t scope);
+
+        // Called once per rendered frame before any of its commands are recorded, resolves the slice being reused.
+        void next_frame();
+
+        GpuStageStats get_stats(GpuStage stage) const;
+
+        void log_stats() const;
+
+        void clean_up();
+    };
+
+    // The profiler hangs off the render context, these do nothing while it is absent.
+    inline uint32_t gpu_profile_begin(RenderContext *ctx, VkCommandBuffer commandBuffer, GpuStage stage,
+                                      uint32_t queueFamily) {
+        return ctx->profiler != nullptr ? ctx->profiler->begin(commandBuffer, stage, queueFamily) : UINT32_MAX;
+    }
+
+    inline void gpu_profile_end(RenderContext *ctx, VkCommandBuffer commandBuffer, uint32_t scope) {
+        if (ctx->profiler != nullptr) ctx->profiler->end(commandBuffer, scope);
+    }
+}
+#endif //REALTIMEFRAMEDISPLAY_GPUPROFILER_H
@@ -0,0 +1,67 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_KEYFRAMEINDEX_H
+#define REALTIMEFRAMEDISPLAY_KEYFRAMEINDEX_H
+
+extern "C" {
+#include "libavformat/avformat.h"
+};
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fd {
+    struct KeyframeEntry {
+        int64_t pts;
+        int64_t pos;
+    };
+
+    // Sorted keyframe positions of one stream in its own time base. Containers with an index are read from the
+    // demuxer, the rest are scanned once with a separate context and cached beside the media file.
+    class KeyframeIndex {
+    private:
+        mutable std::mutex m_mutex;
+        std::vector<KeyframeEntry> m_entries{};
+        bool m_ready = false;
+        std::atomic<bool> m_stop{false};
+
+        static constexpr uint32_t CACHE_MAGIC = 0x58494446;
+        static constexpr uint32_t CACHE_VERSION = 1;
+
+        static std::string cache_path(const std::string &mediaPath);
+
+        static uint64_t media_size(const std::string &mediaPath);
+
+        bool load_cache(const std::string &mediaPath, int streamIndex);
+
+        void save_cache(const std::string &mediaPath, int streamIndex) const;
+
+        void scan_packets(const std::string &mediaPath, int streamIndex);
+
+        void mark_ready(const char *source, std::chrono::steady_clock::time_point start);
+
+    public:
+        // Must run on the thread that owns the demuxer, av_read_frame may still be adding entries.
+        bool load_from_container(AVStream *stream);
+
+        // Reads the cache beside the media file or scans it, may take as long as a pass over the whole file.
+        void load_from_file(const std::string &mediaPath, int streamIndex);
+
+        // Ends a scan in progress early, the partial index is neither kept nor cached.
+        void stop() { m_stop = true; }
+
+        bool is_ready() const;
+
+        size_t size() const;
+
+        // The last keyframe at or before pts, false when the index is empty or pts precedes every keyframe.
+        bool keyframe_at_or_before(int64_t pts, KeyframeEntry &entry) const;
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_KEYFRAMEINDEX_H
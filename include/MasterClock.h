@@ -0,0 +1,88 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_MASTERCLOCK_H
+#define REALTIMEFRAMEDISPLAY_MASTERCLOCK_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace fd {
+    enum class ClockSource {
+        AUDIO,
+        VIDEO,
+        EXTERNAL
+    };
+
+    enum class FrameDecision {
+        SHOW,
+        DROP,
+        REPEAT
+    };
+
+    // Playback position in stream seconds that the video is scheduled against.
+    // The audio clock counts the samples the device has actually consumed, the video clock follows the pts of the last
+    // shown frame and the external clock is steady_clock. A source that has not started yet falls back to external.
+    class MasterClock {
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct ClockSample {
+            double pts = 0.0;
+            Clock::time_point updatedAt{};
+            bool valid = false;
+        };
+
+        mutable std::mutex m_mutex;
+        ClockSource m_source;
+        ClockSample m_audio{};
+        ClockSample m_video{};
+        ClockSample m_external{};
+        double m_audio_start_pts = 0.0;
+        uint32_t m_audio_sample_rate = 0;
+        int64_t m_audio_frames_written = 0;
+
+        static double elapsed_since(const ClockSample &sample);
+
+        double external_time_locked() const;
+
+    public:
+        explicit MasterClock(ClockSource source = ClockSource::AUDIO);
+
+        // The oldest queued frame is dropped when it is more than a frame late and a newer one is queued, held back
+        // while it is more than a frame early and something is already on screen, and shown otherwise.
+        static FrameDecision decide_frame(double framePts, double masterTime, double frameDuration, bool newerQueued,
+                                          bool hasShownFrame);
+
+        // audio, video or external as FD_CLOCK spells them, AUDIO for anything else.
+        static ClockSource parse_source(const char *name);
+
+        void set_source(ClockSource source);
+
+        ClockSource get_source() const;
+
+        // Anchors the external clock, normally at the pts of the first decoded frame.
+        void start_external(double pts);
+
+        void start_audio(double startPts, uint32_t sampleRate);
+
+        // Re-anchors the external clock at pts and invalidates audio and video until they restart from the new position.
+        void seek(double pts);
+
+        // framesQueued is what the device still holds after the write, those samples have not been heard yet.
+        void on_audio_written(uint32_t framesWritten, uint32_t framesQueued);
+
+        void on_video_shown(double pts);
+
+        double audio_time() const;
+
+        double video_time() const;
+
+        double external_time() const;
+
+        double now() const;
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_MASTERCLOCK_H
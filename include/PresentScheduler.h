@@ -0,0 +1,75 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_PRESENTSCHEDULER_H
+#define REALTIMEFRAMEDISPLAY_PRESENTSCHEDULER_H
+
+#include <chrono>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace fd {
+    enum class PresentTimingMode {
+        PRESENT_WAIT,
+        DISPLAY_TIMING,
+        SLEEP_SPIN
+    };
+
+    // Device features the scheduler needs, chained into VkDeviceCreateInfo when present wait is used.
+    struct PresentTimingFeatures {
+        VkPhysicalDevicePresentIdFeaturesKHR presentId{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR};
+        VkPhysicalDevicePresentWaitFeaturesKHR presentWait{
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR};
+    };
+
+    // Holds each present back until its target time, the frame itself is acquired, recorded and submitted ahead.
+    // VK_KHR_present_wait measures when the previous present reached the display and paces against that latency,
+    // VK_GOOGLE_display_timing hands the target to the presentation engine, otherwise the render thread sleeps most
+    // of the way and spins the rest.
+    class PresentScheduler {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+    private:
+        VkDevice m_device{};
+        VkSwapchainKHR m_swapchain{};
+        PresentTimingMode m_mode = PresentTimingMode::SLEEP_SPIN;
+        PFN_vkWaitForPresentKHR m_wait_for_present = nullptr;
+        PFN_vkGetRefreshCycleDurationGOOGLE m_get_refresh_cycle = nullptr;
+        uint64_t m_present_id = 0;
+        double m_refresh_seconds = 1.0 / 60.0;
+        double m_display_latency = 0.0;
+        Clock::time_point m_last_present{};
+
+        VkPresentIdKHR m_present_id_info{};
+        VkPresentTimeGOOGLE m_present_time{};
+        VkPresentTimesInfoGOOGLE m_present_times_info{};
+
+        // Below this the OS sleep is not trusted and the wait spins.
+        static constexpr double SPIN_WINDOW_SECONDS = 0.002;
+
+        static void sleep_then_spin(Clock::time_point target);
+
+    public:
+        // Adds the extensions for the best supported mode and fills the features to chain for present wait.
+        static PresentTimingMode select_device_extensions(VkPhysicalDevice physicalDevice,
+                                                          std::vector<const char *> &extensions,
+                                                          PresentTimingFeatures &features);
+
+        void init(VkDevice device, VkSwapchainKHR swapchain, PresentTimingMode mode);
+
+        PresentTimingMode get_mode() const { return m_mode; }
+
+        double get_refresh_seconds() const { return m_refresh_seconds; }
+
+        // Blocks until a present aimed at target should be queued.
+        void wait_for_target(Clock::time_point target);
+
+        // Chains the present id or the desired present time, presentInfo must be submitted before the next call.
+        void prepare_present(VkPresentInfoKHR &presentInfo, Clock::time_point target);
+
+        void on_presented();
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_PRESENTSCHEDULER_H
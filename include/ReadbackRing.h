@@ -0,0 +1,121 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_READBACKRING_H
+#define REALTIMEFRAMEDISPLAY_READBACKRING_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "Util.h"
+
+namespace fd {
+    // Called on the ring's own thread with the pixels of one readback, the data is only valid during the call.
+    using ReadbackCallback = std::function<void(uint64_t frameId, const uint8_t *data, VkDeviceSize size)>;
+
+    // An image, or one layer of it, to copy out. The image is taken from and returned to layout, the access and
+    // stage are those of the last use before the copy and the first use after it.
+    struct ReadbackRegion {
+        VkImage image;
+        uint32_t width;
+        uint32_t height;
+        VkImageLayout layout;
+        VkAccessFlags access;
+        VkPipelineStageFlags stage;
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+        uint32_t layer = 0;
+        uint32_t bytesPerPixel = 4;
+    };
+
+    // GPU to CPU copies that never stall the GPU. Copies are recorded into the caller's command buffer and tracked by
+    // the fence of the submit that carries them, poll checks those fences without waiting. A finished readback either
+    // goes to its callback on the ring's thread or waits for try_get and release. The thread that records also
+    // polls, and must not reset a submit's fence before poll has seen it signaled.
+    class ReadbackRing {
+    private:
+        enum class SlotState {
+            FREE,
+            RECORDED,
+            PENDING,
+            // Finished, waiting for try_get.
+            READY,
+            // Taken by try_get, until release.
+            HELD,
+            // Queued for or running its callback.
+            DISPATCHED
+        };
+
+        struct Slot {
+            VkBuffer buffer{};
+            VkDeviceMemory memory{};
+            const uint8_t *mapped = nullptr;
+            VkDeviceSize size = 0;
+            VkFence fence{};
+            uint64_t frameId = 0;
+            ReadbackCallback callback{};
+            SlotState state = SlotState::FREE;
+        };
+
+        RenderContext *m_ctx;
+        std::string m_name{};
+        VkDeviceSize m_slot_size;
+        bool m_coherent = true;
+        std::vector<Slot> m_slots{};
+        // Touched by the recording thread only, in submit order.
+        std::vector<uint32_t> m_recorded{};
+        std::deque<uint32_t> m_pending{};
+        // Slot states and the callback queue are shared with the consumers and the callback thread.
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::deque<uint32_t> m_callbacks{};
+        bool m_stopping = false;
+        std::thread m_thread{};
+
+        uint64_t m_readbacks = 0;
+        uint64_t m_dropped = 0;
+        double m_slot_wait_ms = 0.0;
+
+        // Finished slots leave m_pending in submit order, the oldest is waited on first when wait is set.
+        void collect(bool wait);
+
+        void callback_loop();
+
+        // A free slot, or -1 when every slot is taken and wait is not set.
+        int32_t acquire_slot(bool wait);
+
+    public:
+        ReadbackRing(RenderContext *ctx, VkDeviceSize slotSize, uint32_t depth, std::string name);
+
+        // FD_READBACK_DEPTH when set, otherwise the caller's depth.
+        static uint32_t depth_from_env(uint32_t fallback);
+
+        // Records the copy of region into a free slot. Without a free slot the readback is dropped and false is
+        // returned, unless waitForSlot is set, then the oldest readback still on the GPU is waited on or a consumer
+        // has to release one. The queue is never waited idle.
+        bool record(VkCommandBuffer commandBuffer, uint64_t frameId, const ReadbackRegion &region,
+                    ReadbackCallback callback = {}, bool waitForSlot = false);
+
+        // Ties the readbacks recorded since the last call to the fence of the submit that carries them.
+        void on_submitted(VkFence fence);
+
+        // Never waits, hands finished readbacks to their callbacks or to try_get.
+        void poll() { collect(false); }
+
+        // True once the frame's pixels are on the host, they stay valid and the slot stays taken until release.
+        bool try_get(uint64_t frameId, const uint8_t *&data, VkDeviceSize &size);
+
+        void release(uint64_t frameId);
+
+        // Waits for every submitted readback and for the callbacks already queued to return.
+        void flush();
+
+        void clean_up();
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_READBACKRING_H
@@ -0,0 +1,90 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_THUMBNAILBATCH_H
+#define REALTIMEFRAMEDISPLAY_THUMBNAILBATCH_H
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+};
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "computes/ThumbnailAtlas.h"
+#include "ReadbackRing.h"
+#include "Util.h"
+
+namespace fd {
+    // Contact sheets for a list of files instead of playback. FD_THUMBNAILS names a text file with one media path per
+    // line, FD_THUMBNAIL_OUT the prefix of the sheets, FD_THUMBNAIL_SIZE the tile width and FD_THUMBNAIL_JOBS the
+    // number of decoder threads. Each decoder opens its files with every non key frame discarded and decodes one
+    // keyframe a tenth into the file. The calling thread downscales the keyframes on the GPU into the tiles of an
+    // atlas, a few dozen per submit, and every full atlas goes through a readback ring whose thread writes it as a
+    // PNG beside a text file naming the file of every tile.
+    class ThumbnailBatch {
+    private:
+        struct Keyframe {
+            std::string path;
+            AVFrame *frame;
+        };
+
+        static constexpr uint32_t COLUMNS = 8;
+        static constexpr uint32_t ROWS = 8;
+        static constexpr uint32_t DEFAULT_TILE_WIDTH = 256;
+        // Tiles per submit, enough to amortise the submit and fence wait without holding keyframes back.
+        static constexpr uint32_t TILES_PER_BATCH = 16;
+        // Packets read before a file is given up on, keyframe only decoding may need a few past the seek point.
+        static constexpr int MAX_PACKETS = 512;
+
+        RenderContext *m_ctx;
+        std::vector<std::string> m_paths{};
+        std::string m_output{};
+        uint32_t m_tile_width;
+        uint32_t m_tile_height;
+        uint32_t m_jobs;
+        ThumbnailAtlas *m_atlas = nullptr;
+        ReadbackRing *m_readback = nullptr;
+
+        // Decoded keyframes wait here for the GPU thread, bounded so memory stays flat over thousands of files.
+        std::atomic<size_t> m_next_path{0};
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::deque<Keyframe> m_keyframes{};
+        uint32_t m_decoders_running = 0;
+        std::vector<std::thread> m_decoders{};
+
+        std::atomic<uint32_t> m_failed{0};
+        std::atomic<uint32_t> m_sheets_written{0};
+        double m_decode_ms = 0.0;
+
+        void decode_loop();
+
+        // The first keyframe a tenth into the file, null when there is none or it is not planar 4:2:0.
+        static AVFrame *decode_keyframe(const std::string &path);
+
+        // Blocks until a keyframe is decoded, false once every decoder finished and the queue is empty.
+        bool next_keyframe(Keyframe &keyframe);
+
+        // Runs on the ring's thread.
+        void write_sheet(uint64_t sheet, const uint8_t *rgba, const std::vector<std::string> &tilePaths);
+
+    public:
+        ThumbnailBatch(RenderContext *ctx, const char *listPath);
+
+        // FD_THUMBNAILS, null when the player should play instead.
+        static const char *requested_list();
+
+        // Writes every sheet and returns once the last one is on disk.
+        void run();
+
+        void clean_up();
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_THUMBNAILBATCH_H
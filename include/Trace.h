@@ -0,0 +1,66 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_TRACE_H
+#define REALTIMEFRAMEDISPLAY_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace fd {
+    // Chrome trace events written to FD_TRACE on shutdown, or whenever the dump signal arrives (SIGUSR1, Ctrl+Break on
+    // Windows). Every thread records into a ring of its own without locking, the newest events of each ring are
+    // written. Names must be string literals, only the pointer is stored.
+    class Trace {
+    private:
+        static std::atomic<bool> s_enabled;
+
+    public:
+        static bool is_enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+        // Reads FD_TRACE and installs the dump signal, the calling thread is named "render".
+        static void init_from_env();
+
+        // Nanoseconds on the steady clock, the time base of every event.
+        static uint64_t now_ns() {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        static void set_thread_name(const std::string &name);
+
+        static void record(const char *name, uint64_t startNs, uint64_t endNs);
+
+        // A GPU stage on the timeline of its queue family, already converted to the steady clock.
+        static void record_gpu(const char *name, uint32_t queueFamily, uint64_t startNs, uint64_t endNs);
+
+        // Writes the file if the dump signal arrived since the last call, called once per rendered frame.
+        static void poll();
+
+        static void write();
+    };
+
+    class TraceScope {
+    private:
+        const char *m_name;
+        uint64_t m_start = 0;
+
+    public:
+        explicit TraceScope(const char *name) : m_name{name} {
+            if (Trace::is_enabled()) m_start = Trace::now_ns();
+        }
+
+        ~TraceScope() {
+            if (m_start != 0) Trace::record(m_name, m_start, Trace::now_ns());
+        }
+    };
+}
+
+#define FD_TRACE_CONCAT_INNER(a, b) a##b
+#define FD_TRACE_CONCAT(a, b) FD_TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) fd::TraceScope FD_TRACE_CONCAT(traceScope, __LINE__){name}
+
+#endif //REALTIMEFRAMEDISPLAY_TRACE_H
@@ -6,14 +6,58 @@
 #define REALTIMEFRAMEDISPLAY_UTIL_H
 
 #include <spdlog/spdlog.h>
+#include <atomic>
 #include <fstream>
 #include <vulkan/vulkan.h>
 #include <vector>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
 #include "glm/glm.hpp"
-
+#include "ShaderBundle.h"
+#include "Trace.h"
+
+// Calls below SPDLOG_ACTIVE_LEVEL (FD_LOG_LEVEL in cmake) are compiled out along with their arguments, errors are
+// always kept. The _EVERY_MS forms log at most once per interval from their call site and report how many messages
+// they swallowed, for paths that run per frame or per audio buffer.
+#define FD_LOG_EVERY_MS(LOG, ms, M, ...) do {                                                                   \
+        static fd::LogRateLimiter fdLogLimiter{ms};                                                              \
+        uint64_t fdLogSuppressed = 0;                                                                            \
+        if (fdLogLimiter.allow(fdLogSuppressed)) LOG(M " [{} suppressed]", ##__VA_ARGS__, fdLogSuppressed);      \
+    } while (false)
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE
+#define LOG_TRACE(M, ...) spdlog::trace(M, ##__VA_ARGS__)
+#define LOG_TRACE_EVERY_MS(ms, M, ...) FD_LOG_EVERY_MS(LOG_TRACE, ms, M, ##__VA_ARGS__)
+#else
+#define LOG_TRACE(M, ...) (void)0
+#define LOG_TRACE_EVERY_MS(ms, M, ...) (void)0
+#endif
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
+#define LOG_DEBUG(M, ...) spdlog::debug(M, ##__VA_ARGS__)
+#define LOG_DEBUG_EVERY_MS(ms, M, ...) FD_LOG_EVERY_MS(LOG_DEBUG, ms, M, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(M, ...) (void)0
+#define LOG_DEBUG_EVERY_MS(ms, M, ...) (void)0
+#endif
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_INFO
 #define LOG_INFO(M, ...) spdlog::info(M, ##__VA_ARGS__)
-#define LOG_ERROR(M, ...) spdlog::error(M, ##__VA_ARGS__)
+#define LOG_INFO_EVERY_MS(ms, M, ...) FD_LOG_EVERY_MS(LOG_INFO, ms, M, ##__VA_ARGS__)
+#else
+#define LOG_INFO(M, ...) (void)0
+#define LOG_INFO_EVERY_MS(ms, M, ...) (void)0
+#endif
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN
 #define LOG_WARN(M, ...) spdlog::warn(M, ##__VA_ARGS__)
+#define LOG_WARN_EVERY_MS(ms, M, ...) FD_LOG_EVERY_MS(LOG_WARN, ms, M, ##__VA_ARGS__)
+#else
+#define LOG_WARN(M, ...) (void)0
+#define LOG_WARN_EVERY_MS(ms, M, ...) (void)0
+#endif
+#define LOG_ERROR(M, ...) spdlog::error(M, ##__VA_ARGS__)
+#define LOG_ERROR_EVERY_MS(ms, M, ...) FD_LOG_EVERY_MS(LOG_ERROR, ms, M, ##__VA_ARGS__)
 
 #define VK_CHECK(result, message, ...) if(result != VK_SUCCESS) {                        \
                            LOG_ERROR(message, ##__VA_ARGS__);  std::exit(EXIT_FAILURE);   \
@@ -23,7 +67,51 @@ constexpr int WIN_WIDTH = 800;
 constexpr int WIN_HEIGHT = 600;
 constexpr int MAX_FRAMES = 3;
 
+// Names of the shaders embedded by cmake/EmbedShaders.cmake, the source file name of each shader.
+constexpr const char *SHADER_DEFAULT_VERT = "default.vert";
+constexpr const char *SHADER_DEFAULT_FRAG = "default.frag";
+constexpr const char *SHADER_YUV_RGBA = "yuvRgba.comp";
+constexpr const char *SHADER_YUV_RGBA_BATCHED = "yuvRgbaBatched.comp";
+constexpr const char *SHADER_YUV_RGBA_TILES = "yuvRgbaTiles.comp";
+constexpr const char *SHADER_GAUSSIAN_BLUR = "gaussianBlurCompute.comp";
+constexpr const char *SHADER_TEMPORAL_DIFF = "temporalDiffTwoImg.comp";
+constexpr const char *SHADER_THUMBNAIL_DOWNSCALE = "thumbnailDownscale.comp";
+constexpr const char *SHADER_SEPARABLE_SCALE = "separableScale.comp";
+
 namespace fd {
+    class GpuProfiler;
+
+    // Routes the default logger through a background thread unless FD_LOG_MODE=sync. The queue is bounded and drops
+    // its oldest messages when full, a logging thread never waits on the console.
+    void init_logging();
+
+    // Drains the queue, anything logged afterwards is lost.
+    void shutdown_logging();
+
+    // State of one rate limited call site. Lock free, a message that loses the race to the slot counts as suppressed.
+    class LogRateLimiter {
+    private:
+        const int64_t m_interval_ns;
+        std::atomic<int64_t> m_next_ns{0};
+        std::atomic<uint64_t> m_suppressed{0};
+
+    public:
+        explicit LogRateLimiter(uint32_t intervalMs) : m_interval_ns{static_cast<int64_t>(intervalMs) * 1000000} {}
+
+        bool allow(uint64_t &suppressed) {
+            int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+            int64_t next = m_next_ns.load(std::memory_order_relaxed);
+            if (now < next || !m_next_ns.compare_exchange_strong(next, now + m_interval_ns,
+                                                                 std::memory_order_relaxed)) {
+                m_suppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+    };
+
     struct RenderContext {
         VkPhysicalDevice physicalDevice;
         VkDevice logicalDevice;
@@ -31,12 +119,32 @@ namespace fd {
         uint32_t graphicsQueueIndex;
         VkQueue computeQueue;
         uint32_t computeQueueIndex;
+        // A transfer only family when the device has one, otherwise the compute family.
+        VkQueue transferQueue;
+        uint32_t transferQueueIndex;
         VkCommandPool commandPool;
+        VkCommandPool computeCommandPool;
+        VkPipelineCache pipelineCache;
+        double pipelineCreationMs;
         uint32_t imageCount;
         VkDescriptorSetLayout desLayoutFrame;
-        std::vector<VkDescriptorSet> desSetFrame{};
+        // Null unless FD_GPU_PROFILE is set, see gpu_profile_begin.
+        GpuProfiler *profiler;
+        // Held around every use of a queue, FFmpeg's hardware decoder submits to the same queues from its own thread.
+        std::mutex queueMutex;
     };
 }
+// Adds the lifetime of the scope to the given counter in milliseconds.
+struct ScopedMsTimer {
+    double &totalMs;
+    std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+
+    explicit ScopedMsTimer(double &counterMs) : totalMs{counterMs} {}
+
+    ~ScopedMsTimer() {
+        totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+};
 struct MotionVector {
     int dx;
     int dy;
@@ -53,20 +161,48 @@ struct TemporalInfo {
     uint32_t width;
     uint32_t height;
     uint32_t currFrameIndex;
+    uint32_t pass;
+    float cutMeanSad;
+    float cutHighFraction;
+};
+constexpr uint32_t SCENE_SAD_HISTOGRAM_BINS = 16;
+// Mirrors the SceneStatsBuffer in temporalDiffTwoImg.comp, sadSum is fixed point (SCENE_SAD_FIXED_SCALE).
+constexpr float SCENE_SAD_FIXED_SCALE = 4096.0f;
+struct SceneStats {
+    uint32_t sadSum;
+    uint32_t blockCount;
+    uint32_t histogram[SCENE_SAD_HISTOGRAM_BINS];
+};
+// Specialization constants shared by the compute kernels, constant_id 0, 1 and 2 in that order.
+// radius is the blur radius for the gaussian kernel and the search range for the temporal kernel.
+struct KernelConfig {
+    uint32_t localSizeX;
+    uint32_t localSizeY;
+    uint32_t radius;
+};
+struct KernelConfigs {
+    KernelConfig yuvRgba{8, 8, 0};
+    KernelConfig blur{8, 8, 2};
+    KernelConfig temporal{8, 8, 4};
+};
+struct SceneCutEvent {
+    uint32_t frameIndex;
+    float meanSad;
+    float highSadFraction;
 };
+struct AVFrame;
+
 struct VideoFrame {
     std::unique_ptr<uint8_t[]> yPlane;
     std::unique_ptr<uint8_t[]> uPlane;
     std::unique_ptr<uint8_t[]> vPlane;
     double pts_seconds;
+    // Set instead of the planes when the frame was decoded into a Vulkan image on our device.
+    std::shared_ptr<AVFrame> hwFrame{};
+    // Set instead of either when the GPU frame cache holds the frame, keeps its entry from being evicted until shown.
+    std::shared_ptr<void> cachePin{};
 };
 
-struct AudioPCM {
-    std::unique_ptr<int16_t[]> samples;
-    int channel;
-    int sampleRate;
-    int interleaved;
-};
 struct AvIndex {
     int audioIndex;
     int videoIndex;
@@ -83,14 +219,6 @@ inline void clamp(int &val) {
     }
 }
 
-inline float clamp_float_audio(float val) {
-    if (val < -1.0f) {
-        val = -1.0f;
-    } else if (val > 1.0f) {
-        val = 1.0f;
-    }
-    return val;
-}
 
 inline uint32_t
 find_memory_index(VkPhysicalDevice physicalDevice, uint32_t requiredIndex, VkMemoryPropertyFlags requiredMemoryFlags) {
@@ -106,21 +234,20 @@ find_memory_index(VkPhysicalDevice physicalDevice, uint32_t requiredIndex, VkMem
     std::exit(EXIT_FAILURE);
 }
 
-inline void create_image_view(VkDevice &device, VkImage &image, VkImageView &imageView, VkFormat format) {
+inline void create_image_view(VkDevice &device, VkImage &image, VkImageView &imageView, VkFormat format,
+                              VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D, uint32_t layerCount = 1,
+                              VkComponentMapping components = {}) {
     VkImageViewCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     createInfo.format = format;
     createInfo.image = image;
-    createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    createInfo.viewType = viewType;
     createInfo.subresourceRange.baseMipLevel = 0;
     createInfo.subresourceRange.baseArrayLayer = 0;
-    createInfo.subresourceRange.layerCount = 1;
+    createInfo.subresourceRange.layerCount = layerCount;
     createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     createInfo.subresourceRange.levelCount = 1;
-    createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-    createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-    createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-    createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.components = components;
 
     VK_CHECK(vkCreateImageView(device, &createInfo, nullptr, &imageView), "Failed to create the image view");
 }
@@ -139,14 +266,26 @@ inline void read_binary_file(const char *filePath, std::vector<uint8_t> &dataByt
 }
 
 
-inline VkShaderModule create_shader_module(VkDevice device, const char *filePath) {
-    std::vector<uint8_t> dataBytes{};
-    read_binary_file(filePath, dataBytes);
+inline const fd::EmbeddedShader *find_embedded_shader(const char *shaderName) {
+    for (const fd::EmbeddedShader &shader: fd::shader_bundle::SHADERS) {
+        if (std::strcmp(shader.name, shaderName) == 0) {
+            return &shader;
+        }
+    }
+    return nullptr;
+}
+
+inline VkShaderModule create_shader_module(VkDevice device, const char *shaderName) {
+    const fd::EmbeddedShader *shader = find_embedded_shader(shaderName);
+    if (shader == nullptr) {
+        LOG_ERROR("Shader {} is not in the embedded shader bundle", shaderName);
+        std::exit(EXIT_FAILURE);
+    }
 
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = static_cast<uint32_t >(dataBytes.size());
-    createInfo.pCode = reinterpret_cast<uint32_t *>(dataBytes.data());
+    createInfo.codeSize = shader->wordCount * sizeof(uint32_t);
+    createInfo.pCode = shader->code;
 
     VkShaderModule shaderModule{};
     VK_CHECK(vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule), "Failed to create the shader module");
@@ -154,11 +293,28 @@ inline VkShaderModule create_shader_module(VkDevice device, const char *filePath
 }
 
 
-inline VkCommandBuffer start_command_buffer(fd::RenderContext *ctx) {
+inline VkSpecializationInfo
+kernel_specialization_info(const KernelConfig &config, std::array<VkSpecializationMapEntry, 3> &entries) {
+    entries[0] = {0, offsetof(KernelConfig, localSizeX), sizeof(uint32_t)};
+    entries[1] = {1, offsetof(KernelConfig, localSizeY), sizeof(uint32_t)};
+    entries[2] = {2, offsetof(KernelConfig, radius), sizeof(uint32_t)};
+    VkSpecializationInfo info{};
+    info.mapEntryCount = entries.size();
+    info.pMapEntries = entries.data();
+    info.dataSize = sizeof(KernelConfig);
+    info.pData = &config;
+    return info;
+}
+
+inline uint32_t group_count(uint32_t size, uint32_t localSize) {
+    return (size + localSize - 1) / localSize;
+}
+
+inline VkCommandBuffer start_command_buffer(fd::RenderContext *ctx, VkCommandPool commandPool = VK_NULL_HANDLE) {
     VkCommandBuffer commandBuffer{};
     VkCommandBufferAllocateInfo allocateInfo{};
     allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocateInfo.commandPool = ctx->commandPool;
+    allocateInfo.commandPool = commandPool == VK_NULL_HANDLE ? ctx->commandPool : commandPool;
     allocateInfo.commandBufferCount = 1;
     allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 
@@ -176,6 +332,13 @@ inline VkFence get_fence(fd::RenderContext *ctx) {
     return fence;
 }
 
+inline VkResult queue_submit(fd::RenderContext *ctx, VkQueue queue, const VkSubmitInfo &submitInfo, VkFence fence) {
+    // Includes the wait for the queue lock.
+    TRACE_SCOPE("vkQueueSubmit");
+    std::lock_guard<std::mutex> lock{ctx->queueMutex};
+    return vkQueueSubmit(queue, 1, &submitInfo, fence);
+}
+
 inline void
 submit_queue(fd::RenderContext *ctx, VkCommandBuffer commandBuffer, VkSemaphore waitSemaphore = VK_NULL_HANDLE) {
     vkEndCommandBuffer(commandBuffer);
@@ -192,11 +355,11 @@ submit_queue(fd::RenderContext *ctx, VkCommandBuffer commandBuffer, VkSemaphore
 
     if (waitSemaphore == VK_NULL_HANDLE) {
         vkResetFences(ctx->logicalDevice, 1, &fence);
-        vkQueueSubmit(ctx->graphicsQueue, 1, &submitInfo, fence);
+        queue_submit(ctx, ctx->graphicsQueue, submitInfo, fence);
         vkWaitForFences(ctx->logicalDevice, 1, &fence, VK_TRUE, UINT32_MAX);
         vkDestroyFence(ctx->logicalDevice, fence, nullptr);
     } else {
-        vkQueueSubmit(ctx->graphicsQueue, 1, &submitInfo, nullptr);
+        queue_submit(ctx, ctx->graphicsQueue, submitInfo, nullptr);
     }
 
 }
@@ -226,7 +389,7 @@ create_buffer(fd::RenderContext *ctx, VkBuffer &buffer, VkBufferUsageFlags usage
 inline void
 create_image(fd::RenderContext *ctx, VkImage &image, uint32_t width, uint32_t height, VkDeviceMemory &imageMemory,
              VkFormat format,
-             VkImageUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags) {
+             VkImageUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, uint32_t arrayLayers = 1) {
     VkImageCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -234,7 +397,7 @@ create_image(fd::RenderContext *ctx, VkImage &image, uint32_t width, uint32_t he
     createInfo.usage = usageFlags;
     createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    createInfo.arrayLayers = 1;
+    createInfo.arrayLayers = arrayLayers;
     createInfo.mipLevels = 1;
     createInfo.imageType = VK_IMAGE_TYPE_2D;
     createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -295,20 +458,37 @@ buffer_to_image(fd::RenderContext *ctx, VkCommandBuffer commandBuffer, VkBuffer
 
 inline void record_buffer_to_image(VkCommandBuffer commandBuffer, VkBuffer &srcBuffer, VkImage dstImage,
                                    uint32_t width, uint32_t height, VkImageAspectFlags aspectFlags,
-                                   VkImageLayout dstLayout) {
+                                   VkImageLayout dstLayout, VkDeviceSize bufferOffset = 0, uint32_t dstLayer = 0) {
     VkBufferImageCopy bufferImageCopy{};
     bufferImageCopy.imageExtent = {width, height, 1};
-    bufferImageCopy.bufferOffset = 0;
+    bufferImageCopy.bufferOffset = bufferOffset;
     bufferImageCopy.imageOffset = {0, 0};
     bufferImageCopy.bufferImageHeight = 0;
     bufferImageCopy.bufferRowLength = 0;
     bufferImageCopy.imageSubresource.layerCount = 1;
-    bufferImageCopy.imageSubresource.baseArrayLayer = 0;
+    bufferImageCopy.imageSubresource.baseArrayLayer = dstLayer;
     bufferImageCopy.imageSubresource.aspectMask = aspectFlags;
     bufferImageCopy.imageSubresource.mipLevel = 0;
     vkCmdCopyBufferToImage(commandBuffer, srcBuffer, dstImage, dstLayout, 1, &bufferImageCopy);
 }
 
+inline void record_image_to_buffer(VkCommandBuffer commandBuffer, VkImage srcImage, VkBuffer &dstBuffer,
+                                   uint32_t width, uint32_t height, VkImageAspectFlags aspectFlags,
+                                   VkDeviceSize bufferOffset = 0, uint32_t srcLayer = 0) {
+    VkBufferImageCopy bufferImageCopy{};
+    bufferImageCopy.imageExtent = {width, height, 1};
+    bufferImageCopy.bufferOffset = bufferOffset;
+    bufferImageCopy.imageOffset = {0, 0};
+    bufferImageCopy.bufferImageHeight = 0;
+    bufferImageCopy.bufferRowLength = 0;
+    bufferImageCopy.imageSubresource.layerCount = 1;
+    bufferImageCopy.imageSubresource.baseArrayLayer = srcLayer;
+    bufferImageCopy.imageSubresource.aspectMask = aspectFlags;
+    bufferImageCopy.imageSubresource.mipLevel = 0;
+    vkCmdCopyImageToBuffer(commandBuffer, srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstBuffer, 1,
+                           &bufferImageCopy);
+}
+
 inline void
 transition_image_layout(fd::RenderContext *ctx, VkCommandBuffer commandBuffer, VkImage image,
                         VkImageAspectFlags aspectFlags, VkImageLayout oldLayout,
@@ -372,14 +552,14 @@ image_to_image(fd::RenderContext *ctx, VkCommandBuffer commandBuffer, VkImage &s
 
 inline void record_image_to_image(VkCommandBuffer commandBuffer, VkImage &srcImage, VkImage &dstImage,
                                   uint32_t width,
-                                  uint32_t height) {
+                                  uint32_t height, uint32_t srcLayer = 0) {
     VkImageCopy region{};
     region.srcOffset = {0, 0};
     region.dstOffset = {0, 0};
     region.extent = {width, height, 1};
     region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     region.srcSubresource.layerCount = 1;
-    region.srcSubresource.baseArrayLayer = 0;
+    region.srcSubresource.baseArrayLayer = srcLayer;
     region.srcSubresource.mipLevel = 0;
     region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     region.dstSubresource.layerCount = 1;
@@ -395,12 +575,13 @@ inline void record_transition_image(VkCommandBuffer commandBuffer, VkImage image
                                     VkImageLayout newLayout, VkAccessFlags srcAccess, VkPipelineStageFlags srcStage,
                                     VkAccessFlags dstAccess, VkPipelineStageFlags dstStage,
                                     uint32_t srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                                    uint32_t dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED) {
+                                    uint32_t dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                    uint32_t layerCount = 1) {
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.image = image;
     barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
+    barrier.subresourceRange.layerCount = layerCount;
     barrier.subresourceRange.levelCount = 1;
     barrier.subresourceRange.baseMipLevel = 0;
     barrier.subresourceRange.aspectMask = aspectFlags;
@@ -416,6 +597,51 @@ inline void record_transition_image(VkCommandBuffer commandBuffer, VkImage image
                          1, &barrier);
 }
 
+// Release half of a queue family ownership transfer, the matching acquire goes in the next queue's command buffer
+// after a semaphore. Within one family the whole transition is recorded here and the acquire records nothing.
+inline void record_release_image(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspectFlags,
+                                 VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess,
+                                 VkPipelineStageFlags srcStage, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage,
+                                 uint32_t srcQueueFamilyIndex, uint32_t dstQueueFamilyIndex, uint32_t layerCount = 1) {
+    if (srcQueueFamilyIndex == dstQueueFamilyIndex) {
+        record_transition_image(commandBuffer, image, aspectFlags, oldLayout, newLayout, srcAccess, srcStage,
+                                dstAccess, dstStage, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, layerCount);
+        return;
+    }
+    record_transition_image(commandBuffer, image, aspectFlags, oldLayout, newLayout, srcAccess, srcStage,
+                            0, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, srcQueueFamilyIndex, dstQueueFamilyIndex,
+                            layerCount);
+}
+
+// Takes the same layouts and families as the release it pairs with.
+inline void record_acquire_image(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspectFlags,
+                                 VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags dstAccess,
+                                 VkPipelineStageFlags dstStage, uint32_t srcQueueFamilyIndex,
+                                 uint32_t dstQueueFamilyIndex, uint32_t layerCount = 1) {
+    if (srcQueueFamilyIndex == dstQueueFamilyIndex) return;
+    record_transition_image(commandBuffer, image, aspectFlags, oldLayout, newLayout, 0,
+                            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstAccess, dstStage, srcQueueFamilyIndex,
+                            dstQueueFamilyIndex, layerCount);
+}
+
+inline void record_buffer_barrier(VkCommandBuffer commandBuffer, VkBuffer buffer, VkAccessFlags srcAccess,
+                                  VkPipelineStageFlags srcStage, VkAccessFlags dstAccess,
+                                  VkPipelineStageFlags dstStage) {
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0,
+                         0, nullptr,
+                         1, &barrier,
+                         0, nullptr);
+}
+
 inline void create_sampler(VkDevice logicalDevice, VkSampler &sampler) {
     VkSamplerCreateInfo samplerCreateInfo{};
     samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -7,11 +7,21 @@
 
 #include <vulkan/vulkan.h>
 #include <vector>
+#include <chrono>
 #include <condition_variable>
+#include <future>
 #include <optional>
+#include <string>
 #include "FrameHandler.h"
 #include "FrameGeneratorTwo.h"
+#include "PresentScheduler.h"
+#include "GpuFrameCache.h"
+#include "FrameEncoder.h"
+#include "ReadbackRing.h"
+#include "ThumbnailBatch.h"
+#include "VulkanHwDecode.h"
 #include "computes/VulkanYuvToRgba.h"
+#include "computes/BatchedYuvRgba.h"
 #include "computes/VulkanFilterR8Image.h"
 
 namespace fd {
@@ -23,14 +33,65 @@ namespace fd {
         RenderContext *get_context() { return m_ctx; }
 
         void init();
-        FrameGeneratorTwo* m_fmGenerator = nullptr;
         std::condition_variable m_cv_graphics;
         std::mutex _mutex;
-        ComputeYuvRgba* m_computeYuvRgba = nullptr;
+
+#pragma region STREAMS
+        // Everything one video needs, the device, pipelines and descriptor layouts are shared by every stream.
+        struct VideoStream {
+            uint32_t id{};
+            std::string path{};
+            FrameGeneratorTwo *generator = nullptr;
+            uint32_t width{};
+            uint32_t height{};
+            // Size of the image the stream is drawn from, its cell's size when the converter scales it.
+            uint32_t frameWidth{};
+            uint32_t frameHeight{};
+            // Null for streams converted by the batch.
+            ComputeYuvRgba *compute = nullptr;
+            FrameHandler *frameHandler = nullptr;
+            GpuFrameCache *frameCache = nullptr;
+            VkRect2D cell{};
+            // Render fence of the last frame that drew the stream, uploaded or repeated. The next upload waits on it,
+            // which serializes uploading frames with the frame before them.
+            VkFence uploadFence{};
+            bool uploadedThisFrame = false;
+            // The frame handler submitted its own copy and signals its semaphore.
+            bool handlerSubmitted = false;
+            // Layer in the batched converter, -1 when the stream converts on its own.
+            int32_t batchLayer = -1;
+            bool batchStaged = false;
+            VkImage batchCacheImage{};
+            bool hasShownFrame = false;
+            double repeatWait = 0.0;
+            double pendingPts = 0.0;
+            uint64_t droppedFrames = 0;
+            uint64_t repeatedFrames = 0;
+        };
+
+        std::vector<VideoStream> m_streams{};
+        BatchedYuvRgba *m_batch = nullptr;
+        // Render fence of the last frame that copied out of the batch.
+        VkFence m_batch_fence{};
+        bool m_batch_submitted = false;
+
+        static std::vector<std::string> parse_stream_paths(const char *paths);
+
+        // Creates the streams and opens their files on worker threads, the returned futures finish with the probes.
+        std::vector<std::future<void>> start_stream_probes();
+
+        void create_streams(std::vector<std::future<void>> &probes);
+
+        void create_batch(const KernelConfigs &kernelConfigs);
+
+        void layout_grid();
+
+#pragma endregion
 
 
 #pragma region INSTANCE_AND_VALIDATION
         VkInstance m_instance{};
+        std::vector<const char *> m_instance_extensions{};
 
         void create_instance();
 
@@ -49,6 +110,12 @@ namespace fd {
             std::optional<uint32_t> graphicsIndex{};
             std::optional<uint32_t> presentationIndex{};
             std::optional<uint32_t> computeIndex {};
+            std::optional<uint32_t> transferIndex{};
+            // Queue within the family, roles that share a family get queues of their own while the family has them.
+            uint32_t computeQueue = 0;
+            uint32_t transferQueue = 0;
+            // Only set when hardware decode was requested and the device has a video decode queue.
+            std::optional<uint32_t> decodeIndex{};
 
             bool is_valid() {
                 return (graphicsIndex.has_value() && presentationIndex.has_value());
@@ -59,6 +126,13 @@ namespace fd {
         VkQueue m_graphics_queue{};
         VkQueue m_presentation_queue{};
         VkQueue m_compute_queue{};
+        VkQueue m_transfer_queue{};
+        VkCommandPool m_compute_command_pool{};
+        PresentTimingMode m_present_timing_mode = PresentTimingMode::SLEEP_SPIN;
+        PresentTimingFeatures m_present_timing_features{};
+        HwDecodeFeatures m_hw_decode_features{};
+        std::vector<const char *> m_device_extensions{};
+        VulkanHwDecode *m_hw_decode = nullptr;
 
         void get_physical_device_and_create_logical_device();
 
@@ -66,10 +140,20 @@ namespace fd {
 
         bool is_device_suitable(VkPhysicalDevice &device);
 
+        // The first family with every required flag and none of the excluded ones.
+        static std::optional<uint32_t> find_queue_family(const std::vector<VkQueueFamilyProperties> &properties,
+                                                         VkQueueFlags required, VkQueueFlags excluded);
+
         void create_logical_device(VkPhysicalDevice &device);
 
 #pragma endregion
 #pragma region SWAPCHAIN
+        enum class LatencyMode {
+            LOW_LATENCY,
+            VSYNC,
+            UNTHROTTLED
+        };
+
         VkSwapchainKHR m_swap_chain{};
         std::vector<VkImage> m_images{};
         std::vector<VkImageView> m_image_views{};
@@ -77,11 +161,16 @@ namespace fd {
         VkSurfaceFormatKHR m_format{};
         VkPresentModeKHR m_present_mode{};
         uint32_t m_image_count;
+        LatencyMode m_latency_mode = LatencyMode::LOW_LATENCY;
+
+        static LatencyMode parse_latency_mode(const char *name);
 
         VkSurfaceFormatKHR select_format();
 
         VkPresentModeKHR select_present_mode();
 
+        uint32_t select_image_count() const;
+
         void create_swapchain();
 
 #pragma endregion
@@ -97,14 +186,35 @@ namespace fd {
 
         void create_pipeline();
 
+#pragma endregion
+#pragma region PIPELINE_CACHE
+        VkPipelineCache m_pipeline_cache{};
+        std::string m_pipeline_cache_path{};
+        bool m_pipeline_cache_warm = false;
+
+        void create_pipeline_cache();
+
+        void save_pipeline_cache();
+
 #pragma endregion
 #pragma region RENDER
+        // One slot per swapchain image for the command buffer and the sync objects only. The streams' staging buffers,
+        // converted and presented images are single buffered, so a frame that uploads still waits for the previous
+        // one to finish, only frames where every stream repeats are recorded while the last one is on the GPU.
+        struct FrameSlot {
+            VkCommandBuffer commandBuffer{};
+            VkFence renderFence{};
+            VkSemaphore getImageSemaphore{};
+        };
+
         uint32_t m_curr_image{};
+        uint32_t m_curr_frame{};
+        std::vector<FrameSlot> m_frames{};
+        std::vector<VkSemaphore> m_render_image_semaphores{};
+        std::vector<VkFence> m_image_fences{};
         VkCommandBuffer m_command_buffer{};
         VkCommandPool m_command_pool{};
-        VkFence m_render_fence{};
-        VkSemaphore m_get_image_semaphore{};
-        VkSemaphore m_render_image_semaphore{};
+        uint32_t m_draw_profile_scope = UINT32_MAX;
         VkBuffer quadVertBuffer{};
         VkBuffer quadVertBufferStaging{};
         VkDeviceMemory vertBufferMemory{};
@@ -122,12 +232,72 @@ namespace fd {
 
         void begin_frame();
 
-        void draw();
+        void begin_render_pass();
+
+        // Null entries are repeats. Streams outside the batch submit their own conversion and copy, batched streams
+        // are staged and converted together once every stream has been visited.
+        void upload_frames(std::vector<VideoFrame *> &videoFrames);
+
+        void upload(VideoStream &stream, VideoFrame &videoFrame);
+
+        // Draws the stream's current image into its grid cell.
+        void draw(VideoStream &stream);
 
         void end_frame();
 
         void yuv_to_rgba(uint32_t width, uint32_t height, const uint8_t* yPlane, const uint8_t* vPlane, const uint8_t* uPlane, uint32_t* rgbaOut);
 
+#pragma endregion
+#pragma region STARTUP
+        std::chrono::time_point<std::chrono::steady_clock> m_startup_start{};
+        // Since the start of init, the device, swapchain and pipelines exist.
+        double m_device_ready_ms = 0.0;
+        // Time init spent waiting on the probes once the device was ready.
+        double m_probe_wait_ms = 0.0;
+        double m_time_to_first_frame_ms = 0.0;
+        bool m_first_frame_shown = false;
+
+        void log_time_to_first_frame();
+
+#pragma endregion
+#pragma region ENCODE
+        // Only set while transcoding, the first stream is then shown frame by frame as fast as it decodes and every
+        // shown frame is encoded.
+        FrameEncoder *m_encoder = nullptr;
+
+        void create_encoder();
+
+        // Runs once the first stream has shown its last frame, then closes the window.
+        void finish_encoding();
+
+        // FD_FRAME_CHECKSUMS logs a hash of every shown frame of the first stream, to compare runs. Readbacks that
+        // find the ring full are dropped rather than stalling playback.
+        ReadbackRing *m_checksums = nullptr;
+        uint64_t m_checksum_frames = 0;
+
+        void create_checksums();
+
+#pragma endregion
+#pragma region THUMBNAILS
+
+        // FD_THUMBNAILS replaces playback, the contact sheets are written and the window closes.
+        void run_thumbnails(const char *listPath);
+
+#pragma endregion
+#pragma region AV_SYNC
+        enum class FrameAction {
+            SHOW,
+            REPEAT
+        };
+
+        PresentScheduler m_present_scheduler{};
+        PresentScheduler::Clock::time_point m_present_target{};
+
+        FrameAction next_frame_for_clock(VideoStream &stream, VideoFrame &videoFrame);
+
+        // Presents follow the first stream, the others are sampled against their own clocks at that instant.
+        void schedule_present(VideoStream &stream, VideoFrame *videoFrame);
+
 #pragma endregion
     public:
         explicit VulkanGraphics(GLFWwindow *window);
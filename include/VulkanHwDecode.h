@@ -0,0 +1,69 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_VULKANHWDECODE_H
+#define REALTIMEFRAMEDISPLAY_VULKANHWDECODE_H
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+#include "libavutil/hwcontext.h"
+};
+
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "Util.h"
+
+namespace fd {
+    // Device features FFmpeg's Vulkan decoder needs, chained into VkDeviceCreateInfo when hardware decode is used.
+    struct HwDecodeFeatures {
+        VkPhysicalDeviceFeatures2 features2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+        VkPhysicalDeviceVulkan11Features vulkan11{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES};
+        VkPhysicalDeviceVulkan12Features vulkan12{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+        VkPhysicalDeviceVulkan13Features vulkan13{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES};
+    };
+
+    // An FFmpeg Vulkan device built on our own instance, device and queues, so decoded frames are images the compute
+    // pass can read directly. Enabled with FD_HW_DECODE=vulkan, without a video decode queue, the extensions or the
+    // codec's hwaccel every stream decodes in software as before.
+    class VulkanHwDecode {
+    private:
+        RenderContext *m_ctx = nullptr;
+        uint32_t m_decode_family = 0;
+        AVBufferRef *m_device_ref = nullptr;
+        // FFmpeg keeps the extension lists it was handed for the lifetime of the device.
+        std::vector<const char *> m_instance_extensions{};
+        std::vector<const char *> m_device_extensions{};
+
+        // Our queues are shared with the decoder, only its own decode queue goes without our lock.
+        static void lock_queue(AVHWDeviceContext *deviceContext, uint32_t queueFamily, uint32_t index);
+
+        static void unlock_queue(AVHWDeviceContext *deviceContext, uint32_t queueFamily, uint32_t index);
+
+        static AVPixelFormat get_format(AVCodecContext *codecContext, const AVPixelFormat *formats);
+
+        static bool create_frames_context(AVCodecContext *codecContext);
+
+    public:
+        static bool is_requested();
+
+        // FFmpeg needs a 1.3 instance, the player asks for 1.1 unless hardware decode was requested.
+        static uint32_t instance_api_version();
+
+        // Adds the video decode extensions and fills the features to chain, false when the device can't decode.
+        static bool select_device_extensions(VkPhysicalDevice physicalDevice, std::vector<const char *> &extensions,
+                                             HwDecodeFeatures &features, uint32_t &decodeFamily);
+
+        bool init(RenderContext *ctx, VkInstance instance, const std::vector<const char *> &instanceExtensions,
+                  const std::vector<const char *> &deviceExtensions, const HwDecodeFeatures &features,
+                  uint32_t decodeFamily);
+
+        AVBufferRef *get_device() const { return m_device_ref; }
+
+        // Must be called before avcodec_open2. Codecs without a Vulkan hwaccel keep decoding in software.
+        static void attach(AVCodecContext *codecContext, AVBufferRef *device);
+
+        void clean_up();
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_VULKANHWDECODE_H
@@ -0,0 +1,59 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_ALSAAUDIOSINK_H
+#define REALTIMEFRAMEDISPLAY_ALSAAUDIOSINK_H
+
+#ifdef FD_HAVE_ALSA
+
+#include <string>
+#include <alsa/asoundlib.h>
+#include "audio/AudioSink.h"
+
+namespace fd {
+    // ALSA playback woken by period interrupts through snd_pcm_wait. The "default" device is routed through
+    // PulseAudio or PipeWire on desktop distributions, so this also covers Pulse without linking libpulse.
+    class AlsaAudioSink : public AudioSink {
+    private:
+        AudioFormat m_format{};
+        std::string m_device_name;
+        snd_pcm_t *m_pcm = nullptr;
+        snd_pcm_uframes_t m_buffer_frames = 0;
+
+        static constexpr unsigned int LATENCY_US = 200000;
+        static constexpr int WAIT_TIMEOUT_MS = 200;
+
+        bool recover(int error);
+
+    protected:
+        bool start_device() override;
+
+        void stop_device() override;
+
+        bool wait_for_device() override;
+
+        uint32_t writable_frames() override;
+
+        uint32_t write(const int16_t *samples, uint32_t frames) override;
+
+        uint32_t queued_frames() override;
+
+    public:
+        explicit AlsaAudioSink(std::string deviceName = "default");
+
+        ~AlsaAudioSink() override;
+
+        bool open(const AudioFormat &format) override;
+
+        void close() override;
+
+        uint32_t buffer_frames() const override { return static_cast<uint32_t>(m_buffer_frames); }
+
+        const AudioFormat &get_format() const override { return m_format; }
+
+        const char *name() const override { return "alsa"; }
+    };
+}
+#endif
+#endif //REALTIMEFRAMEDISPLAY_ALSAAUDIOSINK_H
@@ -0,0 +1,72 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_AUDIOCONVERTER_H
+#define REALTIMEFRAMEDISPLAY_AUDIOCONVERTER_H
+
+extern "C" {
+#include "libavutil/frame.h"
+#include "libavutil/samplefmt.h"
+};
+
+#include <vector>
+#include "audio/AudioSink.h"
+
+namespace fd {
+    // Rational rate converter, up / down is outputRate / inputRate reduced. Every channel shares one windowed sinc
+    // prototype split into m_up phases of m_taps coefficients, stored reversed so each output is one contiguous dot
+    // product over the input history.
+    class PolyphaseResampler {
+    private:
+        uint32_t m_up = 1;
+        uint32_t m_down = 1;
+        uint32_t m_taps = 0;
+        uint64_t m_time = 0;
+        std::vector<float> m_coefficients{};
+        std::vector<std::vector<float>> m_history{};
+
+    public:
+        void configure(uint32_t inputRate, uint32_t outputRate, uint32_t channels, uint32_t taps = 32);
+
+        bool is_passthrough() const { return m_up == m_down; }
+
+        uint32_t max_output_frames(uint32_t inputFrames) const;
+
+        // Returns the frames written to every channel of output, which must hold max_output_frames.
+        uint32_t process(const std::vector<std::vector<float>> &input, uint32_t frames,
+                         std::vector<std::vector<float>> &output);
+    };
+
+    // Turns decoded frames in any packed or planar u8/s16/s32/float/double layout into the interleaved s16 the sinks
+    // take: convert to planar float, remix the channels, resample to the sink rate, then interleave with saturation.
+    // All working buffers are owned by the converter and only grow, nothing is allocated per frame in steady state.
+    class AudioConverter {
+    private:
+        AudioFormat m_output{};
+        int m_input_rate = 0;
+        int m_input_channels = 0;
+        int m_input_format = AV_SAMPLE_FMT_NONE;
+        std::vector<float> m_remix_matrix{};
+        std::vector<std::vector<float>> m_planar{};
+        std::vector<std::vector<float>> m_remixed{};
+        std::vector<std::vector<float>> m_resampled{};
+        std::vector<int16_t> m_interleaved{};
+        PolyphaseResampler m_resampler{};
+
+        void configure(const AVFrame *frame);
+
+        void build_remix_matrix(const AVChannelLayout &layout);
+
+        bool to_planar_float(const AVFrame *frame);
+
+        void remix(uint32_t frames);
+
+    public:
+        explicit AudioConverter(const AudioFormat &output);
+
+        // The returned samples stay valid until the next call.
+        const int16_t *convert(const AVFrame *frame, uint32_t &framesOut);
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_AUDIOCONVERTER_H
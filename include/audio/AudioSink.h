@@ -0,0 +1,79 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_AUDIOSINK_H
+#define REALTIMEFRAMEDISPLAY_AUDIOSINK_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace fd {
+    class PcmRing;
+
+    // Interleaved signed 16 bit PCM, the only layout the sinks accept.
+    struct AudioFormat {
+        uint32_t sampleRate = 44100;
+        uint32_t channels = 2;
+
+        uint32_t bytes_per_frame() const { return channels * sizeof(int16_t); }
+    };
+
+    // Reports every device write with the frames still queued in the device afterwards.
+    using AudioWrittenCallback = std::function<void(uint32_t framesWritten, uint32_t framesQueued)>;
+
+    // Output device fed from a PcmRing. start runs a device thread that sleeps until the device asks for data, a
+    // WASAPI event, an ALSA period wake up or the null sink's timer, then moves as much of the ring as fits.
+    // open takes the preferred format, a device may settle on its own rate, get_format reports the one in use.
+    class AudioSink {
+    private:
+        std::thread m_device_thread{};
+        std::atomic<bool> m_running{false};
+        PcmRing *m_ring = nullptr;
+        AudioWrittenCallback m_on_written{};
+        uint64_t m_underruns = 0;
+
+        void device_loop();
+
+    protected:
+        virtual bool start_device() = 0;
+
+        virtual void stop_device() = 0;
+
+        // Returns false on a timeout so the loop can notice stop.
+        virtual bool wait_for_device() = 0;
+
+        virtual uint32_t writable_frames() = 0;
+
+        virtual uint32_t write(const int16_t *samples, uint32_t frames) = 0;
+
+        // Frames handed to the device that have not been played yet.
+        virtual uint32_t queued_frames() = 0;
+
+    public:
+        virtual ~AudioSink() = default;
+
+        virtual bool open(const AudioFormat &format) = 0;
+
+        void start(PcmRing *ring, AudioWrittenCallback onWritten);
+
+        void stop();
+
+        virtual void close() = 0;
+
+        virtual uint32_t buffer_frames() const = 0;
+
+        virtual const AudioFormat &get_format() const = 0;
+
+        virtual const char *name() const = 0;
+
+        uint64_t get_underruns() const { return m_underruns; }
+    };
+
+    // spec is "wasapi", "alsa", "null", "null:<speed>" or "wav:<path>", nullptr picks the platform device.
+    std::unique_ptr<AudioSink> create_audio_sink(const char *spec);
+}
+#endif //REALTIMEFRAMEDISPLAY_AUDIOSINK_H
@@ -0,0 +1,67 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_NULLAUDIOSINK_H
+#define REALTIMEFRAMEDISPLAY_NULLAUDIOSINK_H
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include "audio/AudioSink.h"
+
+namespace fd {
+    // Device-less sink that drains its buffer at the format rate times m_speed and wakes on a period timer, so the
+    // audio thread and the audio clock run exactly as they would against hardware. With a path the consumed PCM is
+    // also written as a WAV file.
+    class NullAudioSink : public AudioSink {
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        AudioFormat m_format{};
+        std::string m_wav_path{};
+        std::ofstream m_wav_stream{};
+        uint64_t m_wav_data_bytes = 0;
+        double m_speed = 1.0;
+        uint32_t m_buffer_frames = 0;
+        double m_queued = 0.0;
+        bool m_started = false;
+        Clock::time_point m_last_drain{};
+
+        static constexpr uint32_t BUFFER_MS = 100;
+        static constexpr uint32_t PERIOD_MS = 10;
+
+        void drain();
+
+        void write_wav_header();
+
+    protected:
+        bool start_device() override;
+
+        void stop_device() override;
+
+        bool wait_for_device() override;
+
+        uint32_t writable_frames() override;
+
+        uint32_t write(const int16_t *samples, uint32_t frames) override;
+
+        uint32_t queued_frames() override;
+
+    public:
+        explicit NullAudioSink(std::string wavPath = {}, double speed = 1.0);
+
+        ~NullAudioSink() override;
+
+        bool open(const AudioFormat &format) override;
+
+        void close() override;
+
+        uint32_t buffer_frames() const override { return m_buffer_frames; }
+
+        const AudioFormat &get_format() const override { return m_format; }
+
+        const char *name() const override { return m_wav_path.empty() ? "null" : "wav"; }
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_NULLAUDIOSINK_H
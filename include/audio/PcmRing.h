@@ -0,0 +1,56 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_PCMRING_H
+#define REALTIMEFRAMEDISPLAY_PCMRING_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace fd {
+    // Single producer single consumer ring of interleaved s16 frames between the decode thread and the device thread.
+    // Reads and writes are wait free, only a producer that finds the ring full sleeps until the consumer frees room.
+    class PcmRing {
+    private:
+        std::vector<int16_t> m_samples{};
+        uint32_t m_channels = 0;
+        uint32_t m_capacity = 0;
+        uint32_t m_mask = 0;
+        alignas(64) std::atomic<uint64_t> m_write_pos{0};
+        alignas(64) std::atomic<uint64_t> m_read_pos{0};
+        std::mutex m_space_mutex;
+        std::condition_variable m_space_cv;
+
+    public:
+        // capacityFrames is rounded up to a power of two.
+        PcmRing(uint32_t capacityFrames, uint32_t channels);
+
+        uint32_t capacity() const { return m_capacity; }
+
+        uint32_t channels() const { return m_channels; }
+
+        uint32_t readable_frames() const;
+
+        uint32_t writable_frames() const;
+
+        // Producer side, returns the frames copied which is less than frames when the ring is full.
+        uint32_t write(const int16_t *samples, uint32_t frames);
+
+        // Blocks until at least minFrames are free, the timeout bounds a wake up racing the consumer.
+        void wait_for_space(uint32_t minFrames, std::chrono::milliseconds timeout);
+
+        // Consumer side, the contiguous readable run at the read position, call twice to cover a wrap.
+        uint32_t peek(const int16_t *&samples, uint32_t maxFrames) const;
+
+        void consume(uint32_t frames);
+
+        // Drops everything queued, only valid while the consumer is stopped.
+        void clear();
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_PCMRING_H
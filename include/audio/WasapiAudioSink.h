@@ -0,0 +1,55 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_WASAPIAUDIOSINK_H
+#define REALTIMEFRAMEDISPLAY_WASAPIAUDIOSINK_H
+
+#ifdef _WIN32
+
+#include <Audioclient.h>
+#include "audio/AudioSink.h"
+
+namespace fd {
+    // Shared mode WASAPI output on the default render endpoint in event callback mode, the engine signals
+    // m_buffer_event every time it has consumed a period.
+    class WasapiAudioSink : public AudioSink {
+    private:
+        AudioFormat m_format{};
+        IAudioClient *m_audioClient = nullptr;
+        IAudioRenderClient *m_audio_render_client = nullptr;
+        HANDLE m_buffer_event = nullptr;
+        UINT32 bufferFrameCount = 0;
+        bool m_com_initialized = false;
+
+        static constexpr DWORD EVENT_TIMEOUT_MS = 200;
+
+    protected:
+        bool start_device() override;
+
+        void stop_device() override;
+
+        bool wait_for_device() override;
+
+        uint32_t writable_frames() override;
+
+        uint32_t write(const int16_t *samples, uint32_t frames) override;
+
+        uint32_t queued_frames() override;
+
+    public:
+        ~WasapiAudioSink() override;
+
+        bool open(const AudioFormat &format) override;
+
+        void close() override;
+
+        uint32_t buffer_frames() const override { return bufferFrameCount; }
+
+        const AudioFormat &get_format() const override { return m_format; }
+
+        const char *name() const override { return "wasapi"; }
+    };
+}
+#endif
+#endif //REALTIMEFRAMEDISPLAY_WASAPIAUDIOSINK_H
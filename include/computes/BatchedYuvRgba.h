@@ -0,0 +1,100 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_BATCHEDYUVRGBA_H
+#define REALTIMEFRAMEDISPLAY_BATCHEDYUVRGBA_H
+
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "Util.h"
+
+namespace fd {
+    // Converts the frames of several same resolution streams with one submit. Every stream owns a layer of the Y, U,
+    // V and RGBA array images, the planes staged for a tick are copied and converted by a single dispatch whose z
+    // workgroup is the layer. The Y filters of the per stream path are not run here.
+    class BatchedYuvRgba {
+    private:
+        RenderContext *m_ctx;
+        uint32_t m_width;
+        uint32_t m_height;
+        uint32_t m_layers;
+        KernelConfigs m_configs{};
+
+        VkBuffer m_y_plane_buffer{};
+        VkDeviceMemory m_y_plane_buffer_memory{};
+        VkBuffer m_u_plane_buffer{};
+        VkDeviceMemory m_u_plane_buffer_memory{};
+        VkBuffer m_v_plane_buffer{};
+        VkDeviceMemory m_v_plane_buffer_memory{};
+        void *m_y_data = nullptr;
+        void *m_u_data = nullptr;
+        void *m_v_data = nullptr;
+
+        VkImage m_y_image{};
+        VkImageView m_y_image_view{};
+        VkDeviceMemory m_y_image_memory{};
+        VkImage m_u_image{};
+        VkImageView m_u_image_view{};
+        VkDeviceMemory m_u_image_memory{};
+        VkImage m_v_image{};
+        VkImageView m_v_image_view{};
+        VkDeviceMemory m_v_image_memory{};
+        VkImage m_rgba_image{};
+        VkImageView m_rgba_image_view{};
+        VkDeviceMemory m_rgba_image_memory{};
+
+        VkPipeline m_pipeline{};
+        VkPipelineLayout m_pipeline_layout{};
+        VkDescriptorSetLayout m_des_layout{};
+        VkDescriptorPool m_des_pool{};
+        VkDescriptorSet m_des_set{};
+        VkSampler m_sampler{};
+
+        VkCommandPool m_command_pool{};
+        VkCommandBuffer m_command_buffer{};
+        VkSemaphore m_semaphore{};
+        std::vector<uint32_t> m_staged_layers{};
+        bool m_first_compute = true;
+
+        void prepare_buffers_and_images();
+
+        void setup_descriptors();
+
+        void create_pipeline();
+
+        void record_plane_barriers(VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess,
+                                   VkPipelineStageFlags srcStage, VkAccessFlags dstAccess,
+                                   VkPipelineStageFlags dstStage);
+
+    public:
+        BatchedYuvRgba(RenderContext *ctx, uint32_t width, uint32_t height, uint32_t layers,
+                       const KernelConfigs &configs = {});
+
+        // FD_BATCHED_YUV=1. The batch only converts, its streams lose the blur, the temporal denoise and the scene cut
+        // events, so it is never on by default.
+        static bool is_requested();
+
+        // Copies the planes into the layer's slice of the staging buffers, the layer is converted on the next compute.
+        void stage(uint32_t layer, const uint8_t *yPlane, const uint8_t *uPlane, const uint8_t *vPlane);
+
+        // One command buffer and one submit for every staged layer, signals the batch semaphore. Returns false and
+        // submits nothing when no layer was staged. The previous tick's readers must have finished.
+        bool compute();
+
+        // Queue family ownership of the RGBA layers for the graphics queue, nothing is recorded when the compute and
+        // graphics families match. The acquire goes before the copies out of the layers, the release after them.
+        void record_acquire(VkCommandBuffer commandBuffer);
+
+        void record_release(VkCommandBuffer commandBuffer);
+
+        VkImage &get_rgba_image() { return m_rgba_image; }
+
+        VkSemaphore &get_semaphore() { return m_semaphore; }
+
+        uint32_t get_layers() const { return m_layers; }
+
+        void clean_up();
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_BATCHEDYUVRGBA_H
@@ -0,0 +1,68 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_KERNELAUTOTUNER_H
+#define REALTIMEFRAMEDISPLAY_KERNELAUTOTUNER_H
+
+#include <functional>
+#include <istream>
+#include <string>
+#include "Util.h"
+
+namespace fd {
+    // Times the workgroup shapes of the blur and the conversion once per device and resolution and caches the fastest.
+    // Radius is a quality setting and is never tuned, the candidates keep the radius of the defaults. Neither is the
+    // temporal kernel, its workgroup is the motion block and changes the output.
+    class KernelAutotuner {
+    private:
+        RenderContext *m_ctx;
+        uint32_t m_width;
+        uint32_t m_height;
+        const char *m_cache_path;
+        std::string m_device_key{};
+
+        VkCommandBuffer m_commandBuffer{};
+        VkFence m_fence{};
+        VkQueryPool m_query_pool{};
+        float m_timestamp_period = 0.0f;
+        bool m_has_timestamps = false;
+
+        VkImage m_scratch_image{};
+        VkDeviceMemory m_scratch_image_memory{};
+
+        static constexpr int WARMUP_RUNS = 2;
+        static constexpr int TIMED_RUNS = 8;
+
+        void create_timing_resources();
+
+        void destroy_timing_resources();
+
+        std::vector<KernelConfig> candidates(const KernelConfig &base);
+
+        bool is_supported(const KernelConfig &config);
+
+        double submit_and_wait(const std::function<void(VkCommandBuffer)> &record);
+
+        double time_recording(const std::function<void(VkCommandBuffer)> &record);
+
+        KernelConfig tune_kernel(const char *name, const KernelConfig &base,
+                                 const std::function<double(const KernelConfig &)> &timeVariant);
+
+        bool load_cache(KernelConfigs &configs);
+
+        void save_cache(const KernelConfigs &configs);
+
+    public:
+        KernelAutotuner(RenderContext *ctx, uint32_t width, uint32_t height,
+                        const char *cachePath = "kernel_autotune.cache");
+
+        KernelConfigs tune(const KernelConfigs &defaults = {});
+
+        // Reads the entries of one device and size into configs, false unless a blur of the configured radius and a
+        // conversion were found. Entries the device does not accept are dropped as if they were missing.
+        static bool parse_cache(std::istream &input, const std::string &deviceKey, uint32_t width, uint32_t height,
+                                const std::function<bool(const KernelConfig &)> &isSupported, KernelConfigs &configs);
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_KERNELAUTOTUNER_H
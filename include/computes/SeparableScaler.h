@@ -0,0 +1,95 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_SEPARABLESCALER_H
+#define REALTIMEFRAMEDISPLAY_SEPARABLESCALER_H
+
+#include <vulkan/vulkan.h>
+#include "Util.h"
+
+namespace fd {
+    enum class ScaleFilter : int32_t {
+        BILINEAR = 0,
+        BICUBIC = 1,
+        LANCZOS = 2
+    };
+
+    // Where the scale runs in a stream's luma chain. Early scales the uploaded plane so the filters and the conversion
+    // run at display resolution, late runs the filters at the native resolution and scales only what is presented.
+    enum class ScaleStage {
+        EARLY,
+        LATE
+    };
+
+    // Resamples an R8 image to another size in two separable compute passes, rows into an R32F intermediate and then
+    // columns into the output. Minification widens the kernel over the source so nothing aliases the way the
+    // presenting sampler's four taps do.
+    class SeparableScaler {
+    private:
+        // Matches the push constants of separableScale.comp.
+        struct ScaleInfo {
+            int32_t srcSize[2];
+            int32_t dstSize[2];
+            int32_t vertical;
+            int32_t filterType;
+        };
+
+        RenderContext *m_ctx;
+        uint32_t m_src_width;
+        uint32_t m_src_height;
+        uint32_t m_dst_width;
+        uint32_t m_dst_height;
+        ScaleFilter m_filter;
+        KernelConfig m_config{};
+
+        VkImage m_mid_image{};
+        VkImageView m_mid_image_view{};
+        VkDeviceMemory m_mid_image_memory{};
+        VkImage m_output_image{};
+        VkImageView m_output_image_view{};
+        VkDeviceMemory m_output_image_memory{};
+        VkSampler m_src_sampler{};
+
+        VkPipeline m_pipeline{};
+        VkPipelineLayout m_pipeline_layout{};
+        VkDescriptorSetLayout m_des_layout{};
+        VkDescriptorPool m_des_pool{};
+        VkDescriptorSet m_des_set{};
+
+        void prepare_images();
+
+        void setup_descriptors(VkImageView srcImageView);
+
+        void create_pipeline();
+
+    public:
+        // The source view is read in SHADER_READ_ONLY_OPTIMAL, the output is created at the destination size with the
+        // transfer usages the R8 filters copy through.
+        SeparableScaler(RenderContext *ctx, VkImageView srcImageView, uint32_t srcWidth, uint32_t srcHeight,
+                        uint32_t dstWidth, uint32_t dstHeight, ScaleFilter filter,
+                        const KernelConfig &config = KernelConfigs{}.yuvRgba);
+
+        // False when the scale kernel is not in the shader bundle.
+        static bool is_available();
+
+        // FD_SCALER picks bilinear, bicubic or lanczos, the default. False when it is off.
+        static bool filter_from_env(ScaleFilter &filter);
+
+        // FD_SCALER_STAGE forces early or late, otherwise the cheaper stage for these sizes.
+        static ScaleStage choose_stage(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight);
+
+        static const char *filter_name(ScaleFilter filter);
+
+        // Records both passes, the output's previous contents are discarded and it is left in the given layout.
+        void record(VkCommandBuffer commandBuffer, VkImageLayout layout, VkAccessFlags dstAccess,
+                    VkPipelineStageFlags dstStage);
+
+        VkImage &get_output_image() { return m_output_image; }
+
+        VkImageView get_output_image_view() const { return m_output_image_view; }
+
+        void clean_up();
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_SEPARABLESCALER_H
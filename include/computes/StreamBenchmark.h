@@ -0,0 +1,50 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_STREAMBENCHMARK_H
+#define REALTIMEFRAMEDISPLAY_STREAMBENCHMARK_H
+
+#include <vector>
+#include "Util.h"
+
+namespace fd {
+    struct StreamBenchmarkResult {
+        uint32_t streams;
+        double msPerTick;
+        // Negative when batching is off or unavailable, or a single stream was timed.
+        double batchedMsPerTick;
+    };
+
+    // Measures how many streams of one resolution the device converts and uploads within a frame budget. A tick is
+    // what the player does per stream and per present, conversion on the compute queue and the copy into the sampled
+    // image on the graphics queue, timed on the host since the work spans both queues.
+    class StreamBenchmark {
+    private:
+        RenderContext *m_ctx;
+        uint32_t m_width;
+        uint32_t m_height;
+        KernelConfigs m_configs;
+
+        VkCommandBuffer m_commandBuffer{};
+        VkFence m_fence{};
+
+        static constexpr int WARMUP_TICKS = 4;
+        static constexpr int TIMED_TICKS = 32;
+
+        double time_streams(uint32_t streams);
+
+        // The same tick through the batched converter, one compute submit for every stream.
+        double time_batched(uint32_t streams);
+
+    public:
+        StreamBenchmark(RenderContext *ctx, uint32_t width, uint32_t height, const KernelConfigs &configs);
+
+        // Doubles the stream count up to maxStreams, logs every step and the largest count within frameBudgetMs.
+        std::vector<StreamBenchmarkResult> run(uint32_t maxStreams, double frameBudgetMs);
+
+        // Stream limit from FD_STREAM_BENCHMARK, 0 when unset and the benchmark is skipped.
+        static uint32_t max_streams_from_env();
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_STREAMBENCHMARK_H
@@ -5,16 +5,18 @@
 #ifndef REALTIMEFRAMEDISPLAY_TEMPORALHISTORYTWOIMG_H
 #define REALTIMEFRAMEDISPLAY_TEMPORALHISTORYTWOIMG_H
 
+#include <mutex>
 #include "Util.h"
 
 namespace fd {
     class TemporalHistoryTwoImg {
     private:
         RenderContext *m_ctx;
-        const char *m_shader_path;
+        const char *m_shader_name;
         uint32_t m_width;
         uint32_t m_height;
-        static uint32_t m_frame_count;
+        KernelConfig m_config{};
+        uint32_t m_frame_count = 0;
         std::vector<VkImage> m_history{3, VK_NULL_HANDLE};
         VkImage m_img_one{};
         VkImageView m_img_one_view{};
@@ -32,6 +34,18 @@ namespace fd {
         uint32_t m_motion_vector_buffer_size;
         VkBuffer m_motion_vectors_buffer{};
         VkDeviceMemory m_motion_vectors_buffer_memory {};
+        VkBuffer m_block_sad_buffer{};
+        VkDeviceMemory m_block_sad_buffer_memory{};
+        VkBuffer m_scene_stats_buffer{};
+        VkDeviceMemory m_scene_stats_buffer_memory{};
+        SceneStats *m_scene_stats = nullptr;
+        // Signalled by the submission carrying compute(), the stats buffer is read and cleared only once it has.
+        VkFence m_stats_fence{};
+
+        float m_cut_mean_sad = 0.06f;
+        float m_cut_high_fraction = 0.6f;
+        std::mutex m_scene_cut_mutex;
+        std::vector<SceneCutEvent> m_scene_cuts{};
 
         VkPipeline m_pipeline{};
         VkPipelineLayout m_pipeline_layout{};
@@ -50,11 +64,27 @@ namespace fd {
 
         void create_pipeline();
 
+        void collect_scene_stats();
+
         bool isFirstRender = true;
     public:
-        TemporalHistoryTwoImg(RenderContext *ctx, const char *shaderPath, uint32_t width, uint32_t height);
+        TemporalHistoryTwoImg(RenderContext *ctx, const char *shaderName, uint32_t width, uint32_t height,
+                              const KernelConfig &config = KernelConfigs{}.temporal);
 
         void compute(VkCommandBuffer commandBuffer, VkImage &r8Image);
+
+        // The command buffer given to compute() must be submitted with this fence.
+        VkFence get_stats_fence() const { return m_stats_fence; }
+
+        // A frame is a cut when its mean block SAD and the fraction of blocks above the blend range both exceed these.
+        void set_scene_cut_thresholds(float meanSad, float highSadFraction) {
+            m_cut_mean_sad = meanSad;
+            m_cut_high_fraction = highSadFraction;
+        }
+
+        // Returns the cuts detected since the last call.
+        std::vector<SceneCutEvent> take_scene_cut_events();
+
         void clean_up();
     };
 }
@@ -0,0 +1,111 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_THUMBNAILATLAS_H
+#define REALTIMEFRAMEDISPLAY_THUMBNAILATLAS_H
+
+#include <array>
+#include <vulkan/vulkan.h>
+#include "Util.h"
+
+namespace fd {
+    // Downscales decoded frames into the tiles of one RGBA atlas on the compute queue. The yuv420p planes of a submit
+    // are packed into a host visible buffer that the kernel reads directly, each output pixel averages a box of the
+    // source as a mip level would, and the picture is letterboxed into its tile. Submits alternate between two
+    // batches so the host fills one while the GPU runs the other.
+    class ThumbnailAtlas {
+    private:
+        // Matches the push constants of thumbnailDownscale.comp.
+        struct TileInfo {
+            int32_t srcSize[2];
+            int32_t tileOrigin[2];
+            int32_t tileSize[2];
+            int32_t pictureOrigin[2];
+            int32_t pictureSize[2];
+            uint32_t yOffset;
+            uint32_t uOffset;
+            uint32_t vOffset;
+            int32_t fullRange;
+        };
+
+        struct Batch {
+            VkBuffer planes{};
+            VkDeviceMemory memory{};
+            uint8_t *mapped = nullptr;
+            VkDeviceSize used = 0;
+            uint32_t tiles = 0;
+            VkDescriptorSet desSet{};
+            VkCommandBuffer commandBuffer{};
+            VkFence fence{};
+        };
+
+        static constexpr uint32_t BATCHES = 2;
+        // Fits the planes of one 8K frame, or a few dozen HD ones.
+        static constexpr VkDeviceSize PLANE_BYTES = 64ull << 20;
+
+        RenderContext *m_ctx;
+        uint32_t m_tile_width;
+        uint32_t m_tile_height;
+        uint32_t m_columns;
+        uint32_t m_rows;
+        KernelConfigs m_configs{};
+
+        VkImage m_atlas_image{};
+        VkImageView m_atlas_image_view{};
+        VkDeviceMemory m_atlas_image_memory{};
+
+        VkPipeline m_pipeline{};
+        VkPipelineLayout m_pipeline_layout{};
+        VkDescriptorSetLayout m_des_layout{};
+        VkDescriptorPool m_des_pool{};
+        VkCommandPool m_command_pool{};
+
+        std::array<Batch, BATCHES> m_batches{};
+        uint32_t m_batch = 0;
+
+        void prepare_images_and_batches();
+
+        void setup_descriptors();
+
+        void create_pipeline();
+
+    public:
+        ThumbnailAtlas(RenderContext *ctx, uint32_t tileWidth, uint32_t tileHeight, uint32_t columns, uint32_t rows,
+                       const KernelConfigs &configs = {});
+
+        // False when the downscale kernel is not in the shader bundle.
+        static bool is_available();
+
+        // Waits for the previous submit of the next batch and starts recording it. Readbacks tied to that submit's
+        // fence must be polled before submit_batch resets it.
+        VkCommandBuffer begin_batch();
+
+        // Blacks out the whole atlas before the first tile of a sheet.
+        void record_clear();
+
+        // Packs the planes into the batch and records the tile's dispatch. False when they do not fit what is left of
+        // the batch, planes that do not fit an empty batch never will.
+        bool add_tile(uint32_t tile, uint32_t width, uint32_t height, const uint8_t *const planes[3],
+                      const int strides[3], bool fullRange, double pixelAspect);
+
+        uint32_t batch_tiles() const { return m_batches[m_batch].tiles; }
+
+        // Submits the batch to the compute queue and returns the fence it signals.
+        VkFence submit_batch();
+
+        // Waits for both batches, only at the end of a run.
+        void wait_idle();
+
+        VkImage get_atlas_image() const { return m_atlas_image; }
+
+        uint32_t get_width() const { return m_tile_width * m_columns; }
+
+        uint32_t get_height() const { return m_tile_height * m_rows; }
+
+        uint32_t get_tile_count() const { return m_columns * m_rows; }
+
+        void clean_up();
+    };
+}
+#endif //REALTIMEFRAMEDISPLAY_THUMBNAILATLAS_H
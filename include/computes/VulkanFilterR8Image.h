@@ -14,7 +14,8 @@ namespace fd {
         RenderContext *m_ctx;
         uint32_t m_width;
         uint32_t m_height;
-        const char *m_compute_path{};
+        const char *m_compute_shader{};
+        KernelConfig m_config{};
         bool isFirstRender = true;
         VkImage m_image_in{};
         VkImageView m_image_view_in{};
@@ -41,7 +42,8 @@ namespace fd {
         void setup_descriptors();
 
     public:
-        VulkanFilterR8(RenderContext *ctx, const char *filterComputePath, uint32_t width, uint32_t height);
+        VulkanFilterR8(RenderContext *ctx, const char *filterComputePath, uint32_t width, uint32_t height,
+                       const KernelConfig &config = KernelConfigs{}.blur);
 
         void compute(VkCommandBuffer commandBuffer, VkImage &r8Image);
 
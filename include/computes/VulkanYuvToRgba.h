@@ -9,14 +9,20 @@
 #include "Util.h"
 #include "computes/VulkanFilterR8Image.h"
 #include "computes/TemporalHistoryTwoImg.h"
+#include "computes/SeparableScaler.h"
+#include "DirtyTiles.h"
 
 namespace fd {
     class ComputeYuvRgba {
     private:
-        const char *m_shader_path{};
+        const char *m_shader_name{};
         RenderContext *m_ctx = nullptr;
         uint32_t m_width;
         uint32_t m_height;
+        // Size of the converted image, the display size when the scaler runs and the source size otherwise.
+        uint32_t m_out_width;
+        uint32_t m_out_height;
+        KernelConfigs m_configs{};
         VkBuffer m_y_plane_buffer{};
         VkDeviceMemory m_y_plane_buffer_memory{};
         VkBuffer m_u_plane_buffer{};
@@ -35,8 +41,17 @@ namespace fd {
         VkImage m_rgba_image{};
         VkImageView m_rgba_image_view{};
         VkDeviceMemory m_rgba_image_memory{};
-
-
+        // Interleaved chroma of hardware decoded frames, the U and V views swizzle one channel each into red so the
+        // conversion kernel reads them like the planar images.
+        VkImage m_uv_image{};
+        VkImageView m_uv_image_view_u{};
+        VkImageView m_uv_image_view_v{};
+        VkDeviceMemory m_uv_image_memory{};
+        VkDescriptorSet m_des_set_hw{};
+        bool m_hw_input = false;
+
+        // Borrowed from another instance when constructed with a pipeline source, only the owner destroys them.
+        bool m_owns_pipeline = true;
         VkPipeline m_pipeline{};
         VkPipelineLayout m_pipeline_layout{};
         VkDescriptorSetLayout m_des_layout{};
@@ -51,41 +66,120 @@ namespace fd {
         VkCommandBuffer m_commandBuffer_dispatch{};
         VkCommandBuffer m_compute_command_buffer{};
         VkCommandPool m_compute_command_pool {};
+        // Allocated on the transfer family, the plane uploads run there.
+        VkCommandPool m_upload_command_pool{};
+        VkCommandBuffer m_upload_command_buffer{};
 
         VkSemaphore m_compute_semaphore{};
         VkSemaphore m_filter_semaphore{};
+        VkSemaphore m_upload_semaphore{};
 
         void *yData;
         void *uData;
         void *vData;
-        bool firstRender = true;
 
         VulkanFilterR8* m_blur = nullptr;
         TemporalHistoryTwoImg* m_temp = nullptr;
+        SeparableScaler *m_scaler = nullptr;
+        ScaleStage m_scale_stage = ScaleStage::EARLY;
+        ScaleFilter m_scale_filter = ScaleFilter::LANCZOS;
+
+        // Tile diff mode, the planes are uploaded on the compute queue and stay there so unchanged tiles keep what
+        // the images hold. The filters change Y in place, the uploaded tiles land in a mirror it is copied from.
+        DirtyTiles *m_tiles = nullptr;
+        bool m_tile_images_valid = false;
+        VkImage m_y_mirror_image{};
+        VkDeviceMemory m_y_mirror_image_memory{};
+        std::vector<VkRect2D> m_source_rects{};
+        std::vector<VkRect2D> m_converted_rects{};
+        bool m_converted_all = true;
+        VkBuffer m_tile_rect_buffer{};
+        VkDeviceMemory m_tile_rect_buffer_memory{};
+        uint32_t *m_tile_rects = nullptr;
+        VkBuffer m_indirect_buffer{};
+        VkDeviceMemory m_indirect_buffer_memory{};
+        VkDispatchIndirectCommand *m_indirect = nullptr;
+        VkPipeline m_tile_pipeline{};
+        VkPipelineLayout m_tile_pipeline_layout{};
+        VkDescriptorSetLayout m_tile_des_layout{};
+        VkDescriptorSet m_des_set_tiles{};
 
         void set_up_compute_command_buffer();
         void prepare_buffers_and_images();
 
         void create_pipeline();
 
+        void create_descriptor_layout();
+
         void setup_descriptors();
 
         void create_samplers();
 
+        // Created with the first hardware decoded frame, software streams never allocate them.
+        void prepare_hw_images();
+
+        void write_descriptor_set(VkDescriptorSet desSet, VkImageView uImageView, VkImageView vImageView);
+
         void dispatch();
 
         void invoke_r8_filters();
 
+        void choose_scale();
+
+        // Samples the uploaded Y and leaves the scaled one a transfer destination like the upload did.
+        void scale_luma();
+
+        void create_tile_pipeline();
+
+        void compute_tiles(uint8_t *yPlane, uint8_t *uPlane, uint8_t *vPlane);
+
+        // Maps the tiles to convert to the output and fills the rectangle list and the indirect dispatch.
+        void prepare_converted_tiles();
+
+        // The Y image the filters run on and the one the conversion reads.
+        VkImage &filter_image();
+
+        VkImage &luma_image();
+
 
     public:
-        ComputeYuvRgba(RenderContext *ctx, const char *shaderPath, uint32_t width, uint32_t height);
+        // Streams sharing a pipeline source reuse its pipeline and layouts, the group counts follow each instance's
+        // own resolution. The source has to outlive every instance built from it. An output size other than the source
+        // size scales the luma to it when FD_SCALER allows, get_out_width and get_out_height tell whether it did.
+        ComputeYuvRgba(RenderContext *ctx, const char *shaderName, uint32_t width, uint32_t height,
+                       const KernelConfigs &configs = {}, const ComputeYuvRgba *pipelineSource = nullptr,
+                       uint32_t outWidth = 0, uint32_t outHeight = 0);
 
         void compute(uint8_t *yPlane, uint8_t *uPlane, uint8_t *vPlane);
 
+        // Copies the planes of a frame the Vulkan decoder wrote on our device, nothing goes through the CPU. Waits on
+        // and advances the frame's timeline semaphores so the decoder reuses the image only once the copy is done.
+        void compute_hw(AVFrame *hwFrame);
+
+        // Uploads and converts only the tiles that changed since the last frame from here on, see DirtyTiles. Frames
+        // decoded on the GPU are never diffed.
+        void enable_tile_diff();
+
+        // The next frame goes through whole, the presented image no longer holds the last converted frame.
+        void reset_tile_diff();
+
+        // Output rectangles the last frame converted, null when it converted all of it.
+        const std::vector<VkRect2D> *get_converted_rects() const;
+
+        // Records only the conversion dispatch, the rgba image has to be in the general layout.
+        void record_dispatch(VkCommandBuffer commandBuffer);
+
         VkSemaphore &get_compute_semaphore() { return m_compute_semaphore; };
 
         VkImage &get_rgba_image() { return m_rgba_image; }
         VkImage &get_y_image() { return m_y_image; }
+
+        uint32_t get_out_width() const { return m_out_width; }
+
+        uint32_t get_out_height() const { return m_out_height; }
+
+        std::vector<SceneCutEvent> take_scene_cut_events() { return m_temp->take_scene_cut_events(); }
+
         void clean_up();
     };
 }
@@ -3,8 +3,10 @@
 #include "RenderWindow.h"
 
 int main() {
+    fd::init_logging();
     fd::RenderWindow *window = new fd::RenderWindow();
     window->render();
     delete window;
+    fd::shutdown_logging();
     return 0;
 }
@@ -1,5 +0,0 @@
-glslc D:\cProjects\realTimeFrameDisplay\shaders\default.frag -o D:\cProjects\realTimeFrameDisplay\shaders\default.frag.spv
-glslc D:\cProjects\realTimeFrameDisplay\shaders\default.vert -o D:\cProjects\realTimeFrameDisplay\shaders\default.vert.spv
-glslc D:\cProjects\realTimeFrameDisplay\shaders\yuvRgba.comp -o D:\cProjects\realTimeFrameDisplay\shaders\yuvRgba.comp.spv
-glslc D:\cProjects\realTimeFrameDisplay\shaders\gaussianBlurCompute.comp -o D:\cProjects\realTimeFrameDisplay\shaders\gaussianBlurCompute.comp.spv
-glslc D:\cProjects\realTimeFrameDisplay\shaders\temporalDiffTwoImg.comp -o D:\cProjects\realTimeFrameDisplay\shaders\temporalDiffTwoImg.comp.spv
\ No newline at end of file
@@ -0,0 +1,97 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <cmath>
+#include <vector>
+#include "TestHarness.h"
+#include "audio/AudioConverter.h"
+
+namespace {
+    constexpr double PI = 3.14159265358979323846;
+
+    // Feeds blocks of the signal through the resampler and returns every output frame of each channel.
+    std::vector<std::vector<float>> resample(fd::PolyphaseResampler &resampler, const std::vector<std::vector<float>> &signal,
+                                             uint32_t blockFrames) {
+        size_t channels = signal.size();
+        auto frames = static_cast<uint32_t>(signal[0].size());
+        std::vector<std::vector<float>> result(channels);
+        std::vector<std::vector<float>> block(channels);
+        std::vector<std::vector<float>> output(channels);
+        for (uint32_t start = 0; start < frames; start += blockFrames) {
+            uint32_t count = std::min(blockFrames, frames - start);
+            for (size_t channel = 0; channel < channels; channel++) {
+                block[channel].assign(signal[channel].begin() + start, signal[channel].begin() + start + count);
+                output[channel].resize(resampler.max_output_frames(count));
+            }
+            uint32_t produced = resampler.process(block, count, output);
+            FD_EXPECT(produced <= resampler.max_output_frames(count));
+            for (size_t channel = 0; channel < channels; channel++) {
+                result[channel].insert(result[channel].end(), output[channel].begin(),
+                                       output[channel].begin() + produced);
+            }
+        }
+        return result;
+    }
+
+    std::vector<float> tone(double frequency, uint32_t rate, uint32_t frames, float amplitude) {
+        std::vector<float> samples(frames);
+        for (uint32_t i = 0; i < frames; i++) {
+            samples[i] = amplitude * static_cast<float>(std::sin(2.0 * PI * frequency * i / rate));
+        }
+        return samples;
+    }
+
+    // Skips the filter's start up, where the history is still the zeros it was configured with.
+    double rms(const std::vector<float> &samples, size_t skip) {
+        double sum = 0.0;
+        for (size_t i = skip; i < samples.size(); i++) {
+            sum += static_cast<double>(samples[i]) * samples[i];
+        }
+        return std::sqrt(sum / static_cast<double>(samples.size() - skip));
+    }
+}
+
+FD_TEST(AudioConverter, PassesMatchingRatesThrough) {
+    fd::PolyphaseResampler resampler{};
+    resampler.configure(48000, 48000, 2);
+    FD_EXPECT(resampler.is_passthrough());
+    FD_EXPECT(resampler.max_output_frames(1024) == 1024);
+}
+
+FD_TEST(AudioConverter, ProducesTheRateRatioOfFrames) {
+    fd::PolyphaseResampler resampler{};
+    resampler.configure(44100, 48000, 1);
+    FD_EXPECT(!resampler.is_passthrough());
+    // One second in uneven blocks, the fractional position carries over between them.
+    std::vector<std::vector<float>> signal{std::vector<float>(44100, 0.0f)};
+    std::vector<std::vector<float>> output = resample(resampler, signal, 1000);
+    FD_EXPECT(std::abs(static_cast<int>(output[0].size()) - 48000) <= 1);
+}
+
+FD_TEST(AudioConverter, KeepsUnityGainAtDc) {
+    fd::PolyphaseResampler resampler{};
+    resampler.configure(48000, 44100, 1);
+    std::vector<std::vector<float>> signal{std::vector<float>(4800, 0.5f)};
+    std::vector<std::vector<float>> output = resample(resampler, signal, 480);
+    for (size_t i = 64; i < output[0].size(); i++) {
+        FD_EXPECT_NEAR(output[0][i], 0.5f, 0.01f);
+    }
+}
+
+FD_TEST(AudioConverter, KeepsAPassbandToneAndItsChannelsApart) {
+    fd::PolyphaseResampler resampler{};
+    resampler.configure(44100, 48000, 2);
+    std::vector<std::vector<float>> signal{tone(1000.0, 44100, 44100, 0.5f), std::vector<float>(44100, 0.0f)};
+    std::vector<std::vector<float>> output = resample(resampler, signal, 441);
+    FD_EXPECT_NEAR(rms(output[0], 64), 0.5 / std::sqrt(2.0), 0.01);
+    FD_EXPECT(rms(output[1], 0) == 0.0);
+}
+
+FD_TEST(AudioConverter, RejectsTonesAboveTheOutputNyquist) {
+    fd::PolyphaseResampler resampler{};
+    resampler.configure(48000, 8000, 1);
+    // 16 kHz folds onto 0 Hz at 8 kHz without the low pass.
+    std::vector<std::vector<float>> signal{tone(16000.0, 48000, 48000, 0.5f)};
+    std::vector<std::vector<float>> output = resample(resampler, signal, 480);
+    FD_EXPECT(rms(output[0], 64) < 0.01);
+}
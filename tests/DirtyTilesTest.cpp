@@ -0,0 +1,135 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <cstdint>
+#include <vector>
+#include "TestHarness.h"
+#include "DirtyTiles.h"
+
+namespace {
+    // A yuv420p frame and the staging planes it is uploaded from, FD_DIRTY_TILE_SAD is expected unset.
+    struct Planes {
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint8_t> frame[3];
+        std::vector<uint8_t> staging[3];
+
+        Planes(uint32_t w, uint32_t h) : width{w}, height{h} {
+            for (uint32_t plane = 0; plane < 3; plane++) {
+                size_t size = plane == 0 ? static_cast<size_t>(w) * h : static_cast<size_t>(w >> 1) * (h >> 1);
+                frame[plane].assign(size, static_cast<uint8_t>(16 + plane * 64));
+                staging[plane].assign(size, 0);
+            }
+        }
+
+        uint32_t update(fd::DirtyTiles &tiles) {
+            const uint8_t *planes[3] = {frame[0].data(), frame[1].data(), frame[2].data()};
+            uint8_t *stagings[3] = {staging[0].data(), staging[1].data(), staging[2].data()};
+            return tiles.update(planes, stagings);
+        }
+    };
+}
+
+FD_TEST(DirtyTiles, FirstFrameUploadsEveryPlaneWhole) {
+    Planes planes{256, 192};
+    fd::DirtyTiles tiles{256, 192};
+    FD_EXPECT(tiles.get_tile_count() == 12);
+    FD_EXPECT(planes.update(tiles) == 12);
+    for (uint32_t plane = 0; plane < 3; plane++) {
+        const std::vector<VkBufferImageCopy> &regions = tiles.get_regions(plane);
+        FD_EXPECT(regions.size() == 1);
+        FD_EXPECT(regions[0].bufferOffset == 0);
+        FD_EXPECT(regions[0].imageExtent.width == (plane == 0 ? 256u : 128u));
+        FD_EXPECT(regions[0].imageExtent.height == (plane == 0 ? 192u : 96u));
+        FD_EXPECT(planes.staging[plane] == planes.frame[plane]);
+    }
+    std::vector<VkRect2D> rects{};
+    FD_EXPECT(tiles.converted_tiles(rects));
+    FD_EXPECT(rects.size() == 12);
+}
+
+FD_TEST(DirtyTiles, UnchangedFrameUploadsNothing) {
+    Planes planes{256, 192};
+    fd::DirtyTiles tiles{256, 192};
+    planes.update(tiles);
+    FD_EXPECT(planes.update(tiles) == 0);
+    for (uint32_t plane = 0; plane < 3; plane++) {
+        FD_EXPECT(tiles.get_regions(plane).empty());
+    }
+    FD_EXPECT(tiles.saved_fraction() > 0.49 && tiles.saved_fraction() < 0.51);
+}
+
+FD_TEST(DirtyTiles, OneChangedPixelUploadsItsTile) {
+    Planes planes{256, 192};
+    fd::DirtyTiles tiles{256, 192};
+    planes.update(tiles);
+    // Luma pixel (130, 70) is in tile (2, 1).
+    planes.frame[0][70 * 256 + 130] = 235;
+    FD_EXPECT(planes.update(tiles) == 1);
+    const std::vector<VkBufferImageCopy> &luma = tiles.get_regions(0);
+    FD_EXPECT(luma.size() == 1);
+    FD_EXPECT(luma[0].bufferOffset == 64 * 256 + 128);
+    FD_EXPECT(luma[0].bufferRowLength == 256);
+    FD_EXPECT(luma[0].imageOffset.x == 128 && luma[0].imageOffset.y == 64);
+    FD_EXPECT(luma[0].imageExtent.width == 64 && luma[0].imageExtent.height == 64);
+    for (uint32_t plane = 1; plane < 3; plane++) {
+        const std::vector<VkBufferImageCopy> &chroma = tiles.get_regions(plane);
+        FD_EXPECT(chroma.size() == 1);
+        FD_EXPECT(chroma[0].bufferOffset == 32 * 128 + 64);
+        FD_EXPECT(chroma[0].imageExtent.width == 32 && chroma[0].imageExtent.height == 32);
+    }
+    FD_EXPECT(planes.staging[0][70 * 256 + 130] == 235);
+}
+
+FD_TEST(DirtyTiles, ConvertsChangedTilesAndNeighboursUntilSettled) {
+    Planes planes{256, 192};
+    fd::DirtyTiles tiles{256, 192};
+    std::vector<VkRect2D> rects{};
+    planes.update(tiles);
+    for (int i = 0; i < 4; i++) planes.update(tiles);
+    FD_EXPECT(!tiles.converted_tiles(rects));
+    FD_EXPECT(rects.empty());
+
+    planes.frame[1][0] = 0;
+    FD_EXPECT(planes.update(tiles) == 1);
+    FD_EXPECT(!tiles.converted_tiles(rects));
+    // Tile (0, 0) and the three tiles around it.
+    FD_EXPECT(rects.size() == 4);
+    for (const VkRect2D &rect: rects) {
+        FD_EXPECT(rect.offset.x <= 64 && rect.offset.y <= 64);
+        FD_EXPECT(rect.extent.width == 64 && rect.extent.height == 64);
+    }
+    for (int i = 0; i < 3; i++) planes.update(tiles);
+    FD_EXPECT(!tiles.converted_tiles(rects) && rects.size() == 4);
+    planes.update(tiles);
+    FD_EXPECT(!tiles.converted_tiles(rects) && rects.empty());
+}
+
+FD_TEST(DirtyTiles, ClipsTheEdgeTiles) {
+    Planes planes{100, 70};
+    fd::DirtyTiles tiles{100, 70};
+    FD_EXPECT(tiles.get_tile_count() == 4);
+    planes.update(tiles);
+    planes.frame[0][69 * 100 + 99] = 235;
+    FD_EXPECT(planes.update(tiles) == 1);
+    const std::vector<VkBufferImageCopy> &luma = tiles.get_regions(0);
+    FD_EXPECT(luma.size() == 1);
+    FD_EXPECT(luma[0].imageExtent.width == 36 && luma[0].imageExtent.height == 6);
+    const std::vector<VkBufferImageCopy> &chroma = tiles.get_regions(1);
+    FD_EXPECT(chroma.size() == 1);
+    FD_EXPECT(chroma[0].bufferOffset == 32 * 50 + 32);
+    FD_EXPECT(chroma[0].imageExtent.width == 18 && chroma[0].imageExtent.height == 3);
+    std::vector<VkRect2D> rects{};
+    tiles.converted_tiles(rects);
+    FD_EXPECT(rects.size() == 4);
+    FD_EXPECT(rects.back().extent.width == 36 && rects.back().extent.height == 6);
+}
+
+FD_TEST(DirtyTiles, ResetUploadsTheNextFrameWhole) {
+    Planes planes{256, 192};
+    fd::DirtyTiles tiles{256, 192};
+    planes.update(tiles);
+    tiles.reset();
+    FD_EXPECT(planes.update(tiles) == 12);
+    FD_EXPECT(tiles.get_regions(0).size() == 1);
+}
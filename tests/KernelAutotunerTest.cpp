@@ -0,0 +1,67 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <sstream>
+#include "TestHarness.h"
+#include "computes/KernelAutotuner.h"
+
+namespace {
+    const char *DEVICE = "10de:2684:2280000";
+
+    bool accept_all(const fd::KernelConfig &) { return true; }
+
+    bool same(const fd::KernelConfig &a, const fd::KernelConfig &b) {
+        return a.localSizeX == b.localSizeX && a.localSizeY == b.localSizeY && a.radius == b.radius;
+    }
+}
+
+FD_TEST(KernelAutotuner, ReadsTheEntriesOfItsDeviceAndSize) {
+    std::istringstream cache{"10de:2684:2280000 1920 1080 yuvRgba 16 8 0\n"
+                             "10de:2684:2280000 1920 1080 blur 16 16 2\n"};
+    fd::KernelConfigs configs{};
+    FD_EXPECT(fd::KernelAutotuner::parse_cache(cache, DEVICE, 1920, 1080, accept_all, configs));
+    FD_EXPECT(same(configs.yuvRgba, {16, 8, 0}));
+    FD_EXPECT(same(configs.blur, {16, 16, 2}));
+    FD_EXPECT(same(configs.temporal, fd::KernelConfigs{}.temporal));
+}
+
+FD_TEST(KernelAutotuner, IgnoresOtherDevicesAndSizes) {
+    std::istringstream cache{"10de:2684:2270000 1920 1080 yuvRgba 16 8 0\n"
+                             "10de:2684:2280000 1280 720 blur 16 16 2\n"
+                             "10de:2684:2280000 1920 1080 yuvRgba 32 8 0\n"};
+    fd::KernelConfigs configs{};
+    FD_EXPECT(!fd::KernelAutotuner::parse_cache(cache, DEVICE, 1920, 1080, accept_all, configs));
+    FD_EXPECT(same(configs.yuvRgba, fd::KernelConfigs{}.yuvRgba));
+    FD_EXPECT(same(configs.blur, fd::KernelConfigs{}.blur));
+}
+
+FD_TEST(KernelAutotuner, NeedsABlurOfTheConfiguredRadius) {
+    std::istringstream cache{"10de:2684:2280000 1920 1080 yuvRgba 16 8 0\n"
+                             "10de:2684:2280000 1920 1080 blur 16 16 3\n"};
+    fd::KernelConfigs configs{};
+    FD_EXPECT(!fd::KernelAutotuner::parse_cache(cache, DEVICE, 1920, 1080, accept_all, configs));
+    FD_EXPECT(same(configs.blur, fd::KernelConfigs{}.blur));
+}
+
+FD_TEST(KernelAutotuner, DropsEntriesTheDeviceRejects) {
+    std::istringstream cache{"10de:2684:2280000 1920 1080 yuvRgba 32 32 0\n"
+                             "10de:2684:2280000 1920 1080 blur 16 16 2\n"};
+    fd::KernelConfigs configs{};
+    auto smallGroups = [](const fd::KernelConfig &config) -> bool {
+        return config.localSizeX * config.localSizeY <= 256;
+    };
+    FD_EXPECT(!fd::KernelAutotuner::parse_cache(cache, DEVICE, 1920, 1080, smallGroups, configs));
+    FD_EXPECT(same(configs.yuvRgba, fd::KernelConfigs{}.yuvRgba));
+}
+
+FD_TEST(KernelAutotuner, SkipsMalformedAndEmptyShapes) {
+    std::istringstream cache{"not a cache line\n"
+                             "10de:2684:2280000 1920 1080 yuvRgba 0 8 0\n"
+                             "10de:2684:2280000 1920 1080 blur 16\n"
+                             "10de:2684:2280000 1920 1080 yuvRgba 8 16 0\n"
+                             "10de:2684:2280000 1920 1080 blur 16 8 2\n"};
+    fd::KernelConfigs configs{};
+    FD_EXPECT(fd::KernelAutotuner::parse_cache(cache, DEVICE, 1920, 1080, accept_all, configs));
+    FD_EXPECT(same(configs.yuvRgba, {8, 16, 0}));
+    FD_EXPECT(same(configs.blur, {16, 8, 2}));
+}
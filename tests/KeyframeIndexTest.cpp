@@ -0,0 +1,104 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "TestHarness.h"
+#include "KeyframeIndex.h"
+
+namespace {
+    // Not a container FFmpeg can open, a rejected cache leaves the index empty instead of rescanning into it.
+    std::string write_media(const char *name) {
+        std::string path = (std::filesystem::temp_directory_path() / name).string();
+        std::ofstream media{path, std::ios::binary | std::ios::trunc};
+        std::string filler(4096, 'x');
+        media << filler;
+        return path;
+    }
+
+    // The cache layout of KeyframeIndex::save_cache, count can claim more entries than are written.
+    void write_cache(const std::string &mediaPath, uint64_t mediaSize, int32_t stream,
+                     const std::vector<fd::KeyframeEntry> &entries, uint64_t count) {
+        std::ofstream cache{mediaPath + ".fdidx", std::ios::binary | std::ios::trunc};
+        uint32_t magic = 0x58494446;
+        uint32_t version = 1;
+        cache.write(reinterpret_cast<const char *>(&magic), sizeof(magic));
+        cache.write(reinterpret_cast<const char *>(&version), sizeof(version));
+        cache.write(reinterpret_cast<const char *>(&mediaSize), sizeof(mediaSize));
+        cache.write(reinterpret_cast<const char *>(&stream), sizeof(stream));
+        cache.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        cache.write(reinterpret_cast<const char *>(entries.data()),
+                    static_cast<std::streamsize>(entries.size() * sizeof(fd::KeyframeEntry)));
+    }
+
+    void remove_media(const std::string &mediaPath) {
+        std::remove((mediaPath + ".fdidx").c_str());
+        std::remove(mediaPath.c_str());
+    }
+
+    const std::vector<fd::KeyframeEntry> ENTRIES{{0, 48}, {90000, 51200}, {180000, 102400}};
+}
+
+FD_TEST(KeyframeIndex, FindsTheLastKeyframeAtOrBefore) {
+    AVFormatContext *context = avformat_alloc_context();
+    AVStream *stream = avformat_new_stream(context, nullptr);
+    // Out of order on purpose, only the keyframes make it into the index.
+    av_add_index_entry(stream, 102400, 180000, 1000, 0, AVINDEX_KEYFRAME);
+    av_add_index_entry(stream, 48, 0, 1000, 0, AVINDEX_KEYFRAME);
+    av_add_index_entry(stream, 60000, 120000, 1000, 0, 0);
+    av_add_index_entry(stream, 51200, 90000, 1000, 0, AVINDEX_KEYFRAME);
+    fd::KeyframeIndex index{};
+    FD_EXPECT(index.load_from_container(stream));
+    FD_EXPECT(index.is_ready());
+    FD_EXPECT(index.size() == 3);
+    fd::KeyframeEntry entry{};
+    FD_EXPECT(index.keyframe_at_or_before(90000, entry) && entry.pos == 51200);
+    FD_EXPECT(index.keyframe_at_or_before(179999, entry) && entry.pts == 90000);
+    FD_EXPECT(index.keyframe_at_or_before(1000000, entry) && entry.pts == 180000);
+    FD_EXPECT(!index.keyframe_at_or_before(-1, entry));
+    avformat_free_context(context);
+}
+
+FD_TEST(KeyframeIndex, EmptyIndexFindsNothing) {
+    fd::KeyframeIndex index{};
+    fd::KeyframeEntry entry{};
+    FD_EXPECT(!index.keyframe_at_or_before(0, entry));
+    FD_EXPECT(!index.is_ready());
+}
+
+FD_TEST(KeyframeIndex, LoadsAMatchingCache) {
+    std::string media = write_media("fd_keyframe_index_cached.media");
+    write_cache(media, 4096, 0, ENTRIES, ENTRIES.size());
+    fd::KeyframeIndex index{};
+    index.load_from_file(media, 0);
+    remove_media(media);
+    FD_EXPECT(index.is_ready());
+    FD_EXPECT(index.size() == ENTRIES.size());
+    fd::KeyframeEntry entry{};
+    FD_EXPECT(index.keyframe_at_or_before(100000, entry) && entry.pos == 51200);
+}
+
+FD_TEST(KeyframeIndex, IgnoresACacheOfAnotherFileOrStream) {
+    std::string media = write_media("fd_keyframe_index_stale.media");
+    fd::KeyframeIndex resized{};
+    write_cache(media, 8192, 0, ENTRIES, ENTRIES.size());
+    resized.load_from_file(media, 0);
+    fd::KeyframeIndex otherStream{};
+    write_cache(media, 4096, 1, ENTRIES, ENTRIES.size());
+    otherStream.load_from_file(media, 0);
+    remove_media(media);
+    FD_EXPECT(resized.size() == 0);
+    FD_EXPECT(otherStream.size() == 0);
+}
+
+FD_TEST(KeyframeIndex, IgnoresATruncatedCache) {
+    std::string media = write_media("fd_keyframe_index_truncated.media");
+    write_cache(media, 4096, 0, ENTRIES, 1000000);
+    fd::KeyframeIndex index{};
+    index.load_from_file(media, 0);
+    remove_media(media);
+    FD_EXPECT(index.size() == 0);
+}
@@ -0,0 +1,70 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TestHarness.h"
+#include "Util.h"
+
+namespace {
+    std::vector<std::string> logged{};
+}
+
+// Stands in for LOG_WARN and friends so the test sees what the macro would have logged.
+#define FD_TEST_LOG(M, ...) logged.push_back(fmt::format(M, ##__VA_ARGS__))
+
+FD_TEST(LogRateLimiter, AllowsTheFirstMessage) {
+    fd::LogRateLimiter limiter{1000};
+    uint64_t suppressed = 42;
+    FD_EXPECT(limiter.allow(suppressed));
+    FD_EXPECT(suppressed == 0);
+}
+
+FD_TEST(LogRateLimiter, SuppressesWithinTheInterval) {
+    fd::LogRateLimiter limiter{60000};
+    uint64_t suppressed = 0;
+    FD_EXPECT(limiter.allow(suppressed));
+    FD_EXPECT(!limiter.allow(suppressed));
+    FD_EXPECT(!limiter.allow(suppressed));
+}
+
+FD_TEST(LogRateLimiter, ReportsTheSuppressedCountAfterTheInterval) {
+    fd::LogRateLimiter limiter{20};
+    uint64_t suppressed = 0;
+    FD_EXPECT(limiter.allow(suppressed));
+    FD_EXPECT(!limiter.allow(suppressed));
+    FD_EXPECT(!limiter.allow(suppressed));
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    FD_EXPECT(limiter.allow(suppressed));
+    FD_EXPECT(suppressed == 2);
+}
+
+FD_TEST(LogRateLimiter, LetsOneOfManyThreadsThrough) {
+    fd::LogRateLimiter limiter{60000};
+    std::atomic<int> allowed{0};
+    std::vector<std::thread> threads{};
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&limiter, &allowed]() {
+            for (int j = 0; j < 1000; j++) {
+                uint64_t suppressed = 0;
+                if (limiter.allow(suppressed)) allowed++;
+            }
+        });
+    }
+    for (std::thread &thread: threads) thread.join();
+    FD_EXPECT(allowed == 1);
+}
+
+FD_TEST(LogRateLimiter, MacroLimitsEachCallSiteOnItsOwn) {
+    logged.clear();
+    for (int i = 0; i < 5; i++) {
+        FD_LOG_EVERY_MS(FD_TEST_LOG, 60000, "first site {}", i);
+        FD_LOG_EVERY_MS(FD_TEST_LOG, 60000, "second site");
+    }
+    FD_EXPECT(logged.size() == 2);
+    FD_EXPECT(logged[0] == "first site 0 [0 suppressed]");
+    FD_EXPECT(logged[1] == "second site [0 suppressed]");
+}
@@ -0,0 +1,65 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include "TestHarness.h"
+#include "MasterClock.h"
+
+namespace {
+    // A power of two duration keeps the boundary cases exact.
+    constexpr double FRAME = 1.0 / 32.0;
+    // Wall time that passes between a clock update and the read in the test.
+    constexpr double SLACK = 0.05;
+}
+
+FD_TEST(MasterClock, DropsLateFramesOnlyWhenANewerOneIsQueued) {
+    FD_EXPECT(fd::MasterClock::decide_frame(1.0, 1.0 + 2 * FRAME, FRAME, true, true) == fd::FrameDecision::DROP);
+    FD_EXPECT(fd::MasterClock::decide_frame(1.0, 1.0 + 2 * FRAME, FRAME, false, true) == fd::FrameDecision::SHOW);
+    // Exactly one frame late is still shown.
+    FD_EXPECT(fd::MasterClock::decide_frame(1.0, 1.0 + FRAME, FRAME, true, true) == fd::FrameDecision::SHOW);
+}
+
+FD_TEST(MasterClock, RepeatsWhileEarlyOnceSomethingIsShown) {
+    FD_EXPECT(fd::MasterClock::decide_frame(1.0 + 2 * FRAME, 1.0, FRAME, true, true) == fd::FrameDecision::REPEAT);
+    // The first frame goes up however early it is, the cell would stay empty otherwise.
+    FD_EXPECT(fd::MasterClock::decide_frame(1.0 + 2 * FRAME, 1.0, FRAME, true, false) == fd::FrameDecision::SHOW);
+    FD_EXPECT(fd::MasterClock::decide_frame(1.0 + FRAME / 2, 1.0, FRAME, true, true) == fd::FrameDecision::SHOW);
+}
+
+FD_TEST(MasterClock, ParsesTheClockSource) {
+    FD_EXPECT(fd::MasterClock::parse_source("video") == fd::ClockSource::VIDEO);
+    FD_EXPECT(fd::MasterClock::parse_source("external") == fd::ClockSource::EXTERNAL);
+    FD_EXPECT(fd::MasterClock::parse_source("audio") == fd::ClockSource::AUDIO);
+    FD_EXPECT(fd::MasterClock::parse_source(nullptr) == fd::ClockSource::AUDIO);
+    FD_EXPECT(fd::MasterClock::parse_source("wall") == fd::ClockSource::AUDIO);
+}
+
+FD_TEST(MasterClock, AudioFallsBackToExternalUntilSamplesArePlayed) {
+    fd::MasterClock clock{fd::ClockSource::AUDIO};
+    clock.start_external(5.0);
+    FD_EXPECT_NEAR(clock.now(), 5.0, SLACK);
+    clock.start_audio(10.0, 48000);
+    FD_EXPECT_NEAR(clock.now(), 5.0, SLACK);
+}
+
+FD_TEST(MasterClock, AudioCountsOnlyPlayedSamples) {
+    fd::MasterClock clock{fd::ClockSource::AUDIO};
+    clock.start_audio(10.0, 48000);
+    // 100 ms written, 50 ms of it still queued in the device.
+    clock.on_audio_written(4800, 2400);
+    double now = clock.now();
+    FD_EXPECT(now >= 10.05);
+    FD_EXPECT(now <= 10.1);
+}
+
+FD_TEST(MasterClock, SeekReanchorsEveryClock) {
+    fd::MasterClock clock{fd::ClockSource::VIDEO};
+    clock.start_external(0.0);
+    clock.on_video_shown(3.0);
+    FD_EXPECT_NEAR(clock.video_time(), 3.0, SLACK);
+    clock.seek(42.0);
+    FD_EXPECT_NEAR(clock.video_time(), 42.0, SLACK);
+    FD_EXPECT_NEAR(clock.external_time(), 42.0, SLACK);
+    // Writes reported for samples queued before the seek don't move the audio clock.
+    clock.on_audio_written(4800, 0);
+    FD_EXPECT_NEAR(clock.audio_time(), 42.0, SLACK);
+}
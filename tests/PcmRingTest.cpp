@@ -0,0 +1,91 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "TestHarness.h"
+#include "audio/PcmRing.h"
+
+FD_TEST(PcmRing, RoundsTheCapacityUpToAPowerOfTwo) {
+    fd::PcmRing ring{1000, 2};
+    FD_EXPECT(ring.capacity() == 1024);
+    FD_EXPECT(ring.channels() == 2);
+    FD_EXPECT(ring.readable_frames() == 0);
+    FD_EXPECT(ring.writable_frames() == 1024);
+}
+
+FD_TEST(PcmRing, WritesOnlyWhatFits) {
+    fd::PcmRing ring{4, 2};
+    std::vector<int16_t> samples{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    FD_EXPECT(ring.write(samples.data(), 5) == 4);
+    FD_EXPECT(ring.writable_frames() == 0);
+    FD_EXPECT(ring.write(samples.data(), 1) == 0);
+}
+
+FD_TEST(PcmRing, PeeksAWrappedRunInTwoParts) {
+    fd::PcmRing ring{4, 1};
+    std::vector<int16_t> first{1, 2, 3};
+    std::vector<int16_t> second{4, 5, 6};
+    ring.write(first.data(), 3);
+    ring.consume(3);
+    FD_EXPECT(ring.write(second.data(), 3) == 3);
+    const int16_t *samples = nullptr;
+    FD_EXPECT(ring.peek(samples, 8) == 1);
+    FD_EXPECT(samples[0] == 4);
+    ring.consume(1);
+    FD_EXPECT(ring.peek(samples, 8) == 2);
+    FD_EXPECT(samples[0] == 5 && samples[1] == 6);
+    ring.consume(2);
+    FD_EXPECT(ring.readable_frames() == 0);
+}
+
+FD_TEST(PcmRing, PeekIsBoundedByTheRequest) {
+    fd::PcmRing ring{8, 2};
+    std::vector<int16_t> samples{1, -1, 2, -2, 3, -3};
+    ring.write(samples.data(), 3);
+    const int16_t *peeked = nullptr;
+    FD_EXPECT(ring.peek(peeked, 2) == 2);
+    FD_EXPECT(peeked[2] == 2 && peeked[3] == -2);
+    FD_EXPECT(ring.readable_frames() == 3);
+}
+
+FD_TEST(PcmRing, ClearDropsEverythingQueued) {
+    fd::PcmRing ring{8, 1};
+    std::vector<int16_t> samples{1, 2, 3, 4, 5};
+    ring.write(samples.data(), 5);
+    ring.clear();
+    FD_EXPECT(ring.readable_frames() == 0);
+    FD_EXPECT(ring.writable_frames() == 8);
+}
+
+FD_TEST(PcmRing, KeepsOrderBetweenAProducerAndAConsumerThread) {
+    constexpr int16_t FRAMES = 30000;
+    fd::PcmRing ring{256, 2};
+    std::thread producer{[&ring]() -> void {
+        std::vector<int16_t> block{};
+        for (int16_t next = 0; next < FRAMES;) {
+            ring.wait_for_space(1, std::chrono::milliseconds{10});
+            int16_t count = std::min<int16_t>(static_cast<int16_t>(FRAMES - next), 37);
+            block.clear();
+            for (int16_t i = 0; i < count; i++) {
+                block.push_back(static_cast<int16_t>(next + i));
+                block.push_back(static_cast<int16_t>(-(next + i)));
+            }
+            next = static_cast<int16_t>(next + ring.write(block.data(), count));
+        }
+    }};
+    bool ordered = true;
+    for (int16_t expected = 0; expected < FRAMES;) {
+        const int16_t *samples = nullptr;
+        uint32_t frames = ring.peek(samples, 53);
+        for (uint32_t i = 0; i < frames; i++, expected++) {
+            ordered = ordered && samples[2 * i] == expected && samples[2 * i + 1] == -expected;
+        }
+        ring.consume(frames);
+        if (frames == 0) std::this_thread::yield();
+    }
+    producer.join();
+    FD_EXPECT(ordered);
+    FD_EXPECT(ring.readable_frames() == 0);
+}
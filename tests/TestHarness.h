@@ -0,0 +1,52 @@
+//
+// Created by ghima on 19-10-2026.
+//
+
+#ifndef REALTIMEFRAMEDISPLAY_TESTHARNESS_H
+#define REALTIMEFRAMEDISPLAY_TESTHARNESS_H
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fd::test {
+    using TestFunction = void (*)();
+
+    struct TestCase {
+        const char *suite;
+        const char *name;
+        TestFunction function;
+    };
+
+    // Every FD_TEST registers itself here before main runs.
+    std::vector<TestCase> &registry();
+
+    struct Registrar {
+        Registrar(const char *suite, const char *name, TestFunction function) {
+            registry().push_back({suite, name, function});
+        }
+    };
+
+    struct TestFailure : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    [[noreturn]] inline void fail(const char *file, int line, const char *expression) {
+        throw TestFailure(std::string{file} + ":" + std::to_string(line) + ": expected " + expression);
+    }
+}
+
+#define FD_TEST(suite, name)                                                                                    \
+    static void suite##_##name();                                                                               \
+    static const fd::test::Registrar suite##_##name##_registrar{#suite, #name, &suite##_##name};                \
+    static void suite##_##name()
+
+// Ends the test at the first failed expectation, the runner reports it and moves on to the next test.
+#define FD_EXPECT(condition) do {                                                                               \
+        if (!(condition)) fd::test::fail(__FILE__, __LINE__, #condition);                                       \
+    } while (false)
+
+#define FD_EXPECT_NEAR(value, expected, tolerance) FD_EXPECT(std::abs((value) - (expected)) <= (tolerance))
+
+#endif //REALTIMEFRAMEDISPLAY_TESTHARNESS_H
@@ -0,0 +1,35 @@
+//
+// Created by ghima on 19-10-2026.
+//
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include "TestHarness.h"
+
+namespace fd::test {
+    std::vector<TestCase> &registry() {
+        static std::vector<TestCase> tests{};
+        return tests;
+    }
+}
+
+// Runs the suite named by the first argument, or every suite without one. Fails when nothing matched so a renamed
+// suite can't pass by running no tests.
+int main(int argc, char **argv) {
+    const char *suite = argc > 1 ? argv[1] : nullptr;
+    int run = 0;
+    int failed = 0;
+    for (const fd::test::TestCase &test: fd::test::registry()) {
+        if (suite != nullptr && std::strcmp(suite, test.suite) != 0) continue;
+        run++;
+        try {
+            test.function();
+            std::cout << "[ ok ] " << test.suite << "." << test.name << std::endl;
+        } catch (const std::exception &error) {
+            failed++;
+            std::cout << "[FAIL] " << test.suite << "." << test.name << " " << error.what() << std::endl;
+        }
+    }
+    std::cout << run - failed << " of " << run << " tests passed" << std::endl;
+    return run == 0 || failed > 0 ? 1 : 0;
+}